@@ -0,0 +1,167 @@
+// Query Arena Benchmark
+//
+// Usage: bench_arena [documents] [seconds]
+//
+// Multi-threaded load test of TermScorer with its per-query scratch on the
+// heap (std::allocator) and in a per-query SL::arena recycling blocks
+// through a thread-local pool. Each thread runs two-term and three-term
+// top 10 queries back to back over a synthetic corpus of 200-term
+// documents for the given seconds per run. Reports queries per second,
+// latency percentiles and allocator calls per query (operator new and
+// new[], plus blocks the arena took from malloc or mmap) for 1, 4 and 16
+// threads.
+
+#include "scoring.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <thread>
+
+using namespace SE;
+using SE::bench::make_corpus;
+using SE::bench::seconds_since;
+
+std::atomic<unsigned long> allocations(0);
+
+// malloc and free behind calls the compiler cannot see through, as in
+// SL/test_util.h: inlined into operator delete, the free() is reported by
+// -Wmismatched-new-delete against every new in the program
+__attribute__((noinline)) void* system_allocate(std::size_t bytes) {
+	return std::malloc(bytes ? bytes : 1);
+}
+
+__attribute__((noinline)) void system_free(void* ptr) {
+	std::free(ptr);
+}
+
+void* operator new(std::size_t bytes) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = system_allocate(bytes);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t bytes) {
+	return operator new(bytes);
+}
+
+void operator delete(void* ptr) noexcept {
+	system_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	operator delete(ptr);
+}
+
+std::vector<std::vector<std::string>> make_queries(unsigned long seed, unsigned long count);
+template<class Search>
+void run(const char* scratch, unsigned long threads, double seconds, Search search);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 50000;
+	double seconds = argc > 2 ? std::stod(argv[2]) : 2;
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "se_bench_arena";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	DocStoreBuilder docs;
+	{
+		std::vector<std::vector<std::string>> corpus = make_corpus(documents);
+		IndexBuilder builder(root.string());
+		for (unsigned long d = 0; d < corpus.size(); d++) {
+			builder.add(corpus[d]);
+			docs.add("http://example.com/" + std::to_string(d), corpus[d].size(), 1.0f, 0);
+		}
+		builder.finish();
+	}
+	InvertedIndex index(root.string());
+	DocStore store = docs.build();
+	TermScorer<BM25<>> scorer(index, store);
+
+	printf("%-8s %8s %10s %10s %10s %10s %10s %12s\n", "scratch", "threads", "queries/s", "p50 us", "p99 us",
+			"p999 us", "max us", "allocs/query");
+	for (unsigned long threads : { 1, 4, 16 }) {
+		run("heap", threads, seconds, [&](const std::vector<std::string> &query) {
+			return scorer.search(query, 10, std::allocator<char>());
+		});
+		run("arena", threads, seconds, [&](const std::vector<std::string> &query) {
+			return scorer.search(query, 10);
+		});
+	}
+
+	printf("\n%lu documents\n", documents);
+	std::filesystem::remove_all(root);
+	return 0;
+}
+
+// Helper Functions
+
+std::vector<std::vector<std::string>> make_queries(unsigned long seed, unsigned long count) {
+	std::mt19937_64 rng(seed);
+	std::vector<std::vector<std::string>> queries(count);
+	for (std::vector<std::string> &query : queries) {
+		for (unsigned long t = 0; t < 2 + rng() % 2; t++) {
+			query.push_back("t" + std::to_string((rng() % 50000) * (rng() % 50000) / 50000));
+		}
+	}
+	return queries;
+}
+
+// Closed loop over queries made up front, so only search allocates
+template<class Search>
+void run(const char* scratch, unsigned long threads, double seconds, Search search) {
+	std::vector<std::vector<double>> latencies(threads);
+	std::vector<std::vector<std::vector<std::string>>> queries;
+	for (unsigned long t = 0; t < threads; t++) {
+		queries.push_back(make_queries(t + 1, 4096));
+		latencies[t].reserve(1 << 20);
+	}
+	std::vector<std::thread> workers;
+	unsigned long allocated = allocations.load() + SL::arena::stats().system_blocks;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long t = 0; t < threads; t++) {
+		workers.emplace_back([&, t]() {
+			unsigned long hits = 0;
+			for (unsigned long q = 0; seconds_since(start) < seconds; q++) {
+				auto sent = std::chrono::steady_clock::now();
+				hits += search(queries[t][q % queries[t].size()]).size();
+				if (latencies[t].size() < latencies[t].capacity()) {
+					latencies[t].push_back(seconds_since(sent));
+				}
+			}
+			if (hits == 0) {
+				printf("no hits\n");
+			}
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	double elapsed = seconds_since(start);
+	allocated = allocations.load() + SL::arena::stats().system_blocks - allocated;
+
+	std::vector<double> all;
+	for (unsigned long t = 0; t < threads; t++) {
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+	}
+	std::sort(all.begin(), all.end());
+	unsigned long n = all.size();
+	printf("%-8s %8lu %10.0f %10.1f %10.1f %10.1f %10.1f %12.2f\n", scratch, threads, n / elapsed, all[n / 2] * 1e6,
+			all[std::min(n - 1, n * 99 / 100)] * 1e6, all[std::min(n - 1, n * 999 / 1000)] * 1e6, all[n - 1] * 1e6,
+			(double) allocated / n);
+}
@@ -0,0 +1,141 @@
+// Dedupe Benchmark
+//
+// Usage: bench_dedupe [documents] [duplicate percent]
+//
+// Generates a corpus of 200-2000 word documents in which the given share
+// are copies of an earlier document with 0-5 words changed, fingerprints
+// every document with MinHasher and feeds the signatures to a
+// DuplicateDetector. Reports fingerprint throughput, detection throughput
+// and recall/precision against the known copies. For comparison it times
+// the seeded hashes one seed at a time; bench_dedupe_avx2 is the same
+// benchmark built with the eight-seed AVX2 path.
+
+#include "dedupe.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <random>
+
+using namespace SE;
+using SE::bench::seconds_since;
+
+std::vector<std::vector<std::string>> make_corpus(unsigned long documents, unsigned long percent,
+		std::vector<unsigned long> &original);
+void scalar_signature(const MinHasher &hasher, const uint32_t* shingles, unsigned long n, uint32_t* out);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 20000;
+	unsigned long percent = argc > 2 ? std::stoul(argv[2]) : 20;
+
+	std::vector<unsigned long> original;
+	std::vector<std::vector<std::string>> corpus = make_corpus(documents, percent, original);
+	unsigned long terms = 0;
+	for (const std::vector<std::string> &words : corpus) {
+		terms += words.size();
+	}
+	printf("%lu documents, %.1f M terms, %lu%% near-duplicates\n\n", documents, terms / 1e6, percent);
+
+	MinHasher hasher;
+	std::vector<std::vector<uint32_t>> signatures(documents);
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long d = 0; d < documents; d++) {
+		hasher.signature(corpus[d], signatures[d]);
+	}
+	double signature_seconds = seconds_since(start);
+
+	// The seeded hashes alone, vectorized and not, over shingles of the terms
+	std::vector<uint32_t> shingles;
+	for (unsigned long d = 0; d < documents && shingles.size() < 2000000; d++) {
+		for (const std::string &term : corpus[d]) {
+			shingles.push_back(term_hash(term.data(), term.size()));
+		}
+	}
+	std::vector<uint32_t> fast(hasher.size()), slow(hasher.size());
+	start = std::chrono::steady_clock::now();
+	for (unsigned long at = 0; at < shingles.size(); at += 1000) {
+		hasher.signature(&shingles[at], std::min(1000UL, shingles.size() - at), fast.data());
+	}
+	double fast_seconds = seconds_since(start);
+	start = std::chrono::steady_clock::now();
+	for (unsigned long at = 0; at < shingles.size(); at += 1000) {
+		scalar_signature(hasher, &shingles[at], std::min(1000UL, shingles.size() - at), slow.data());
+	}
+	double slow_seconds = seconds_since(start);
+	if (fast != slow) {
+		printf("Signatures differ!\n");
+		return 1;
+	}
+
+	DuplicateDetector detector;
+	std::vector<unsigned long> canonical(documents);
+	start = std::chrono::steady_clock::now();
+	for (unsigned long d = 0; d < documents; d++) {
+		unsigned long id = detector.add(std::to_string(d), signatures[d]);
+		canonical[d] = id == DuplicateDetector::NOT_DUPLICATE ? d : std::stoul(detector.url(id));
+	}
+	double detect_seconds = seconds_since(start);
+
+	unsigned long copies = 0, found = 0, wrong = 0;
+	for (unsigned long d = 0; d < documents; d++) {
+		copies += original[d] != d;
+		if (canonical[d] != d) {
+			found += original[d] == canonical[d];
+			wrong += original[d] != canonical[d];
+		}
+	}
+
+	printf("%-32s %12s %12s\n", "step", "docs/s", "M terms/s");
+	printf("%-32s %12.0f %12.2f\n", "signature()", documents / signature_seconds, terms / signature_seconds / 1e6);
+	printf("%-32s %12.0f %12s\n\n", "DuplicateDetector add()", documents / detect_seconds, "-");
+	printf("%-32s %12s\n", "seeded hashes", "M shingles/s");
+#ifdef __AVX2__
+	printf("%-32s %12.2f\n", "signature() (AVX2)", shingles.size() / fast_seconds / 1e6);
+#else
+	printf("%-32s %12.2f\n", "signature() (scalar build)", shingles.size() / fast_seconds / 1e6);
+#endif
+	printf("%-32s %12.2f\n\n", "one seed at a time", shingles.size() / slow_seconds / 1e6);
+
+	printf("dedupe rate %.1f%% (%lu of %lu documents), recall %.1f%%, wrong canonical %lu, %lu candidates checked\n",
+			100.0 * detector.stats().duplicates / documents, detector.stats().duplicates, documents,
+			copies ? 100.0 * found / copies : 100.0, wrong, detector.stats().candidates);
+	printf("detector memory %.1f MB\n", detector.memory_bytes() / 1e6);
+	return 0;
+}
+
+// Helper Functions
+
+// original[d] is d for a fresh document, else the document d copies
+std::vector<std::vector<std::string>> make_corpus(unsigned long documents, unsigned long percent,
+		std::vector<unsigned long> &original) {
+	std::mt19937_64 rng(1);
+	std::vector<std::vector<std::string>> corpus(documents);
+	original.resize(documents);
+	for (unsigned long d = 0; d < documents; d++) {
+		original[d] = d;
+		if (d > 0 && rng() % 100 < percent) {
+			unsigned long source = original[rng() % d];
+			original[d] = source;
+			corpus[d] = corpus[source];
+			for (unsigned long e = 0, n = rng() % 6; e < n; e++) {
+				corpus[d][rng() % corpus[d].size()] = "edit" + std::to_string(rng() % 1000);
+			}
+			continue;
+		}
+		for (unsigned long i = 0, n = 200 + rng() % 1800; i < n; i++) {
+			corpus[d].push_back("w" + std::to_string((rng() % 20000) * (rng() % 20000) / 20000));
+		}
+	}
+	return corpus;
+}
+
+void scalar_signature(const MinHasher &hasher, const uint32_t* shingles, unsigned long n, uint32_t* out) {
+	for (unsigned long s = 0; s < hasher.size(); s++) {
+		uint32_t min = 0xFFFFFFFFU;
+		for (unsigned long i = 0; i < n; i++) {
+			uint32_t h = MinHasher::mix(shingles[i] ^ hasher.seeds()[s]);
+			min = h < min ? h : min;
+		}
+		out[s] = min;
+	}
+}
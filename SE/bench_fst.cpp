@@ -0,0 +1,238 @@
+// FST Benchmark
+//
+// Usage: bench_fst [terms] [queries]
+//
+// Builds a term dictionary of pronounceable pseudo-words two ways, as an
+// FST and as an std::unordered_map<std::string, uint32_t>, and compares
+// their memory (the map's measured through a counting allocator) and
+// exact lookup times. Then times fuzzy expansion of misspelled terms
+// within 1 and 2 edits on the FST against a scan of the vocabulary.
+
+#include "fst.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <unordered_map>
+
+using namespace SE;
+using SE::bench::seconds_since;
+
+unsigned long allocated = 0;
+
+template<class T>
+struct CountingAllocator {
+	typedef T value_type;
+
+	CountingAllocator() {}
+	template<class U>
+	CountingAllocator(const CountingAllocator<U> &) {}
+
+	T* allocate(std::size_t n) {
+		allocated += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		allocated -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template<class U>
+	bool operator==(const CountingAllocator<U> &) const {
+		return true;
+	}
+
+	template<class U>
+	bool operator!=(const CountingAllocator<U> &) const {
+		return false;
+	}
+};
+
+typedef std::basic_string<char, std::char_traits<char>, CountingAllocator<char>> CountedString;
+
+struct CountedHash {
+	std::size_t operator()(const CountedString &s) const {
+		return std::hash<std::string_view>()(std::string_view(s.data(), s.size()));
+	}
+};
+
+typedef std::unordered_map<CountedString, uint32_t, CountedHash, std::equal_to<CountedString>,
+		CountingAllocator<std::pair<const CountedString, uint32_t>>> CountedMap;
+
+std::vector<std::string> make_vocabulary(unsigned long terms);
+std::string misspell(const std::string &term, std::mt19937_64 &rng);
+unsigned long edit_distance(const std::string &a, const std::string &b, unsigned long limit);
+
+
+int main(int argc, char** argv) {
+	unsigned long terms = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	unsigned long queries = argc > 2 ? std::stoul(argv[2]) : 200;
+
+	std::vector<std::string> vocabulary = make_vocabulary(terms);
+	unsigned long characters = 0;
+	for (const std::string &term : vocabulary) {
+		characters += term.size();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	FstBuilder builder;
+	for (unsigned long i = 0; i < vocabulary.size(); i++) {
+		builder.add(vocabulary[i], i);
+	}
+	Fst fst(builder.finish());
+	double build_seconds = seconds_since(start);
+
+	CountedMap map;
+	for (unsigned long i = 0; i < vocabulary.size(); i++) {
+		map.emplace(CountedString(vocabulary[i].data(), vocabulary[i].size()), (uint32_t) i);
+	}
+
+	printf("%lu terms, %.1f MB of characters; FST built in %.2f s\n\n", vocabulary.size(), characters / 1e6,
+			build_seconds);
+	printf("%-28s %12s %12s\n", "dictionary", "MB", "bytes/term");
+	printf("%-28s %12.2f %12.1f\n", "FST", fst.data().size() / 1e6, (double) fst.data().size() / vocabulary.size());
+	printf("%-28s %12.2f %12.1f\n\n", "unordered_map<string, id>", allocated / 1e6,
+			(double) allocated / vocabulary.size());
+
+	// Exact lookups of every term in a shuffled order
+	std::mt19937_64 rng(2);
+	std::vector<std::string> lookups(vocabulary);
+	std::shuffle(lookups.begin(), lookups.end(), rng);
+	lookups.resize(std::min(lookups.size(), 200000UL));
+	std::vector<CountedString> counted_lookups;
+	for (const std::string &term : lookups) {
+		counted_lookups.emplace_back(term.data(), term.size());
+	}
+
+	uint64_t sum = 0, value;
+	start = std::chrono::steady_clock::now();
+	for (const std::string &term : lookups) {
+		sum += fst.get(term, value) ? value : 0;
+	}
+	double fst_ns = seconds_since(start) / lookups.size() * 1e9;
+	start = std::chrono::steady_clock::now();
+	for (const CountedString &term : counted_lookups) {
+		sum -= map.find(term)->second;
+	}
+	double map_ns = seconds_since(start) / lookups.size() * 1e9;
+	if (sum != 0) {
+		printf("Lookups disagree!\n");
+		return 1;
+	}
+	printf("%-28s %12s\n", "exact lookup", "ns");
+	printf("%-28s %12.0f\n", "FST", fst_ns);
+	printf("%-28s %12.0f\n\n", "unordered_map", map_ns);
+
+	printf("%-28s %12s %12s %12s\n", "fuzzy expansion", "edits", "us/query", "terms/query");
+	for (unsigned long edits = 1; edits <= 2; edits++) {
+		std::vector<std::string> typos;
+		for (unsigned long q = 0; q < queries; q++) {
+			typos.push_back(misspell(vocabulary[rng() % vocabulary.size()], rng));
+		}
+
+		unsigned long fst_found = 0;
+		start = std::chrono::steady_clock::now();
+		for (const std::string &typo : typos) {
+			fst.fuzzy(typo, edits, [&](const std::string&, uint64_t, unsigned long) {
+				fst_found++;
+			});
+		}
+		double fst_us = seconds_since(start) / queries * 1e6;
+
+		unsigned long scan_found = 0;
+		start = std::chrono::steady_clock::now();
+		for (const std::string &typo : typos) {
+			for (const std::string &term : vocabulary) {
+				scan_found += edit_distance(typo, term, edits) <= edits;
+			}
+		}
+		double scan_us = seconds_since(start) / queries * 1e6;
+		if (fst_found != scan_found) {
+			printf("Fuzzy results disagree: %lu vs %lu!\n", fst_found, scan_found);
+			return 1;
+		}
+		printf("%-28s %12lu %12.1f %12.1f\n", "FST", edits, fst_us, (double) fst_found / queries);
+		printf("%-28s %12lu %12.1f %12.1f\n", "vocabulary scan", edits, scan_us, (double) scan_found / queries);
+	}
+
+	return 0;
+}
+
+// Helper Functions
+
+// One to four syllables with common endings, sorted and unique
+std::vector<std::string> make_vocabulary(unsigned long terms) {
+	const char* onsets[] = { "b", "br", "c", "ch", "d", "f", "g", "gr", "h", "k", "l", "m", "n", "p", "pl", "r", "s",
+			"sh", "st", "t", "th", "tr", "v", "w" };
+	const char* vowels[] = { "a", "e", "i", "o", "u", "ai", "ea", "ou" };
+	const char* codas[] = { "", "", "n", "r", "s", "t", "l", "ck", "nd" };
+	const char* endings[] = { "", "", "", "s", "ed", "ing", "er", "ly", "tion" };
+
+	std::mt19937_64 rng(1);
+	std::set<std::string> words;
+	while (words.size() < terms) {
+		std::string word;
+		unsigned long syllables = 1 + rng() % 4;
+		for (unsigned long s = 0; s < syllables; s++) {
+			word += onsets[rng() % 24];
+			word += vowels[rng() % 8];
+			word += codas[rng() % 9];
+		}
+		word += endings[rng() % 9];
+		words.insert(word);
+	}
+	return std::vector<std::string>(words.begin(), words.end());
+}
+
+// A substitution, deletion, insertion or transposition
+std::string misspell(const std::string &term, std::mt19937_64 &rng) {
+	std::string typo = term;
+	unsigned long at = rng() % typo.size();
+	switch (rng() % 4) {
+	case 0:
+		typo[at] = 'a' + rng() % 26;
+		break;
+	case 1:
+		typo.erase(at, 1);
+		break;
+	case 2:
+		typo.insert(at, 1, 'a' + rng() % 26);
+		break;
+	default:
+		if (at + 1 < typo.size()) {
+			std::swap(typo[at], typo[at + 1]);
+		}
+	}
+	return typo;
+}
+
+// Levenshtein distance, or limit + 1 once it must exceed limit
+unsigned long edit_distance(const std::string &a, const std::string &b, unsigned long limit) {
+	if ((a.size() > b.size() ? a.size() - b.size() : b.size() - a.size()) > limit) {
+		return limit + 1;
+	}
+	unsigned long row[64];
+	if (b.size() >= 64) {
+		return limit + 1;
+	}
+	for (unsigned long j = 0; j <= b.size(); j++) {
+		row[j] = j;
+	}
+	for (unsigned long i = 1; i <= a.size(); i++) {
+		unsigned long diagonal = row[0], best = i;
+		row[0] = i;
+		for (unsigned long j = 1; j <= b.size(); j++) {
+			unsigned long above = row[j];
+			row[j] = std::min(std::min(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] != b[j - 1]));
+			diagonal = above;
+			best = std::min(best, row[j]);
+		}
+		if (best > limit) {
+			return limit + 1;
+		}
+	}
+	return row[b.size()];
+}
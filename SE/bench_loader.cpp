@@ -0,0 +1,130 @@
+// Loader Benchmark
+//
+// Usage: bench_loader [files] [dir]
+//
+// Writes files of 1-8 KB, evicts them from the page cache and loads them
+// with plain blocking reads, the pread thread pool and io_uring, tokenizing
+// every file so the zero-copy hand-off is part of what is measured. The
+// LoaderSource row is the path se_server index takes: the same io_uring
+// loads plus a directory walk and a copy of each file into its Document.
+// Eviction uses posix_fadvise(DONTNEED); run as root after
+// "echo 3 > /proc/sys/vm/drop_caches" for a fully cold cache.
+
+#include "loader.h"
+#include <stdio.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+using namespace SE;
+
+void evict(const std::vector<std::string> &paths);
+double run_blocking(const std::vector<std::string> &paths, unsigned long &terms);
+double run_loader(const std::vector<std::string> &paths, bool sync, unsigned long &terms, LoaderStats &stats);
+double run_source(const std::string &root, unsigned long &terms);
+
+
+int main(int argc, char** argv) {
+	unsigned long count = argc > 1 ? std::stoul(argv[1]) : 20000;
+	std::filesystem::path root = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "se_bench_loader";
+
+	printf("Preparing %lu files in %s\n", count, root.c_str());
+	std::vector<std::string> paths;
+	std::string body;
+	for (unsigned long i = 0; i < count; i++) {
+		std::filesystem::path dir = root / std::to_string(i / 1000);
+		if (i % 1000 == 0) {
+			std::filesystem::create_directories(dir);
+		}
+		paths.push_back((dir / std::to_string(i)).string());
+		if (!std::filesystem::exists(paths.back())) {
+			body.assign(1024 + (i * 2654435761UL) % 7168, ' ');
+			for (unsigned long j = 0; j < body.size(); j += 6) {
+				body[j] = 'a' + (i + j) % 26;
+			}
+			std::ofstream(paths.back(), std::ios::binary) << body;
+		}
+	}
+
+	unsigned long terms = 0;
+	LoaderStats stats;
+
+	evict(paths);
+	double blocking = run_blocking(paths, terms);
+	printf("%-12s %8.0f files/s %10lu terms\n", "blocking", count / blocking, terms);
+
+	evict(paths);
+	double threads = run_loader(paths, true, terms, stats);
+	printf("%-12s %8.0f files/s %10lu terms %10lu syscalls  %.1fx\n", "threadpool",
+			count / threads, terms, stats.syscalls, blocking / threads);
+
+	evict(paths);
+	FileLoader probe;
+	if (probe.using_io_uring()) {
+		double uring = run_loader(paths, false, terms, stats);
+		printf("%-12s %8.0f files/s %10lu terms %10lu syscalls  %.1fx\n", "io_uring",
+				count / uring, terms, stats.syscalls, blocking / uring);
+
+		evict(paths);
+		double source = run_source(root.string(), terms);
+		printf("%-12s %8.0f files/s %10lu terms %21s %.1fx\n", "LoaderSource", count / source, terms, "",
+				blocking / source);
+	} else {
+		printf("%-12s unavailable\n", "io_uring");
+	}
+
+	return 0;
+}
+
+void evict(const std::vector<std::string> &paths) {
+	for (const std::string &path : paths) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd >= 0) {
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+	}
+}
+
+double run_blocking(const std::vector<std::string> &paths, unsigned long &terms) {
+	terms = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::string data;
+	for (const std::string &path : paths) {
+		DirectorySource::read_file(path, data);
+		tokenize(data.data(), data.size(), [&](const char*, unsigned long) { terms++; });
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double run_loader(const std::vector<std::string> &paths, bool sync, unsigned long &terms, LoaderStats &stats) {
+	LoaderOptions options;
+	options.force_sync = sync;
+	options.queue_depth = 256;
+	options.threads = 16;
+	FileLoader loader(options);
+
+	terms = 0;
+	auto start = std::chrono::steady_clock::now();
+	loader.load(paths, [&](const LoadedFile &file) {
+		tokenize(file.data, file.length, [&](const char*, unsigned long) { terms++; });
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats = loader.stats();
+	return seconds;
+}
+
+double run_source(const std::string &root, unsigned long &terms) {
+	LoaderOptions options;
+	options.queue_depth = 256;
+	LoaderSource source(root, options);
+
+	terms = 0;
+	auto start = std::chrono::steady_clock::now();
+	Document doc;
+	while (source.next(doc)) {
+		tokenize(doc.raw.data(), doc.raw.size(), [&](const char*, unsigned long) { terms++; });
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,135 @@
+// Phrase Benchmark
+//
+// Usage: bench_phrase [documents] [queries] [dir]
+//
+// Indexes a synthetic corpus of 200-term documents with and without
+// positions, then answers two-term and three-term phrase queries two ways:
+// PhraseMatcher over the positional index, and the post-filter it
+// replaces, which intersects plain posting lists and then scans every
+// candidate document's tokens. The post-filter reads the tokens from
+// memory, so it is a lower bound on re-reading documents from disk.
+
+#include "phrase.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+using namespace SE;
+using SE::bench::make_corpus;
+using SE::bench::seconds_since;
+
+IndexBuildStats build(const std::vector<std::vector<std::string>> &corpus, const std::string &dir, bool positions);
+unsigned long post_filter(const InvertedIndex &index, const std::vector<std::vector<std::string>> &corpus,
+		const std::vector<std::string> &phrase, unsigned long &candidates);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 50000;
+	unsigned long queries = argc > 2 ? std::stoul(argv[2]) : 2000;
+	std::filesystem::path root = argc > 3 ? argv[3] : std::filesystem::temp_directory_path() / "se_bench_phrase";
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(documents);
+	IndexBuildStats plain = build(corpus, (root / "plain").string(), false);
+	IndexBuildStats positional = build(corpus, (root / "positions").string(), true);
+	printf("Indexed %lu documents: %.1f MB plain, %.1f MB with positions (%.1f s vs %.1f s)\n\n", documents,
+			plain.index_bytes / 1e6, positional.index_bytes / 1e6, plain.add_seconds + plain.merge_seconds,
+			positional.add_seconds + positional.merge_seconds);
+
+	// Phrases cut from the corpus, so most match somewhere
+	std::mt19937_64 rng(7);
+	std::vector<std::vector<std::string>> phrases;
+	for (unsigned long q = 0; q < queries; q++) {
+		const std::vector<std::string> &doc = corpus[rng() % documents];
+		unsigned long length = 2 + q % 2;
+		unsigned long start = rng() % (doc.size() - length);
+		phrases.emplace_back(doc.begin() + start, doc.begin() + start + length);
+	}
+
+	InvertedIndex plain_index((root / "plain").string());
+	InvertedIndex positional_index((root / "positions").string());
+	PhraseMatcher matcher(positional_index);
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned long matches = 0;
+	std::vector<uint32_t> docs;
+	for (const std::vector<std::string> &phrase : phrases) {
+		docs.clear();
+		matches += matcher.phrase(phrase, docs);
+	}
+	double positions_seconds = seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	unsigned long filtered = 0, candidates = 0;
+	for (const std::vector<std::string> &phrase : phrases) {
+		filtered += post_filter(plain_index, corpus, phrase, candidates);
+	}
+	double filter_seconds = seconds_since(start);
+
+	if (matches != filtered) {
+		printf("Match counts differ: %lu vs %lu!\n", matches, filtered);
+		return 1;
+	}
+	printf("%lu queries, %lu candidate documents, %lu matches\n", queries, candidates, matches);
+	printf("%-24s %12s %12s\n", "method", "us/query", "queries/s");
+	printf("%-24s %12.1f %12.0f\n", "positional index", positions_seconds / queries * 1e6, queries / positions_seconds);
+	printf("%-24s %12.1f %12.0f\n", "post-filter (in memory)", filter_seconds / queries * 1e6, queries / filter_seconds);
+
+	std::filesystem::remove_all(root);
+	return 0;
+}
+
+// Helper Functions
+
+IndexBuildStats build(const std::vector<std::vector<std::string>> &corpus, const std::string &dir, bool positions) {
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	IndexBuilderOptions options;
+	options.positions = positions;
+	IndexBuilder builder(dir, options);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	builder.finish();
+	return builder.stats();
+}
+
+unsigned long post_filter(const InvertedIndex &index, const std::vector<std::vector<std::string>> &corpus,
+		const std::vector<std::string> &phrase, unsigned long &candidates) {
+	// Documents holding every term, by merging plain posting lists
+	std::vector<std::pair<uint32_t, uint32_t>> list;
+	index.postings(phrase[0], list);
+	std::vector<uint32_t> docs;
+	for (auto &posting : list) {
+		docs.push_back(posting.first);
+	}
+	for (unsigned long t = 1; t < phrase.size(); t++) {
+		list.clear();
+		index.postings(phrase[t], list);
+		std::vector<uint32_t> kept;
+		unsigned long j = 0;
+		for (uint32_t doc : docs) {
+			while (j < list.size() && list[j].first < doc) {
+				j++;
+			}
+			if (j < list.size() && list[j].first == doc) {
+				kept.push_back(doc);
+			}
+		}
+		docs.swap(kept);
+	}
+
+	unsigned long matches = 0;
+	for (uint32_t doc : docs) {
+		candidates++;
+		const std::vector<std::string> &tokens = corpus[doc];
+		for (unsigned long start = 0; start + phrase.size() <= tokens.size(); start++) {
+			if (std::equal(phrase.begin(), phrase.end(), tokens.begin() + start)) {
+				matches++;
+				break;
+			}
+		}
+	}
+	return matches;
+}
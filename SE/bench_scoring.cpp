@@ -0,0 +1,161 @@
+// Scoring Benchmark
+//
+// Usage: bench_scoring [postings] [rounds]
+//
+// Scores one long posting list with each model three ways: a loop written
+// by hand for that model, score_block<Model>, and a loop calling the model
+// through a virtual function per posting, the way a runtime-configurable
+// scorer would. Reports nanoseconds per posting, the best of five
+// interleaved trials; the template should match the hand-written loop.
+
+#include "scoring.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace SE;
+
+struct Scorer {
+	virtual ~Scorer() {}
+	virtual float score(float tf, float doc) const = 0;
+};
+
+template<class Model>
+struct VirtualScorer : Scorer {
+	typename Model::Term term;
+
+	VirtualScorer(const typename Model::Term &t) : term(t) {}
+
+	float score(float tf, float doc) const override {
+		return Model::score(term, &tf, &doc);
+	}
+};
+
+template<class Body>
+double time_rounds(unsigned long rounds, unsigned long postings, Body body);
+template<class Model>
+void run(const char* name, const PostingBlock<1> &block, unsigned long rounds, float* scores);
+void hand_bm25(const BM25<>::Term &term, const float* tf, const float* length, unsigned long n, float* scores);
+void hand_tfidf(const TfIdfCosine::Term &term, const float* tf, const float* norm, unsigned long n, float* scores);
+void hand_dirichlet(const Dirichlet<>::Term &term, const float* tf, const float* length, unsigned long n, float* scores);
+void virtual_loop(const Scorer &scorer, const float* tf, const float* doc, unsigned long n, float* scores);
+
+CollectionStats collection;
+TermStats term_stats;
+
+
+int main(int argc, char** argv) {
+	unsigned long postings = argc > 1 ? std::stoul(argv[1]) : 1 << 16;
+	unsigned long rounds = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+	// Term frequencies skewed towards 1, lengths around 300 terms
+	std::mt19937 rng(1);
+	std::vector<float> tf(postings), doc(postings), scores(postings);
+	for (unsigned long i = 0; i < postings; i++) {
+		tf[i] = 1 + (rng() % 8) * (rng() % 8) / 8;
+		doc[i] = 50 + rng() % 500;
+	}
+	collection.documents = postings * 10;
+	collection.total_terms = collection.documents * 300;
+	collection.average_length[0] = 300;
+	term_stats = { postings, postings * 2 };
+
+	PostingBlock<1> block;
+	block.size = postings;
+	block.tf[0] = tf.data();
+	block.doc[0] = doc.data();
+
+	printf("Scoring %lu postings x %lu rounds\n", postings, rounds);
+	printf("%-12s %12s %12s %12s\n", "model", "hand ns", "template ns", "virtual ns");
+	run<BM25<>>("BM25", block, rounds, scores.data());
+	run<TfIdfCosine>("TF-IDF", block, rounds, scores.data());
+	run<Dirichlet<>>("Dirichlet", block, rounds, scores.data());
+	return 0;
+}
+
+// Helper Functions
+
+template<class Body>
+double time_rounds(unsigned long rounds, unsigned long postings, Body body) {
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long r = 0; r < rounds; r++) {
+		body();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / (rounds * postings);
+}
+
+template<class Model>
+void run(const char* name, const PostingBlock<1> &block, unsigned long rounds, float* scores) {
+	typename Model::Term term = Model::prepare(collection, term_stats, 1);
+	const float* tf = block.tf[0];
+	const float* doc = block.doc[0];
+	unsigned long n = block.size;
+
+	auto hand_loop = [&] {
+		if constexpr (std::is_same<Model, BM25<>>::value) {
+			hand_bm25(term, tf, doc, n, scores);
+		} else if constexpr (std::is_same<Model, TfIdfCosine>::value) {
+			hand_tfidf(term, tf, doc, n, scores);
+		} else {
+			hand_dirichlet(term, tf, doc, n, scores);
+		}
+	};
+
+	// Same scores from one pass of each
+	std::vector<float> expected(n, 0.0f);
+	std::fill(scores, scores + n, 0.0f);
+	hand_loop();
+	std::copy(scores, scores + n, expected.begin());
+	std::fill(scores, scores + n, 0.0f);
+	score_block<Model>(term, block, scores);
+	if (!std::equal(scores, scores + n, expected.begin())) {
+		printf("%s: template result differs!\n", name);
+	}
+
+	// Best of interleaved trials, so neither warm-up nor a noisy neighbour
+	// favours whichever loop happens to run first
+	VirtualScorer<Model> impl(term);
+	const Scorer &scorer = impl;
+	unsigned long trial_rounds = std::max(rounds / 5, 1UL);
+	double hand = 1e9, templated = 1e9, virtual_ns = 1e9;
+	for (int trial = 0; trial < 5; trial++) {
+		hand = std::min(hand, time_rounds(trial_rounds, n, hand_loop));
+		templated = std::min(templated, time_rounds(trial_rounds, n, [&] { score_block<Model>(term, block, scores); }));
+		virtual_ns = std::min(virtual_ns, time_rounds(trial_rounds, n, [&] { virtual_loop(scorer, tf, doc, n, scores); }));
+	}
+
+	printf("%-12s %12.3f %12.3f %12.3f\n", name, hand, templated, virtual_ns);
+}
+
+// Out of line so the compiler can't specialize the call through the known type
+__attribute__((noinline)) void virtual_loop(const Scorer &scorer, const float* tf, const float* doc, unsigned long n,
+		float* scores) {
+	for (unsigned long i = 0; i < n; i++) {
+		scores[i] += scorer.score(tf[i], doc[i]);
+	}
+}
+
+void hand_bm25(const BM25<>::Term &term, const float* tf, const float* length, unsigned long n, float* scores) {
+	float weight = term.weight, base = term.base, slope = term.slope;
+	for (unsigned long i = 0; i < n; i++) {
+		scores[i] += weight * tf[i] / (tf[i] + base + slope * length[i]);
+	}
+}
+
+void hand_tfidf(const TfIdfCosine::Term &term, const float* tf, const float* norm, unsigned long n, float* scores) {
+	float weight = term.weight;
+	for (unsigned long i = 0; i < n; i++) {
+		scores[i] += weight * (1.0f + std::log(tf[i])) / norm[i];
+	}
+}
+
+void hand_dirichlet(const Dirichlet<>::Term &term, const float* tf, const float* length, unsigned long n, float* scores) {
+	float weight = term.weight, inv_mu_p = term.inv_mu_p;
+	for (unsigned long i = 0; i < n; i++) {
+		float s = std::log(1.0f + tf[i] * inv_mu_p) + std::log(2000.0f / (length[i] + 2000.0f));
+		scores[i] += weight * std::max(s, 0.0f);
+	}
+}
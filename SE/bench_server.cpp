@@ -0,0 +1,129 @@
+// Server Benchmark
+//
+// Usage: bench_server [documents] [seconds] [workers] [address]
+//
+// Load generator for the query server. Each client thread holds one
+// connection and sends two-term and three-term top 10 queries back to
+// back, timing each from send to answer, for the given seconds per run.
+// Reports queries per second and latency percentiles for 1, 4 and 16
+// clients. Without an address the benchmark indexes a synthetic corpus of
+// 200-term documents (terms t0, t1, ...) and serves it in process over a
+// Unix socket and over TCP on 127.0.0.1; with one it drives a running
+// se_server, whose index should use the same terms.
+
+#include "server.h"
+#include "shard.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+using namespace SE;
+using SE::bench::make_corpus;
+using SE::bench::seconds_since;
+
+void run(const char* transport, const std::string &address, unsigned long clients, double seconds);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 50000;
+	double seconds = argc > 2 ? std::stod(argv[2]) : 2;
+	ServerOptions options;
+	options.workers = argc > 3 ? std::stoul(argv[3]) : options.workers;
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "se_bench_server";
+
+	printf("%-10s %8s %10s %10s %10s %10s %10s %8s\n", "transport", "clients", "queries/s", "p50 us", "p99 us",
+			"p999 us", "max us", "errors");
+	if (argc > 4) {
+		for (unsigned long clients : { 1, 4, 16 }) {
+			run("remote", argv[4], clients, seconds);
+		}
+		return 0;
+	}
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	{
+		std::vector<std::vector<std::string>> corpus = make_corpus(documents);
+		ShardedIndexBuilder builder(root.string(), 1);
+		for (unsigned long d = 0; d < corpus.size(); d++) {
+			builder.add("http://example.com/" + std::to_string(d), corpus[d]);
+		}
+		builder.finish();
+	}
+
+	ShardServer shard(ShardedIndexBuilder::shard_directory(root.string(), 0));
+	QueryServer<ShardServer> server(shard, options);
+	std::string unix_address = (root / "server.sock").string();
+	server.listen(unix_address);
+	std::string tcp_address = "127.0.0.1:" + std::to_string(server.listen("127.0.0.1:0"));
+	std::thread thread([&]() {
+		server.serve();
+	});
+
+	for (unsigned long clients : { 1, 4, 16 }) {
+		run("unix", unix_address, clients, seconds);
+	}
+	for (unsigned long clients : { 1, 4, 16 }) {
+		run("tcp", tcp_address, clients, seconds);
+	}
+
+	server.stop();
+	thread.join();
+	printf("\n%lu documents, %lu workers: ", documents, options.workers);
+	server.print_stats(stdout);
+	std::filesystem::remove_all(root);
+	return 0;
+}
+
+// Helper Functions
+
+// Closed loop: every client waits for each answer before the next query
+void run(const char* transport, const std::string &address, unsigned long clients, double seconds) {
+	std::vector<std::vector<double>> latencies(clients);
+	std::vector<unsigned long> errors(clients, 0);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long c = 0; c < clients; c++) {
+		threads.emplace_back([&, c]() {
+			QueryClient client(address);
+			std::mt19937_64 rng(c + 1);
+			QueryRequest request;
+			std::vector<ScoredDoc> hits;
+			while (seconds_since(start) < seconds) {
+				request.terms.clear();
+				for (unsigned long t = 0; t < 2 + rng() % 2; t++) {
+					request.terms.push_back("t" + std::to_string((rng() % 50000) * (rng() % 50000) / 50000));
+				}
+				auto sent = std::chrono::steady_clock::now();
+				if (client.search(request, hits, sent + std::chrono::seconds(5))) {
+					latencies[c].push_back(seconds_since(sent));
+				} else {
+					errors[c]++;
+					return;
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	double elapsed = seconds_since(start);
+
+	std::vector<double> all;
+	unsigned long failed = 0;
+	for (unsigned long c = 0; c < clients; c++) {
+		all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+		failed += errors[c];
+	}
+	if (all.empty()) {
+		printf("%-10s %8lu %10s\n", transport, clients, "no answers");
+		return;
+	}
+	std::sort(all.begin(), all.end());
+	unsigned long n = all.size();
+	printf("%-10s %8lu %10.0f %10.1f %10.1f %10.1f %10.1f %8lu\n", transport, clients, n / elapsed,
+			all[n / 2] * 1e6, all[std::min(n - 1, n * 99 / 100)] * 1e6, all[std::min(n - 1, n * 999 / 1000)] * 1e6,
+			all[n - 1] * 1e6, failed);
+}
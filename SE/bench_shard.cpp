@@ -0,0 +1,153 @@
+// Shard Benchmark
+//
+// Usage: bench_shard [documents] [queries] [max shards] [dir]
+//
+// Partitions a synthetic corpus of 200-term documents into 1, 2, 4, ...
+// shards, forks one ShardServer process per shard and sends two-term and
+// three-term BM25 queries through a ShardCoordinator, one at a time.
+// Reports latency percentiles per shard count next to the same queries
+// answered in process by a single unsharded ShardServer. Every shard
+// process competes for the same cores, so with fewer cores than shards
+// the scatter-gather overhead shows rather than the parallel speedup.
+
+#include "shard.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace SE;
+using SE::bench::make_corpus;
+using SE::bench::seconds_since;
+
+void build_shards(const std::vector<std::vector<std::string>> &corpus, const std::string &dir, unsigned long shards);
+pid_t start_shard(const std::string &directory, const std::string &socket_path);
+void report(const char* name, std::vector<double> &latencies, unsigned long partial);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 50000;
+	unsigned long queries = argc > 2 ? std::stoul(argv[2]) : 2000;
+	unsigned long max_shards = argc > 3 ? std::stoul(argv[3]) : 8;
+	std::filesystem::path root = argc > 4 ? argv[4] : std::filesystem::temp_directory_path() / "se_bench_shard";
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(documents);
+	std::mt19937_64 rng(7);
+	std::vector<std::vector<std::string>> query_terms;
+	for (unsigned long q = 0; q < queries; q++) {
+		const std::vector<std::string> &doc = corpus[rng() % documents];
+		std::vector<std::string> terms;
+		for (unsigned long t = 0; t < 2 + q % 2; t++) {
+			terms.push_back(doc[rng() % doc.size()]);
+		}
+		query_terms.push_back(terms);
+	}
+
+	printf("%lu documents, %lu queries, top 10\n\n", documents, queries);
+	printf("%-24s %10s %10s %10s %10s %10s\n", "configuration", "mean us", "p50 us", "p99 us", "max us", "partial");
+
+	std::vector<double> latencies;
+	for (unsigned long shards = 1; shards <= max_shards; shards *= 2) {
+		std::string dir = (root / std::to_string(shards)).string();
+		build_shards(corpus, dir, shards);
+
+		if (shards == 1) {
+			ShardServer server(ShardedIndexBuilder::shard_directory(dir, 0));
+			QueryRequest request;
+			latencies.clear();
+			for (const std::vector<std::string> &terms : query_terms) {
+				request.terms = terms;
+				auto start = std::chrono::steady_clock::now();
+				server.search(request);
+				latencies.push_back(seconds_since(start));
+			}
+			report("in process, unsharded", latencies, 0);
+		}
+
+		std::vector<std::string> sockets;
+		std::vector<pid_t> pids;
+		for (unsigned long s = 0; s < shards; s++) {
+			sockets.push_back(dir + "/shard-" + std::to_string(s) + ".sock");
+			pids.push_back(start_shard(ShardedIndexBuilder::shard_directory(dir, s), sockets[s]));
+		}
+
+		CoordinatorOptions options;
+		options.shard_deadline_us = 1000000;
+		ShardCoordinator coordinator(sockets, options);
+		for (unsigned long q = 0; q < std::min(queries, 100UL); q++) {
+			coordinator.search(query_terms[q], 10);
+		}
+		unsigned long partial = coordinator.stats().partial;
+		latencies.clear();
+		for (const std::vector<std::string> &terms : query_terms) {
+			auto start = std::chrono::steady_clock::now();
+			coordinator.search(terms, 10);
+			latencies.push_back(seconds_since(start));
+		}
+		std::string name = std::to_string(shards) + (shards == 1 ? " shard" : " shards");
+		report(name.c_str(), latencies, coordinator.stats().partial - partial);
+
+		for (pid_t pid : pids) {
+			::kill(pid, SIGKILL);
+			::waitpid(pid, nullptr, 0);
+		}
+	}
+
+	std::filesystem::remove_all(root);
+	return 0;
+}
+
+// Helper Functions
+
+void build_shards(const std::vector<std::vector<std::string>> &corpus, const std::string &dir, unsigned long shards) {
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	IndexBuilderOptions options;
+	options.memory_budget = (256UL << 20) / shards;
+	ShardedIndexBuilder builder(dir, shards, options);
+	for (unsigned long d = 0; d < corpus.size(); d++) {
+		builder.add("http://example.com/" + std::to_string(d), corpus[d]);
+	}
+	builder.finish();
+}
+
+// Forks a shard server process; returns once it is listening
+pid_t start_shard(const std::string &directory, const std::string &socket_path) {
+	int ready[2];
+	if (::pipe(ready) != 0) {
+		throw "Cannot create pipe!";
+	}
+	fflush(stdout);
+	pid_t pid = ::fork();
+	if (pid == 0) {
+		::close(ready[0]);
+		ShardServer server(directory);
+		server.listen(socket_path);
+		char byte = 1;
+		if (::write(ready[1], &byte, 1) == 1) {
+			server.serve();
+		}
+		_exit(1);
+	}
+	::close(ready[1]);
+	char byte;
+	if (pid < 0 || ::read(ready[0], &byte, 1) != 1) {
+		throw "Cannot start shard server!";
+	}
+	::close(ready[0]);
+	return pid;
+}
+
+void report(const char* name, std::vector<double> &latencies, unsigned long partial) {
+	std::sort(latencies.begin(), latencies.end());
+	double sum = 0;
+	for (double latency : latencies) {
+		sum += latency;
+	}
+	unsigned long n = latencies.size();
+	printf("%-24s %10.1f %10.1f %10.1f %10.1f %10lu\n", name, sum / n * 1e6, latencies[n / 2] * 1e6,
+			latencies[std::min(n - 1, n * 99 / 100)] * 1e6, latencies[n - 1] * 1e6, partial);
+}
@@ -0,0 +1,154 @@
+// Snippet Benchmark
+//
+// Usage: bench_snippet [documents] [queries]
+//
+// Stores a synthetic corpus of 1-8 KB documents in a SnippetStore, then
+// builds snippets for ten documents per two-term or three-term query and
+// reports microseconds per result. For comparison it times re-tokenizing
+// each result's text and comparing every token with the query terms,
+// which is all a tokenize-at-query-time snippet would do before even
+// choosing a window. Last, it times find_term over whole documents
+// against a byte-at-a-time search.
+
+#include "snippet.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <random>
+
+using namespace SE;
+using SE::bench::seconds_since;
+
+std::vector<std::string> make_corpus(unsigned long documents);
+unsigned long scalar_find(const std::string &text, const std::string &term);
+
+
+int main(int argc, char** argv) {
+	unsigned long documents = argc > 1 ? std::stoul(argv[1]) : 20000;
+	unsigned long queries = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+	std::vector<std::string> corpus = make_corpus(documents);
+	unsigned long text_bytes = 0;
+	for (const std::string &text : corpus) {
+		text_bytes += text.size();
+	}
+	auto start = std::chrono::steady_clock::now();
+	SnippetStoreBuilder builder;
+	for (const std::string &text : corpus) {
+		builder.add(text);
+	}
+	SnippetStore store = builder.build();
+	printf("%lu documents, %.1f MB of text, %.1f MB stored (built in %.2f s)\n\n", documents, text_bytes / 1e6,
+			store.memory_bytes() / 1e6, seconds_since(start));
+
+	// Terms drawn from one result so most snippets have matches
+	std::mt19937_64 rng(7);
+	std::vector<std::vector<std::string>> query_terms;
+	std::vector<std::vector<unsigned long>> results;
+	for (unsigned long q = 0; q < queries; q++) {
+		std::vector<unsigned long> docs;
+		for (unsigned long r = 0; r < 10; r++) {
+			docs.push_back(rng() % documents);
+		}
+		std::vector<std::string> words;
+		tokenize(corpus[docs[0]], words);
+		std::vector<std::string> terms;
+		for (unsigned long t = 0; t < 2 + q % 2; t++) {
+			terms.push_back(words[rng() % words.size()]);
+		}
+		query_terms.push_back(terms);
+		results.push_back(docs);
+	}
+
+	unsigned long highlights = 0, bytes = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned long q = 0; q < queries; q++) {
+		for (unsigned long doc : results[q]) {
+			Snippet snippet = store.snippet(doc, query_terms[q]);
+			highlights += snippet.highlights.size();
+			bytes += snippet.text.size();
+		}
+	}
+	double stored_us = seconds_since(start) / (queries * 10) * 1e6;
+
+	unsigned long matches = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned long q = 0; q < queries; q++) {
+		const std::vector<std::string> &terms = query_terms[q];
+		for (unsigned long doc : results[q]) {
+			tokenize_offsets(corpus[doc].data(), corpus[doc].size(), [&](const char* t, unsigned long n, unsigned long) {
+				for (const std::string &term : terms) {
+					matches += term.size() == n && std::memcmp(term.data(), t, n) == 0;
+				}
+			});
+		}
+	}
+	double tokenize_us = seconds_since(start) / (queries * 10) * 1e6;
+
+	printf("%lu results, %.1f highlights and %.0f bytes per snippet, %.1f matches per document\n",
+			queries * 10, (double) highlights / (queries * 10), (double) bytes / (queries * 10),
+			(double) matches / (queries * 10));
+	printf("%-32s %12s\n", "method", "us/result");
+	printf("%-32s %12.2f\n", "stored offsets (snippet)", stored_us);
+	printf("%-32s %12.2f\n\n", "re-tokenizing alone", tokenize_us);
+
+	// Highlighting throughput over whole documents
+	unsigned long simd_found = 0, scalar_found = 0, scanned = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned long q = 0; q < queries; q++) {
+		const std::string &text = corpus[results[q][1]];
+		for (const std::string &term : query_terms[q]) {
+			find_term(text.data(), text.size(), term, [&](unsigned long) {
+				simd_found++;
+			});
+			scanned += text.size();
+		}
+	}
+	double simd_seconds = seconds_since(start);
+	start = std::chrono::steady_clock::now();
+	for (unsigned long q = 0; q < queries; q++) {
+		const std::string &text = corpus[results[q][1]];
+		for (const std::string &term : query_terms[q]) {
+			scalar_found += scalar_find(text, term);
+		}
+	}
+	double scalar_seconds = seconds_since(start);
+	if (simd_found != scalar_found) {
+		printf("Highlight counts differ: %lu vs %lu!\n", simd_found, scalar_found);
+		return 1;
+	}
+	printf("%-32s %12s\n", "highlight search", "GB/s");
+	printf("%-32s %12.2f\n", "find_term", scanned / simd_seconds / 1e9);
+	printf("%-32s %12.2f\n", "byte at a time", scanned / scalar_seconds / 1e9);
+	return 0;
+}
+
+// Helper Functions
+
+// Sentences of 6 to 24 Zipf-like words over a 20K vocabulary
+std::vector<std::string> make_corpus(unsigned long documents) {
+	std::mt19937_64 rng(1);
+	std::vector<std::string> corpus(documents);
+	for (std::string &text : corpus) {
+		unsigned long target = 1000 + rng() % 7000;
+		while (text.size() < target) {
+			for (unsigned long i = 0, n = 6 + rng() % 19; i < n; i++) {
+				std::string word = "w" + std::to_string((rng() % 20000) * (rng() % 20000) / 20000);
+				if (i == 0) {
+					word[0] = 'W';
+				}
+				text += word;
+				text += i + 1 < n ? (rng() % 8 ? " " : ", ") : ". ";
+			}
+		}
+	}
+	return corpus;
+}
+
+unsigned long scalar_find(const std::string &text, const std::string &term) {
+	unsigned long found = 0;
+	for (unsigned long i = 0; i + term.size() <= text.size(); i++) {
+		found += to_lower(text[i]) == term[0] && term_at(text.data(), text.size(), i, term);
+	}
+	return found;
+}
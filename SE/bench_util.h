@@ -0,0 +1,41 @@
+// bench utility header file
+//
+// Helpers shared by the SE benchmarks (bench_*.cpp).
+//
+//   make_corpus   - documents of 200 Zipf-like terms over a 50K
+//                   vocabulary, the same on every run
+//   seconds_since - wall-clock seconds since a steady_clock time point
+//
+// Benchmarks whose corpus has a shape of its own (bench_dedupe,
+// bench_snippet) take only seconds_since.
+
+#ifndef SE_BENCH_UTIL_H
+#define SE_BENCH_UTIL_H
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace SE {
+namespace bench {
+
+inline std::vector<std::vector<std::string>> make_corpus(unsigned long documents) {
+	std::mt19937_64 rng(1);
+	std::vector<std::vector<std::string>> corpus(documents);
+	for (std::vector<std::string> &doc : corpus) {
+		for (unsigned long i = 0; i < 200; i++) {
+			doc.push_back("t" + std::to_string((rng() % 50000) * (rng() % 50000) / 50000));
+		}
+	}
+	return corpus;
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+}
+}
+#endif
@@ -0,0 +1,191 @@
+// coding header file
+//
+// Integer compression shared by the on-disk and in-memory index structures:
+// variable-byte integers and frame-of-reference bit packing.
+
+#ifndef SE_CODING_H
+#define SE_CODING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SE {
+
+// Variable Byte
+
+// 7 bits per byte, high bit set on every byte but the last
+inline void write_varint(std::string &out, uint64_t val) {
+	while (val >= 0x80) {
+		out.push_back((char) (val | 0x80));
+		val >>= 7;
+	}
+	out.push_back((char) val);
+}
+
+inline uint64_t read_varint(const char* &in) {
+	uint64_t val = 0;
+	unsigned shift = 0;
+	while (true) {
+		uint8_t byte = *in++;
+		val |= (uint64_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return val;
+		}
+		shift += 7;
+	}
+}
+
+// As read_varint, for untrusted input: false if the varint runs past end
+// or is longer than ten bytes
+inline bool read_varint_checked(const char* &in, const char* end, uint64_t &val) {
+	val = 0;
+	for (unsigned shift = 0; in < end && shift < 70; shift += 7) {
+		uint8_t byte = *in++;
+		val |= (uint64_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline unsigned bit_width(uint64_t val) {
+	return val ? 64 - __builtin_clzll(val) : 0;
+}
+
+
+// Serialization
+
+template<class T>
+void write_pod(std::ostream &out, const T &val) {
+	out.write((const char*) &val, sizeof(T));
+}
+
+template<class T>
+void read_pod(std::istream &in, T &val) {
+	if (!in.read((char*) &val, sizeof(T))) {
+		throw "Unexpected end of stream!";
+	}
+}
+
+template<class T>
+void write_array(std::ostream &out, const std::vector<T> &vals) {
+	write_pod(out, (uint64_t) vals.size());
+	out.write((const char*) vals.data(), vals.size() * sizeof(T));
+}
+
+template<class T>
+void read_array(std::istream &in, std::vector<T> &vals) {
+	uint64_t size;
+	read_pod(in, size);
+	vals.resize(size);
+	if (!in.read((char*) vals.data(), size * sizeof(T))) {
+		throw "Unexpected end of stream!";
+	}
+}
+
+
+// Packed Array
+
+// Immutable array of unsigned integers split into blocks of BLOCK values.
+// Each block stores its minimum and packs (value - minimum) at the
+// narrowest bit width that fits, so get() is O(1): one header lookup and
+// an unaligned two-word extract.
+class PackedArray {
+public:
+	static constexpr unsigned long BLOCK = 128;
+
+	PackedArray() : size_(0) {}
+
+	explicit PackedArray(const std::vector<uint64_t> &vals) : size_(vals.size()) {
+		for (unsigned long start = 0; start < vals.size(); start += BLOCK) {
+			unsigned long end = std::min(start + BLOCK, (unsigned long) vals.size());
+
+			uint64_t base = vals[start], max = vals[start];
+			for (unsigned long i = start; i < end; i++) {
+				base = std::min(base, vals[i]);
+				max = std::max(max, vals[i]);
+			}
+
+			Header header = { base, (uint32_t) words_.size(), (uint32_t) bit_width(max - base) };
+			headers_.push_back(header);
+
+			unsigned long bits = header.bits * (end - start);
+			words_.resize(words_.size() + (bits + 63) / 64 + 1, 0); // +1 lets get() read two words
+			for (unsigned long i = start; i < end; i++) {
+				put(header, i - start, vals[i] - base);
+			}
+		}
+	}
+
+	uint64_t get(unsigned long index) const {
+		const Header &header = headers_[index / BLOCK];
+		if (header.bits == 0) {
+			return header.base;
+		}
+
+		unsigned long bit = (index % BLOCK) * header.bits;
+		const uint64_t* word = &words_[header.offset + bit / 64];
+		unsigned shift = bit % 64;
+		uint64_t val = word[0] >> shift;
+		if (shift + header.bits > 64) {
+			val |= word[1] << (64 - shift);
+		}
+		uint64_t mask = header.bits == 64 ? ~0ULL : (1ULL << header.bits) - 1;
+		return header.base + (val & mask);
+	}
+
+	unsigned long size() const {
+		return size_;
+	}
+
+	unsigned long memory_bytes() const {
+		return headers_.size() * sizeof(Header) + words_.size() * sizeof(uint64_t);
+	}
+
+	void save(std::ostream &out) const {
+		write_pod(out, (uint64_t) size_);
+		write_array(out, headers_);
+		write_array(out, words_);
+	}
+
+	void load(std::istream &in) {
+		uint64_t size;
+		read_pod(in, size);
+		size_ = size;
+		read_array(in, headers_);
+		read_array(in, words_);
+	}
+
+private:
+	struct Header {
+		uint64_t base;
+		uint32_t offset; // first word of the block
+		uint32_t bits;
+	};
+
+	unsigned long size_;
+	std::vector<Header> headers_;
+	std::vector<uint64_t> words_;
+
+	void put(const Header &header, unsigned long i, uint64_t val) {
+		if (header.bits == 0) {
+			return;
+		}
+		unsigned long bit = i * header.bits;
+		uint64_t* word = &words_[header.offset + bit / 64];
+		unsigned shift = bit % 64;
+		word[0] |= val << shift;
+		if (shift + header.bits > 64) {
+			word[1] |= val >> (64 - shift);
+		}
+	}
+};
+
+
+}
+#endif
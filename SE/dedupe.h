@@ -0,0 +1,290 @@
+// dedupe header file
+//
+// Near-duplicate detection for the ingest pipeline. Crawls are full of
+// mirrors, printer-friendly copies and pages that differ only in a date or
+// a session id; indexing each copy inflates posting lists and fills result
+// pages with the same document.
+//
+//   MinHasher          - hashes every run of `shingle` consecutive terms,
+//                        then keeps, for each of bands * rows seeded hash
+//                        functions, the minimum over the shingles. Two
+//                        signatures agree in a given position with
+//                        probability equal to the Jaccard similarity of
+//                        the documents' shingle sets. The seeded hashes
+//                        are computed eight seeds per AVX2 instruction
+//                        when available.
+//   DuplicateDetector  - locality sensitive hashing over signatures: each
+//                        band of `rows` values is a key into that band's
+//                        hash table, so documents sharing any whole band
+//                        become candidates, and a candidate is a duplicate
+//                        when the signatures agree in at least threshold
+//                        of their positions. The first document of a
+//                        cluster is its canonical copy; later ones map to
+//                        its URL and are not indexed.
+//
+// With the default 16 bands of 4 rows a pair becomes a candidate with
+// probability 1 - (1 - J^4)^16: 0.5% at J = 0.2, 64% at J = 0.5 and
+// 99.9% at J = 0.8.
+
+#ifndef SE_DEDUPE_H
+#define SE_DEDUPE_H
+
+#include "tokenizer.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace SE {
+
+struct DedupeOptions {
+	unsigned long shingle = 4;    // terms per shingle
+	unsigned long bands = 16;
+	unsigned long rows = 4;       // signature values per band
+	double threshold = 0.8;       // estimated Jaccard similarity of a duplicate
+};
+
+
+// MinHash Signatures
+
+class MinHasher {
+public:
+	explicit MinHasher(DedupeOptions options = DedupeOptions()) : shingle_(options.shingle) {
+		if (options.shingle == 0 || options.bands == 0 || options.rows == 0) {
+			throw "Dedupe options must be positive!";
+		}
+		uint64_t state = 0x9E3779B97F4A7C15ULL;
+		for (unsigned long i = 0; i < options.bands * options.rows; i++) {
+			// splitmix64, so the seeds are distinct and well spread
+			uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			seeds_.push_back((uint32_t) (z ^ (z >> 31)));
+		}
+	}
+
+	// Values per signature
+	unsigned long size() const {
+		return seeds_.size();
+	}
+
+	const std::vector<uint32_t>& seeds() const {
+		return seeds_;
+	}
+
+	// Signature of a term sequence; empty if there are no terms. Documents
+	// shorter than one shingle are hashed as a single shingle.
+	void signature(const std::vector<std::string> &terms, std::vector<uint32_t> &out) const {
+		out.clear();
+		if (terms.empty()) {
+			return;
+		}
+
+		std::vector<uint32_t> hashes;
+		hashes.reserve(terms.size());
+		for (const std::string &term : terms) {
+			hashes.push_back(term_hash(term.data(), term.size()));
+		}
+		unsigned long count = terms.size() > shingle_ ? terms.size() - shingle_ + 1 : 1;
+		std::vector<uint32_t> shingles(count);
+		for (unsigned long i = 0; i < count; i++) {
+			uint32_t hash = 0;
+			for (unsigned long j = i; j < i + shingle_ && j < hashes.size(); j++) {
+				hash = ((hash << 5) | (hash >> 27)) ^ hashes[j];
+				hash *= 0x9E3779B1U;
+			}
+			shingles[i] = hash;
+		}
+
+		out.resize(seeds_.size());
+		signature(shingles.data(), shingles.size(), out.data());
+	}
+
+	// Minimum of every seeded hash over n shingle hashes into out[size()]
+	void signature(const uint32_t* shingles, unsigned long n, uint32_t* out) const {
+		unsigned long s = 0;
+#ifdef __AVX2__
+		for (; s + 8 <= seeds_.size(); s += 8) {
+			__m256i seeds = _mm256_loadu_si256((const __m256i*) (seeds_.data() + s));
+			__m256i min = _mm256_set1_epi32(-1);
+			for (unsigned long i = 0; i < n; i++) {
+				__m256i h = _mm256_xor_si256(_mm256_set1_epi32((int) shingles[i]), seeds);
+				h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int) 0x9E3779B1U));
+				h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+				h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int) 0x85EBCA6BU));
+				h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+				min = _mm256_min_epu32(min, h);
+			}
+			_mm256_storeu_si256((__m256i*) (out + s), min);
+		}
+#endif
+
+		for (; s < seeds_.size(); s++) {
+			uint32_t min = 0xFFFFFFFFU;
+			for (unsigned long i = 0; i < n; i++) {
+				uint32_t h = mix(shingles[i] ^ seeds_[s]);
+				min = h < min ? h : min;
+			}
+			out[s] = min;
+		}
+	}
+
+	// Fraction of positions where two signatures agree, an estimate of the
+	// Jaccard similarity of the two documents
+	static double similarity(const uint32_t* a, const uint32_t* b, unsigned long size) {
+		unsigned long equal = 0;
+		for (unsigned long i = 0; i < size; i++) {
+			equal += a[i] == b[i];
+		}
+		return size ? (double) equal / size : 0.0;
+	}
+
+	static uint32_t mix(uint32_t h) {
+		h *= 0x9E3779B1U;
+		h ^= h >> 15;
+		h *= 0x85EBCA6BU;
+		h ^= h >> 13;
+		return h;
+	}
+
+private:
+	unsigned long shingle_;
+	std::vector<uint32_t> seeds_;
+};
+
+
+// Duplicate Detection
+
+struct DedupeStats {
+	unsigned long documents = 0;   // signatures added
+	unsigned long duplicates = 0;  // of which matched an earlier document
+	unsigned long candidates = 0;  // signature comparisons made
+};
+
+class DuplicateDetector {
+public:
+	static const unsigned long NOT_DUPLICATE = ~0UL;
+
+	explicit DuplicateDetector(DedupeOptions options = DedupeOptions()) :
+			options_(options), tables_(options.bands) {
+		if (options.bands == 0 || options.rows == 0) {
+			throw "Dedupe options must be positive!";
+		}
+	}
+
+	// Returns the id of the canonical document signature duplicates, or
+	// NOT_DUPLICATE after making url a canonical document of its own.
+	// Documents without a signature (no terms) are never duplicates.
+	unsigned long add(const std::string &url, const std::vector<uint32_t> &signature) {
+		unsigned long size = options_.bands * options_.rows;
+		if (!signature.empty() && signature.size() != size) {
+			throw "Signature size does not match the dedupe options!";
+		}
+		stats_.documents++;
+
+		unsigned long best = NOT_DUPLICATE;
+		double best_similarity = 0.0;
+		if (!signature.empty()) {
+			for (unsigned long b = 0; b < options_.bands; b++) {
+				auto itr = tables_[b].find(band_key(signature.data(), b));
+				if (itr == tables_[b].end()) {
+					continue;
+				}
+				for (uint32_t id : itr->second) {
+					if (checked_[id] == stats_.documents) {
+						continue;
+					}
+					checked_[id] = stats_.documents;
+					stats_.candidates++;
+					double similarity = MinHasher::similarity(signature.data(), &signatures_[id * size], size);
+					if (similarity >= options_.threshold && (similarity > best_similarity ||
+							(similarity == best_similarity && id < best))) {
+						best = id;
+						best_similarity = similarity;
+					}
+				}
+			}
+		}
+
+		if (best != NOT_DUPLICATE) {
+			stats_.duplicates++;
+			duplicates_.push_back(std::make_pair(url, best));
+			return best;
+		}
+
+		uint32_t id = urls_.size();
+		urls_.push_back(url);
+		checked_.push_back(0);
+		if (signature.empty()) {
+			signatures_.insert(signatures_.end(), size, 0);
+		} else {
+			signatures_.insert(signatures_.end(), signature.begin(), signature.end());
+			for (unsigned long b = 0; b < options_.bands; b++) {
+				tables_[b][band_key(signature.data(), b)].push_back(id);
+			}
+		}
+		return NOT_DUPLICATE;
+	}
+
+	// Canonical documents, in the order they were added
+	unsigned long size() const {
+		return urls_.size();
+	}
+
+	const std::string& url(unsigned long id) const {
+		if (id >= urls_.size()) {
+			throw "Document ID out of range!";
+		}
+		return urls_[id];
+	}
+
+	// (duplicate URL, canonical id) for every collapsed document
+	const std::vector<std::pair<std::string, unsigned long>>& duplicates() const {
+		return duplicates_;
+	}
+
+	const DedupeStats& stats() const {
+		return stats_;
+	}
+
+	unsigned long memory_bytes() const {
+		unsigned long bytes = signatures_.capacity() * sizeof(uint32_t) + checked_.capacity() * sizeof(unsigned long);
+		for (const auto &table : tables_) {
+			for (const auto &bucket : table) {
+				bytes += sizeof(bucket) + bucket.second.capacity() * sizeof(uint32_t);
+			}
+		}
+		for (const std::string &url : urls_) {
+			bytes += sizeof(url) + url.capacity();
+		}
+		return bytes;
+	}
+
+private:
+	DedupeOptions options_;
+	std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> tables_;
+	std::vector<uint32_t> signatures_;   // size() signatures, back to back
+	std::vector<unsigned long> checked_; // last add() that compared with each id
+	std::vector<std::string> urls_;
+	std::vector<std::pair<std::string, unsigned long>> duplicates_;
+	DedupeStats stats_;
+
+	// FNV-1a over the band's rows
+	uint64_t band_key(const uint32_t* signature, unsigned long band) const {
+		uint64_t key = 14695981039346656037ULL;
+		for (unsigned long r = band * options_.rows; r < (band + 1) * options_.rows; r++) {
+			key = (key ^ signature[r]) * 1099511628211ULL;
+		}
+		return key;
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,271 @@
+// docstore header file
+//
+// Columnar per-document storage for the "store per url" step in notes.txt.
+//
+// URLs live in a sorted, front-coded dictionary: blocks of URL_BLOCK URLs
+// where the first is stored whole and the rest as (shared prefix length,
+// suffix). docID <-> dictionary rank arrays connect it to docIDs, which
+// stay in ingest order. Numeric fields are separate frame-of-reference
+// packed columns, so reading one field for many documents touches only
+// that field's memory.
+//
+//   url(doc)    O(1): rank lookup, then decode at most URL_BLOCK entries
+//   find(url)   binary search over block heads, then scan one block
+//   length/norm/crawl_time(doc)   O(1) packed column reads
+
+#ifndef SE_DOCSTORE_H
+#define SE_DOCSTORE_H
+
+#include "coding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace SE {
+
+class DocStoreBuilder;
+
+class DocStore {
+public:
+	static constexpr unsigned long URL_BLOCK = 16;
+	static constexpr unsigned long NOT_FOUND = ~0UL;
+
+	DocStore() : size_(0), total_length_(0) {}
+
+	unsigned long size() const {
+		return size_;
+	}
+
+	std::string url(unsigned long doc) const {
+		check(doc);
+		unsigned long rank = doc_to_rank_[doc];
+		const char* in = url_data_.data() + block_offsets_[rank / URL_BLOCK];
+
+		std::string url;
+		read_head(in, url);
+		for (unsigned long i = 0; i < rank % URL_BLOCK; i++) {
+			read_next(in, url);
+		}
+		return url;
+	}
+
+	// docID of url, or NOT_FOUND
+	unsigned long find(const std::string &url) const {
+		if (size_ == 0) {
+			return NOT_FOUND;
+		}
+
+		// Last block whose head is <= url
+		unsigned long lo = 0, hi = block_offsets_.size();
+		std::string head;
+		while (hi - lo > 1) {
+			unsigned long mid = lo + (hi - lo) / 2;
+			const char* in = url_data_.data() + block_offsets_[mid];
+			read_head(in, head);
+			if (head <= url) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+
+		const char* in = url_data_.data() + block_offsets_[lo];
+		std::string current;
+		read_head(in, current);
+		unsigned long rank = lo * URL_BLOCK;
+		unsigned long block_end = std::min(rank + URL_BLOCK, size_);
+		while (true) {
+			int cmp = current.compare(url);
+			if (cmp == 0) {
+				return rank_to_doc_[rank];
+			}
+			if (cmp > 0 || ++rank == block_end) {
+				return NOT_FOUND;
+			}
+			read_next(in, current);
+		}
+	}
+
+	// Number of terms in the document
+	uint32_t length(unsigned long doc) const {
+		check(doc);
+		return (uint32_t) lengths_.get(doc);
+	}
+
+	// Vector norm, stored as bfloat16 (about 3 significant digits)
+	float norm(unsigned long doc) const {
+		check(doc);
+		uint32_t bits = (uint32_t) norms_.get(doc) << 16;
+		float val;
+		std::memcpy(&val, &bits, sizeof(val));
+		return val;
+	}
+
+	uint64_t crawl_time(unsigned long doc) const {
+		check(doc);
+		return crawl_times_.get(doc);
+	}
+
+	double average_length() const {
+		return size_ ? (double) total_length_ / size_ : 0;
+	}
+
+	unsigned long memory_bytes() const {
+		return url_data_.size() + block_offsets_.size() * sizeof(uint64_t)
+				+ (doc_to_rank_.size() + rank_to_doc_.size()) * sizeof(uint32_t)
+				+ lengths_.memory_bytes() + norms_.memory_bytes() + crawl_times_.memory_bytes();
+	}
+
+	void save(std::ostream &out) const {
+		write_pod(out, (uint64_t) size_);
+		write_pod(out, (uint64_t) total_length_);
+		write_pod(out, (uint64_t) url_data_.size());
+		out.write(url_data_.data(), url_data_.size());
+		write_array(out, block_offsets_);
+		write_array(out, doc_to_rank_);
+		write_array(out, rank_to_doc_);
+		lengths_.save(out);
+		norms_.save(out);
+		crawl_times_.save(out);
+	}
+
+	void load(std::istream &in) {
+		uint64_t size, total_length, url_bytes;
+		read_pod(in, size);
+		read_pod(in, total_length);
+		read_pod(in, url_bytes);
+		size_ = size;
+		total_length_ = total_length;
+		url_data_.resize(url_bytes);
+		if (!in.read(&url_data_[0], url_bytes)) {
+			throw "Unexpected end of stream!";
+		}
+		read_array(in, block_offsets_);
+		read_array(in, doc_to_rank_);
+		read_array(in, rank_to_doc_);
+		lengths_.load(in);
+		norms_.load(in);
+		crawl_times_.load(in);
+	}
+
+private:
+	unsigned long size_;
+	unsigned long total_length_;
+	std::string url_data_;
+	std::vector<uint64_t> block_offsets_;
+	std::vector<uint32_t> doc_to_rank_;
+	std::vector<uint32_t> rank_to_doc_;
+	PackedArray lengths_;
+	PackedArray norms_;
+	PackedArray crawl_times_;
+
+	friend class DocStoreBuilder;
+
+
+	void check(unsigned long doc) const {
+		if (doc >= size_) {
+			throw "Document ID out of range!";
+		}
+	}
+
+	static void read_head(const char* &in, std::string &url) {
+		unsigned long length = read_varint(in);
+		url.assign(in, length);
+		in += length;
+	}
+
+	static void read_next(const char* &in, std::string &url) {
+		unsigned long shared = read_varint(in);
+		unsigned long suffix = read_varint(in);
+		url.resize(shared);
+		url.append(in, suffix);
+		in += suffix;
+	}
+};
+
+class DocStoreBuilder {
+public:
+	// Returns the new document's ID; IDs are assigned in insertion order
+	unsigned long add(const std::string &url, uint32_t length, float norm, uint64_t crawl_time) {
+		urls_.push_back(url);
+		lengths_.push_back(length);
+		norms_.push_back(to_bfloat16(norm));
+		crawl_times_.push_back(crawl_time);
+		return urls_.size() - 1;
+	}
+
+	unsigned long size() const {
+		return urls_.size();
+	}
+
+	DocStore build() const {
+		DocStore store;
+		unsigned long n = urls_.size();
+		if (n > 0xFFFFFFFFUL) {
+			throw "Too many documents for 32 bit IDs!";
+		}
+		store.size_ = n;
+
+		store.rank_to_doc_.resize(n);
+		for (unsigned long i = 0; i < n; i++) {
+			store.rank_to_doc_[i] = i;
+		}
+		std::sort(store.rank_to_doc_.begin(), store.rank_to_doc_.end(), [this](uint32_t a, uint32_t b) {
+			return urls_[a] < urls_[b];
+		});
+
+		store.doc_to_rank_.resize(n);
+		for (unsigned long rank = 0; rank < n; rank++) {
+			uint32_t doc = store.rank_to_doc_[rank];
+			if (rank > 0 && urls_[doc] == urls_[store.rank_to_doc_[rank - 1]]) {
+				throw "Duplicate URL in document store!";
+			}
+			store.doc_to_rank_[doc] = rank;
+
+			const std::string &url = urls_[doc];
+			if (rank % DocStore::URL_BLOCK == 0) {
+				store.block_offsets_.push_back(store.url_data_.size());
+				write_varint(store.url_data_, url.size());
+				store.url_data_ += url;
+			} else {
+				const std::string &prev = urls_[store.rank_to_doc_[rank - 1]];
+				unsigned long shared = 0;
+				unsigned long limit = std::min(prev.size(), url.size());
+				while (shared < limit && prev[shared] == url[shared]) {
+					shared++;
+				}
+				write_varint(store.url_data_, shared);
+				write_varint(store.url_data_, url.size() - shared);
+				store.url_data_.append(url, shared, std::string::npos);
+			}
+		}
+
+		for (uint64_t length : lengths_) {
+			store.total_length_ += length;
+		}
+		store.lengths_ = PackedArray(lengths_);
+		store.norms_ = PackedArray(norms_);
+		store.crawl_times_ = PackedArray(crawl_times_);
+		return store;
+	}
+
+private:
+	std::vector<std::string> urls_;
+	std::vector<uint64_t> lengths_;
+	std::vector<uint64_t> norms_;
+	std::vector<uint64_t> crawl_times_;
+
+	// Round to nearest even on the upper 16 bits of the float
+	static uint64_t to_bfloat16(float val) {
+		uint32_t bits;
+		std::memcpy(&bits, &val, sizeof(bits));
+		bits += 0x7FFF + ((bits >> 16) & 1);
+		return bits >> 16;
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,436 @@
+// fst header file
+//
+// Term dictionary as a minimal acyclic finite-state transducer mapping byte
+// strings to uint64_t values (termIDs). Shared prefixes are stored once, as
+// in a trie, and so are shared suffixes: FstBuilder freezes each node once
+// the sorted input has moved past it, and a registry of frozen nodes maps
+// identical nodes to one address. Outputs live on the arcs and are pushed
+// as close to the root as they can go, so a key's value is the sum of the
+// outputs along its path plus the output of its final node.
+//
+// The compiled FST is one byte string, nodes written bottom up:
+//
+//   node     varint (arc count << 1 | final), [varint final output],
+//            arcs in label order
+//   arc      label byte, varint output, varint (node address - target)
+//   footer   root address and key count, 8 bytes each
+//
+// Fst walks that string in place. Besides exact lookups it enumerates
+// keys by prefix, by wildcard pattern ('?' is any byte, '*' any run of
+// bytes) and by Levenshtein distance. Wildcard and fuzzy matching run an
+// automaton over the FST: each step carries the automaton's state (a set
+// of pattern positions, or a row of the edit distance table) down an arc,
+// and a branch is dropped as soon as no key below it can match. So only
+// the part of the dictionary near the query is ever visited.
+
+#ifndef SE_FST_H
+#define SE_FST_H
+
+#include "coding.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SE {
+
+class FstBuilder {
+public:
+	FstBuilder() : count_(0), finished_(false) {
+		stack_.resize(1);
+	}
+
+	// Keys must come in strictly increasing byte order
+	void add(const std::string &key, uint64_t value) {
+		if (finished_) {
+			throw "Cannot add to a finished FST!";
+		}
+		if (count_ > 0 && key <= last_) {
+			throw "FST keys must be added in increasing order!";
+		}
+
+		unsigned long prefix = 0;
+		while (prefix < key.size() && prefix < last_.size() && key[prefix] == last_[prefix]) {
+			prefix++;
+		}
+		freeze(prefix);
+
+		// Keep what the shared arcs have in common with value and push the
+		// rest of their outputs down to the node after them
+		for (unsigned long i = 0; i < prefix; i++) {
+			Arc &arc = stack_[i].arcs.back();
+			uint64_t common = std::min(arc.output, value);
+			uint64_t rest = arc.output - common;
+			arc.output = common;
+			value -= common;
+			if (rest > 0) {
+				Node &next = stack_[i + 1];
+				for (Arc &a : next.arcs) {
+					a.output += rest;
+				}
+				if (next.final) {
+					next.final_output += rest;
+				}
+			}
+		}
+
+		if (prefix == key.size()) {
+			// Only the empty key, added first
+			stack_[prefix].final = true;
+			stack_[prefix].final_output = value;
+		} else {
+			stack_[prefix].arcs.push_back({ (uint8_t) key[prefix], value, 0 });
+			for (unsigned long i = prefix + 1; i <= key.size(); i++) {
+				stack_.emplace_back();
+				if (i < key.size()) {
+					stack_.back().arcs.push_back({ (uint8_t) key[i], 0, 0 });
+				}
+			}
+			stack_.back().final = true;
+		}
+		last_ = key;
+		count_++;
+	}
+
+	unsigned long size() const {
+		return count_;
+	}
+
+	// Distinct nodes so far
+	unsigned long nodes() const {
+		return registry_.size();
+	}
+
+	// The compiled FST; the builder is done afterwards
+	std::string finish() {
+		if (finished_) {
+			throw "FST already finished!";
+		}
+		finished_ = true;
+		freeze(0);
+		uint64_t root = compile(stack_[0]);
+		char footer[16];
+		std::memcpy(footer, &root, 8);
+		uint64_t count = count_;
+		std::memcpy(footer + 8, &count, 8);
+		bytes_.append(footer, sizeof(footer));
+		registry_.clear();
+		return std::move(bytes_);
+	}
+
+private:
+	struct Arc {
+		uint8_t label;
+		uint64_t output;
+		uint64_t target;
+	};
+
+	struct Node {
+		std::vector<Arc> arcs;
+		bool final = false;
+		uint64_t final_output = 0;
+	};
+
+	std::vector<Node> stack_;  // stack_[i]: node after the first i bytes of last_
+	std::string last_;
+	unsigned long count_;
+	bool finished_;
+	std::string bytes_;
+	std::unordered_map<std::string, uint64_t> registry_;  // node with absolute targets -> address
+	std::string key_;
+
+
+	// Compiles the nodes past depth into their parents' last arcs
+	void freeze(unsigned long depth) {
+		for (unsigned long i = stack_.size() - 1; i > depth; i--) {
+			stack_[i - 1].arcs.back().target = compile(stack_[i]);
+		}
+		stack_.resize(depth + 1);
+	}
+
+	uint64_t compile(const Node &node) {
+		key_.clear();
+		write_header(key_, node);
+		for (const Arc &arc : node.arcs) {
+			write_arc(key_, arc, arc.target);
+		}
+		auto found = registry_.find(key_);
+		if (found != registry_.end()) {
+			return found->second;
+		}
+
+		uint64_t address = bytes_.size();
+		write_header(bytes_, node);
+		for (const Arc &arc : node.arcs) {
+			write_arc(bytes_, arc, address - arc.target);
+		}
+		registry_.emplace(key_, address);
+		return address;
+	}
+
+	static void write_header(std::string &out, const Node &node) {
+		write_varint(out, node.arcs.size() << 1 | node.final);
+		if (node.final) {
+			write_varint(out, node.final_output);
+		}
+	}
+
+	static void write_arc(std::string &out, const Arc &arc, uint64_t target) {
+		out.push_back((char) arc.label);
+		write_varint(out, arc.output);
+		write_varint(out, target);
+	}
+};
+
+
+class Fst {
+public:
+	Fst() {
+		FstBuilder empty;
+		load(empty.finish());
+	}
+
+	// bytes as returned by FstBuilder::finish()
+	explicit Fst(std::string bytes) {
+		load(std::move(bytes));
+	}
+
+	// Keys stored
+	unsigned long size() const {
+		return count_;
+	}
+
+	const std::string& data() const {
+		return bytes_;
+	}
+
+	// Value of key; false if absent
+	bool get(const std::string &key, uint64_t &value) const {
+		uint64_t address = root_, output = 0;
+		for (unsigned char c : key) {
+			Node node = read_node(address);
+			Arc arc;
+			bool found = false;
+			for (unsigned long i = 0; i < node.arcs; i++) {
+				read_arc(node, arc);
+				if (arc.label >= c) {
+					found = arc.label == c;
+					break;
+				}
+			}
+			if (!found) {
+				return false;
+			}
+			output += arc.output;
+			address = arc.target;
+		}
+		Node node = read_node(address);
+		if (!node.final) {
+			return false;
+		}
+		value = output + node.final_output;
+		return true;
+	}
+
+	// Calls f(key, value) for every key, in byte order
+	template<class F>
+	void each(F f) const {
+		std::string key;
+		enumerate(root_, key, 0, f);
+	}
+
+	// Calls f(key, value) for the keys starting with prefix, in byte order
+	template<class F>
+	void prefix(const std::string &prefix, F f) const {
+		uint64_t address = root_, output = 0;
+		for (unsigned char c : prefix) {
+			Node node = read_node(address);
+			Arc arc;
+			bool found = false;
+			for (unsigned long i = 0; i < node.arcs && !found; i++) {
+				read_arc(node, arc);
+				found = arc.label == c;
+			}
+			if (!found) {
+				return;
+			}
+			output += arc.output;
+			address = arc.target;
+		}
+		std::string key(prefix);
+		enumerate(address, key, output, f);
+	}
+
+	// Calls f(key, value) for the keys matching pattern, in byte order;
+	// '?' matches one byte and '*' any number of bytes
+	template<class F>
+	void wildcard(const std::string &pattern, F f) const {
+		if (pattern.size() >= 64) {
+			throw "Wildcard pattern too long!";
+		}
+		std::string key;
+		wildcard_walk(root_, key, 0, closure(pattern, 1), pattern, f);
+	}
+
+	// Calls f(key, value, distance) for the keys within max_edits byte
+	// insertions, deletions and substitutions of term, in byte order
+	template<class F>
+	void fuzzy(const std::string &term, unsigned long max_edits, F f) const {
+		unsigned long width = term.size() + 1;
+		std::vector<uint32_t> rows(width);
+		for (unsigned long j = 0; j < width; j++) {
+			rows[j] = (uint32_t) j;
+		}
+		std::string key;
+		fuzzy_walk(root_, key, 0, term, (uint32_t) max_edits, rows, f);
+	}
+
+private:
+	struct Node {
+		const char* next;     // next arc to read
+		uint64_t address;
+		unsigned long arcs;
+		bool final;
+		uint64_t final_output;
+	};
+
+	struct Arc {
+		uint8_t label;
+		uint64_t output;
+		uint64_t target;
+	};
+
+	std::string bytes_;
+	uint64_t root_;
+	unsigned long count_;
+
+
+	void load(std::string bytes) {
+		if (bytes.size() < 16) {
+			throw "Truncated FST!";
+		}
+		bytes_ = std::move(bytes);
+		uint64_t count;
+		std::memcpy(&root_, bytes_.data() + bytes_.size() - 16, 8);
+		std::memcpy(&count, bytes_.data() + bytes_.size() - 8, 8);
+		count_ = count;
+		if (root_ >= bytes_.size() - 16) {
+			throw "Corrupt FST!";
+		}
+	}
+
+	Node read_node(uint64_t address) const {
+		Node node;
+		const char* in = bytes_.data() + address;
+		uint64_t header = read_varint(in);
+		node.address = address;
+		node.arcs = header >> 1;
+		node.final = header & 1;
+		node.final_output = node.final ? read_varint(in) : 0;
+		node.next = in;
+		return node;
+	}
+
+	static void read_arc(Node &node, Arc &arc) {
+		arc.label = (uint8_t) *node.next++;
+		arc.output = read_varint(node.next);
+		arc.target = node.address - read_varint(node.next);
+	}
+
+	template<class F>
+	void enumerate(uint64_t address, std::string &key, uint64_t output, F &f) const {
+		Node node = read_node(address);
+		if (node.final) {
+			f(key, output + node.final_output);
+		}
+		Arc arc;
+		for (unsigned long i = 0; i < node.arcs; i++) {
+			read_arc(node, arc);
+			key.push_back((char) arc.label);
+			enumerate(arc.target, key, output + arc.output, f);
+			key.pop_back();
+		}
+	}
+
+	// Pattern positions reachable from states by letting '*' match nothing
+	static uint64_t closure(const std::string &pattern, uint64_t states) {
+		for (unsigned long i = 0; i < pattern.size(); i++) {
+			if ((states >> i & 1) && pattern[i] == '*') {
+				states |= 1ULL << (i + 1);
+			}
+		}
+		return states;
+	}
+
+	template<class F>
+	void wildcard_walk(uint64_t address, std::string &key, uint64_t output, uint64_t states,
+			const std::string &pattern, F &f) const {
+		Node node = read_node(address);
+		if (node.final && (states >> pattern.size() & 1)) {
+			f(key, output + node.final_output);
+		}
+		Arc arc;
+		for (unsigned long i = 0; i < node.arcs; i++) {
+			read_arc(node, arc);
+			uint64_t next = 0;
+			for (unsigned long p = 0; p < pattern.size(); p++) {
+				if (!(states >> p & 1)) {
+					continue;
+				}
+				if (pattern[p] == '*') {
+					next |= 1ULL << p;
+				} else if (pattern[p] == '?' || (uint8_t) pattern[p] == arc.label) {
+					next |= 1ULL << (p + 1);
+				}
+			}
+			next = closure(pattern, next);
+			if (next != 0) {
+				key.push_back((char) arc.label);
+				wildcard_walk(arc.target, key, output + arc.output, next, pattern, f);
+				key.pop_back();
+			}
+		}
+	}
+
+	// rows holds one edit distance row per byte of key: the distances from
+	// key to each prefix of term. A branch ends when its row's minimum
+	// exceeds max_edits, as rows never decrease along a path.
+	template<class F>
+	void fuzzy_walk(uint64_t address, std::string &key, uint64_t output, const std::string &term, uint32_t max_edits,
+			std::vector<uint32_t> &rows, F &f) const {
+		unsigned long width = term.size() + 1;
+		unsigned long depth = key.size();
+		Node node = read_node(address);
+		uint32_t distance = rows[depth * width + term.size()];
+		if (node.final && distance <= max_edits) {
+			f(key, output + node.final_output, (unsigned long) distance);
+		}
+
+		rows.resize(std::max(rows.size(), (depth + 2) * width));
+		Arc arc;
+		for (unsigned long i = 0; i < node.arcs; i++) {
+			read_arc(node, arc);
+			const uint32_t* previous = rows.data() + depth * width;
+			uint32_t* row = rows.data() + (depth + 1) * width;
+			row[0] = previous[0] + 1;
+			uint32_t best = row[0];
+			for (unsigned long j = 1; j < width; j++) {
+				uint32_t substitute = previous[j - 1] + ((uint8_t) term[j - 1] != arc.label);
+				row[j] = std::min(std::min(previous[j], row[j - 1]) + 1, substitute);
+				best = std::min(best, row[j]);
+			}
+			if (best <= max_edits) {
+				key.push_back((char) arc.label);
+				fuzzy_walk(arc.target, key, output + arc.output, term, max_edits, rows, f);
+				key.pop_back();
+			}
+		}
+	}
+};
+
+
+}
+#endif
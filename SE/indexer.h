@@ -0,0 +1,1046 @@
+// indexer header file
+//
+// External-memory inverted index construction for corpora larger than RAM.
+// IndexBuilder accepts tokenized documents and keeps (term, doc, tf)
+// postings in a buffer sized from memory_budget. When the buffer fills it
+// is radix sorted and spilled to a run file. finish() merges the runs into
+// the final index:
+//
+//   add(terms) ... add(terms)      buffer, sort, spill run-0, run-1, ...
+//   finish()                       merge passes of at most fan_in runs,
+//                                  then the last pass writes the index
+//
+// Runs and postings are delta and varint coded. Runs are read through
+// fixed read_buffer windows, and the kernel is asked to prefetch the next
+// window while the current one is decoded. So a merge needs fan_in read
+// windows and the output's write buffers, however large the runs are.
+// fan_in is what the budget holds of those beside the vocabulary; when it
+// cannot hold two full windows, the windows shrink. When there are more
+// runs than one merge can read, intermediate passes merge them into fewer,
+// longer runs.
+//
+// Only the vocabulary (term strings and IDs) stays in memory for the whole
+// build; it is counted against the budget.
+//
+// The index directory holds three files, four with positions:
+//
+//   postings    - per term: (doc gap, tf) varint pairs in docID order
+//   positions   - per posting: byte length, then tf position gaps
+//   lexicon     - terms in byte order with document frequency and the byte
+//                 ranges of their postings and positions
+//   dictionary  - FST (fst.h) from each term to its rank in the lexicon
+//
+// Positions are optional (IndexBuilderOptions::positions) and travel
+// through the runs with their postings. Each position list is prefixed by
+// its length so readers skip lists they don't need without decoding them.
+//
+// InvertedIndex opens such a directory, keeps the dictionary and the
+// lexicon entries but not the term strings in memory, and reads posting
+// lists on demand with pread. The dictionary also expands prefix, wildcard
+// and fuzzy query terms.
+
+#ifndef SE_INDEXER_H
+#define SE_INDEXER_H
+
+#include "coding.h"
+#include "fst.h"
+#include "instrument.h"
+
+#include "algorithm.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SE_DEFINE_COUNTER(postings_spilled);
+SE_DEFINE_COUNTER(runs_written);
+SE_DEFINE_COUNTER(positions_decoded);
+
+namespace SE {
+
+struct Posting {
+	uint32_t term;
+	uint32_t doc;
+	uint32_t tf;
+	uint32_t positions = 0;  // offset of its tf positions in the builder's pool
+};
+
+// Lexicon flag: the index has a positions file
+const unsigned long LEXICON_POSITIONS = 1;
+
+// Document filter of every document. Filtered queries over postings take
+// any set with next(doc) returning its smallest member >= doc, or a value
+// past every docID once there is none (SL::bitvector, SL::roaring_bitmap);
+// the unfiltered ones pass this.
+struct AllDocuments {
+	unsigned long next(unsigned long doc) const {
+		return doc;
+	}
+};
+
+struct IndexBuilderOptions {
+	unsigned long memory_budget = 256UL << 20;  // postings buffer, its sort scratch and the vocabulary
+	unsigned long read_buffer = 1UL << 20;      // per run while merging
+	unsigned long write_buffer = 1UL << 20;
+	bool positions = false;                     // for phrase and proximity queries
+};
+
+struct IndexBuildStats {
+	unsigned long documents = 0;
+	unsigned long postings = 0;
+	unsigned long terms = 0;
+	unsigned long runs = 0;           // runs spilled while adding
+	unsigned long merge_passes = 0;   // including the final one
+	unsigned long bytes_spilled = 0;  // run bytes written, over all passes
+	unsigned long positions = 0;      // term occurrences stored, 0 without positions
+	unsigned long index_bytes = 0;    // every index file
+	unsigned long peak_bytes = 0;     // largest buffers or merge windows + vocabulary estimate
+	double add_seconds = 0;
+	double merge_seconds = 0;
+};
+
+
+// Run Files
+
+// Buffered sequential writer over a file descriptor
+class FileWriter {
+public:
+	FileWriter(const std::string &path, unsigned long buffer_size) : written_(0), buffer_size_(buffer_size) {
+		fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd_ < 0) {
+			throw "Cannot create index file!";
+		}
+		buffer_.reserve(buffer_size_);
+	}
+
+	FileWriter(const FileWriter &) = delete;
+	FileWriter& operator=(const FileWriter &) = delete;
+
+	~FileWriter() {
+		if (fd_ >= 0) {
+			::close(fd_);
+		}
+	}
+
+	std::string& buffer() {
+		return buffer_;
+	}
+
+	// Flushes once the buffer is full
+	void maybe_flush() {
+		if (buffer_.size() >= buffer_size_) {
+			flush();
+		}
+	}
+
+	void flush() {
+		const char* data = buffer_.data();
+		unsigned long left = buffer_.size();
+		while (left > 0) {
+			ssize_t n = ::write(fd_, data, left);
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw "Cannot write index file!";
+			}
+			data += n;
+			left -= n;
+		}
+		written_ += buffer_.size();
+		buffer_.clear();
+	}
+
+	void close() {
+		flush();
+		if (::close(fd_) != 0) {
+			fd_ = -1;
+			throw "Cannot write index file!";
+		}
+		fd_ = -1;
+	}
+
+	// Bytes written so far, including the buffer
+	unsigned long offset() const {
+		return written_ + buffer_.size();
+	}
+
+private:
+	int fd_;
+	unsigned long written_;
+	unsigned long buffer_size_;
+	std::string buffer_;
+};
+
+// Streams the records of a run through a window of buffer_size bytes. Each
+// refill asks the kernel to start reading the window after it, so the disk
+// works while the merge decodes.
+class RunReader {
+public:
+	RunReader(const std::string &path, unsigned long buffer_size, bool positions = false) :
+			window_(std::max(buffer_size, 2 * MAX_RECORD)), file_offset_(0), pos_(0), end_(0),
+			eof_(false), term_(0), doc_(0), tf_(0), valid_(false), has_positions_(positions) {
+		fd_ = ::open(path.c_str(), O_RDONLY);
+		if (fd_ < 0) {
+			throw "Cannot open run file!";
+		}
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		buffer_.resize(window_);
+		next();
+	}
+
+	RunReader(const RunReader &) = delete;
+	RunReader& operator=(const RunReader &) = delete;
+
+	~RunReader() {
+		::close(fd_);
+	}
+
+	bool valid() const {
+		return valid_;
+	}
+
+	// Bytes buffered from the run
+	unsigned long window() const {
+		return window_;
+	}
+
+	uint64_t key() const {
+		return (uint64_t) term_ << 32 | doc_;
+	}
+
+	Posting posting() const {
+		return { term_, doc_, tf_ };
+	}
+
+	// Positions of the current record, nullptr for runs without them
+	const uint32_t* positions() const {
+		return has_positions_ ? positions_.data() : nullptr;
+	}
+
+	// Advances to the next record; valid() turns false at the end
+	void next() {
+		if (end_ - pos_ < MAX_RECORD && !eof_) {
+			refill();
+		}
+		if (pos_ == end_) {
+			valid_ = false;
+			return;
+		}
+
+		const char* in = buffer_.data() + pos_;
+		uint32_t term_gap = (uint32_t) read_varint(in);
+		uint32_t doc = (uint32_t) read_varint(in);
+		tf_ = (uint32_t) read_varint(in);
+		if (in > buffer_.data() + end_) {
+			throw "Truncated run file!";
+		}
+		pos_ = in - buffer_.data();
+
+		doc_ = (term_gap == 0 && valid_) ? doc_ + doc : doc;
+		term_ += term_gap;
+		valid_ = true;
+
+		// Position lists have no bound, so refill varint by varint
+		if (has_positions_) {
+			positions_.resize(tf_);
+			uint32_t position = 0;
+			for (uint32_t i = 0; i < tf_; i++) {
+				if (end_ - pos_ < MAX_VARINT && !eof_) {
+					refill();
+				}
+				const char* at = buffer_.data() + pos_;
+				position = i == 0 ? (uint32_t) read_varint(at) : position + (uint32_t) read_varint(at);
+				if (at > buffer_.data() + end_) {
+					throw "Truncated run file!";
+				}
+				pos_ = at - buffer_.data();
+				positions_[i] = position;
+			}
+		}
+	}
+
+private:
+	// Three varints of up to five bytes
+	static constexpr unsigned long MAX_VARINT = 5;
+	static constexpr unsigned long MAX_RECORD = 3 * MAX_VARINT;
+
+	int fd_;
+	std::vector<char> buffer_;
+	unsigned long window_;
+	unsigned long file_offset_;
+	unsigned long pos_;
+	unsigned long end_;
+	bool eof_;
+
+	uint32_t term_;
+	uint32_t doc_;
+	uint32_t tf_;
+	bool valid_;
+	bool has_positions_;
+	std::vector<uint32_t> positions_;
+
+	void refill() {
+		unsigned long left = end_ - pos_;
+		std::memmove(buffer_.data(), buffer_.data() + pos_, left);
+		pos_ = 0;
+		end_ = left;
+
+		while (end_ < window_ && !eof_) {
+			ssize_t n = ::pread(fd_, buffer_.data() + end_, window_ - end_, file_offset_);
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw "Cannot read run file!";
+			}
+			eof_ = n == 0;
+			file_offset_ += n;
+			end_ += n;
+		}
+#ifdef POSIX_FADV_WILLNEED
+		if (!eof_) {
+			posix_fadvise(fd_, file_offset_, window_, POSIX_FADV_WILLNEED);
+		}
+#endif
+	}
+};
+
+// Appends one run record, delta coded against the previous one, followed
+// by the gaps between its tf positions if there are any
+inline void write_run_record(std::string &out, const Posting &posting, Posting &last, bool first,
+		const uint32_t* positions = nullptr) {
+	uint32_t term_gap = first ? posting.term : posting.term - last.term;
+	write_varint(out, term_gap);
+	write_varint(out, (term_gap == 0 && !first) ? posting.doc - last.doc : posting.doc);
+	write_varint(out, posting.tf);
+	if (positions) {
+		for (uint32_t i = 0; i < posting.tf; i++) {
+			write_varint(out, i == 0 ? positions[0] : positions[i] - positions[i - 1]);
+		}
+	}
+	last = posting;
+}
+
+
+// Builder
+
+class IndexBuilder {
+public:
+	// directory must exist; runs and the index files are written there
+	IndexBuilder(const std::string &directory, IndexBuilderOptions options = IndexBuilderOptions()) :
+			directory_(directory), options_(options), vocabulary_bytes_(0), next_run_(0), finished_(false) {
+		if (options_.read_buffer == 0 || options_.write_buffer == 0) {
+			throw "Index builder buffers must not be empty!";
+		}
+		if (options_.memory_budget < 2 * options_.read_buffer
+				|| options_.memory_budget < 2 * MIN_RUN * sizeof(Posting)) {
+			throw "Memory budget must hold at least two read buffers and one run!";
+		}
+		struct stat st;
+		if (::stat(directory_.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+			throw "Index directory does not exist!";
+		}
+		start_ = std::chrono::steady_clock::now();
+	}
+
+	IndexBuilder(const IndexBuilder &) = delete;
+	IndexBuilder& operator=(const IndexBuilder &) = delete;
+
+	~IndexBuilder() {
+		for (const std::string &path : runs_) {
+			::unlink(path.c_str());
+		}
+	}
+
+	// Adds the next document and returns its docID; docIDs count up from 0.
+	// A term's positions are its indexes in terms.
+	uint32_t add(const std::vector<std::string> &terms) {
+		if (finished_) {
+			throw "Cannot add to a finished index!";
+		}
+		uint32_t doc = (uint32_t) stats_.documents++;
+
+		// (termID, position) keys: sorted, each term's positions ascend
+		doc_terms_.clear();
+		for (unsigned long position = 0; position < terms.size(); position++) {
+			doc_terms_.push_back((uint64_t) term_id(terms[position]) << 32 | position);
+		}
+		std::sort(doc_terms_.begin(), doc_terms_.end());
+
+		for (unsigned long i = 0; i < doc_terms_.size();) {
+			uint32_t term = (uint32_t) (doc_terms_[i] >> 32);
+			unsigned long j = i;
+			while (j < doc_terms_.size() && (uint32_t) (doc_terms_[j] >> 32) == term) {
+				j++;
+			}
+			// New terms shrink the room left for the buffer
+			unsigned long capacity = buffer_capacity();
+			bool pool_full = options_.positions && position_pool_.size() + (j - i) > pool_capacity();
+			if (buffer_.size() >= capacity || (buffer_.size() > 0 && (pool_full || used_bytes() > options_.memory_budget))) {
+				spill();
+				// The next run reuses the storage, except what the vocabulary
+				// has since claimed: kept, every later posting would be over
+				// budget and spill a run of its own
+				if (buffer_.capacity() > capacity) {
+					buffer_ = SL::vector<Posting>();
+				}
+				if (position_pool_.capacity() > pool_capacity()) {
+					position_pool_ = SL::vector<uint32_t>();
+				}
+			}
+			if (buffer_.size() == buffer_.capacity()) {
+				// Grow by hand so doubling never overshoots the budget
+				buffer_.reserve(std::min(std::max(2 * buffer_.size(), 1024UL), capacity));
+			}
+
+			Posting posting = { term, doc, (uint32_t) (j - i), (uint32_t) position_pool_.size() };
+			if (options_.positions) {
+				if (position_pool_.size() + (j - i) > position_pool_.capacity()) {
+					unsigned long grown = std::min(std::max(2 * position_pool_.size(), 1024UL), pool_capacity());
+					position_pool_.reserve(std::max(grown, position_pool_.size() + (j - i)));
+				}
+				for (unsigned long k = i; k < j; k++) {
+					position_pool_.push_back((uint32_t) doc_terms_[k]);
+				}
+				stats_.positions += j - i;
+			}
+			buffer_.push_back(posting);
+			stats_.postings++;
+			i = j;
+		}
+		stats_.peak_bytes = std::max(stats_.peak_bytes, used_bytes());
+		return doc;
+	}
+
+	// Merges every run into the index files; the builder is done afterwards
+	void finish() {
+		if (finished_) {
+			throw "Index already finished!";
+		}
+		finished_ = true;
+		if (buffer_.size() > 0 || runs_.empty()) {
+			spill();
+		}
+		buffer_ = SL::vector<Posting>();
+		position_pool_ = SL::vector<uint32_t>();
+		// Term lookups are over; the hash map's share of the vocabulary
+		// estimate covers the lexicon entries of the last pass
+		std::unordered_map<std::string, uint32_t>().swap(ids_);
+		stats_.runs = runs_.size();
+		stats_.terms = terms_.size();
+		auto merge_start = std::chrono::steady_clock::now();
+		stats_.add_seconds = seconds_between(start_, merge_start);
+
+		// Intermediate passes until one merge can take every run
+		unsigned long fan = fan_in();
+		while (runs_.size() > fan) {
+			std::vector<std::string> next;
+			for (unsigned long begin = 0; begin < runs_.size(); begin += fan) {
+				unsigned long end = std::min(begin + fan, (unsigned long) runs_.size());
+				std::vector<std::string> group(runs_.begin() + begin, runs_.begin() + end);
+				if (group.size() == 1) {
+					next.push_back(group[0]);
+					continue;
+				}
+				std::string path = run_path(next_run_++);
+				merge_to_run(group, path);
+				next.push_back(path);
+				for (const std::string &done : group) {
+					::unlink(done.c_str());
+				}
+			}
+			runs_ = next;
+			stats_.merge_passes++;
+		}
+
+		merge_to_index();
+		stats_.merge_passes++;
+		for (const std::string &path : runs_) {
+			::unlink(path.c_str());
+		}
+		runs_.clear();
+		stats_.merge_seconds = seconds_between(merge_start, std::chrono::steady_clock::now());
+	}
+
+	const IndexBuildStats& stats() const {
+		return stats_;
+	}
+
+	// Runs one merge can read at once through read_buffer windows, within
+	// what the vocabulary and the output's write buffers leave of the budget
+	unsigned long fan_in() const {
+		return std::max(merge_bytes() / options_.read_buffer, 2UL);
+	}
+
+	void print_stats(FILE* out) const {
+		double total = stats_.add_seconds + stats_.merge_seconds;
+		fprintf(out, "documents %lu, postings %lu, terms %lu, positions %lu\n", stats_.documents, stats_.postings,
+				stats_.terms, stats_.positions);
+		fprintf(out, "runs %lu, merge passes %lu, spilled %.1f MB, index %.1f MB, peak memory %.1f MB\n",
+				stats_.runs, stats_.merge_passes, stats_.bytes_spilled / 1e6, stats_.index_bytes / 1e6,
+				stats_.peak_bytes / 1e6);
+		fprintf(out, "add %.3f s, merge %.3f s, %.0f postings/s\n", stats_.add_seconds, stats_.merge_seconds,
+				total > 0 ? stats_.postings / total : 0.0);
+	}
+
+private:
+	// Rough heap cost of a vocabulary entry beyond its characters: the hash
+	// node, the bucket and the terms_ slot
+	static constexpr unsigned long TERM_OVERHEAD = 96;
+	static constexpr unsigned long MIN_RUN = 4096;
+
+	std::string directory_;
+	IndexBuilderOptions options_;
+	IndexBuildStats stats_;
+
+	std::unordered_map<std::string, uint32_t> ids_;
+	std::vector<std::string> terms_;  // termID -> term
+	unsigned long vocabulary_bytes_;
+
+	SL::vector<Posting> buffer_;
+	SL::vector<uint32_t> position_pool_;  // positions of the buffered postings
+	std::vector<uint64_t> doc_terms_;
+	std::vector<std::string> runs_;
+	unsigned long next_run_;
+	bool finished_;
+	std::chrono::steady_clock::time_point start_;
+
+
+	static double seconds_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+		return std::chrono::duration<double>(b - a).count();
+	}
+
+	uint32_t term_id(const std::string &term) {
+		auto found = ids_.find(term);
+		if (found != ids_.end()) {
+			return found->second;
+		}
+		uint32_t id = (uint32_t) terms_.size();
+		ids_.emplace(term, id);
+		terms_.push_back(term);
+		vocabulary_bytes_ += 2 * term.size() + TERM_OVERHEAD;
+		return id;
+	}
+
+	// The buffer and the radix sort's scratch copy share what the
+	// vocabulary leaves of the budget, less a quarter for the position pool
+	// when there is one. Runs shorter than MIN_RUN would bury the merge in
+	// files, so a vocabulary that crowds them out fails.
+	unsigned long buffer_capacity() const {
+		unsigned long left = left_bytes();
+		if (options_.positions) {
+			left -= left / 4;
+		}
+		unsigned long capacity = left / (2 * sizeof(Posting));
+		if (capacity < MIN_RUN) {
+			throw "Vocabulary does not fit in the memory budget!";
+		}
+		return capacity;
+	}
+
+	unsigned long pool_capacity() const {
+		return left_bytes() / 4 / sizeof(uint32_t);
+	}
+
+	unsigned long left_bytes() const {
+		return options_.memory_budget > vocabulary_bytes_ ? options_.memory_budget - vocabulary_bytes_ : 0;
+	}
+
+	// Write buffers of a merge's output: postings, and positions if kept
+	unsigned long write_bytes() const {
+		return (options_.positions ? 2 : 1) * options_.write_buffer;
+	}
+
+	unsigned long merge_bytes() const {
+		unsigned long left = left_bytes();
+		return left > write_bytes() ? left - write_bytes() : 0;
+	}
+
+	// Read window per run: read_buffer, or an even share of merge_bytes()
+	// when the budget is too tight for a full window each
+	unsigned long read_window(unsigned long runs) const {
+		return std::max(std::min(options_.read_buffer, merge_bytes() / std::max(runs, 1UL)), 1UL);
+	}
+
+	unsigned long used_bytes() const {
+		return 2 * buffer_.capacity() * sizeof(Posting) + position_pool_.capacity() * sizeof(uint32_t)
+				+ vocabulary_bytes_;
+	}
+
+	std::string run_path(unsigned long n) const {
+		return directory_ + "/run-" + std::to_string(n);
+	}
+
+	void spill() {
+		SL::radix_sort_by_key(buffer_, [](const Posting &p) {
+			return (uint64_t) p.term << 32 | p.doc;
+		});
+
+		std::string path = run_path(next_run_++);
+		FileWriter writer(path, options_.write_buffer);
+		runs_.push_back(path);
+		Posting last = {};
+		const Posting* postings = buffer_.data();
+		const uint32_t* pool = position_pool_.data();
+		for (unsigned long i = 0; i < buffer_.size(); i++) {
+			const uint32_t* positions = options_.positions ? pool + postings[i].positions : nullptr;
+			write_run_record(writer.buffer(), postings[i], last, i == 0, positions);
+			writer.maybe_flush();
+		}
+		writer.close();
+
+		stats_.bytes_spilled += writer.offset();
+		SE_COUNT(postings_spilled, buffer_.size());
+		SE_COUNT(runs_written, 1);
+		buffer_.clear();
+		position_pool_.clear();
+	}
+
+	// Calls emit(posting, positions) for every record of the runs in
+	// (term, doc) order; positions is nullptr without positions
+	template<class Emit>
+	void merge(const std::vector<std::string> &paths, Emit emit) {
+		std::vector<std::unique_ptr<RunReader>> readers;
+		typedef std::pair<uint64_t, unsigned long> Head;
+		std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+		unsigned long window = read_window(paths.size());
+		unsigned long bytes = vocabulary_bytes_ + write_bytes();
+		for (const std::string &path : paths) {
+			readers.emplace_back(new RunReader(path, window, options_.positions));
+			bytes += readers.back()->window();
+			if (readers.back()->valid()) {
+				heap.push({ readers.back()->key(), readers.size() - 1 });
+			}
+		}
+		stats_.peak_bytes = std::max(stats_.peak_bytes, bytes);
+
+		while (!heap.empty()) {
+			unsigned long r = heap.top().second;
+			heap.pop();
+			RunReader &reader = *readers[r];
+			emit(reader.posting(), reader.positions());
+			reader.next();
+			if (reader.valid()) {
+				heap.push({ reader.key(), r });
+			}
+		}
+	}
+
+	void merge_to_run(const std::vector<std::string> &paths, const std::string &path) {
+		FileWriter writer(path, options_.write_buffer);
+		Posting last = {};
+		bool first = true;
+		merge(paths, [&](const Posting &posting, const uint32_t* positions) {
+			write_run_record(writer.buffer(), posting, last, first, positions);
+			writer.maybe_flush();
+			first = false;
+		});
+		writer.close();
+		stats_.bytes_spilled += writer.offset();
+	}
+
+	// The last pass: postings (and positions) grouped per term, then the lexicon
+	void merge_to_index() {
+		struct Entry {
+			uint64_t offset = 0;
+			uint64_t bytes = 0;
+			uint64_t positions_offset = 0;
+			uint64_t positions_bytes = 0;
+			uint32_t df = 0;
+		};
+		std::vector<Entry> entries(terms_.size());
+
+		FileWriter postings(directory_ + "/postings", options_.write_buffer);
+		std::unique_ptr<FileWriter> positions;
+		if (options_.positions) {
+			positions.reset(new FileWriter(directory_ + "/positions", options_.write_buffer));
+		}
+		auto close_term = [&](uint32_t term) {
+			entries[term].bytes = postings.offset() - entries[term].offset;
+			if (positions) {
+				entries[term].positions_bytes = positions->offset() - entries[term].positions_offset;
+			}
+		};
+
+		uint32_t term = 0, last_doc = 0;
+		bool open = false;
+		std::string list;
+		merge(runs_, [&](const Posting &posting, const uint32_t* pos) {
+			if (!open || posting.term != term) {
+				if (open) {
+					close_term(term);
+				}
+				term = posting.term;
+				entries[term].offset = postings.offset();
+				entries[term].positions_offset = positions ? positions->offset() : 0;
+				last_doc = 0;
+				open = true;
+			} else if (posting.doc <= last_doc) {
+				throw "Duplicate posting in runs!";
+			}
+			write_varint(postings.buffer(), entries[term].df == 0 ? posting.doc : posting.doc - last_doc);
+			write_varint(postings.buffer(), posting.tf);
+			postings.maybe_flush();
+			if (positions) {
+				list.clear();
+				for (uint32_t i = 0; i < posting.tf; i++) {
+					write_varint(list, i == 0 ? pos[0] : pos[i] - pos[i - 1]);
+				}
+				write_varint(positions->buffer(), list.size());
+				positions->buffer().append(list);
+				positions->maybe_flush();
+			}
+			entries[term].df++;
+			last_doc = posting.doc;
+		});
+		if (open) {
+			close_term(term);
+		}
+		postings.close();
+		if (positions) {
+			positions->close();
+			stats_.index_bytes += positions->offset();
+		}
+
+		// Lexicon in term byte order
+		std::vector<uint32_t> order(terms_.size());
+		for (uint32_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+			return terms_[a] < terms_[b];
+		});
+
+		FileWriter lexicon(directory_ + "/lexicon", options_.write_buffer);
+		FstBuilder dictionary;
+		write_varint(lexicon.buffer(), terms_.size());
+		write_varint(lexicon.buffer(), options_.positions ? LEXICON_POSITIONS : 0);
+		for (uint32_t id : order) {
+			const std::string &text = terms_[id];
+			write_varint(lexicon.buffer(), text.size());
+			lexicon.buffer().append(text);
+			write_varint(lexicon.buffer(), entries[id].df);
+			write_varint(lexicon.buffer(), entries[id].offset);
+			write_varint(lexicon.buffer(), entries[id].bytes);
+			if (options_.positions) {
+				write_varint(lexicon.buffer(), entries[id].positions_offset);
+				write_varint(lexicon.buffer(), entries[id].positions_bytes);
+			}
+			lexicon.maybe_flush();
+			dictionary.add(text, dictionary.size());
+		}
+		lexicon.close();
+
+		FileWriter fst(directory_ + "/dictionary", options_.write_buffer);
+		fst.buffer() = dictionary.finish();
+		fst.close();
+		stats_.index_bytes += postings.offset() + lexicon.offset() + fst.offset();
+	}
+};
+
+
+// Reader
+
+// Posting list of one term with its position lists still encoded.
+// positions(i) skips the lists before i by their length prefixes and
+// decodes only list i, so a phrase query pays for the positions of
+// candidate documents alone. Access is cheapest in increasing i.
+class TermPositions {
+public:
+	TermPositions() : cursor_(0), offset_(0) {}
+
+	unsigned long size() const {
+		return docs_.size();
+	}
+
+	// docIDs in increasing order
+	const std::vector<uint32_t>& docs() const {
+		return docs_;
+	}
+
+	uint32_t tf(unsigned long i) const {
+		return tfs_[i];
+	}
+
+	// Replaces out with the increasing positions of posting i
+	void positions(unsigned long i, std::vector<uint32_t> &out) {
+		if (i >= docs_.size()) {
+			throw "Posting index out of range!";
+		}
+		if (i < cursor_) {
+			cursor_ = 0;
+			offset_ = 0;
+		}
+		const char* in = bytes_.data() + offset_;
+		const char* end = bytes_.data() + bytes_.size();
+		for (; cursor_ < i; cursor_++) {
+			unsigned long skip = read_varint(in);
+			in += skip;
+		}
+		offset_ = in - bytes_.data();
+
+		unsigned long length = read_varint(in);
+		if (in + length > end) {
+			throw "Truncated positions file!";
+		}
+		out.resize(tfs_[i]);
+		uint32_t position = 0;
+		for (uint32_t k = 0; k < tfs_[i]; k++) {
+			position = k == 0 ? (uint32_t) read_varint(in) : position + (uint32_t) read_varint(in);
+			out[k] = position;
+		}
+		SE_COUNT(positions_decoded, tfs_[i]);
+	}
+
+private:
+	friend class InvertedIndex;
+
+	std::vector<uint32_t> docs_;
+	std::vector<uint32_t> tfs_;
+	std::string bytes_;      // length-prefixed position lists
+	unsigned long cursor_;   // posting whose list starts at offset_
+	unsigned long offset_;
+};
+
+class InvertedIndex {
+public:
+	struct Entry {
+		uint32_t df;
+		uint64_t offset;
+		uint64_t bytes;
+		uint64_t positions_offset;
+		uint64_t positions_bytes;
+	};
+
+	InvertedIndex() : fd_(-1), positions_fd_(-1) {}
+
+	explicit InvertedIndex(const std::string &directory) : fd_(-1), positions_fd_(-1) {
+		open(directory);
+	}
+
+	InvertedIndex(const InvertedIndex &) = delete;
+	InvertedIndex& operator=(const InvertedIndex &) = delete;
+
+	~InvertedIndex() {
+		close_files();
+	}
+
+	void open(const std::string &directory) {
+		std::string data = read_file(directory + "/lexicon");
+		const char* in = data.data();
+		const char* end = data.data() + data.size();
+		unsigned long count = read_varint(in);
+		bool positional = read_varint(in) & LEXICON_POSITIONS;
+		entries_.clear();
+		entries_.reserve(count);
+		for (unsigned long i = 0; i < count; i++) {
+			// The dictionary has the strings
+			unsigned long length = read_varint(in);
+			if (in + length > end) {
+				throw "Truncated lexicon!";
+			}
+			in += length;
+			Entry entry = {};
+			entry.df = (uint32_t) read_varint(in);
+			entry.offset = read_varint(in);
+			entry.bytes = read_varint(in);
+			if (positional) {
+				entry.positions_offset = read_varint(in);
+				entry.positions_bytes = read_varint(in);
+			}
+			entries_.push_back(entry);
+		}
+		if (in > end) {
+			throw "Truncated lexicon!";
+		}
+		dictionary_ = Fst(read_file(directory + "/dictionary"));
+		if (dictionary_.size() != count) {
+			throw "Dictionary does not match the lexicon!";
+		}
+
+		close_files();
+		fd_ = ::open((directory + "/postings").c_str(), O_RDONLY);
+		if (fd_ < 0) {
+			throw "Cannot open postings file!";
+		}
+		if (positional) {
+			positions_fd_ = ::open((directory + "/positions").c_str(), O_RDONLY);
+			if (positions_fd_ < 0) {
+				throw "Cannot open positions file!";
+			}
+		}
+	}
+
+	unsigned long term_count() const {
+		return entries_.size();
+	}
+
+	bool has_positions() const {
+		return positions_fd_ >= 0;
+	}
+
+	// Document frequency of term, 0 if absent
+	uint32_t df(const std::string &term) const {
+		const Entry* entry = find(term);
+		return entry ? entry->df : 0;
+	}
+
+	// Appends (doc, tf) pairs of term in docID order to out, a vector of
+	// pairs with any allocator; returns how many. The encoded postings are
+	// read into a buffer from out's allocator, so with an arena the call
+	// allocates nothing on the heap.
+	template<class Pairs>
+	unsigned long postings(const std::string &term, Pairs &out) const {
+		const Entry* entry = find(term);
+		if (entry == nullptr) {
+			return 0;
+		}
+
+		typedef typename std::allocator_traits<typename Pairs::allocator_type>::template rebind_alloc<char> Bytes;
+		std::vector<char, Bytes> bytes(out.get_allocator());
+		read_range(fd_, entry->offset, entry->bytes, bytes);
+		const char* in = bytes.data();
+		uint32_t doc = 0;
+		for (uint32_t i = 0; i < entry->df; i++) {
+			doc = i == 0 ? (uint32_t) read_varint(in) : doc + (uint32_t) read_varint(in);
+			out.push_back({ doc, (uint32_t) read_varint(in) });
+		}
+		return entry->df;
+	}
+
+	// Loads the postings of term with their undecoded positions into out;
+	// false if the term is absent
+	bool positions(const std::string &term, TermPositions &out) const {
+		if (!has_positions()) {
+			throw "Index has no positions!";
+		}
+		out.docs_.clear();
+		out.tfs_.clear();
+		out.bytes_.clear();
+		out.cursor_ = 0;
+		out.offset_ = 0;
+		const Entry* entry = find(term);
+		if (entry == nullptr) {
+			return false;
+		}
+
+		std::string bytes;
+		read_range(fd_, entry->offset, entry->bytes, bytes);
+		const char* in = bytes.data();
+		out.docs_.resize(entry->df);
+		out.tfs_.resize(entry->df);
+		uint32_t doc = 0;
+		for (uint32_t i = 0; i < entry->df; i++) {
+			doc = i == 0 ? (uint32_t) read_varint(in) : doc + (uint32_t) read_varint(in);
+			out.docs_[i] = doc;
+			out.tfs_[i] = (uint32_t) read_varint(in);
+		}
+		read_range(positions_fd_, entry->positions_offset, entry->positions_bytes, out.bytes_);
+		return true;
+	}
+
+	// Terms in byte order
+	std::vector<std::string> terms() const {
+		std::vector<std::string> out;
+		out.reserve(entries_.size());
+		dictionary_.each([&](const std::string &term, uint64_t) {
+			out.push_back(term);
+		});
+		return out;
+	}
+
+	// Term -> lexicon rank, for prefix, wildcard and fuzzy expansion
+	const Fst& dictionary() const {
+		return dictionary_;
+	}
+
+private:
+	int fd_;
+	int positions_fd_;
+	Fst dictionary_;
+	std::vector<Entry> entries_;  // in term byte order
+
+
+	const Entry* find(const std::string &term) const {
+		uint64_t rank;
+		if (!dictionary_.get(term, rank) || rank >= entries_.size()) {
+			return nullptr;
+		}
+		return &entries_[rank];
+	}
+
+	void close_files() {
+		if (fd_ >= 0) {
+			::close(fd_);
+			fd_ = -1;
+		}
+		if (positions_fd_ >= 0) {
+			::close(positions_fd_);
+			positions_fd_ = -1;
+		}
+	}
+
+	// Into any contiguous byte container: std::string or a vector of char
+	template<class Buffer>
+	static void read_range(int fd, uint64_t offset, uint64_t size, Buffer &out) {
+		out.resize(size);
+		unsigned long done = 0;
+		while (done < size) {
+			ssize_t n = ::pread(fd, &out[done], size - done, offset + done);
+			if (n <= 0) {
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				throw "Cannot read index file!";
+			}
+			done += n;
+		}
+	}
+
+	static std::string read_file(const std::string &path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw "Cannot open index file!";
+		}
+		std::string data;
+		char chunk[1 << 16];
+		while (true) {
+			ssize_t n = ::read(fd, chunk, sizeof(chunk));
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				::close(fd);
+				throw "Cannot read index file!";
+			}
+			if (n == 0) {
+				break;
+			}
+			data.append(chunk, n);
+		}
+		::close(fd);
+		return data;
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,610 @@
+// ingest header file
+//
+// Streaming implementation of the "Crawl pages; for each page" step in
+// notes.txt. A local directory tree or a WARC-like archive stands in for
+// the web. Documents flow through four stages connected by bounded queues:
+//
+//   fetch -> [queue] -> parse -> [queue] -> tokenize -> [queue] -> index
+//
+// A full queue blocks its producer, so a slow stage throttles everything
+// upstream of it and at most (3 * queue_capacity + worker threads)
+// documents are ever held in memory, however large the crawl is.
+//
+// With IngestOptions::dedupe set, the tokenize stage also computes each
+// document's MinHash signature (see dedupe.h) and the index stage drops
+// near-duplicates of a document it has already indexed, recording the URL
+// they collapse to instead of passing them to the sink.
+
+#ifndef SE_INGEST_H
+#define SE_INGEST_H
+
+#include "dedupe.h"
+#include "instrument.h"
+#include "tokenizer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+SE_DEFINE_HISTOGRAM(ingest_fetch_ns);
+SE_DEFINE_HISTOGRAM(ingest_parse_ns);
+SE_DEFINE_HISTOGRAM(ingest_tokenize_ns);
+SE_DEFINE_HISTOGRAM(ingest_index_ns);
+SE_DEFINE_HISTOGRAM(ingest_fingerprint_ns);
+SE_DEFINE_COUNTER(documents_ingested);
+SE_DEFINE_COUNTER(terms_tokenized);
+SE_DEFINE_COUNTER(documents_deduplicated);
+
+namespace SE {
+
+struct Document {
+	std::string url;
+	std::string raw;                // fetched bytes, released after parsing
+	std::string text;               // markup-free text
+	std::vector<std::string> terms; // lowercase terms in document order
+	std::vector<uint32_t> signature; // MinHash of terms, when deduplicating
+};
+
+
+// Bounded Queue
+
+template<class T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(unsigned long capacity) :
+			capacity_(capacity ? capacity : 1), max_depth_(0), closed_(false) {}
+
+	// Blocks while the queue is full. Returns false, dropping item, if the
+	// queue was closed before there was room.
+	bool push(T &&item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_full_.wait(lock, [this] { return items_.size() < capacity_ || closed_; });
+		if (closed_) {
+			return false;
+		}
+
+		items_.push_back(std::move(item));
+		if (items_.size() > max_depth_) {
+			max_depth_ = items_.size();
+		}
+		lock.unlock();
+		not_empty_.notify_one();
+		return true;
+	}
+
+	// Blocks while the queue is empty. Returns false once the queue is
+	// closed and fully drained.
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+		if (items_.empty()) {
+			return false;
+		}
+
+		item = std::move(items_.front());
+		items_.pop_front();
+		lock.unlock();
+		not_full_.notify_one();
+		return true;
+	}
+
+	// No more pushes succeed; consumers drain what is left
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+		}
+		not_full_.notify_all();
+		not_empty_.notify_all();
+	}
+
+	unsigned long depth() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return items_.size();
+	}
+
+	unsigned long max_depth() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return max_depth_;
+	}
+
+	unsigned long capacity() const {
+		return capacity_;
+	}
+
+private:
+	unsigned long capacity_;
+	unsigned long max_depth_;
+	bool closed_;
+	std::deque<T> items_;
+	std::mutex mutex_;
+	std::condition_variable not_full_;
+	std::condition_variable not_empty_;
+};
+
+
+// Document Sources
+
+class DocumentSource {
+public:
+	virtual ~DocumentSource() {}
+
+	// Fills doc.url and doc.raw with the next document; false once exhausted
+	virtual bool next(Document &doc) = 0;
+};
+
+// Every regular file below root, visited lazily in directory order and
+// read with a blocking ifstream; LoaderSource (loader.h) batches the reads
+class DirectorySource : public DocumentSource {
+public:
+	explicit DirectorySource(const std::string &root) : itr_(root), end_() {}
+
+	bool next(Document &doc) override {
+		while (itr_ != end_) {
+			std::filesystem::path path = itr_->path();
+			bool regular = itr_->is_regular_file();
+			++itr_;
+
+			if (regular && read_file(path.string(), doc.raw)) {
+				doc.url = "file://" + path.string();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool read_file(const std::string &path, std::string &out) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in) {
+			return false;
+		}
+		in.seekg(0, std::ios::end);
+		std::streamoff length = in.tellg();
+		in.seekg(0, std::ios::beg);
+		out.resize(length > 0 ? (unsigned long) length : 0);
+		in.read(&out[0], out.size());
+		return (bool) in || out.empty();
+	}
+
+private:
+	std::filesystem::recursive_directory_iterator itr_;
+	std::filesystem::recursive_directory_iterator end_;
+};
+
+// WARC-like archive: a sequence of records, each
+//
+//   WARC/1.0\r\n
+//   WARC-Target-URI: <url>\r\n
+//   Content-Length: <n>\r\n
+//   <other headers>\r\n
+//   \r\n
+//   <n bytes of payload>\r\n\r\n
+//
+// Records are read one at a time so archives of any size stream through.
+class ArchiveSource : public DocumentSource {
+public:
+	explicit ArchiveSource(std::istream &in) : in_(in) {}
+
+	bool next(Document &doc) override {
+		std::string line;
+		while (std::getline(in_, line)) {
+			strip_cr(line);
+			if (line.compare(0, 5, "WARC/") != 0) {
+				continue;
+			}
+
+			std::string url;
+			unsigned long length = 0;
+			while (std::getline(in_, line)) {
+				strip_cr(line);
+				if (line.empty()) {
+					break;
+				}
+				if (has_prefix(line, "WARC-Target-URI:")) {
+					url = trim(line.substr(16));
+				} else if (has_prefix(line, "Content-Length:")) {
+					length = std::stoul(trim(line.substr(15)));
+				}
+			}
+
+			doc.raw.resize(length);
+			in_.read(&doc.raw[0], length);
+			if ((unsigned long) in_.gcount() != length) {
+				throw "Truncated archive record!";
+			}
+
+			if (!url.empty()) {
+				doc.url = url;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void write_record(std::ostream &out, const std::string &url, const std::string &payload) {
+		out << "WARC/1.0\r\n"
+			<< "WARC-Type: response\r\n"
+			<< "WARC-Target-URI: " << url << "\r\n"
+			<< "Content-Length: " << payload.size() << "\r\n"
+			<< "\r\n"
+			<< payload << "\r\n\r\n";
+	}
+
+private:
+	std::istream &in_;
+
+	static void strip_cr(std::string &line) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+	}
+
+	static bool has_prefix(const std::string &line, const char* prefix) {
+		return line.compare(0, std::strlen(prefix), prefix) == 0;
+	}
+
+	static std::string trim(const std::string &s) {
+		unsigned long begin = s.find_first_not_of(" \t");
+		unsigned long end = s.find_last_not_of(" \t");
+		return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+	}
+};
+
+
+// Parsing
+
+inline bool starts_with_tag(const char* data, unsigned long length, unsigned long i, const char* tag) {
+	unsigned long tag_length = std::strlen(tag);
+	if (i + tag_length > length) {
+		return false;
+	}
+	for (unsigned long j = 0; j < tag_length; j++) {
+		if (to_lower(data[i + j]) != tag[j]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Drops tags, comments and script/style bodies, and decodes the handful of
+// entities that matter for tokenizing. Every removed tag becomes a space so
+// words on either side of it stay separate.
+inline void strip_markup(const char* data, unsigned long length, std::string &text) {
+	text.clear();
+	text.reserve(length);
+
+	unsigned long i = 0;
+	while (i < length) {
+		char c = data[i];
+		if (c == '<') {
+			const char* close = nullptr;
+			if (starts_with_tag(data, length, i, "<script")) {
+				close = "</script";
+			} else if (starts_with_tag(data, length, i, "<style")) {
+				close = "</style";
+			} else if (starts_with_tag(data, length, i, "<!--")) {
+				close = "-->";
+			}
+
+			if (close) {
+				while (i < length && !starts_with_tag(data, length, i, close)) {
+					i++;
+				}
+			}
+			while (i < length && data[i] != '>') {
+				i++;
+			}
+			i++;
+			text.push_back(' ');
+		} else if (c == '&') {
+			static const char* entities[][2] = {
+				{ "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" },
+				{ "&quot;", "\"" }, { "&#39;", "'" }, { "&nbsp;", " " }
+			};
+
+			bool decoded = false;
+			for (auto &entity : entities) {
+				if (starts_with_tag(data, length, i, entity[0])) {
+					text += entity[1];
+					i += std::strlen(entity[0]);
+					decoded = true;
+					break;
+				}
+			}
+			if (!decoded) {
+				text.push_back(c);
+				i++;
+			}
+		} else {
+			text.push_back(c);
+			i++;
+		}
+	}
+}
+
+
+// Pipeline
+
+enum Stage { FETCH, PARSE, TOKENIZE, INDEX, STAGE_COUNT };
+
+inline const char* stage_name(Stage stage) {
+	static const char* names[] = { "fetch", "parse", "tokenize", "index" };
+	return names[stage];
+}
+
+// Counters are updated while the pipeline runs and may be read from any
+// thread at any time, e.g. by a progress reporter
+struct StageStats {
+	std::atomic<unsigned long> documents{0};
+	std::atomic<unsigned long> bytes{0};
+	std::atomic<unsigned long> busy_ns{0};    // doing the stage's own work
+	std::atomic<unsigned long> blocked_ns{0}; // waiting on a full downstream queue
+};
+
+struct IngestOptions {
+	unsigned long queue_capacity = 64;
+	unsigned long parse_threads = 1;
+	unsigned long tokenize_threads = 1;
+	bool dedupe = false;            // collapse near-duplicates before the sink
+	DedupeOptions dedupe_options;
+};
+
+class IngestPipeline {
+public:
+	typedef std::function<void(Document&)> Sink;
+
+	IngestPipeline(DocumentSource &source, Sink sink, IngestOptions options = IngestOptions()) :
+			source_(source), sink_(sink), options_(options),
+			fetched_(options.queue_capacity), parsed_(options.queue_capacity),
+			tokenized_(options.queue_capacity), hasher_(options.dedupe_options),
+			detector_(options.dedupe_options), elapsed_ns_(0) {
+		if (options_.parse_threads == 0 || options_.tokenize_threads == 0) {
+			throw "Pipeline stages need at least one thread!";
+		}
+	}
+
+	// Runs every stage to completion; rethrows the first stage failure
+	void run() {
+		auto start = std::chrono::steady_clock::now();
+		active_parsers_ = options_.parse_threads;
+		active_tokenizers_ = options_.tokenize_threads;
+
+		std::vector<std::thread> threads;
+		threads.emplace_back(&IngestPipeline::guarded, this, &IngestPipeline::fetch_stage);
+		for (unsigned long i = 0; i < options_.parse_threads; i++) {
+			threads.emplace_back(&IngestPipeline::guarded, this, &IngestPipeline::parse_stage);
+		}
+		for (unsigned long i = 0; i < options_.tokenize_threads; i++) {
+			threads.emplace_back(&IngestPipeline::guarded, this, &IngestPipeline::tokenize_stage);
+		}
+		threads.emplace_back(&IngestPipeline::guarded, this, &IngestPipeline::index_stage);
+
+		for (std::thread &t : threads) {
+			t.join();
+		}
+		elapsed_ns_ = elapsed_since(start);
+
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+	}
+
+	const StageStats& stats(Stage stage) const {
+		return stats_[stage];
+	}
+
+	// Queue feeding the given stage; FETCH has none
+	BoundedQueue<Document>& queue(Stage stage) {
+		if (stage == FETCH || stage >= STAGE_COUNT) {
+			throw "The fetch stage has no input queue!";
+		}
+		return stage == PARSE ? fetched_ : stage == TOKENIZE ? parsed_ : tokenized_;
+	}
+
+	// Canonical URLs and collapsed duplicates; empty unless options.dedupe
+	const DuplicateDetector& duplicates() const {
+		return detector_;
+	}
+
+	double elapsed_seconds() const {
+		return elapsed_ns_ / 1e9;
+	}
+
+	void print_stats(FILE* out) {
+		double seconds = elapsed_seconds() > 0 ? elapsed_seconds() : 1e-9;
+		fprintf(out, "%-9s %10s %10s %10s %10s %12s %6s %6s\n", "stage", "docs", "MB",
+				"busy s", "blocked s", "docs/s", "queue", "max");
+
+		for (int s = FETCH; s < STAGE_COUNT; s++) {
+			const StageStats &st = stats_[s];
+			fprintf(out, "%-9s %10lu %10.2f %10.3f %10.3f %12.0f", stage_name((Stage) s),
+					st.documents.load(), st.bytes.load() / 1e6, st.busy_ns.load() / 1e9,
+					st.blocked_ns.load() / 1e9, st.documents.load() / seconds);
+			if (s == FETCH) {
+				fprintf(out, " %6s %6s\n", "-", "-");
+			} else {
+				BoundedQueue<Document> &q = queue((Stage) s);
+				fprintf(out, " %6lu %6lu\n", q.depth(), q.max_depth());
+			}
+		}
+
+		if (options_.dedupe) {
+			const DedupeStats &st = detector_.stats();
+			double fingerprint = fingerprint_ns_ > 0 ? fingerprint_ns_ / 1e9 : 1e-9;
+			fprintf(out, "dedupe: %lu of %lu documents collapsed (%.1f%%), %lu candidates checked, "
+					"%.0f fingerprints/s per thread\n", st.duplicates, st.documents,
+					st.documents ? 100.0 * st.duplicates / st.documents : 0.0, st.candidates,
+					stats_[TOKENIZE].documents.load() / fingerprint);
+		}
+	}
+
+private:
+	DocumentSource &source_;
+	Sink sink_;
+	IngestOptions options_;
+
+	BoundedQueue<Document> fetched_;
+	BoundedQueue<Document> parsed_;
+	BoundedQueue<Document> tokenized_;
+
+	MinHasher hasher_;
+	DuplicateDetector detector_;        // only touched by the index stage
+	std::atomic<unsigned long> fingerprint_ns_{0};
+
+	StageStats stats_[STAGE_COUNT];
+	std::atomic<unsigned long> active_parsers_{0};
+	std::atomic<unsigned long> active_tokenizers_{0};
+	unsigned long elapsed_ns_;
+
+	std::mutex error_mutex_;
+	std::exception_ptr error_;
+
+
+	static unsigned long elapsed_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Pushes downstream, charging time spent blocked to the producing stage
+	bool forward(Stage stage, BoundedQueue<Document> &out, Document &doc) {
+		auto start = std::chrono::steady_clock::now();
+		bool pushed = out.push(std::move(doc));
+		stats_[stage].blocked_ns += elapsed_since(start);
+		return pushed;
+	}
+
+	// Busy time of one document in one stage
+	void charge(Stage stage, std::chrono::steady_clock::time_point start) {
+		unsigned long ns = elapsed_since(start);
+		stats_[stage].busy_ns += ns;
+		switch (stage) {
+			case FETCH:
+				SE_RECORD(ingest_fetch_ns, ns);
+				break;
+			case PARSE:
+				SE_RECORD(ingest_parse_ns, ns);
+				break;
+			case TOKENIZE:
+				SE_RECORD(ingest_tokenize_ns, ns);
+				break;
+			default:
+				SE_RECORD(ingest_index_ns, ns);
+		}
+	}
+
+	void fetch_stage() {
+		while (true) {
+			Document doc;
+			auto start = std::chrono::steady_clock::now();
+			bool fetched = source_.next(doc);
+			charge(FETCH, start);
+			if (!fetched) {
+				break;
+			}
+
+			stats_[FETCH].documents++;
+			stats_[FETCH].bytes += doc.raw.size();
+			if (!forward(FETCH, fetched_, doc)) {
+				break;
+			}
+		}
+		fetched_.close();
+	}
+
+	void parse_stage() {
+		Document doc;
+		while (fetched_.pop(doc)) {
+			auto start = std::chrono::steady_clock::now();
+			strip_markup(doc.raw.data(), doc.raw.size(), doc.text);
+			stats_[PARSE].bytes += doc.raw.size();
+			std::string().swap(doc.raw);
+			charge(PARSE, start);
+			stats_[PARSE].documents++;
+
+			if (!forward(PARSE, parsed_, doc)) {
+				break;
+			}
+		}
+		if (--active_parsers_ == 0) {
+			parsed_.close();
+		}
+	}
+
+	void tokenize_stage() {
+		Document doc;
+		while (parsed_.pop(doc)) {
+			auto start = std::chrono::steady_clock::now();
+			doc.terms.clear();
+			tokenize(doc.text, doc.terms);
+			SE_COUNT(terms_tokenized, doc.terms.size());
+			if (options_.dedupe) {
+				auto hash_start = std::chrono::steady_clock::now();
+				hasher_.signature(doc.terms, doc.signature);
+				unsigned long ns = elapsed_since(hash_start);
+				fingerprint_ns_ += ns;
+				SE_RECORD(ingest_fingerprint_ns, ns);
+			}
+			stats_[TOKENIZE].bytes += doc.text.size();
+			charge(TOKENIZE, start);
+			stats_[TOKENIZE].documents++;
+
+			if (!forward(TOKENIZE, tokenized_, doc)) {
+				break;
+			}
+		}
+		if (--active_tokenizers_ == 0) {
+			tokenized_.close();
+		}
+	}
+
+	void index_stage() {
+		Document doc;
+		while (tokenized_.pop(doc)) {
+			auto start = std::chrono::steady_clock::now();
+			if (options_.dedupe && detector_.add(doc.url, doc.signature) != DuplicateDetector::NOT_DUPLICATE) {
+				SE_COUNT(documents_deduplicated, 1);
+			} else {
+				sink_(doc);
+				SE_COUNT(documents_ingested, 1);
+			}
+			stats_[INDEX].bytes += doc.text.size();
+			charge(INDEX, start);
+			stats_[INDEX].documents++;
+		}
+	}
+
+	// Runs a stage; a failure anywhere closes every queue so all stages
+	// wind down instead of blocking forever on a dead neighbour
+	void guarded(void (IngestPipeline::*stage)()) {
+		try {
+			(this->*stage)();
+		} catch (...) {
+			{
+				std::lock_guard<std::mutex> lock(error_mutex_);
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+			}
+			fetched_.close();
+			parsed_.close();
+			tokenized_.close();
+		}
+	}
+};
+
+
+}
+#endif
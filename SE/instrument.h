@@ -0,0 +1,437 @@
+// instrument header file
+//
+// Counters and latency histograms for the hot paths of crawling, indexing
+// and query scoring. Everything is compiled out unless SE_INSTRUMENT is
+// defined: the macros below expand to nothing and no metric objects exist.
+//
+//   SE_DEFINE_COUNTER(name);      at global scope, once per metric
+//   SE_DEFINE_HISTOGRAM(name);
+//   SE_COUNT(name, n);            add n to a counter
+//   SE_RECORD(name, value);       add one sample to a histogram
+//   SE_TIME(name);                time the enclosing scope into a histogram
+//
+// Each thread writes only its own slots with plain relaxed stores, so the
+// hot path has no locks and no atomic read-modify-write. dump_json() and
+// dump_prometheus() sum every thread's slots on demand.
+//
+// Timers use steady_clock nanoseconds. Define SE_INSTRUMENT_RDTSC as well
+// to time with the x86 timestamp counter, converted to nanoseconds using a
+// one-off calibration against steady_clock.
+
+#ifndef SE_INSTRUMENT_H
+#define SE_INSTRUMENT_H
+
+#ifdef SE_INSTRUMENT
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SE_INSTRUMENT_RDTSC
+#include <x86intrin.h>
+#endif
+
+namespace SE {
+namespace instrument {
+
+const unsigned long MAX_COUNTERS = 64;
+const unsigned long MAX_HISTOGRAMS = 32;
+
+// Log-linear buckets: values below 16 are exact, above that each power of
+// two is split into 16 sub-buckets, bounding relative error to 1/16
+const unsigned long SUB_BUCKETS = 16;
+const unsigned long BUCKETS = (64 - 3) * SUB_BUCKETS;
+
+inline unsigned long bucket_of(uint64_t val) {
+	if (val < SUB_BUCKETS) {
+		return val;
+	}
+	unsigned long exp = 63 - __builtin_clzll(val);
+	return (exp - 3) * SUB_BUCKETS + ((val >> (exp - 4)) & (SUB_BUCKETS - 1));
+}
+
+// Midpoint of the values that fall into bucket
+inline uint64_t bucket_value(unsigned long bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+	unsigned long exp = bucket / SUB_BUCKETS + 3;
+	uint64_t low = (uint64_t) (SUB_BUCKETS + bucket % SUB_BUCKETS) << (exp - 4);
+	uint64_t width = 1ULL << (exp - 4);
+	return low + width / 2;
+}
+
+// Only the owning thread writes; any thread may read
+inline void bump(std::atomic<uint64_t> &slot, uint64_t n) {
+	slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct HistogramSlots {
+	std::atomic<uint64_t> buckets[BUCKETS];
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> sum{0};
+	std::atomic<uint64_t> max{0};
+
+	HistogramSlots() {
+		for (unsigned long i = 0; i < BUCKETS; i++) {
+			buckets[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void record(uint64_t val) {
+		bump(buckets[bucket_of(val)], 1);
+		bump(count, 1);
+		bump(sum, val);
+		if (val > max.load(std::memory_order_relaxed)) {
+			max.store(val, std::memory_order_relaxed);
+		}
+	}
+};
+
+struct ThreadSlots {
+	std::atomic<uint64_t> counters[MAX_COUNTERS];
+	std::atomic<HistogramSlots*> histograms[MAX_HISTOGRAMS];
+
+	ThreadSlots() {
+		for (unsigned long i = 0; i < MAX_COUNTERS; i++) {
+			counters[i].store(0, std::memory_order_relaxed);
+		}
+		for (unsigned long i = 0; i < MAX_HISTOGRAMS; i++) {
+			histograms[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	~ThreadSlots() {
+		for (unsigned long i = 0; i < MAX_HISTOGRAMS; i++) {
+			delete histograms[i].load();
+		}
+	}
+
+	HistogramSlots& histogram(unsigned long id) {
+		HistogramSlots* slots = histograms[id].load(std::memory_order_relaxed);
+		if (slots == nullptr) {
+			slots = new HistogramSlots();
+			histograms[id].store(slots, std::memory_order_release);
+		}
+		return *slots;
+	}
+};
+
+struct HistogramSummary {
+	std::string name;
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t p50, p90, p99, p999;
+};
+
+struct Snapshot {
+	std::vector<std::pair<std::string, uint64_t>> counters;
+	std::vector<HistogramSummary> histograms;
+
+	uint64_t counter(const std::string &name) const {
+		for (auto &c : counters) {
+			if (c.first == name) {
+				return c.second;
+			}
+		}
+		return 0;
+	}
+
+	const HistogramSummary* histogram(const std::string &name) const {
+		for (auto &h : histograms) {
+			if (h.name == name) {
+				return &h;
+			}
+		}
+		return nullptr;
+	}
+};
+
+// Names of every metric and the slots of every thread that has used one.
+// Slots of exited threads are folded into retired_ so no samples are lost.
+class Registry {
+public:
+	static Registry& get() {
+		static Registry registry;
+		return registry;
+	}
+
+	unsigned long add_counter(const char* name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (counter_names_.size() == MAX_COUNTERS) {
+			throw "Too many instrumentation counters!";
+		}
+		counter_names_.push_back(name);
+		return counter_names_.size() - 1;
+	}
+
+	unsigned long add_histogram(const char* name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (histogram_names_.size() == MAX_HISTOGRAMS) {
+			throw "Too many instrumentation histograms!";
+		}
+		histogram_names_.push_back(name);
+		return histogram_names_.size() - 1;
+	}
+
+	void attach(ThreadSlots* slots) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		threads_.push_back(slots);
+	}
+
+	void detach(ThreadSlots* slots) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		merge(*slots, retired_);
+		threads_.erase(std::find(threads_.begin(), threads_.end(), slots));
+	}
+
+	Snapshot snapshot() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		ThreadSlots total;
+		merge(retired_, total);
+		for (ThreadSlots* slots : threads_) {
+			merge(*slots, total);
+		}
+
+		Snapshot snap;
+		for (unsigned long i = 0; i < counter_names_.size(); i++) {
+			snap.counters.emplace_back(counter_names_[i], total.counters[i].load());
+		}
+		for (unsigned long i = 0; i < histogram_names_.size(); i++) {
+			snap.histograms.push_back(summarize(histogram_names_[i], total.histograms[i].load()));
+		}
+		return snap;
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<std::string> counter_names_;
+	std::vector<std::string> histogram_names_;
+	std::vector<ThreadSlots*> threads_;
+	ThreadSlots retired_;
+
+	static void merge(ThreadSlots &from, ThreadSlots &into) {
+		for (unsigned long i = 0; i < MAX_COUNTERS; i++) {
+			bump(into.counters[i], from.counters[i].load(std::memory_order_relaxed));
+		}
+		for (unsigned long i = 0; i < MAX_HISTOGRAMS; i++) {
+			HistogramSlots* src = from.histograms[i].load(std::memory_order_acquire);
+			if (src == nullptr) {
+				continue;
+			}
+			HistogramSlots &dst = into.histogram(i);
+			for (unsigned long b = 0; b < BUCKETS; b++) {
+				bump(dst.buckets[b], src->buckets[b].load(std::memory_order_relaxed));
+			}
+			bump(dst.count, src->count.load(std::memory_order_relaxed));
+			bump(dst.sum, src->sum.load(std::memory_order_relaxed));
+			dst.max.store(std::max(dst.max.load(), src->max.load(std::memory_order_relaxed)));
+		}
+	}
+
+	static HistogramSummary summarize(const std::string &name, HistogramSlots* slots) {
+		HistogramSummary summary = { name, 0, 0, 0, 0, 0, 0, 0 };
+		if (slots == nullptr) {
+			return summary;
+		}
+
+		// Buckets may advance while being read; quantiles use their own total
+		uint64_t total = 0;
+		std::vector<uint64_t> counts(BUCKETS);
+		for (unsigned long b = 0; b < BUCKETS; b++) {
+			counts[b] = slots->buckets[b].load(std::memory_order_relaxed);
+			total += counts[b];
+		}
+		summary.count = total;
+		summary.sum = slots->sum.load();
+		summary.max = slots->max.load();
+
+		double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+		uint64_t* outputs[] = { &summary.p50, &summary.p90, &summary.p99, &summary.p999 };
+		for (int q = 0; q < 4; q++) {
+			uint64_t rank = (uint64_t) (quantiles[q] * total + 0.5);
+			uint64_t seen = 0;
+			for (unsigned long b = 0; b < BUCKETS && total > 0; b++) {
+				seen += counts[b];
+				if (seen >= std::max(rank, (uint64_t) 1)) {
+					*outputs[q] = std::min(bucket_value(b), summary.max);
+					break;
+				}
+			}
+		}
+		return summary;
+	}
+};
+
+// Registers this thread's slots on first use and folds them into the
+// registry's retired totals when the thread exits
+class ThreadHandle {
+public:
+	ThreadHandle() {
+		Registry::get().attach(&slots_);
+	}
+
+	~ThreadHandle() {
+		Registry::get().detach(&slots_);
+	}
+
+	ThreadSlots slots_;
+};
+
+inline ThreadSlots& local() {
+	thread_local ThreadHandle handle;
+	return handle.slots_;
+}
+
+
+// Clock
+
+#ifdef SE_INSTRUMENT_RDTSC
+
+inline double ns_per_tick() {
+	static double ratio = [] {
+		auto start = std::chrono::steady_clock::now();
+		uint64_t ticks = __rdtsc();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		return ns / (__rdtsc() - ticks);
+	}();
+	return ratio;
+}
+
+inline uint64_t now() {
+	return __rdtsc();
+}
+
+inline uint64_t to_ns(uint64_t ticks) {
+	return (uint64_t) (ticks * ns_per_tick());
+}
+
+#else
+
+inline uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t to_ns(uint64_t ticks) {
+	return ticks;
+}
+
+#endif
+
+
+// Metrics
+
+class Counter {
+public:
+	explicit Counter(const char* name) : id_(Registry::get().add_counter(name)) {}
+
+	void add(uint64_t n) {
+		bump(local().counters[id_], n);
+	}
+
+private:
+	unsigned long id_;
+};
+
+class Histogram {
+public:
+	explicit Histogram(const char* name) : id_(Registry::get().add_histogram(name)) {}
+
+	void record(uint64_t val) {
+		local().histogram(id_).record(val);
+	}
+
+private:
+	unsigned long id_;
+};
+
+class ScopedTimer {
+public:
+	explicit ScopedTimer(Histogram &histogram) : histogram_(histogram), start_(now()) {}
+
+	~ScopedTimer() {
+		histogram_.record(to_ns(now() - start_));
+	}
+
+private:
+	Histogram &histogram_;
+	uint64_t start_;
+};
+
+
+// Output
+
+inline Snapshot snapshot() {
+	return Registry::get().snapshot();
+}
+
+inline void dump_json(std::ostream &out) {
+	Snapshot snap = snapshot();
+	out << "{\"counters\":{";
+	for (unsigned long i = 0; i < snap.counters.size(); i++) {
+		out << (i ? "," : "") << "\"" << snap.counters[i].first << "\":" << snap.counters[i].second;
+	}
+	out << "},\"histograms\":{";
+	for (unsigned long i = 0; i < snap.histograms.size(); i++) {
+		const HistogramSummary &h = snap.histograms[i];
+		out << (i ? "," : "") << "\"" << h.name << "\":{\"count\":" << h.count << ",\"sum\":" << h.sum
+				<< ",\"max\":" << h.max << ",\"p50\":" << h.p50 << ",\"p90\":" << h.p90
+				<< ",\"p99\":" << h.p99 << ",\"p999\":" << h.p999 << "}";
+	}
+	out << "}}\n";
+}
+
+// Prometheus text exposition format; histograms become summaries
+inline void dump_prometheus(std::ostream &out) {
+	Snapshot snap = snapshot();
+	for (auto &c : snap.counters) {
+		out << "# TYPE se_" << c.first << " counter\n";
+		out << "se_" << c.first << " " << c.second << "\n";
+	}
+	for (auto &h : snap.histograms) {
+		out << "# TYPE se_" << h.name << " summary\n";
+		out << "se_" << h.name << "{quantile=\"0.5\"} " << h.p50 << "\n";
+		out << "se_" << h.name << "{quantile=\"0.9\"} " << h.p90 << "\n";
+		out << "se_" << h.name << "{quantile=\"0.99\"} " << h.p99 << "\n";
+		out << "se_" << h.name << "{quantile=\"0.999\"} " << h.p999 << "\n";
+		out << "se_" << h.name << "_sum " << h.sum << "\n";
+		out << "se_" << h.name << "_count " << h.count << "\n";
+	}
+}
+
+
+}
+}
+
+#define SE_CONCAT_INNER(a, b) a##b
+#define SE_CONCAT(a, b) SE_CONCAT_INNER(a, b)
+
+#define SE_DEFINE_COUNTER(name) \
+	namespace SE { namespace metrics { inline ::SE::instrument::Counter name(#name); } }
+#define SE_DEFINE_HISTOGRAM(name) \
+	namespace SE { namespace metrics { inline ::SE::instrument::Histogram name(#name); } }
+
+#define SE_COUNT(name, n) ::SE::metrics::name.add(n)
+#define SE_RECORD(name, val) ::SE::metrics::name.record(val)
+#define SE_TIME(name) ::SE::instrument::ScopedTimer SE_CONCAT(se_timer_, __LINE__)(::SE::metrics::name)
+
+#else
+
+#define SE_DEFINE_COUNTER(name)
+#define SE_DEFINE_HISTOGRAM(name)
+#define SE_COUNT(name, n) do {} while (0)
+#define SE_RECORD(name, val) do {} while (0)
+#define SE_TIME(name) do {} while (0)
+
+#endif
+
+#endif
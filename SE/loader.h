@@ -0,0 +1,762 @@
+// loader header file
+//
+// Batched file loading for ingesting millions of small crawled documents.
+//
+// On Linux the loader drives io_uring directly (no liburing dependency):
+// opens, fixed-buffer reads and closes for up to queue_depth files are
+// submitted together, so one io_uring_enter call services a whole batch.
+// Where io_uring is unavailable (old kernel, seccomp, or force_sync) a
+// pool of threads issuing open/pread is used instead. So is it where the
+// ring sets up but its opcode probe lacks OPENAT, CLOSE or both reads: on
+// 5.1 to 5.5 kernels those opcodes fail every file with EINVAL.
+//
+// Either way file contents land in buffers from a BufferPool that is
+// allocated once and registered with the ring. The callback borrows the
+// buffer for its duration, so the tokenizer can run straight over the
+// bytes the kernel wrote without any intermediate copy. LoaderSource, the
+// IngestPipeline source se_server index uses, does copy: see below.
+
+#ifndef SE_LOADER_H
+#define SE_LOADER_H
+
+#include "ingest.h"
+#include "instrument.h"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+SE_DEFINE_COUNTER(files_loaded);
+SE_DEFINE_COUNTER(bytes_loaded);
+
+namespace SE {
+
+// A file handed to the load callback. data is only valid until the
+// callback returns.
+struct LoadedFile {
+	unsigned long index; // position in the path list
+	const char* data;
+	unsigned long length;
+	int error;           // errno of the failed step, 0 on success
+};
+
+struct LoaderOptions {
+	unsigned long buffer_size = 64 * 1024; // files up to this size are zero-copy
+	unsigned long queue_depth = 64;        // files in flight at once
+	unsigned long threads = 8;             // fallback pread workers
+	bool force_sync = false;               // skip io_uring even if available
+};
+
+struct LoaderStats {
+	unsigned long files = 0;
+	unsigned long bytes = 0;
+	unsigned long errors = 0;
+	unsigned long syscalls = 0;  // io_uring_enter calls, or open/read/close calls
+	unsigned long overflows = 0; // files larger than one buffer
+};
+
+
+// Buffer Pool
+
+// One page-aligned allocation split into fixed size buffers. acquire()
+// blocks while every buffer is out, which bounds loader memory.
+class BufferPool {
+public:
+	BufferPool(unsigned long count, unsigned long buffer_size) :
+			count_(count), buffer_size_(round_up(buffer_size)), memory_(nullptr) {
+		if (count == 0 || buffer_size == 0) {
+			throw "Buffer pool needs at least one non-empty buffer!";
+		}
+		memory_ = (char*) std::aligned_alloc(ALIGNMENT, count_ * buffer_size_);
+		if (memory_ == nullptr) {
+			throw "Cannot allocate buffer pool!";
+		}
+		for (unsigned long i = count_; i > 0; i--) {
+			free_.push_back(i - 1);
+		}
+	}
+
+	~BufferPool() {
+		std::free(memory_);
+	}
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	unsigned long acquire() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		available_.wait(lock, [this] { return !free_.empty(); });
+		unsigned long index = free_.back();
+		free_.pop_back();
+		return index;
+	}
+
+	void release(unsigned long index) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			free_.push_back(index);
+		}
+		available_.notify_one();
+	}
+
+	char* buffer(unsigned long index) {
+		return memory_ + index * buffer_size_;
+	}
+
+	unsigned long count() const {
+		return count_;
+	}
+
+	unsigned long buffer_size() const {
+		return buffer_size_;
+	}
+
+private:
+	static const unsigned long ALIGNMENT = 4096;
+
+	unsigned long count_;
+	unsigned long buffer_size_;
+	char* memory_;
+	std::vector<unsigned long> free_;
+	std::mutex mutex_;
+	std::condition_variable available_;
+
+	static unsigned long round_up(unsigned long size) {
+		return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+};
+
+
+// io_uring
+
+#ifdef __linux__
+
+// Minimal io_uring wrapper over the raw system calls
+class IoUring {
+public:
+	IoUring() : fd_(-1), sq_ring_(nullptr), cq_ring_(nullptr), sqes_(nullptr),
+			sq_ring_size_(0), cq_ring_size_(0), sqe_tail_(0), sqe_submitted_(0) {}
+
+	~IoUring() {
+		if (sqes_) {
+			munmap(sqes_, params_.sq_entries * sizeof(io_uring_sqe));
+		}
+		if (cq_ring_ && cq_ring_ != sq_ring_) {
+			munmap(cq_ring_, cq_ring_size_);
+		}
+		if (sq_ring_) {
+			munmap(sq_ring_, sq_ring_size_);
+		}
+		if (fd_ >= 0) {
+			close(fd_);
+		}
+	}
+
+	IoUring(const IoUring&) = delete;
+	IoUring& operator=(const IoUring&) = delete;
+
+	// False when the kernel does not support (or forbids) io_uring
+	bool init(unsigned entries) {
+		std::memset(&params_, 0, sizeof(params_));
+		fd_ = (int) syscall(__NR_io_uring_setup, entries, &params_);
+		if (fd_ < 0) {
+			return false;
+		}
+
+		sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+		cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+		bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+		if (single_mmap) {
+			sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+		}
+
+		sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+		if (sq_ring_ == nullptr) {
+			return false;
+		}
+		cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+		sqes_ = (io_uring_sqe*) map(params_.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES);
+		if (cq_ring_ == nullptr || sqes_ == nullptr) {
+			return false;
+		}
+
+		sq_head_ = (unsigned*) (sq_ring_ + params_.sq_off.head);
+		sq_tail_ = (unsigned*) (sq_ring_ + params_.sq_off.tail);
+		sq_mask_ = *(unsigned*) (sq_ring_ + params_.sq_off.ring_mask);
+		sq_array_ = (unsigned*) (sq_ring_ + params_.sq_off.array);
+		cq_head_ = (unsigned*) (cq_ring_ + params_.cq_off.head);
+		cq_tail_ = (unsigned*) (cq_ring_ + params_.cq_off.tail);
+		cq_mask_ = *(unsigned*) (cq_ring_ + params_.cq_off.ring_mask);
+		cqes_ = (io_uring_cqe*) (cq_ring_ + params_.cq_off.cqes);
+		sqe_tail_ = sqe_submitted_ = *sq_tail_;
+		probe_ops();
+		return true;
+	}
+
+	// Whether the kernel reported op as supported; false for every op on
+	// kernels without IORING_REGISTER_PROBE (before 5.6)
+	bool supports(unsigned op) const {
+		return op < supported_.size() && supported_[op];
+	}
+
+	bool register_buffers(const iovec* iovecs, unsigned count) {
+		return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iovecs, count) == 0;
+	}
+
+	// Next free submission entry, zeroed; nullptr when the queue is full
+	io_uring_sqe* get_sqe() {
+		unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+		if (sqe_tail_ - head >= params_.sq_entries) {
+			return nullptr;
+		}
+		unsigned index = sqe_tail_ & sq_mask_;
+		io_uring_sqe* sqe = &sqes_[index];
+		std::memset(sqe, 0, sizeof(*sqe));
+		sq_array_[index] = index;
+		sqe_tail_++;
+		return sqe;
+	}
+
+	// Publishes queued entries and waits for at least wait_nr completions
+	int submit(unsigned wait_nr) {
+		unsigned to_submit = sqe_tail_ - sqe_submitted_;
+		__atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+		sqe_submitted_ = sqe_tail_;
+
+		unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+		int ret;
+		do {
+			ret = (int) syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr, flags, nullptr, 0);
+		} while (ret < 0 && errno == EINTR);
+		return ret;
+	}
+
+	bool peek(io_uring_cqe &out) {
+		unsigned head = *cq_head_;
+		if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+			return false;
+		}
+		out = cqes_[head & cq_mask_];
+		__atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	unsigned pending() const {
+		return sqe_tail_ - sqe_submitted_;
+	}
+
+private:
+	int fd_;
+	io_uring_params params_;
+	char* sq_ring_;
+	char* cq_ring_;
+	io_uring_sqe* sqes_;
+	unsigned long sq_ring_size_;
+	unsigned long cq_ring_size_;
+
+	unsigned* sq_head_;
+	unsigned* sq_tail_;
+	unsigned sq_mask_;
+	unsigned* sq_array_;
+	unsigned* cq_head_;
+	unsigned* cq_tail_;
+	unsigned cq_mask_;
+	io_uring_cqe* cqes_;
+
+	unsigned sqe_tail_;
+	unsigned sqe_submitted_;
+	std::vector<bool> supported_;  // by opcode
+
+	void probe_ops() {
+		const unsigned max_ops = 256;
+		std::vector<char> bytes(sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op), 0);
+		io_uring_probe* probe = (io_uring_probe*) bytes.data();
+		supported_.clear();
+		if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, max_ops) != 0) {
+			return;
+		}
+		supported_.resize(max_ops, false);
+		for (unsigned i = 0; i < probe->ops_len && i < max_ops; i++) {
+			supported_[probe->ops[i].op] = probe->ops[i].flags & IO_URING_OP_SUPPORTED;
+		}
+	}
+
+	char* map(unsigned long size, unsigned long long offset) {
+		void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+		return ptr == MAP_FAILED ? nullptr : (char*) ptr;
+	}
+};
+
+#endif
+
+
+// File Loader
+
+class FileLoader {
+public:
+	explicit FileLoader(LoaderOptions options = LoaderOptions()) :
+			options_(options), pool_(std::max(options.queue_depth, 1UL), options.buffer_size),
+			uring_enabled_(false) {
+#ifdef __linux__
+		if (!options_.force_sync && uring_.init(ring_entries()) && uring_.supports(IORING_OP_OPENAT)
+				&& uring_.supports(IORING_OP_CLOSE)) {
+			if (uring_.supports(IORING_OP_READ_FIXED)) {
+				std::vector<iovec> iovecs(pool_.count());
+				for (unsigned long i = 0; i < pool_.count(); i++) {
+					iovecs[i].iov_base = pool_.buffer(i);
+					iovecs[i].iov_len = pool_.buffer_size();
+				}
+				// Registration can fail under a low RLIMIT_MEMLOCK; plain reads still work
+				fixed_buffers_ = uring_.register_buffers(iovecs.data(), iovecs.size());
+			}
+			uring_enabled_ = fixed_buffers_ || uring_.supports(IORING_OP_READ);
+		}
+#endif
+	}
+
+	bool using_io_uring() const {
+		return uring_enabled_;
+	}
+
+	const LoaderStats& stats() const {
+		return stats_;
+	}
+
+	// Loads every path, calling callback(const LoadedFile&) once per path on
+	// the calling thread, in completion order
+	template<class Callback>
+	void load(const std::vector<std::string> &paths, Callback callback) {
+#ifdef __linux__
+		if (uring_enabled_) {
+			load_uring(paths, callback);
+			return;
+		}
+#endif
+		load_threads(paths, callback);
+	}
+
+private:
+	LoaderOptions options_;
+	BufferPool pool_;
+	LoaderStats stats_;
+	bool uring_enabled_;
+	bool fixed_buffers_ = false;
+
+	// Files larger than a pool buffer are finished with a synchronous read
+	// into heap memory; returns the whole file, or error in out.error
+	void read_overflow(int fd, const char* head, unsigned long head_length,
+			std::string &overflow, LoadedFile &out) {
+		struct stat st;
+		stats_.overflows++;
+		if (fstat(fd, &st) != 0) {
+			out.error = errno;
+			return;
+		}
+
+		overflow.assign(head, head_length);
+		overflow.resize(std::max((unsigned long) st.st_size, head_length));
+		unsigned long done = head_length;
+		while (done < overflow.size()) {
+			ssize_t n = pread(fd, &overflow[done], overflow.size() - done, done);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				break;
+			}
+			done += n;
+		}
+		overflow.resize(done);
+		out.data = overflow.data();
+		out.length = overflow.size();
+	}
+
+	void record(const LoadedFile &file) {
+		stats_.files++;
+		SE_COUNT(files_loaded, 1);
+		if (file.error) {
+			stats_.errors++;
+		} else {
+			stats_.bytes += file.length;
+			SE_COUNT(bytes_loaded, file.length);
+		}
+	}
+
+#ifdef __linux__
+	IoUring uring_;
+
+	enum Op { OPEN, READ, CLOSE };
+
+	struct Slot {
+		unsigned long index;
+		unsigned long buffer;
+		int fd;
+	};
+
+	unsigned ring_entries() const {
+		// open, read and close of every in-flight file may be queued at once
+		unsigned entries = 1;
+		while (entries < 2 * std::max(options_.queue_depth, 1UL)) {
+			entries *= 2;
+		}
+		return entries;
+	}
+
+	static unsigned long long pack(unsigned long slot, Op op) {
+		return (slot << 2) | op;
+	}
+
+	template<class Callback>
+	void load_uring(const std::vector<std::string> &paths, Callback &callback) {
+		unsigned long slots = pool_.count();
+		std::vector<Slot> slot_state(slots);
+		std::vector<unsigned long> free_slots;
+		for (unsigned long i = slots; i > 0; i--) {
+			free_slots.push_back(i - 1);
+		}
+
+		unsigned long next = 0;
+		unsigned long in_flight = 0;
+		std::string overflow;
+		std::exception_ptr error;
+
+		while (next < paths.size() || in_flight > 0) {
+			// Fill every free slot with a new open
+			while (next < paths.size() && !free_slots.empty()) {
+				io_uring_sqe* sqe = uring_.get_sqe();
+				if (sqe == nullptr) {
+					break;
+				}
+				unsigned long slot = free_slots.back();
+				free_slots.pop_back();
+				slot_state[slot].index = next;
+				slot_state[slot].buffer = slot;
+				slot_state[slot].fd = -1;
+
+				sqe->opcode = IORING_OP_OPENAT;
+				sqe->fd = AT_FDCWD;
+				sqe->addr = (unsigned long) paths[next].c_str();
+				sqe->open_flags = O_RDONLY | O_CLOEXEC;
+				sqe->user_data = pack(slot, OPEN);
+				next++;
+				in_flight++;
+			}
+
+			if (uring_.submit(1) < 0) {
+				throw "io_uring_enter failed!";
+			}
+			stats_.syscalls++;
+
+			io_uring_cqe cqe;
+			while (uring_.peek(cqe)) {
+				unsigned long slot = cqe.user_data >> 2;
+				Op op = (Op) (cqe.user_data & 3);
+				Slot &state = slot_state[slot];
+
+				if (op == OPEN && cqe.res >= 0) {
+					state.fd = cqe.res;
+					queue_read(state, slot);
+					continue;
+				}
+
+				if (op == OPEN || op == READ) {
+					LoadedFile file = { state.index, nullptr, 0, 0 };
+					if (cqe.res < 0) {
+						file.error = -cqe.res;
+					} else {
+						file.data = pool_.buffer(state.buffer);
+						file.length = cqe.res;
+						if (file.length == pool_.buffer_size()) {
+							read_overflow(state.fd, file.data, file.length, overflow, file);
+						}
+					}
+					record(file);
+					if (!error) {
+						// After a throwing callback the files in flight are
+						// only reaped, so the ring is idle when it rethrows
+						try {
+							callback(file);
+						} catch (...) {
+							error = std::current_exception();
+							next = paths.size();
+						}
+					}
+
+					if (state.fd >= 0) {
+						queue_close(state, slot);
+						continue;
+					}
+				}
+
+				// Failed open, or close finished: the slot is free again
+				free_slots.push_back(slot);
+				in_flight--;
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	io_uring_sqe* wait_sqe() {
+		io_uring_sqe* sqe;
+		while ((sqe = uring_.get_sqe()) == nullptr) {
+			uring_.submit(0);
+			stats_.syscalls++;
+		}
+		return sqe;
+	}
+
+	void queue_read(Slot &state, unsigned long slot) {
+		io_uring_sqe* sqe = wait_sqe();
+		sqe->opcode = fixed_buffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+		sqe->fd = state.fd;
+		sqe->addr = (unsigned long) pool_.buffer(state.buffer);
+		sqe->len = pool_.buffer_size();
+		sqe->off = 0;
+		sqe->buf_index = fixed_buffers_ ? state.buffer : 0;
+		sqe->user_data = pack(slot, READ);
+	}
+
+	void queue_close(Slot &state, unsigned long slot) {
+		io_uring_sqe* sqe = wait_sqe();
+		sqe->opcode = IORING_OP_CLOSE;
+		sqe->fd = state.fd;
+		sqe->user_data = pack(slot, CLOSE);
+		state.fd = -1;
+	}
+#endif
+
+	struct Completed {
+		LoadedFile file;
+		long buffer;          // pool buffer to release, -1 if none
+		std::string overflow; // owns file.data for oversized files
+	};
+
+	template<class Callback>
+	void load_threads(const std::vector<std::string> &paths, Callback &callback) {
+		BoundedQueue<Completed> done(pool_.count());
+		std::atomic<unsigned long> next{0};
+		std::atomic<unsigned long> syscalls{0};
+		std::atomic<unsigned long> overflows{0};
+		std::atomic<unsigned long> active{std::max(options_.threads, 1UL)};
+
+		auto worker = [&] {
+			unsigned long i;
+			while ((i = next++) < paths.size()) {
+				Completed item;
+				item.file = { i, nullptr, 0, 0 };
+				item.buffer = -1;
+
+				int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+				syscalls++;
+				if (fd < 0) {
+					item.file.error = errno;
+					done.push(std::move(item));
+					continue;
+				}
+
+				item.buffer = pool_.acquire();
+				char* buffer = pool_.buffer(item.buffer);
+				unsigned long length = 0;
+				while (length < pool_.buffer_size()) {
+					ssize_t n = pread(fd, buffer + length, pool_.buffer_size() - length, length);
+					syscalls++;
+					if (n < 0 && errno == EINTR) {
+						continue;
+					}
+					if (n < 0) {
+						item.file.error = errno;
+					}
+					if (n <= 0) {
+						break;
+					}
+					length += n;
+				}
+
+				item.file.data = buffer;
+				item.file.length = length;
+				if (!item.file.error && length == pool_.buffer_size()) {
+					overflows++;
+					struct stat st;
+					if (fstat(fd, &st) == 0 && (unsigned long) st.st_size > length) {
+						item.overflow.assign(buffer, length);
+						item.overflow.resize(st.st_size);
+						ssize_t n = pread(fd, &item.overflow[length], st.st_size - length, length);
+						item.overflow.resize(length + std::max(n, (ssize_t) 0));
+						item.file.data = item.overflow.data();
+						item.file.length = item.overflow.size();
+					}
+				}
+				close(fd);
+				syscalls++;
+				long taken = item.buffer;
+				if (!done.push(std::move(item))) {
+					// The consumer gave up; hand the buffer back and stop
+					if (taken >= 0) {
+						pool_.release(taken);
+					}
+					break;
+				}
+			}
+			if (--active == 0) {
+				done.close();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned long t = 0; t < std::max(options_.threads, 1UL); t++) {
+			threads.emplace_back(worker);
+		}
+
+		// Runs on success and on a throwing callback alike: workers stop
+		// taking paths, buffers still queued go back to the pool so none
+		// stays blocked in acquire(), and every thread is joined before
+		// the exception leaves
+		auto finish = [&] {
+			next = paths.size();
+			done.close();
+			Completed rest;
+			while (done.pop(rest)) {
+				if (rest.buffer >= 0) {
+					pool_.release(rest.buffer);
+				}
+			}
+			for (std::thread &t : threads) {
+				t.join();
+			}
+			stats_.syscalls += syscalls;
+			stats_.overflows += overflows;
+		};
+
+		Completed item;
+		try {
+			while (done.pop(item)) {
+				if (!item.overflow.empty()) {
+					item.file.data = item.overflow.data();
+				}
+				record(item.file);
+				callback(item.file);
+				if (item.buffer >= 0) {
+					pool_.release(item.buffer);
+					item.buffer = -1;
+				}
+			}
+		} catch (...) {
+			if (item.buffer >= 0) {
+				pool_.release(item.buffer);
+			}
+			finish();
+			throw;
+		}
+		finish();
+	}
+};
+
+
+// Loader Source
+
+// Every regular file below root in directory order, like DirectorySource,
+// but read through a FileLoader a batch of files at a time so the fetch
+// stage of an IngestPipeline does not block on one file after another.
+// Unreadable files are skipped.
+//
+// Each file is copied out of its pool buffer into Document::raw. The
+// pipeline parses documents on other threads while the loader reuses the
+// buffers, and the pool holds only queue_depth of them, so lending them
+// until parsing finishes would stall the ring. The copy is one memcpy of
+// the file: in bench_loader, tokenizing a copy of each loaded file is
+// within run-to-run noise of tokenizing the buffer in place (about 65K
+// files/s on 1-8 KB files). The LoaderSource row there is about 20%
+// slower than the raw io_uring row, mostly from the directory walk and
+// the ring draining at the end of each batch.
+class LoaderSource : public DocumentSource {
+public:
+	explicit LoaderSource(const std::string &root, LoaderOptions options = LoaderOptions()) :
+			loader_(options), batch_(BATCH_DEPTHS * std::max(options.queue_depth, 1UL)),
+			itr_(root), end_() {}
+
+	bool next(Document &doc) override {
+		while (ready_.empty()) {
+			if (!load_batch()) {
+				return false;
+			}
+		}
+		doc.url = std::move(ready_.front().url);
+		doc.raw = std::move(ready_.front().raw);
+		ready_.pop_front();
+		return true;
+	}
+
+	const FileLoader& loader() const {
+		return loader_;
+	}
+
+private:
+	// Files per batch, in loader queue depths; the ring only drains at the
+	// end of a batch
+	static const unsigned long BATCH_DEPTHS = 4;
+
+	FileLoader loader_;
+	unsigned long batch_;
+	std::filesystem::recursive_directory_iterator itr_;
+	std::filesystem::recursive_directory_iterator end_;
+	std::deque<Document> ready_;
+
+
+	// Loads the next batch into ready_; false once the tree is exhausted
+	bool load_batch() {
+		std::vector<std::string> paths;
+		while (itr_ != end_ && paths.size() < batch_) {
+			if (itr_->is_regular_file()) {
+				paths.push_back(itr_->path().string());
+			}
+			++itr_;
+		}
+		if (paths.empty()) {
+			return false;
+		}
+
+		std::vector<Document> docs(paths.size());
+		std::vector<bool> loaded(paths.size(), false);
+		loader_.load(paths, [&](const LoadedFile &file) {
+			if (!file.error) {
+				docs[file.index].raw.assign(file.data, file.length);
+				loaded[file.index] = true;
+			}
+		});
+
+		for (unsigned long i = 0; i < paths.size(); i++) {
+			if (loaded[i]) {
+				docs[i].url = "file://" + paths[i];
+				ready_.push_back(std::move(docs[i]));
+			}
+		}
+		return true;
+	}
+};
+
+
+}
+#endif
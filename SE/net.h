@@ -0,0 +1,320 @@
+// net header file
+//
+// Unix domain or TCP sockets carrying length-prefixed frames: a 4-byte little
+// endian payload length, then the payload. Servers read through a
+// FrameBuffer, which takes whatever bytes a readable socket has and hands
+// out complete frames, so one poll loop can serve many connections; replies
+// queue per connection and go out with send_pending as the socket takes
+// them. Clients wait for replies with a deadline instead of blocking forever;
+// one that must not block at all, like ShardCoordinator, also connects with
+// start_connect_unix and sends with send_pending.
+//
+// An address containing a '/' is a Unix socket path, anything else is
+// host:port over TCP (IPv4, port 0 picks a free port on listening).
+
+#ifndef SE_NET_H
+#define SE_NET_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace SE {
+
+typedef std::chrono::steady_clock::time_point Deadline;
+
+const unsigned long MAX_FRAME = 16UL << 20;
+
+inline sockaddr_un unix_address(const std::string &path) {
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw "Socket path too long!";
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return address;
+}
+
+// Listening socket at path, replacing a stale socket file
+inline int listen_unix(const std::string &path) {
+	sockaddr_un address = unix_address(path);
+	::unlink(path.c_str());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		throw "Cannot create socket!";
+	}
+	if (::bind(fd, (sockaddr*) &address, sizeof(address)) != 0 || ::listen(fd, 128) != 0) {
+		::close(fd);
+		throw "Cannot listen on socket!";
+	}
+	return fd;
+}
+
+// Connected socket, or -1 if nothing listens at path
+inline int connect_unix(const std::string &path) {
+	sockaddr_un address = unix_address(path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (::connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Non-blocking socket connecting to path, or -1 if nothing listens there
+// or its backlog is full. connecting is set while the connection is still
+// being made: poll for POLLOUT, then check connect_error().
+inline int start_connect_unix(const std::string &path, bool &connecting) {
+	sockaddr_un address = unix_address(path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	connecting = false;
+	if (::connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+		if (errno != EINPROGRESS) {
+			::close(fd);
+			return -1;
+		}
+		connecting = true;
+	}
+	return fd;
+}
+
+// Outcome of a non-blocking connect once fd polled writable, 0 if connected
+inline int connect_error(int fd) {
+	int error = 0;
+	socklen_t size = sizeof(error);
+	if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0) {
+		return errno;
+	}
+	return error;
+}
+
+// Small frames go out at once instead of waiting on Nagle's algorithm;
+// a no-op on Unix sockets
+inline void set_no_delay(int fd) {
+	int one = 1;
+	::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+inline sockaddr_in tcp_address(const std::string &address) {
+	unsigned long colon = address.rfind(':');
+	if (colon == std::string::npos) {
+		throw "TCP address needs host:port!";
+	}
+	sockaddr_in in;
+	std::memset(&in, 0, sizeof(in));
+	in.sin_family = AF_INET;
+	std::string host = address.substr(0, colon);
+	char* end;
+	unsigned long port = std::strtoul(address.c_str() + colon + 1, &end, 10);
+	if (*end != '\0' || colon + 1 == address.size() || port > 65535
+			|| ::inet_pton(AF_INET, host.empty() ? "0.0.0.0" : host.c_str(), &in.sin_addr) != 1) {
+		throw "Bad TCP address!";
+	}
+	in.sin_port = htons((uint16_t) port);
+	return in;
+}
+
+inline bool is_unix_address(const std::string &address) {
+	return address.find('/') != std::string::npos;
+}
+
+// Listening socket for a Unix path or host:port
+inline int listen_address(const std::string &address) {
+	if (is_unix_address(address)) {
+		return listen_unix(address);
+	}
+	sockaddr_in in = tcp_address(address);
+	int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		throw "Cannot create socket!";
+	}
+	int one = 1;
+	::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (::bind(fd, (sockaddr*) &in, sizeof(in)) != 0 || ::listen(fd, 128) != 0) {
+		::close(fd);
+		throw "Cannot listen on socket!";
+	}
+	return fd;
+}
+
+// Connected socket for a Unix path or host:port, or -1 if nothing listens
+inline int connect_address(const std::string &address) {
+	if (is_unix_address(address)) {
+		return connect_unix(address);
+	}
+	sockaddr_in in = tcp_address(address);
+	int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (::connect(fd, (sockaddr*) &in, sizeof(in)) != 0) {
+		::close(fd);
+		return -1;
+	}
+	set_no_delay(fd);
+	return fd;
+}
+
+// TCP port a socket is bound to, 0 for Unix sockets
+inline unsigned long local_port(int fd) {
+	sockaddr_storage address;
+	socklen_t size = sizeof(address);
+	if (::getsockname(fd, (sockaddr*) &address, &size) != 0 || address.ss_family != AF_INET) {
+		return 0;
+	}
+	return ntohs(((sockaddr_in*) &address)->sin_port);
+}
+
+// Appends the frame header and payload to out
+inline void append_frame(std::string &out, const std::string &payload) {
+	uint32_t length = (uint32_t) payload.size();
+	out.append((const char*) &length, 4);
+	out += payload;
+}
+
+// Writes the frame header and payload; false if the peer is gone
+inline bool send_frame(int fd, const std::string &payload) {
+	std::string frame;
+	append_frame(frame, payload);
+
+	const char* data = frame.data();
+	unsigned long left = frame.size();
+	while (left > 0) {
+		ssize_t n = ::send(fd, data, left, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += n;
+		left -= n;
+	}
+	return true;
+}
+
+// Writes what fd takes of out without blocking and erases it from out;
+// false if the peer is gone
+inline bool send_pending(int fd, std::string &out) {
+	unsigned long sent = 0;
+	while (sent < out.size()) {
+		ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return false;
+		}
+		sent += n;
+	}
+	out.erase(0, sent);
+	return true;
+}
+
+// Milliseconds until deadline for poll(), 0 once passed
+inline int poll_timeout(Deadline deadline) {
+	auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+	return left.count() <= 0 ? 0 : (int) ((left.count() + 999) / 1000);
+}
+
+class FrameBuffer {
+public:
+	FrameBuffer() : start_(0) {}
+
+	// Appends what fd has to read without blocking on more; false on end
+	// of stream, an error or an oversized frame
+	bool fill(int fd) {
+		char chunk[1 << 16];
+		ssize_t n;
+		do {
+			n = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+		} while (n < 0 && errno == EINTR);
+		if (n < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		if (n == 0) {
+			return false;
+		}
+		data_.append(chunk, n);
+		return header_size() <= MAX_FRAME;
+	}
+
+	// Moves the next complete frame's payload into payload
+	bool next(std::string &payload) {
+		if (data_.size() - start_ < 4 || data_.size() - start_ - 4 < header_size()) {
+			return false;
+		}
+		unsigned long length = header_size();
+		payload.assign(data_, start_ + 4, length);
+		start_ += 4 + length;
+		if (start_ == data_.size()) {
+			data_.clear();
+			start_ = 0;
+		} else if (start_ > data_.size() / 2) {
+			data_.erase(0, start_);
+			start_ = 0;
+		}
+		return true;
+	}
+
+	void clear() {
+		data_.clear();
+		start_ = 0;
+	}
+
+private:
+	std::string data_;
+	unsigned long start_;  // first byte of the next frame
+
+
+	// Payload length of the next frame, 0 until its header is in
+	unsigned long header_size() const {
+		if (data_.size() - start_ < 4) {
+			return 0;
+		}
+		uint32_t length;
+		std::memcpy(&length, data_.data() + start_, 4);
+		return length;
+	}
+};
+
+// Waits for one frame on fd; false on timeout, end of stream or error
+inline bool recv_frame(int fd, FrameBuffer &buffer, std::string &payload, Deadline deadline) {
+	while (!buffer.next(payload)) {
+		pollfd p = { fd, POLLIN, 0 };
+		int ready = ::poll(&p, 1, poll_timeout(deadline));
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ready <= 0 || !buffer.fill(fd)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+}
+#endif
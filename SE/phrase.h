@@ -0,0 +1,247 @@
+// phrase header file
+//
+// Exact phrase and proximity queries over an index built with positions.
+// Both run in two stages:
+//
+//   documents   galloping intersection of the terms' docID lists, led by
+//               the rarest term: each other list is searched by doubling
+//               steps from its last match, so a list is never scanned
+//   positions   only for documents in every list: decode each term's
+//               position list (TermPositions skips the others undecoded)
+//               and check the phrase or window
+//
+// Documents are never re-read; a query touches its terms' postings and the
+// position lists of the candidates that survive the first stage. The
+// _filtered queries leapfrog a document filter (see AllDocuments) along
+// with the docID lists, so documents outside it never reach the second.
+
+#ifndef SE_PHRASE_H
+#define SE_PHRASE_H
+
+#include "indexer.h"
+#include "instrument.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+SE_DEFINE_COUNTER(phrase_candidates);
+
+namespace SE {
+
+// First index at or after from whose doc is >= target, docs.size() if none
+inline unsigned long gallop(const std::vector<uint32_t> &docs, unsigned long from, uint32_t target) {
+	if (from >= docs.size() || docs[from] >= target) {
+		return from;
+	}
+	// docs[low] < target throughout
+	unsigned long low = from, step = 1;
+	while (low + step < docs.size() && docs[low + step] < target) {
+		low += step;
+		step *= 2;
+	}
+	unsigned long high = std::min(low + step, (unsigned long) docs.size());
+	return std::lower_bound(docs.begin() + low + 1, docs.begin() + high, target) - docs.begin();
+}
+
+class PhraseMatcher {
+public:
+	explicit PhraseMatcher(const InvertedIndex &index) : index_(index) {
+		if (!index.has_positions()) {
+			throw "Phrase queries need an index with positions!";
+		}
+	}
+
+	// Appends the documents containing the terms consecutively, in docID
+	// order; returns how many
+	unsigned long phrase(const std::vector<std::string> &terms, std::vector<uint32_t> &out) {
+		return phrase_filtered(terms, AllDocuments(), out);
+	}
+
+	// Appends the documents with every distinct term inside some run of
+	// window consecutive positions, in any order; returns how many
+	unsigned long near(const std::vector<std::string> &terms, unsigned long window, std::vector<uint32_t> &out) {
+		return near_filtered(terms, window, AllDocuments(), out);
+	}
+
+	// Same as phrase(), among the documents in filter
+	template<class Filter>
+	unsigned long phrase_filtered(const std::vector<std::string> &terms, const Filter &filter,
+			std::vector<uint32_t> &out) {
+		if (!load(terms)) {
+			return 0;
+		}
+		return intersect(filter, out, [this](const std::vector<unsigned long> &at) {
+			return has_phrase(at);
+		});
+	}
+
+	// Same as near(), among the documents in filter
+	template<class Filter>
+	unsigned long near_filtered(const std::vector<std::string> &terms, unsigned long window,
+			const Filter &filter, std::vector<uint32_t> &out) {
+		std::vector<std::string> distinct(terms);
+		std::sort(distinct.begin(), distinct.end());
+		distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+		if (window < distinct.size() || !load(distinct)) {
+			return 0;
+		}
+		return intersect(filter, out, [this, window](const std::vector<unsigned long> &at) {
+			return within(at, window);
+		});
+	}
+
+private:
+	const InvertedIndex &index_;
+	std::vector<TermPositions> lists_;          // one per distinct term
+	std::vector<unsigned long> slots_;          // query position -> list
+	std::vector<std::vector<uint32_t>> decoded_;
+
+
+	// Loads each distinct term once; false if the query can't match
+	bool load(const std::vector<std::string> &terms) {
+		if (terms.empty()) {
+			return false;
+		}
+		std::vector<std::string> names;
+		slots_.clear();
+		for (const std::string &term : terms) {
+			unsigned long list = std::find(names.begin(), names.end(), term) - names.begin();
+			if (list == names.size()) {
+				names.push_back(term);
+			}
+			slots_.push_back(list);
+		}
+
+		lists_.resize(names.size());
+		decoded_.resize(names.size());
+		for (unsigned long i = 0; i < names.size(); i++) {
+			if (!index_.positions(names[i], lists_[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Leapfrogs the docID lists, rarest first, then the filter, and appends
+	// the common docs that match(at) accepts, at[list] being the doc's
+	// index in each list
+	template<class Filter, class Match>
+	unsigned long intersect(const Filter &filter, std::vector<uint32_t> &out, Match match) {
+		std::vector<unsigned long> order(lists_.size());
+		for (unsigned long i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [this](unsigned long a, unsigned long b) {
+			return lists_[a].size() < lists_[b].size();
+		});
+
+		std::vector<unsigned long> at(lists_.size(), 0);
+		const std::vector<uint32_t> &lead = lists_[order[0]].docs();
+		unsigned long found = 0;
+		unsigned long i = 0;
+		while (i < lead.size()) {
+			uint32_t doc = lead[i];
+			bool all = true;
+			for (unsigned long o = 1; o < order.size(); o++) {
+				const std::vector<uint32_t> &docs = lists_[order[o]].docs();
+				unsigned long &j = at[order[o]];
+				j = gallop(docs, j, doc);
+				if (j == docs.size()) {
+					return found;
+				}
+				if (docs[j] != doc) {
+					i = gallop(lead, i + 1, docs[j]);
+					all = false;
+					break;
+				}
+			}
+			if (!all) {
+				continue;
+			}
+
+			unsigned long member = filter.next(doc);
+			if (member > UINT32_MAX) {
+				return found;
+			}
+			if (member != doc) {
+				i = gallop(lead, i + 1, (uint32_t) member);
+				continue;
+			}
+
+			SE_COUNT(phrase_candidates, 1);
+			at[order[0]] = i;
+			if (match(at)) {
+				out.push_back(doc);
+				found++;
+			}
+			i++;
+		}
+		return found;
+	}
+
+	void decode(const std::vector<unsigned long> &at) {
+		for (unsigned long l = 0; l < lists_.size(); l++) {
+			lists_[l].positions(at[l], decoded_[l]);
+		}
+	}
+
+	// Some start p with slot k's term at p + k for every slot
+	bool has_phrase(const std::vector<unsigned long> &at) {
+		if (slots_.size() == 1) {
+			return true;
+		}
+		decode(at);
+
+		// Starts implied by the first slot, narrowed by each later one
+		std::vector<uint32_t> starts(decoded_[slots_[0]]);
+		for (unsigned long k = 1; k < slots_.size() && !starts.empty(); k++) {
+			const std::vector<uint32_t> &positions = decoded_[slots_[k]];
+			unsigned long kept = 0, p = 0;
+			for (uint32_t start : starts) {
+				while (p < positions.size() && positions[p] < start + k) {
+					p++;
+				}
+				if (p < positions.size() && positions[p] == start + k) {
+					starts[kept++] = start;
+				}
+			}
+			starts.resize(kept);
+		}
+		return !starts.empty();
+	}
+
+	// Smallest span holding one position of every list, by always
+	// advancing the list at the span's start
+	bool within(const std::vector<unsigned long> &at, unsigned long window) {
+		if (lists_.size() == 1) {
+			return true;
+		}
+		decode(at);
+
+		std::vector<unsigned long> next(lists_.size(), 0);
+		while (true) {
+			unsigned long first = 0;
+			uint32_t low = decoded_[0][next[0]], high = low;
+			for (unsigned long l = 1; l < lists_.size(); l++) {
+				uint32_t position = decoded_[l][next[l]];
+				if (position < low) {
+					low = position;
+					first = l;
+				}
+				high = std::max(high, position);
+			}
+			if (high - low < window) {
+				return true;
+			}
+			if (++next[first] == decoded_[first].size()) {
+				return false;
+			}
+		}
+	}
+};
+
+
+}
+#endif
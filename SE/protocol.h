@@ -0,0 +1,109 @@
+// protocol header file
+//
+// Binary query protocol shared by the query server (server.h) and shard
+// servers (shard.h). Each message is one frame (net.h) of varint fields:
+//
+//   request    k, term count, then each term as length and bytes
+//   response   hit count, then each hit as float score bits and docID
+//
+// A two-term top-10 query is about 15 bytes and its answer about 60, so a
+// request costs one small write each way. Decoding checks every field
+// against the end of the frame and k against MAX_K: requests come off
+// sockets, and k sizes the top k heap.
+
+#ifndef SE_PROTOCOL_H
+#define SE_PROTOCOL_H
+
+#include "coding.h"
+#include "scoring.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace SE {
+
+// Largest k a request may ask for
+const uint32_t MAX_K = 10000;
+
+struct QueryRequest {
+	uint32_t k = 10;
+	std::vector<std::string> terms;
+};
+
+inline std::string encode_request(const QueryRequest &request) {
+	std::string out;
+	write_varint(out, request.k);
+	write_varint(out, request.terms.size());
+	for (const std::string &term : request.terms) {
+		write_varint(out, term.size());
+		out += term;
+	}
+	return out;
+}
+
+// False on any malformed or truncated field, or k over MAX_K
+inline bool decode_request(const std::string &in, QueryRequest &request) {
+	const char* p = in.data();
+	const char* end = p + in.size();
+	uint64_t value;
+	if (!read_varint_checked(p, end, value) || value > MAX_K) {
+		return false;
+	}
+	request.k = (uint32_t) value;
+	uint64_t count;
+	if (!read_varint_checked(p, end, count) || count > in.size()) {
+		return false;
+	}
+	request.terms.clear();
+	for (uint64_t i = 0; i < count; i++) {
+		if (!read_varint_checked(p, end, value) || value > (uint64_t) (end - p)) {
+			return false;
+		}
+		request.terms.emplace_back(p, value);
+		p += value;
+	}
+	return p == end;
+}
+
+inline std::string encode_hits(const std::vector<ScoredDoc> &hits) {
+	std::string out;
+	write_varint(out, hits.size());
+	for (const ScoredDoc &hit : hits) {
+		uint32_t bits;
+		std::memcpy(&bits, &hit.first, 4);
+		write_varint(out, bits);
+		write_varint(out, hit.second);
+	}
+	return out;
+}
+
+inline bool decode_hits(const std::string &in, std::vector<ScoredDoc> &hits) {
+	const char* p = in.data();
+	const char* end = p + in.size();
+	uint64_t count, bits, doc;
+	if (!read_varint_checked(p, end, count) || count > in.size()) {
+		return false;
+	}
+	hits.clear();
+	for (uint64_t i = 0; i < count; i++) {
+		if (!read_varint_checked(p, end, bits) || !read_varint_checked(p, end, doc)) {
+			return false;
+		}
+		uint32_t b = (uint32_t) bits;
+		float score;
+		std::memcpy(&score, &b, 4);
+		hits.push_back(ScoredDoc(score, doc));
+	}
+	return p == end;
+}
+
+// Higher score first, lower docID on ties, as QuantizedIndex::top_k
+inline bool ranks_before(const ScoredDoc &a, const ScoredDoc &b) {
+	return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+
+}
+#endif
@@ -0,0 +1,537 @@
+// quantize header file
+//
+// Compact codecs for per-document float vectors (TF-IDF or embeddings).
+//
+//   ScalarQuantizer  - one uint8 code per dimension (4x smaller than float)
+//   ProductQuantizer - one uint8 centroid id per subspace (dim / subspaces
+//                      floats collapse into one byte, 32x at 8 dims/byte)
+//   QuantizedIndex   - stores codes in blocks of BLOCK_DOCS documents and
+//                      scores them with asymmetric distance computation:
+//                      the query stays float, documents stay compressed.
+//
+// Searches can be restricted to a document filter (see search_filtered).
+//
+// All scores are inner products, which equal cosine similarity when the
+// vectors are L2 normalized as the TF-IDF plan in notes.txt assumes.
+
+#ifndef SE_QUANTIZE_H
+#define SE_QUANTIZE_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "instrument.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+SE_DEFINE_HISTOGRAM(quantized_search_ns);
+SE_DEFINE_COUNTER(documents_scored);
+
+namespace SE {
+
+// (score, docID) pair returned by searches, best first
+typedef std::pair<float, unsigned long> ScoredDoc;
+
+
+// Scalar Quantization
+
+class ScalarQuantizer {
+public:
+	ScalarQuantizer() : dim_(0) {}
+
+	explicit ScalarQuantizer(unsigned long dim) : dim_(dim), min_(dim, 0.0f), scale_(dim, 1.0f) {}
+
+	// Learns a [min, max] range per dimension from n row-major vectors
+	void train(const float* data, unsigned long n) {
+		if (n == 0) {
+			throw "Cannot train quantizer on empty data!";
+		}
+
+		std::vector<float> maxs(dim_, -FLT_MAX);
+		std::fill(min_.begin(), min_.end(), FLT_MAX);
+
+		for (unsigned long i = 0; i < n; i++) {
+			const float* vec = data + i * dim_;
+			for (unsigned long d = 0; d < dim_; d++) {
+				min_[d] = std::min(min_[d], vec[d]);
+				maxs[d] = std::max(maxs[d], vec[d]);
+			}
+		}
+
+		for (unsigned long d = 0; d < dim_; d++) {
+			float range = maxs[d] - min_[d];
+			scale_[d] = range > 0 ? range / LEVELS : 1.0f;
+		}
+	}
+
+	void encode(const float* vec, uint8_t* codes) const {
+		for (unsigned long d = 0; d < dim_; d++) {
+			float level = (vec[d] - min_[d]) / scale_[d] + 0.5f;
+			level = std::min(std::max(level, 0.0f), (float) LEVELS);
+			codes[d] = (uint8_t) level;
+		}
+	}
+
+	void decode(const uint8_t* codes, float* vec) const {
+		for (unsigned long d = 0; d < dim_; d++) {
+			vec[d] = min_[d] + codes[d] * scale_[d];
+		}
+	}
+
+	// Folds the per-dimension affine transform into the query so scoring is
+	// bias + sum(table[d] * code[d]); table must hold dim() floats
+	float compute_table(const float* query, float* table) const {
+		float bias = 0;
+		for (unsigned long d = 0; d < dim_; d++) {
+			table[d] = query[d] * scale_[d];
+			bias += query[d] * min_[d];
+		}
+		return bias;
+	}
+
+	float score(const float* table, float bias, const uint8_t* codes) const {
+		unsigned long d = 0;
+		float sum = bias;
+
+#ifdef __AVX2__
+		__m256 acc = _mm256_setzero_ps();
+		for (; d + 8 <= dim_; d += 8) {
+			__m128i bytes = _mm_loadl_epi64((const __m128i*) (codes + d));
+			__m256 vals = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(vals, _mm256_loadu_ps(table + d)));
+		}
+		sum += horizontal_sum(acc);
+#endif
+
+		for (; d < dim_; d++) {
+			sum += table[d] * codes[d];
+		}
+		return sum;
+	}
+
+	unsigned long dim() const {
+		return dim_;
+	}
+
+	unsigned long code_size() const {
+		return dim_;
+	}
+
+#ifdef __AVX2__
+	static float horizontal_sum(__m256 v) {
+		__m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+		lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+		return _mm_cvtss_f32(lo);
+	}
+#endif
+
+private:
+	static constexpr unsigned long LEVELS = 255;
+
+	unsigned long dim_;
+	std::vector<float> min_;
+	std::vector<float> scale_;
+};
+
+
+// Product Quantization
+
+class ProductQuantizer {
+public:
+	static constexpr unsigned long CENTROIDS = 256;
+
+	ProductQuantizer() : dim_(0), subspaces_(0), sub_dim_(0) {}
+
+	ProductQuantizer(unsigned long dim, unsigned long subspaces) :
+			dim_(dim), subspaces_(subspaces), sub_dim_(subspaces ? dim / subspaces : 0) {
+		if (subspaces == 0 || dim % subspaces != 0) {
+			throw "Dimension must be a multiple of the subspace count!";
+		}
+		centroids_.assign(subspaces_ * CENTROIDS * sub_dim_, 0.0f);
+	}
+
+	// Runs k-means independently in every subspace. At most max_samples
+	// vectors are used so training cost stays flat on large corpora.
+	void train(const float* data, unsigned long n, unsigned long iterations = 12,
+			unsigned long max_samples = 64 * CENTROIDS, unsigned long seed = 42) {
+		if (n == 0) {
+			throw "Cannot train quantizer on empty data!";
+		}
+
+		std::mt19937_64 rng(seed);
+		std::vector<unsigned long> sample(n);
+		for (unsigned long i = 0; i < n; i++) {
+			sample[i] = i;
+		}
+		std::shuffle(sample.begin(), sample.end(), rng);
+		if (sample.size() > max_samples) {
+			sample.resize(max_samples);
+		}
+
+		std::vector<float> sub(sample.size() * sub_dim_);
+		for (unsigned long s = 0; s < subspaces_; s++) {
+			for (unsigned long i = 0; i < sample.size(); i++) {
+				const float* src = data + sample[i] * dim_ + s * sub_dim_;
+				std::memcpy(&sub[i * sub_dim_], src, sub_dim_ * sizeof(float));
+			}
+			kmeans(sub.data(), sample.size(), centroid(s, 0), iterations);
+		}
+	}
+
+	void encode(const float* vec, uint8_t* codes) const {
+		for (unsigned long s = 0; s < subspaces_; s++) {
+			codes[s] = (uint8_t) nearest(s, vec + s * sub_dim_);
+		}
+	}
+
+	void decode(const uint8_t* codes, float* vec) const {
+		for (unsigned long s = 0; s < subspaces_; s++) {
+			std::memcpy(vec + s * sub_dim_, centroid(s, codes[s]), sub_dim_ * sizeof(float));
+		}
+	}
+
+	// Inner product of every query sub-vector with every centroid of that
+	// subspace; table must hold subspaces() * CENTROIDS floats
+	void compute_table(const float* query, float* table) const {
+		for (unsigned long s = 0; s < subspaces_; s++) {
+			const float* q = query + s * sub_dim_;
+			for (unsigned long c = 0; c < CENTROIDS; c++) {
+				const float* cent = centroid(s, c);
+				float dot = 0;
+				for (unsigned long d = 0; d < sub_dim_; d++) {
+					dot += q[d] * cent[d];
+				}
+				table[s * CENTROIDS + c] = dot;
+			}
+		}
+	}
+
+	float score(const float* table, const uint8_t* codes) const {
+		float sum = 0;
+		for (unsigned long s = 0; s < subspaces_; s++) {
+			sum += table[s * CENTROIDS + codes[s]];
+		}
+		return sum;
+	}
+
+	unsigned long dim() const {
+		return dim_;
+	}
+
+	unsigned long subspaces() const {
+		return subspaces_;
+	}
+
+	unsigned long code_size() const {
+		return subspaces_;
+	}
+
+private:
+	unsigned long dim_;
+	unsigned long subspaces_;
+	unsigned long sub_dim_;
+	std::vector<float> centroids_; // [subspace][centroid][sub_dim]
+
+
+	float* centroid(unsigned long s, unsigned long c) {
+		return &centroids_[(s * CENTROIDS + c) * sub_dim_];
+	}
+
+	const float* centroid(unsigned long s, unsigned long c) const {
+		return &centroids_[(s * CENTROIDS + c) * sub_dim_];
+	}
+
+	float sq_dist(const float* a, const float* b) const {
+		float dist = 0;
+		for (unsigned long d = 0; d < sub_dim_; d++) {
+			float diff = a[d] - b[d];
+			dist += diff * diff;
+		}
+		return dist;
+	}
+
+	unsigned long nearest(unsigned long s, const float* vec) const {
+		unsigned long best = 0;
+		float best_dist = FLT_MAX;
+		for (unsigned long c = 0; c < CENTROIDS; c++) {
+			float dist = sq_dist(vec, centroid(s, c));
+			if (dist < best_dist) {
+				best_dist = dist;
+				best = c;
+			}
+		}
+		return best;
+	}
+
+	void kmeans(const float* points, unsigned long n, float* cents, unsigned long iterations) {
+		// Seed with the (already shuffled) first points, cycling if n < CENTROIDS
+		for (unsigned long c = 0; c < CENTROIDS; c++) {
+			std::memcpy(cents + c * sub_dim_, points + (c % n) * sub_dim_, sub_dim_ * sizeof(float));
+		}
+
+		std::vector<unsigned long> assign(n);
+		std::vector<float> sums(CENTROIDS * sub_dim_);
+		std::vector<unsigned long> counts(CENTROIDS);
+
+		for (unsigned long iter = 0; iter < iterations; iter++) {
+			for (unsigned long i = 0; i < n; i++) {
+				unsigned long best = 0;
+				float best_dist = FLT_MAX;
+				for (unsigned long c = 0; c < CENTROIDS; c++) {
+					float dist = sq_dist(points + i * sub_dim_, cents + c * sub_dim_);
+					if (dist < best_dist) {
+						best_dist = dist;
+						best = c;
+					}
+				}
+				assign[i] = best;
+			}
+
+			std::fill(sums.begin(), sums.end(), 0.0f);
+			std::fill(counts.begin(), counts.end(), 0);
+			for (unsigned long i = 0; i < n; i++) {
+				counts[assign[i]]++;
+				for (unsigned long d = 0; d < sub_dim_; d++) {
+					sums[assign[i] * sub_dim_ + d] += points[i * sub_dim_ + d];
+				}
+			}
+
+			// Empty clusters keep their previous centroid
+			for (unsigned long c = 0; c < CENTROIDS; c++) {
+				if (counts[c] == 0) {
+					continue;
+				}
+				for (unsigned long d = 0; d < sub_dim_; d++) {
+					cents[c * sub_dim_ + d] = sums[c * sub_dim_ + d] / counts[c];
+				}
+			}
+		}
+	}
+};
+
+
+// Quantized Index
+
+enum Codec { SCALAR, PRODUCT };
+
+class QuantizedIndex {
+public:
+	// Codes of BLOCK_DOCS consecutive documents are interleaved per
+	// dimension/subspace, so one 8 byte load feeds 8 documents at once
+	static constexpr unsigned long BLOCK_DOCS = 8;
+
+	QuantizedIndex(const ScalarQuantizer& sq) : codec_(SCALAR), sq_(sq), size_(0) {}
+
+	QuantizedIndex(const ProductQuantizer& pq) : codec_(PRODUCT), pq_(pq), size_(0) {}
+
+	void add(const float* vec) {
+		unsigned long code_size = this->code_size();
+		if (size_ % BLOCK_DOCS == 0) {
+			codes_.resize(codes_.size() + code_size * BLOCK_DOCS, 0);
+		}
+
+		std::vector<uint8_t> code(code_size);
+		if (codec_ == SCALAR) {
+			sq_.encode(vec, code.data());
+		} else {
+			pq_.encode(vec, code.data());
+		}
+
+		uint8_t* block = &codes_[(size_ / BLOCK_DOCS) * code_size * BLOCK_DOCS];
+		for (unsigned long c = 0; c < code_size; c++) {
+			block[c * BLOCK_DOCS + size_ % BLOCK_DOCS] = code[c];
+		}
+		size_++;
+	}
+
+	void add(const float* data, unsigned long n) {
+		for (unsigned long i = 0; i < n; i++) {
+			add(data + i * dim());
+		}
+	}
+
+	// Approximate scores of every document against query
+	void score_all(const float* query, float* scores) const {
+		SE_COUNT(documents_scored, size_);
+		std::vector<float> table(table_size());
+		float bias = 0;
+		if (codec_ == SCALAR) {
+			bias = sq_.compute_table(query, table.data());
+		} else {
+			pq_.compute_table(query, table.data());
+		}
+
+		unsigned long blocks = (size_ + BLOCK_DOCS - 1) / BLOCK_DOCS;
+		float block_scores[BLOCK_DOCS];
+		for (unsigned long b = 0; b < blocks; b++) {
+			score_block(table.data(), bias, b, block_scores);
+
+			unsigned long count = std::min(BLOCK_DOCS, size_ - b * BLOCK_DOCS);
+			std::memcpy(scores + b * BLOCK_DOCS, block_scores, count * sizeof(float));
+		}
+	}
+
+	// Top k documents by approximate score. When originals (n x dim row-major
+	// float vectors, e.g. an mmap'd file) are given, the best rerank_depth
+	// candidates are rescored exactly before the final top k is taken.
+	std::vector<ScoredDoc> search(const float* query, unsigned long k,
+			const float* originals = nullptr, unsigned long rerank_depth = 0) const {
+		SE_TIME(quantized_search_ns);
+		std::vector<float> scores(size_);
+		score_all(query, scores.data());
+
+		unsigned long depth = originals ? std::max(k, rerank_depth) : k;
+		std::vector<ScoredDoc> top = top_k(scores.data(), size_, depth);
+
+		if (originals) {
+			for (unsigned long i = 0; i < top.size(); i++) {
+				const float* vec = originals + top[i].second * dim();
+				float dot = 0;
+				for (unsigned long d = 0; d < dim(); d++) {
+					dot += query[d] * vec[d];
+				}
+				top[i].first = dot;
+			}
+			sort_scored(top);
+			if (top.size() > k) {
+				top.resize(k);
+			}
+		}
+		return top;
+	}
+
+	// Top k among the documents in filter, any set with next(doc) returning
+	// the smallest member >= doc (SL::bitvector, SL::roaring_bitmap), e.g.
+	// the live documents with deletions removed
+	template<class Filter>
+	std::vector<ScoredDoc> search_filtered(const float* query, unsigned long k, const Filter& filter) const {
+		SE_TIME(quantized_search_ns);
+		std::vector<float> scores(size_);
+		score_all(query, scores.data());
+
+		// Compact the members' scores in docID order, so ties still go to
+		// the lower docID
+		std::vector<float> kept;
+		std::vector<unsigned long> docs;
+		for (unsigned long doc = filter.next(0); doc < size_; doc = filter.next(doc + 1)) {
+			kept.push_back(scores[doc]);
+			docs.push_back(doc);
+		}
+
+		std::vector<ScoredDoc> top = top_k(kept.data(), kept.size(), k);
+		for (ScoredDoc& hit : top) {
+			hit.second = docs[hit.second];
+		}
+		return top;
+	}
+
+	unsigned long size() const {
+		return size_;
+	}
+
+	unsigned long dim() const {
+		return codec_ == SCALAR ? sq_.dim() : pq_.dim();
+	}
+
+	unsigned long code_size() const {
+		return codec_ == SCALAR ? sq_.code_size() : pq_.code_size();
+	}
+
+	// Bytes of code storage per document (excluding block padding)
+	unsigned long bytes_per_doc() const {
+		return code_size();
+	}
+
+	static std::vector<ScoredDoc> top_k(const float* scores, unsigned long n, unsigned long k) {
+		// Min-heap of the best k seen so far; the root is the one to evict
+		std::vector<ScoredDoc> heap;
+		heap.reserve(std::min(k, n));
+		auto worse = [](const ScoredDoc& a, const ScoredDoc& b) { return better(a, b); };
+
+		for (unsigned long i = 0; i < n && k > 0; i++) {
+			if (heap.size() < k) {
+				heap.push_back(ScoredDoc(scores[i], i));
+				std::push_heap(heap.begin(), heap.end(), worse);
+			} else if (better(ScoredDoc(scores[i], i), heap.front())) {
+				std::pop_heap(heap.begin(), heap.end(), worse);
+				heap.back() = ScoredDoc(scores[i], i);
+				std::push_heap(heap.begin(), heap.end(), worse);
+			}
+		}
+
+		sort_scored(heap);
+		return heap;
+	}
+
+private:
+	Codec codec_;
+	ScalarQuantizer sq_;
+	ProductQuantizer pq_;
+	unsigned long size_;
+	std::vector<uint8_t> codes_;
+
+
+	// Higher score first, lower docID breaks ties
+	static bool better(const ScoredDoc& a, const ScoredDoc& b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	}
+
+	static void sort_scored(std::vector<ScoredDoc>& docs) {
+		std::sort(docs.begin(), docs.end(), better);
+	}
+
+	unsigned long table_size() const {
+		return codec_ == SCALAR ? sq_.dim() : pq_.subspaces() * ProductQuantizer::CENTROIDS;
+	}
+
+	void score_block(const float* table, float bias, unsigned long b, float* out) const {
+		unsigned long code_size = this->code_size();
+		const uint8_t* block = &codes_[b * code_size * BLOCK_DOCS];
+
+#ifdef __AVX2__
+		__m256 acc = _mm256_set1_ps(bias);
+		for (unsigned long c = 0; c < code_size; c++) {
+			__m128i bytes = _mm_loadl_epi64((const __m128i*) (block + c * BLOCK_DOCS));
+			__m256i idx = _mm256_cvtepu8_epi32(bytes);
+
+			if (codec_ == SCALAR) {
+				__m256 vals = _mm256_cvtepi32_ps(idx);
+				acc = _mm256_add_ps(acc, _mm256_mul_ps(vals, _mm256_set1_ps(table[c])));
+			} else {
+				const float* sub_table = table + c * ProductQuantizer::CENTROIDS;
+				acc = _mm256_add_ps(acc, _mm256_i32gather_ps(sub_table, idx, 4));
+			}
+		}
+		_mm256_storeu_ps(out, acc);
+#else
+		for (unsigned long i = 0; i < BLOCK_DOCS; i++) {
+			out[i] = bias;
+		}
+		for (unsigned long c = 0; c < code_size; c++) {
+			const uint8_t* codes = block + c * BLOCK_DOCS;
+			if (codec_ == SCALAR) {
+				for (unsigned long i = 0; i < BLOCK_DOCS; i++) {
+					out[i] += table[c] * codes[i];
+				}
+			} else {
+				const float* sub_table = table + c * ProductQuantizer::CENTROIDS;
+				for (unsigned long i = 0; i < BLOCK_DOCS; i++) {
+					out[i] += sub_table[codes[i]];
+				}
+			}
+		}
+#endif
+	}
+};
+
+
+}
+#endif
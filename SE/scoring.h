@@ -0,0 +1,352 @@
+// scoring header file
+//
+// Relevance models for scoring posting lists, chosen at compile time. The
+// similarity in notes.txt (TF-IDF + cosine) is one model among several:
+//
+//   TfIdfCosine     - (1 + ln tf) * idf^2 / document norm
+//   BM25<P>         - Okapi BM25 with P::k1, P::b
+//   BM25F<P>        - BM25 over P::FIELDS weighted fields (e.g. title, body)
+//   Dirichlet<P>    - query likelihood with Dirichlet smoothing, P::mu
+//
+// A model is a policy class; custom models need the same members:
+//
+//   static constexpr unsigned long FIELDS;   // tf and doc columns per posting
+//   static constexpr DocValue DOC_VALUE;     // per-document input: length or norm
+//   struct Term;                             // per query term constants
+//   static Term prepare(const CollectionStats&, const TermStats&, float query_weight);
+//   static float score(const Term&, const float* tf, const float* doc);
+//
+// score_block<Model>() is the inner loop. Parameters are constexpr members
+// of the parameter type, and score() is a static inline function. So each
+// model gets its own loop with no indirect call, and BM25 compiles to
+// straight-line vector code. TermScorer runs term-at-a-time queries over an
+// InvertedIndex and DocStore with any single-field model, taking its
+// per-query scratch from an SL::arena rather than the heap; its
+// search_filtered restricts a query to a document filter.
+
+#ifndef SE_SCORING_H
+#define SE_SCORING_H
+
+#include "docstore.h"
+#include "indexer.h"
+#include "quantize.h"
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SE {
+
+const unsigned long MAX_FIELDS = 8;
+
+// What a model reads per document alongside term frequency
+enum DocValue { DOC_LENGTH, DOC_NORM };
+
+struct CollectionStats {
+	unsigned long documents = 0;
+	unsigned long total_terms = 0;                // over every field
+	float average_length[MAX_FIELDS] = {};       // per field
+};
+
+struct TermStats {
+	unsigned long df = 0;   // documents containing the term
+	unsigned long cf = 0;   // occurrences in the collection
+};
+
+// Column-wise postings of one term, size entries per column
+template<unsigned long FIELDS>
+struct PostingBlock {
+	unsigned long size = 0;
+	const float* tf[FIELDS] = {};
+	const float* doc[FIELDS] = {};  // the model's DOC_VALUE of each posting's document
+};
+
+
+// Models
+
+// Smoothed so terms in every document still count a little
+inline float idf(unsigned long documents, unsigned long df) {
+	return std::log(1.0f + (documents - df + 0.5f) / (df + 0.5f));
+}
+
+struct TfIdfCosine {
+	static constexpr unsigned long FIELDS = 1;
+	static constexpr DocValue DOC_VALUE = DOC_NORM;
+
+	struct Term {
+		float weight;  // query weight * idf * idf
+	};
+
+	static Term prepare(const CollectionStats &collection, const TermStats &term, float query_weight) {
+		float w = std::log((float) collection.documents / std::max(term.df, 1UL));
+		return { query_weight * w * w };
+	}
+
+	static float score(const Term &term, const float* tf, const float* norm) {
+		return term.weight * (1.0f + std::log(tf[0])) / norm[0];
+	}
+};
+
+struct BM25Params {
+	static constexpr float k1 = 1.2f;
+	static constexpr float b = 0.75f;
+};
+
+template<class P = BM25Params>
+struct BM25 {
+	static constexpr unsigned long FIELDS = 1;
+	static constexpr DocValue DOC_VALUE = DOC_LENGTH;
+
+	struct Term {
+		float weight;  // query weight * idf * (k1 + 1)
+		float base;    // k1 * (1 - b)
+		float slope;   // k1 * b / average length
+	};
+
+	static Term prepare(const CollectionStats &collection, const TermStats &term, float query_weight) {
+		float avg = collection.average_length[0] > 0 ? collection.average_length[0] : 1.0f;
+		return { query_weight * idf(collection.documents, term.df) * (P::k1 + 1),
+				P::k1 * (1 - P::b), P::k1 * P::b / avg };
+	}
+
+	static float score(const Term &term, const float* tf, const float* length) {
+		return term.weight * tf[0] / (tf[0] + term.base + term.slope * length[0]);
+	}
+};
+
+// Title and body, title twice as important
+struct BM25FParams {
+	static constexpr unsigned long FIELDS = 2;
+	static constexpr float k1 = 1.2f;
+	static constexpr float weight[FIELDS] = { 2.0f, 1.0f };
+	static constexpr float b[FIELDS] = { 0.5f, 0.75f };
+};
+
+template<class P = BM25FParams>
+struct BM25F {
+	static constexpr unsigned long FIELDS = P::FIELDS;
+	static constexpr DocValue DOC_VALUE = DOC_LENGTH;
+	static_assert(FIELDS <= MAX_FIELDS, "Too many BM25F fields");
+
+	struct Term {
+		float weight;         // query weight * idf * (k1 + 1)
+		float base[FIELDS];   // (1 - b) / field weight
+		float slope[FIELDS];  // b / (average length * field weight)
+	};
+
+	static Term prepare(const CollectionStats &collection, const TermStats &term, float query_weight) {
+		Term t;
+		t.weight = query_weight * idf(collection.documents, term.df) * (P::k1 + 1);
+		for (unsigned long f = 0; f < FIELDS; f++) {
+			float avg = collection.average_length[f] > 0 ? collection.average_length[f] : 1.0f;
+			t.base[f] = (1 - P::b[f]) / P::weight[f];
+			t.slope[f] = P::b[f] / (avg * P::weight[f]);
+		}
+		return t;
+	}
+
+	static float score(const Term &term, const float* tf, const float* length) {
+		float pseudo_tf = 0;
+		for (unsigned long f = 0; f < FIELDS; f++) {
+			pseudo_tf += tf[f] / (term.base[f] + term.slope[f] * length[f]);
+		}
+		return term.weight * pseudo_tf / (pseudo_tf + P::k1);
+	}
+};
+
+struct DirichletParams {
+	static constexpr float mu = 2000.0f;
+};
+
+// Per matched term: ln(1 + tf / (mu * P(t|C))) + ln(mu / (length + mu)),
+// floored at 0 so long documents never lose score by matching
+template<class P = DirichletParams>
+struct Dirichlet {
+	static constexpr unsigned long FIELDS = 1;
+	static constexpr DocValue DOC_VALUE = DOC_LENGTH;
+
+	struct Term {
+		float weight;
+		float inv_mu_p;  // 1 / (mu * P(t|C))
+	};
+
+	static Term prepare(const CollectionStats &collection, const TermStats &term, float query_weight) {
+		float p = (float) std::max(term.cf, 1UL) / std::max(collection.total_terms, 1UL);
+		return { query_weight, 1.0f / (P::mu * p) };
+	}
+
+	static float score(const Term &term, const float* tf, const float* length) {
+		float s = std::log(1.0f + tf[0] * term.inv_mu_p) + std::log(P::mu / (length[0] + P::mu));
+		return term.weight * std::max(s, 0.0f);
+	}
+};
+
+
+// Scoring Loop
+
+// scores[i] += score of posting i
+template<class Model>
+void score_block(const typename Model::Term &term, const PostingBlock<Model::FIELDS> &block, float* scores) {
+	// Local copies: stores to scores could otherwise alias the term's floats,
+	// forcing a reload of every constant per posting
+	const typename Model::Term t = term;
+	const PostingBlock<Model::FIELDS> columns = block;
+	// One field reads straight from the columns, the same code as a loop
+	// written by hand. Gathering into locals first loads the document value
+	// ahead of a model's log call and spills it across the call.
+	if constexpr (Model::FIELDS == 1) {
+		for (unsigned long i = 0; i < columns.size; i++) {
+			scores[i] += Model::score(t, columns.tf[0] + i, columns.doc[0] + i);
+		}
+		return;
+	}
+	for (unsigned long i = 0; i < columns.size; i++) {
+		float tf[Model::FIELDS];
+		float doc[Model::FIELDS];
+		for (unsigned long f = 0; f < Model::FIELDS; f++) {
+			tf[f] = columns.tf[f][i];
+			doc[f] = columns.doc[f][i];
+		}
+		scores[i] += Model::score(t, tf, doc);
+	}
+}
+
+
+// Term-at-a-time search over an InvertedIndex, with per-document lengths
+// and norms from the DocStore built alongside it (same docIDs)
+template<class Model>
+class TermScorer {
+public:
+	static_assert(Model::FIELDS == 1, "InvertedIndex postings have a single field");
+
+	TermScorer(const InvertedIndex &index, const DocStore &docs) : index_(index), docs_(docs) {
+		collection_.documents = docs.size();
+		collection_.average_length[0] = (float) docs.average_length();
+		collection_.total_terms = (unsigned long) (docs.average_length() * docs.size() + 0.5);
+	}
+
+	const CollectionStats& collection() const {
+		return collection_;
+	}
+
+	// Top k documents for the query terms; repeated terms weigh more. The
+	// scratch space comes from an arena made for the query, whose blocks
+	// are recycled through this thread's pool from one query to the next.
+	std::vector<ScoredDoc> search(const std::vector<std::string> &query, unsigned long k) const {
+		SL::arena arena;
+		return search(query, k, SL::arena_allocator<char>(arena));
+	}
+
+	// Same, with the scratch vectors drawn from alloc: an arena_allocator
+	// for a caller's own arena, or std::allocator for the heap
+	template<class Allocator>
+	std::vector<ScoredDoc> search(const std::vector<std::string> &query, unsigned long k,
+			const Allocator &alloc) const {
+		return search_filtered(query, k, AllDocuments(), alloc);
+	}
+
+	// Top k among the documents in filter (see AllDocuments), e.g. the live
+	// documents with deletions removed. Postings of other documents are
+	// skipped before they are scored; term statistics still count them.
+	template<class Filter>
+	std::vector<ScoredDoc> search_filtered(const std::vector<std::string> &query, unsigned long k,
+			const Filter &filter) const {
+		SL::arena arena;
+		return search_filtered(query, k, filter, SL::arena_allocator<char>(arena));
+	}
+
+	template<class Filter, class Allocator>
+	std::vector<ScoredDoc> search_filtered(const std::vector<std::string> &query, unsigned long k,
+			const Filter &filter, const Allocator &alloc) const {
+		Scratch<Allocator, const std::string*> terms(alloc);
+		for (const std::string &term : query) {
+			terms.push_back(&term);
+		}
+		std::sort(terms.begin(), terms.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+		Scratch<Allocator, float> accumulators(docs_.size(), 0.0f, alloc);
+		Scratch<Allocator, std::pair<uint32_t, uint32_t>> postings(alloc);
+		Scratch<Allocator, float> tfs(alloc), values(alloc), scores(alloc);
+		for (unsigned long i = 0; i < terms.size();) {
+			unsigned long j = i;
+			while (j < terms.size() && *terms[j] == *terms[i]) {
+				j++;
+			}
+			float query_weight = (float) (j - i);
+
+			postings.clear();
+			index_.postings(*terms[i], postings);
+			i = j;
+			if (postings.empty()) {
+				continue;
+			}
+
+			// Leapfrog the filter along the postings, keeping the members
+			TermStats stats;
+			stats.df = postings.size();
+			tfs.resize(postings.size());
+			values.resize(postings.size());
+			unsigned long member = filter.next(0);
+			unsigned long n = 0;
+			for (unsigned long p = 0; p < postings.size(); p++) {
+				uint32_t doc = postings[p].first;
+				stats.cf += postings[p].second;
+				if (member < doc) {
+					member = filter.next(doc);
+				}
+				if (member != doc) {
+					continue;
+				}
+				postings[n] = postings[p];
+				tfs[n] = (float) postings[p].second;
+				values[n] = Model::DOC_VALUE == DOC_NORM ? docs_.norm(doc) : (float) docs_.length(doc);
+				n++;
+			}
+			postings.resize(n);
+			scores.assign(n, 0.0f);
+
+			PostingBlock<1> block;
+			block.size = n;
+			block.tf[0] = tfs.data();
+			block.doc[0] = values.data();
+			score_block<Model>(Model::prepare(collection_, stats, query_weight), block, scores.data());
+
+			for (unsigned long p = 0; p < postings.size(); p++) {
+				accumulators[postings[p].first] += scores[p];
+			}
+		}
+
+		// Documents matching no term stay out of the results
+		Scratch<Allocator, float> kept(alloc);
+		Scratch<Allocator, unsigned long> ids(alloc);
+		for (unsigned long doc = 0; doc < accumulators.size(); doc++) {
+			if (accumulators[doc] > 0) {
+				kept.push_back(accumulators[doc]);
+				ids.push_back(doc);
+			}
+		}
+		std::vector<ScoredDoc> top = QuantizedIndex::top_k(kept.data(), kept.size(), k);
+		for (ScoredDoc &hit : top) {
+			hit.second = ids[hit.second];
+		}
+		return top;
+	}
+
+private:
+	template<class Allocator, class T>
+	using Scratch = std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+
+	const InvertedIndex &index_;
+	const DocStore &docs_;
+	CollectionStats collection_;
+};
+
+
+}
+#endif
@@ -0,0 +1,128 @@
+// Query Server
+//
+// Usage: se_server index <crawl dir> <index dir> [shards]
+//        se_server serve <shard dir> <address> [workers]
+//        se_server query <address> <term>...
+//
+// index crawls a directory tree, read in batches through FileLoader, with
+// the ingest pipeline and writes <index dir>/shard-0 ... one directory per
+// shard (one by default), with the snippet store of each shard's text,
+// leaving out near-duplicates of pages already indexed.
+// serve loads one shard directory and answers queries until SIGINT or
+// SIGTERM; several serve processes over the shards of one build are the
+// shard servers of a ShardCoordinator. query sends one top 10 query and
+// prints the score and docID of each hit. Addresses are Unix socket paths
+// (anything with a '/') or host:port.
+
+#include "loader.h"
+#include "server.h"
+#include "shard.h"
+#include <stdio.h>
+#include <csignal>
+#include <stdexcept>
+
+using namespace SE;
+
+int run_index(int argc, char** argv);
+int run_serve(int argc, char** argv);
+int run_query(int argc, char** argv);
+int usage();
+void on_signal(int);
+
+QueryServer<ShardServer>* running = nullptr;
+
+
+int main(int argc, char** argv) {
+	std::string command = argc > 1 ? argv[1] : "";
+	try {
+		if (command == "index" && argc >= 4) {
+			return run_index(argc, argv);
+		} else if (command == "serve" && argc >= 4) {
+			return run_serve(argc, argv);
+		} else if (command == "query" && argc >= 4) {
+			return run_query(argc, argv);
+		}
+	} catch (const char* e) {
+		fprintf(stderr, "se_server: %s\n", e);
+		return 1;
+	} catch (const std::logic_error &) {
+		// std::stoul on a count that is not a number
+		return usage();
+	} catch (const std::exception &e) {
+		fprintf(stderr, "se_server: %s\n", e.what());
+		return 1;
+	}
+	return usage();
+}
+
+// Helper Functions
+
+int run_index(int argc, char** argv) {
+	std::string directory = argv[3];
+	unsigned long shards = argc > 4 ? std::stoul(argv[4]) : 1;
+	std::filesystem::create_directories(directory);
+
+	LoaderSource source(argv[2]);
+	ShardedIndexBuilder builder(directory, shards);
+	IngestOptions options;
+	options.dedupe = true;
+	IngestPipeline pipeline(source, [&](Document &doc) {
+		builder.add(doc.url, doc.terms, doc.text);
+	}, options);
+	pipeline.run();
+	builder.finish();
+	pipeline.print_stats(stdout);
+	for (unsigned long s = 0; s < shards; s++) {
+		printf("%s\n", ShardedIndexBuilder::shard_directory(directory, s).c_str());
+	}
+	return 0;
+}
+
+int run_serve(int argc, char** argv) {
+	ShardServer shard(argv[2]);
+	ServerOptions options;
+	options.workers = argc > 4 ? std::stoul(argv[4]) : options.workers;
+	QueryServer<ShardServer> server(shard, options);
+	unsigned long port = server.listen(argv[3]);
+	running = &server;
+	std::signal(SIGINT, on_signal);
+	std::signal(SIGTERM, on_signal);
+
+	fprintf(stderr, "Serving shard %lu of %lu on %s", shard.shard(), shard.shards(), argv[3]);
+	if (port != 0) {
+		fprintf(stderr, " (port %lu)", port);
+	}
+	fprintf(stderr, " with %lu workers\n", options.workers);
+	server.serve();
+	running = nullptr;
+	server.print_stats(stderr);
+	return 0;
+}
+
+int run_query(int argc, char** argv) {
+	QueryClient client(argv[2]);
+	QueryRequest request;
+	request.terms.assign(argv + 3, argv + argc);
+	std::vector<ScoredDoc> hits;
+	if (!client.search(request, hits, std::chrono::steady_clock::now() + std::chrono::seconds(10))) {
+		fprintf(stderr, "se_server: no answer\n");
+		return 1;
+	}
+	for (const ScoredDoc &hit : hits) {
+		printf("%10.4f %10lu\n", hit.first, (unsigned long) hit.second);
+	}
+	return 0;
+}
+
+int usage() {
+	fprintf(stderr, "Usage: se_server index <crawl dir> <index dir> [shards]\n"
+			"       se_server serve <shard dir> <address> [workers]\n"
+			"       se_server query <address> <term>...\n");
+	return 2;
+}
+
+void on_signal(int) {
+	if (running) {
+		running->stop();
+	}
+}
@@ -0,0 +1,428 @@
+// server header file
+//
+// Long-running query server: the index is loaded once and queries arrive
+// in the binary protocol of protocol.h on any number of Unix and TCP
+// listeners, so nothing is reloaded per query.
+//
+// One thread runs an epoll loop that accepts connections and reads their
+// bytes into per-connection FrameBuffers. Complete requests go to the
+// connection's queue and the connection to a fixed pool of workers, which
+// score the requests and queue the replies on the connection. A connection
+// is held by one worker at a time, so a client that pipelines gets its
+// answers in request order while different clients are served in
+// parallel. A malformed request, or one the searcher throws on, closes its
+// connection.
+//
+// Sockets are non-blocking: a worker writes what a socket takes and the
+// event loop sends the rest when it becomes writable. A connection whose
+// queued requests and unsent replies pass MAX_QUEUED bytes is not read, or
+// given to a worker, until its client takes the replies, so a client that
+// sends without reading stalls only itself.
+//
+// Searcher is anything with
+//
+//   std::vector<ScoredDoc> search(const QueryRequest &request) const
+//
+// that may be called from several threads at once, such as ShardServer:
+// a one-shard directory is a whole index, and any shard of a larger build
+// can be served the same way for a ShardCoordinator.
+
+#ifndef SE_SERVER_H
+#define SE_SERVER_H
+
+#include "ingest.h"
+#include "net.h"
+#include "protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace SE {
+
+struct ServerOptions {
+	unsigned long workers = 4;
+	unsigned long queue_capacity = 1024;  // connections waiting for a worker
+};
+
+struct ServerStats {
+	unsigned long connections = 0;   // accepted
+	unsigned long requests = 0;      // answered
+	unsigned long bad_requests = 0;  // malformed or failed, connection closed
+};
+
+
+// Server
+
+template<class Searcher>
+class QueryServer {
+public:
+	QueryServer(const Searcher &searcher, ServerOptions options = ServerOptions()) :
+			searcher_(searcher), options_(options), epoll_fd_(-1), wake_fd_(-1), notify_fd_(-1) {
+		if (options_.workers == 0) {
+			throw "Query server needs at least one worker!";
+		}
+		epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+		wake_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		notify_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (epoll_fd_ < 0 || wake_fd_ < 0 || notify_fd_ < 0) {
+			close_all();
+			throw "Cannot create event loop!";
+		}
+		watch(wake_fd_, EPOLLIN);
+		watch(notify_fd_, EPOLLIN);
+	}
+
+	QueryServer(const QueryServer &) = delete;
+	QueryServer& operator=(const QueryServer &) = delete;
+
+	~QueryServer() {
+		close_all();
+	}
+
+	// Adds a listener (see net.h for addresses); returns the TCP port it
+	// bound, which tells callers the port picked for port 0, or 0 for Unix
+	unsigned long listen(const std::string &address) {
+		int fd = listen_address(address);
+		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+		listeners_.push_back(fd);
+		watch(fd, EPOLLIN);
+		return local_port(fd);
+	}
+
+	// Serves until stop(); every connection is closed on return
+	void serve() {
+		if (listeners_.empty()) {
+			throw "Query server is not listening!";
+		}
+		BoundedQueue<std::shared_ptr<Connection>> ready(options_.queue_capacity);
+		std::vector<std::thread> workers;
+		for (unsigned long i = 0; i < options_.workers; i++) {
+			workers.emplace_back(&QueryServer::work, this, std::ref(ready));
+		}
+
+		epoll_event events[64];
+		bool running = true, failed = false;
+		while (running) {
+			int n = ::epoll_wait(epoll_fd_, events, 64, -1);
+			if (n < 0 && errno != EINTR) {
+				running = false;
+				failed = true;
+			}
+			for (int i = 0; i < n; i++) {
+				int fd = events[i].data.fd;
+				uint64_t count;
+				if (fd == wake_fd_) {
+					running = ::read(wake_fd_, &count, sizeof(count)) < 0;
+				} else if (fd == notify_fd_) {
+					notified(ready);
+				} else if (std::find(listeners_.begin(), listeners_.end(), fd) != listeners_.end()) {
+					accept_all(fd);
+				} else {
+					serve_connection(fd, events[i].events, ready);
+				}
+			}
+		}
+
+		ready.close();
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+		connections_.clear();
+		if (failed) {
+			throw "Query server event loop failed!";
+		}
+	}
+
+	// Makes serve() return; safe from other threads and signal handlers
+	void stop() {
+		uint64_t one = 1;
+		ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+		(void) n;
+	}
+
+	ServerStats stats() const {
+		ServerStats stats;
+		stats.connections = connections_accepted_.load();
+		stats.requests = requests_.load();
+		stats.bad_requests = bad_requests_.load();
+		return stats;
+	}
+
+	void print_stats(FILE* out) const {
+		ServerStats s = stats();
+		fprintf(out, "connections %lu, requests %lu, bad requests %lu\n", s.connections, s.requests,
+				s.bad_requests);
+	}
+
+private:
+	// Queued request and unsent reply bytes past which a connection is not
+	// read or worked on
+	static constexpr unsigned long MAX_QUEUED = 1UL << 20;
+
+	struct Connection {
+		int fd;
+		FrameBuffer buffer;                 // event loop only
+		uint32_t events = EPOLLIN;          // event loop only: what epoll watches
+		std::mutex mutex;
+		std::deque<std::string> requests;   // guarded by mutex
+		unsigned long request_bytes = 0;    // guarded: payload bytes in requests
+		std::string out;                    // guarded: replies the socket has not taken
+		bool scheduled = false;             // guarded: queued for or held by a worker
+		bool paused = false;                // guarded: over MAX_QUEUED, not read
+
+		explicit Connection(int f) : fd(f) {}
+
+		~Connection() {
+			::close(fd);
+		}
+
+		// Drops what is queued either way once the connection is closing
+		void fail() {
+			::shutdown(fd, SHUT_RDWR);
+			requests.clear();
+			request_bytes = 0;
+			out.clear();
+		}
+	};
+
+	const Searcher &searcher_;
+	ServerOptions options_;
+	int epoll_fd_;
+	int wake_fd_;
+	int notify_fd_;                     // workers: a connection needs the event loop
+	std::vector<int> listeners_;
+	std::map<int, std::shared_ptr<Connection>> connections_;  // event loop only
+	std::mutex notify_mutex_;
+	std::vector<int> notify_;           // guarded by notify_mutex_
+
+	std::atomic<unsigned long> connections_accepted_{0};
+	std::atomic<unsigned long> requests_{0};
+	std::atomic<unsigned long> bad_requests_{0};
+
+
+	void watch(int fd, uint32_t events) {
+		epoll_event event;
+		event.events = events;
+		event.data.fd = fd;
+		if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+			throw "Cannot watch socket!";
+		}
+	}
+
+	void accept_all(int listener) {
+		while (true) {
+			int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+			if (fd < 0) {
+				return;
+			}
+			set_no_delay(fd);
+			connections_[fd] = std::make_shared<Connection>(fd);
+			connections_accepted_++;
+			watch(fd, EPOLLIN);
+		}
+	}
+
+	// Reads complete requests into the connection's queue and sends what
+	// it has of its replies; drops it at end of stream. A worker still
+	// holding it keeps the socket open until it lets go.
+	void serve_connection(int fd, uint32_t events, BoundedQueue<std::shared_ptr<Connection>> &ready) {
+		auto it = connections_.find(fd);
+		if (it == connections_.end()) {
+			return;
+		}
+		std::shared_ptr<Connection> connection = it->second;
+		bool open = true;
+		if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+			open = connection->buffer.fill(fd);
+			std::string payload;
+			std::lock_guard<std::mutex> lock(connection->mutex);
+			while (connection->buffer.next(payload)) {
+				connection->request_bytes += payload.size();
+				connection->requests.push_back(std::move(payload));
+			}
+		}
+		if (events & EPOLLOUT) {
+			std::lock_guard<std::mutex> lock(connection->mutex);
+			open = send_pending(fd, connection->out) && open;
+		}
+		if (!open) {
+			::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+			connections_.erase(it);
+			return;
+		}
+		update(connection, ready);
+	}
+
+	// Connections workers left with unsent replies or under MAX_QUEUED again
+	void notified(BoundedQueue<std::shared_ptr<Connection>> &ready) {
+		uint64_t count;
+		ssize_t n = ::read(notify_fd_, &count, sizeof(count));
+		(void) n;
+		std::vector<int> fds;
+		{
+			std::lock_guard<std::mutex> lock(notify_mutex_);
+			fds.swap(notify_);
+		}
+		for (int fd : fds) {
+			auto it = connections_.find(fd);
+			if (it != connections_.end()) {
+				update(it->second, ready);
+			}
+		}
+	}
+
+	// Watches for what the connection can do next and hands it to a worker
+	// if it has requests and room for their replies
+	void update(const std::shared_ptr<Connection> &connection, BoundedQueue<std::shared_ptr<Connection>> &ready) {
+		uint32_t events;
+		bool schedule = false;
+		{
+			std::lock_guard<std::mutex> lock(connection->mutex);
+			connection->paused = connection->request_bytes + connection->out.size() >= MAX_QUEUED;
+			events = (connection->paused ? 0 : EPOLLIN) | (connection->out.empty() ? 0 : EPOLLOUT);
+			if (!connection->scheduled && !connection->requests.empty() && connection->out.size() < MAX_QUEUED) {
+				connection->scheduled = schedule = true;
+			}
+		}
+		if (events != connection->events) {
+			epoll_event event;
+			event.events = events;
+			event.data.fd = connection->fd;
+			::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event);
+			connection->events = events;
+		}
+		if (schedule) {
+			ready.push(std::shared_ptr<Connection>(connection));
+		}
+	}
+
+	// Answers each scheduled connection's requests until its queue is empty
+	// or its unsent replies reach MAX_QUEUED
+	void work(BoundedQueue<std::shared_ptr<Connection>> &ready) {
+		std::shared_ptr<Connection> connection;
+		std::string payload;
+		QueryRequest request;
+		while (ready.pop(connection)) {
+			bool notify;
+			while (true) {
+				{
+					std::lock_guard<std::mutex> lock(connection->mutex);
+					if (connection->requests.empty() || connection->out.size() >= MAX_QUEUED) {
+						connection->scheduled = false;
+						notify = !connection->out.empty() || connection->paused || !connection->requests.empty();
+						break;
+					}
+					payload = std::move(connection->requests.front());
+					connection->requests.pop_front();
+					connection->request_bytes -= payload.size();
+				}
+
+				std::string reply;
+				bool answered = false;
+				try {
+					if (decode_request(payload, request)) {
+						reply = encode_hits(searcher_.search(request));
+						requests_++;
+						answered = true;
+					} else {
+						bad_requests_++;
+					}
+				} catch (...) {
+					// A request the searcher throws on closes its connection,
+					// not the worker
+					bad_requests_++;
+				}
+
+				// The event loop sees the end of stream of a failed one and
+				// drops it
+				std::lock_guard<std::mutex> lock(connection->mutex);
+				if (answered) {
+					append_frame(connection->out, reply);
+				}
+				if (!answered || !send_pending(connection->fd, connection->out)) {
+					connection->fail();
+				}
+			}
+			if (notify) {
+				{
+					std::lock_guard<std::mutex> lock(notify_mutex_);
+					notify_.push_back(connection->fd);
+				}
+				uint64_t one = 1;
+				ssize_t n = ::write(notify_fd_, &one, sizeof(one));
+				(void) n;
+			}
+			connection.reset();
+		}
+	}
+
+	void close_all() {
+		for (int fd : listeners_) {
+			::close(fd);
+		}
+		listeners_.clear();
+		if (epoll_fd_ >= 0) {
+			::close(epoll_fd_);
+		}
+		if (wake_fd_ >= 0) {
+			::close(wake_fd_);
+		}
+		if (notify_fd_ >= 0) {
+			::close(notify_fd_);
+		}
+	}
+};
+
+
+// Client
+
+class QueryClient {
+public:
+	// Connects to a Unix path or host:port
+	explicit QueryClient(const std::string &address) : fd_(connect_address(address)) {
+		if (fd_ < 0) {
+			throw "Cannot connect to query server!";
+		}
+	}
+
+	QueryClient(const QueryClient &) = delete;
+	QueryClient& operator=(const QueryClient &) = delete;
+
+	~QueryClient() {
+		::close(fd_);
+	}
+
+	// One query and its answer; false on a timeout or a broken connection
+	bool search(const QueryRequest &request, std::vector<ScoredDoc> &hits, Deadline deadline) {
+		return send(request) && receive(hits, deadline);
+	}
+
+	// Pipelining: answers come back in the order requests were sent
+	bool send(const QueryRequest &request) {
+		return send_frame(fd_, encode_request(request));
+	}
+
+	bool receive(std::vector<ScoredDoc> &hits, Deadline deadline) {
+		return recv_frame(fd_, buffer_, reply_, deadline) && decode_hits(reply_, hits);
+	}
+
+private:
+	int fd_;
+	FrameBuffer buffer_;
+	std::string reply_;
+};
+
+
+}
+#endif
@@ -0,0 +1,466 @@
+// shard header file
+//
+// Query serving split across processes. Documents are partitioned by docID
+// into shards, document d going to shard d % shards as its local document
+// d / shards. Each shard is an ordinary index directory plus its DocStore
+// and SnippetStore (docstore and snippets files), served by its own
+// process:
+//
+//   ShardedIndexBuilder   builds dir/shard-0 ... dir/shard-(n-1)
+//   ShardServer           loads one shard and answers queries on a Unix
+//                         domain socket, one poll loop over every client
+//   ShardCoordinator      scatters each query to every shard, gathers the
+//                         partial top k lists until the deadline, merges
+//
+// The coordinator never blocks on a shard: it connects, sends and receives
+// over non-blocking sockets in one poll loop bounded by the deadline, so a
+// shard whose backlog or socket buffer is full costs no more than a slow
+// one.
+// A shard that misses the deadline or has died is left out of that answer
+// and counted; the answer is marked partial. Its connection is dropped, so
+// a late reply can't be taken for the next query's, and reopened on the
+// next query. Scores use each shard's own collection statistics, as usual
+// for docID partitioning: with documents spread round robin they differ
+// little from the global ones. Shards speak the query protocol of
+// protocol.h, answering with global docIDs.
+
+#ifndef SE_SHARD_H
+#define SE_SHARD_H
+
+#include "coding.h"
+#include "docstore.h"
+#include "indexer.h"
+#include "net.h"
+#include "protocol.h"
+#include "scoring.h"
+#include "snippet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace SE {
+
+// Builder
+
+class ShardedIndexBuilder {
+public:
+	// options apply to each shard's IndexBuilder; directory must exist
+	ShardedIndexBuilder(const std::string &directory, unsigned long shards,
+			IndexBuilderOptions options = IndexBuilderOptions()) : directory_(directory), documents_(0) {
+		if (shards == 0) {
+			throw "Need at least one shard!";
+		}
+		for (unsigned long s = 0; s < shards; s++) {
+			std::string path = shard_directory(directory, s);
+			::mkdir(path.c_str(), 0755);
+			builders_.emplace_back(new IndexBuilder(path, options));
+			docs_.emplace_back();
+			snippets_.emplace_back();
+		}
+	}
+
+	// Adds the next document; returns its global docID. text is the
+	// markup-free text its snippets are cut from, empty for none; the
+	// snippet stores are held in memory until finish().
+	unsigned long add(const std::string &url, const std::vector<std::string> &terms,
+			const std::string &text = std::string(), uint64_t crawl_time = 0) {
+		unsigned long shard = documents_ % builders_.size();
+		builders_[shard]->add(terms);
+		snippets_[shard].add(text);
+
+		// Cosine norm of the (1 + ln tf) weighted term vector
+		counts_.clear();
+		for (const std::string &term : terms) {
+			counts_[term]++;
+		}
+		double norm = 0;
+		for (auto &count : counts_) {
+			double w = 1 + std::log((double) count.second);
+			norm += w * w;
+		}
+		docs_[shard].add(url, (uint32_t) terms.size(), norm > 0 ? (float) std::sqrt(norm) : 1.0f, crawl_time);
+		return documents_++;
+	}
+
+	unsigned long shards() const {
+		return builders_.size();
+	}
+
+	void finish() {
+		for (unsigned long s = 0; s < builders_.size(); s++) {
+			builders_[s]->finish();
+			std::string path = shard_directory(directory_, s);
+			std::ofstream out(path + "/docstore", std::ios::binary);
+			docs_[s].build().save(out);
+			if (!out) {
+				throw "Cannot write document store!";
+			}
+			std::ofstream snippets(path + "/snippets", std::ios::binary);
+			snippets_[s].build().save(snippets);
+			if (!snippets) {
+				throw "Cannot write snippet store!";
+			}
+			std::string meta;
+			write_varint(meta, s);
+			write_varint(meta, builders_.size());
+			std::ofstream shard(path + "/shard", std::ios::binary);
+			shard << meta;
+			if (!shard) {
+				throw "Cannot write shard file!";
+			}
+		}
+	}
+
+	static std::string shard_directory(const std::string &directory, unsigned long shard) {
+		return directory + "/shard-" + std::to_string(shard);
+	}
+
+private:
+	std::string directory_;
+	std::vector<std::unique_ptr<IndexBuilder>> builders_;
+	std::vector<DocStoreBuilder> docs_;
+	std::vector<SnippetStoreBuilder> snippets_;
+	std::map<std::string, uint32_t> counts_;
+	unsigned long documents_;
+};
+
+
+// Server
+
+class ShardServer {
+public:
+	// Loads a shard directory written by ShardedIndexBuilder
+	explicit ShardServer(const std::string &directory) : index_(directory), listen_fd_(-1) {
+		std::ifstream in(directory + "/docstore", std::ios::binary);
+		if (!in) {
+			throw "Cannot open document store!";
+		}
+		docs_.load(in);
+
+		// Shards built before snippets were stored have none
+		std::ifstream snippets(directory + "/snippets", std::ios::binary);
+		if (snippets) {
+			snippets_.load(snippets);
+		}
+
+		std::ifstream meta(directory + "/shard", std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(meta)), std::istreambuf_iterator<char>());
+		const char* p = bytes.data();
+		const char* end = p + bytes.size();
+		uint64_t shard, shards;
+		if (!read_varint_checked(p, end, shard) || !read_varint_checked(p, end, shards) || shards == 0
+				|| shard >= shards) {
+			throw "Cannot read shard file!";
+		}
+		shard_ = shard;
+		shards_ = shards;
+		scorer_.reset(new TermScorer<BM25<>>(index_, docs_));
+	}
+
+	ShardServer(const ShardServer &) = delete;
+	ShardServer& operator=(const ShardServer &) = delete;
+
+	~ShardServer() {
+		if (listen_fd_ >= 0) {
+			::close(listen_fd_);
+		}
+		for (Client &client : clients_) {
+			::close(client.fd);
+		}
+	}
+
+	unsigned long shard() const {
+		return shard_;
+	}
+
+	unsigned long shards() const {
+		return shards_;
+	}
+
+	// Top k of this shard with global docIDs
+	std::vector<ScoredDoc> search(const QueryRequest &request) const {
+		std::vector<ScoredDoc> hits = scorer_->search(request.terms, request.k);
+		for (ScoredDoc &hit : hits) {
+			hit.second = hit.second * shards_ + shard_;
+		}
+		return hits;
+	}
+
+	// Snippet of doc, a global docID on this shard, for the query terms
+	Snippet snippet(unsigned long doc, const std::vector<std::string> &terms,
+			SnippetOptions options = SnippetOptions()) const {
+		if (doc % shards_ != shard_) {
+			throw "Document is on another shard!";
+		}
+		return snippets_.snippet(doc / shards_, terms, options);
+	}
+
+	void listen(const std::string &socket_path) {
+		listen_fd_ = listen_unix(socket_path);
+	}
+
+	// Serves clients until the process is stopped; each readable client's
+	// complete requests are answered in arrival order. Replies queue on the
+	// client and go out as its socket takes them, so a client that stops
+	// reading stalls only itself: past MAX_QUEUED unsent bytes its requests
+	// wait in the socket until it reads again.
+	void serve() {
+		if (listen_fd_ < 0) {
+			throw "Shard server is not listening!";
+		}
+		std::vector<pollfd> fds;
+		std::string payload;
+		QueryRequest request;
+		while (true) {
+			fds.assign(1, { listen_fd_, POLLIN, 0 });
+			for (const Client &client : clients_) {
+				short events = client.out.size() < MAX_QUEUED ? POLLIN : 0;
+				fds.push_back({ client.fd, (short) (events | (client.out.empty() ? 0 : POLLOUT)), 0 });
+			}
+			if (::poll(fds.data(), fds.size(), -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw "Shard server poll failed!";
+			}
+
+			// Clients first: accepting appends to clients_
+			for (unsigned long i = fds.size() - 1; i > 0; i--) {
+				if (!fds[i].revents) {
+					continue;
+				}
+				Client &client = clients_[i - 1];
+				bool open = !(fds[i].revents & ~POLLOUT) || client.buffer.fill(client.fd);
+				bool capped = true;
+				while (open && capped) {
+					while (open && client.out.size() < MAX_QUEUED && client.buffer.next(payload)) {
+						open = decode_request(payload, request);
+						if (open) {
+							append_frame(client.out, encode_hits(search(request)));
+						}
+					}
+					// Requests held back by the cap are answered once the
+					// socket takes enough, not left for input that may not come
+					capped = client.out.size() >= MAX_QUEUED;
+					open = open && send_pending(client.fd, client.out);
+					capped = capped && client.out.size() < MAX_QUEUED;
+				}
+				if (!open) {
+					::close(client.fd);
+					clients_.erase(clients_.begin() + (i - 1));
+				}
+			}
+			if (fds[0].revents & POLLIN) {
+				int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+				if (fd >= 0) {
+					clients_.push_back({ fd, FrameBuffer(), std::string() });
+				}
+			}
+		}
+	}
+
+private:
+	// Unsent reply bytes past which a client's requests are not read
+	static constexpr unsigned long MAX_QUEUED = 1UL << 20;
+
+	struct Client {
+		int fd;
+		FrameBuffer buffer;
+		std::string out;  // replies not yet taken by the socket
+	};
+
+	InvertedIndex index_;
+	DocStore docs_;
+	SnippetStore snippets_;
+	std::unique_ptr<TermScorer<BM25<>>> scorer_;
+	unsigned long shard_;
+	unsigned long shards_;
+	int listen_fd_;
+	std::vector<Client> clients_;
+};
+
+
+// Coordinator
+
+struct CoordinatorOptions {
+	unsigned long shard_deadline_us = 50000;  // from connecting to the last reply taken
+};
+
+struct CoordinatorStats {
+	unsigned long queries = 0;
+	unsigned long partial = 0;        // answers missing at least one shard
+	unsigned long timeouts = 0;       // shards still connecting, sending or replying at the deadline
+	unsigned long failures = 0;       // shards unreachable, closed or garbled
+};
+
+struct SearchResult {
+	std::vector<ScoredDoc> hits;
+	unsigned long shards_answered = 0;
+	bool partial = false;
+};
+
+class ShardCoordinator {
+public:
+	ShardCoordinator(const std::vector<std::string> &socket_paths, CoordinatorOptions options = CoordinatorOptions()) :
+			options_(options) {
+		for (const std::string &path : socket_paths) {
+			shards_.push_back({ path, -1, false, FrameBuffer(), std::string() });
+		}
+	}
+
+	ShardCoordinator(const ShardCoordinator &) = delete;
+	ShardCoordinator& operator=(const ShardCoordinator &) = delete;
+
+	~ShardCoordinator() {
+		for (Shard &shard : shards_) {
+			disconnect(shard);
+		}
+	}
+
+	SearchResult search(const std::vector<std::string> &terms, unsigned long k) {
+		stats_.queries++;
+		Deadline deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(options_.shard_deadline_us);
+		QueryRequest request;
+		request.k = (uint32_t) std::min(k, (unsigned long) MAX_K);
+		request.terms = terms;
+		std::string payload = encode_request(request);
+
+		// Scatter: the query goes out now as far as each socket takes it,
+		// the rest in the gather loop
+		std::vector<unsigned long> pending;
+		for (unsigned long s = 0; s < shards_.size(); s++) {
+			Shard &shard = shards_[s];
+			if (shard.fd < 0) {
+				shard.fd = start_connect_unix(shard.path, shard.connecting);
+			}
+			if (shard.fd < 0) {
+				stats_.failures++;
+				continue;
+			}
+			shard.out.clear();
+			append_frame(shard.out, payload);
+			if (shard.connecting || send_pending(shard.fd, shard.out)) {
+				pending.push_back(s);
+			} else {
+				disconnect(shard);
+				stats_.failures++;
+			}
+		}
+
+		// Gather until every shard replied or the deadline passed
+		SearchResult result;
+		std::vector<ScoredDoc> hits;
+		std::vector<pollfd> fds;
+		std::string reply;
+		while (!pending.empty()) {
+			fds.clear();
+			for (unsigned long s : pending) {
+				const Shard &shard = shards_[s];
+				short events = shard.connecting ? POLLOUT : (short) (POLLIN | (shard.out.empty() ? 0 : POLLOUT));
+				fds.push_back({ shard.fd, events, 0 });
+			}
+			int ready = ::poll(fds.data(), fds.size(), poll_timeout(deadline));
+			if (ready < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ready <= 0) {
+				break;
+			}
+
+			std::vector<unsigned long> waiting;
+			for (unsigned long i = 0; i < pending.size(); i++) {
+				Shard &shard = shards_[pending[i]];
+				short revents = fds[i].revents;
+				bool open = true;
+				if (shard.connecting && revents) {
+					shard.connecting = false;
+					open = connect_error(shard.fd) == 0;
+					revents = open ? POLLOUT : revents;
+				}
+				if (open && (revents & POLLOUT)) {
+					open = send_pending(shard.fd, shard.out);
+				}
+				if (open && (revents & ~POLLOUT)) {
+					open = shard.buffer.fill(shard.fd);
+					if (open && shard.buffer.next(reply)) {
+						open = decode_hits(reply, hits);
+						if (open) {
+							result.hits.insert(result.hits.end(), hits.begin(), hits.end());
+							result.shards_answered++;
+							continue;
+						}
+					}
+				}
+				if (open) {
+					waiting.push_back(pending[i]);
+				} else {
+					disconnect(shard);
+					stats_.failures++;
+				}
+			}
+			pending.swap(waiting);
+		}
+		for (unsigned long s : pending) {
+			disconnect(shards_[s]);
+			stats_.timeouts++;
+		}
+
+		// Merge the partial top k lists
+		unsigned long keep = std::min(k, (unsigned long) result.hits.size());
+		std::partial_sort(result.hits.begin(), result.hits.begin() + keep, result.hits.end(), ranks_before);
+		result.hits.resize(keep);
+		result.partial = result.shards_answered < shards_.size();
+		stats_.partial += result.partial;
+		return result;
+	}
+
+	unsigned long shards() const {
+		return shards_.size();
+	}
+
+	const CoordinatorStats& stats() const {
+		return stats_;
+	}
+
+	void print_stats(FILE* out) const {
+		fprintf(out, "queries %lu, partial %lu, shard timeouts %lu, shard failures %lu\n", stats_.queries,
+				stats_.partial, stats_.timeouts, stats_.failures);
+	}
+
+private:
+	struct Shard {
+		std::string path;
+		int fd;             // non-blocking
+		bool connecting;    // until fd polls writable
+		FrameBuffer buffer;
+		std::string out;    // the query, until the socket has taken it
+	};
+
+	CoordinatorOptions options_;
+	CoordinatorStats stats_;
+	std::vector<Shard> shards_;
+
+
+	static void disconnect(Shard &shard) {
+		if (shard.fd >= 0) {
+			::close(shard.fd);
+			shard.fd = -1;
+		}
+		shard.connecting = false;
+		shard.buffer.clear();
+		shard.out.clear();
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,384 @@
+// snippet header file
+//
+// Query-dependent snippets for result pages. SnippetStoreBuilder runs at
+// index time over each document's markup-free text and stores beside it
+// everything snippet selection needs, so nothing is tokenized per query:
+//
+//   text         the first max_text bytes
+//   term hashes  one 32-bit hash per token, a fixed-width array
+//   starts       byte offset of each token, delta varints
+//   sentences    first token of each sentence, delta varints
+//
+// snippet(doc, terms) compares the hash array with the query terms' hashes
+// four tokens per SSE2 compare, then slides a window of at most max_bytes
+// over the matches and keeps the one with the most distinct query terms,
+// then the most matches. The window is widened back to the start of its
+// sentence when that fits, else centered, and cut at token boundaries.
+// Highlights come from a SIMD substring search for each query term over
+// the window's raw bytes, keeping whole-word, case-insensitive matches.
+
+#ifndef SE_SNIPPET_H
+#define SE_SNIPPET_H
+
+#include "coding.h"
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace SE {
+
+// Query terms considered per snippet; the rest are ignored
+const unsigned long MAX_SNIPPET_TERMS = 32;
+
+struct SnippetOptions {
+	unsigned long max_bytes = 200;
+};
+
+struct Snippet {
+	std::string text;
+	std::vector<std::pair<uint32_t, uint32_t>> highlights;  // (offset, length) in text, in order
+
+	// text with every highlight wrapped in open and close
+	std::string format(const std::string &open = "<b>", const std::string &close = "</b>") const {
+		std::string out;
+		unsigned long at = 0;
+		for (const std::pair<uint32_t, uint32_t> &h : highlights) {
+			out.append(text, at, h.first - at);
+			out += open;
+			out.append(text, h.first, h.second);
+			out += close;
+			at = h.first + h.second;
+		}
+		out.append(text, at, std::string::npos);
+		return out;
+	}
+};
+
+// Whether term occurs at text[at] as a whole word, ignoring case
+inline bool term_at(const char* text, unsigned long length, unsigned long at, const std::string &term) {
+	unsigned long end = at + term.size();
+	if (end > length || (at > 0 && is_term_char(text[at - 1])) || (end < length && is_term_char(text[end]))) {
+		return false;
+	}
+	for (unsigned long i = 0; i < term.size(); i++) {
+		if (to_lower(text[at + i]) != term[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Calls emit(offset) for every whole-word occurrence of term, a lowercase
+// term as tokenize emits it, in text. Candidates are positions whose first
+// and last bytes match, tested 16 at a time; OR-ing 0x20 lowercases
+// letters and leaves digits alone, and term_at weeds out the other bytes
+// it maps onto term characters.
+template<class Emit>
+void find_term(const char* text, unsigned long length, const std::string &term, Emit emit) {
+	unsigned long m = term.size();
+	if (m == 0 || m > length) {
+		return;
+	}
+	unsigned long i = 0;
+
+#ifdef __SSE2__
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i first = _mm_set1_epi8(term[0]);
+	const __m128i last = _mm_set1_epi8(term[m - 1]);
+	for (; i + m - 1 + 16 <= length; i += 16) {
+		__m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i*) (text + i)), case_bit);
+		__m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i*) (text + i + m - 1)), case_bit);
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+		while (mask) {
+			unsigned long at = i + __builtin_ctz(mask);
+			if (term_at(text, length, at, term)) {
+				emit(at);
+			}
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i + m <= length; i++) {
+		if (to_lower(text[i]) == term[0] && term_at(text, length, i, term)) {
+			emit(i);
+		}
+	}
+}
+
+class SnippetStoreBuilder;
+
+class SnippetStore {
+public:
+	unsigned long size() const {
+		return offsets_.size();
+	}
+
+	// The stored text, at most max_text bytes of the document's
+	std::string text(unsigned long doc) const {
+		check(doc);
+		const char* in = data_.data() + offsets_[doc];
+		unsigned long length = read_varint(in);
+		return std::string(in, length);
+	}
+
+	Snippet snippet(unsigned long doc, const std::vector<std::string> &terms,
+			SnippetOptions options = SnippetOptions()) const {
+		check(doc);
+		const char* in = data_.data() + offsets_[doc];
+		unsigned long length = read_varint(in);
+		const char* text = in;
+		in += length;
+		unsigned long tokens = read_varint(in);
+		const char* hashes = in;
+		in += 4 * tokens;
+		std::vector<uint32_t> starts(tokens);
+		uint32_t at = 0;
+		for (unsigned long t = 0; t < tokens; t++) {
+			at += read_varint(in);
+			starts[t] = at;
+		}
+		std::vector<uint32_t> sentences(read_varint(in));
+		at = 0;
+		for (uint32_t &sentence : sentences) {
+			at += read_varint(in);
+			sentence = at;
+		}
+
+		// Query terms normalized as at index time, without repeats
+		std::vector<std::string> query;
+		std::vector<uint32_t> query_hashes;
+		for (const std::string &term : terms) {
+			tokenize(term.data(), term.size(), [&](const char* t, unsigned long n) {
+				std::string normal(t, n);
+				if (query.size() < MAX_SNIPPET_TERMS && std::find(query.begin(), query.end(), normal) == query.end()) {
+					query.push_back(normal);
+					query_hashes.push_back(term_hash(t, n));
+				}
+			});
+		}
+
+		// (token, query term) for every token equal to a query term
+		std::vector<std::pair<uint32_t, uint32_t>> matches;
+		match_tokens(hashes, tokens, query_hashes, matches);
+		unsigned long kept = 0;
+		for (const std::pair<uint32_t, uint32_t> &match : matches) {
+			if (term_at(text, length, starts[match.first], query[match.second])) {
+				matches[kept++] = match;
+			}
+		}
+		matches.resize(kept);
+
+		// Best window: most distinct terms, then most matches, then earliest
+		auto match_end = [&](unsigned long i) {
+			return starts[matches[i].first] + query[matches[i].second].size();
+		};
+		unsigned long counts[MAX_SNIPPET_TERMS] = { 0 };
+		unsigned long distinct = 0, best_score = 0, best_first = 0, best_last = 0;
+		for (unsigned long i = 0, j = 0; j < matches.size(); j++) {
+			distinct += counts[matches[j].second]++ == 0;
+			while (i < j && match_end(j) - starts[matches[i].first] > options.max_bytes) {
+				distinct -= --counts[matches[i].second] == 0;
+				i++;
+			}
+			unsigned long score = (distinct << 32) + (j - i + 1);
+			if (score > best_score) {
+				best_score = score;
+				best_first = i;
+				best_last = j;
+			}
+		}
+
+		// Leading context back to the sentence start if it fits, else half
+		// the spare bytes; trailing context up to the budget
+		unsigned long begin = 0, end = 0;
+		if (!matches.empty()) {
+			uint32_t first_token = matches[best_first].first;
+			unsigned long first = starts[first_token];
+			end = match_end(best_last);
+			auto sentence = std::upper_bound(sentences.begin(), sentences.end(), first_token);
+			unsigned long sentence_start = sentence == sentences.begin() ? 0 : starts[*(sentence - 1)];
+			unsigned long spare = end - first < options.max_bytes ? options.max_bytes - (end - first) : 0;
+			unsigned long lead = end - sentence_start <= options.max_bytes ? first - sentence_start
+					: std::min(first - sentence_start, spare / 2);
+			begin = *std::lower_bound(starts.begin(), starts.begin() + first_token + 1, (uint32_t) (first - lead));
+		}
+		unsigned long limit = begin + options.max_bytes;
+		auto next = matches.empty() ? starts.begin() : std::upper_bound(starts.begin(), starts.end(), (uint32_t) end);
+		for (; next != starts.end() && *next < limit; ++next) {
+			unsigned long token_end = *next;
+			while (token_end < length && is_term_char(text[token_end])) {
+				token_end++;
+			}
+			if (token_end > limit) {
+				break;
+			}
+			end = token_end;
+		}
+		if (end > begin && end < length && end < limit && (text[end] == '.' || text[end] == '!' || text[end] == '?')) {
+			end++;
+		}
+
+		Snippet snippet;
+		snippet.text.assign(text + begin, end - begin);
+		for (const std::string &term : query) {
+			find_term(snippet.text.data(), snippet.text.size(), term, [&](unsigned long offset) {
+				snippet.highlights.push_back(std::make_pair((uint32_t) offset, (uint32_t) term.size()));
+			});
+		}
+		std::sort(snippet.highlights.begin(), snippet.highlights.end());
+		return snippet;
+	}
+
+	unsigned long memory_bytes() const {
+		return data_.size() + offsets_.size() * sizeof(uint64_t);
+	}
+
+	void save(std::ostream &out) const {
+		write_pod(out, (uint64_t) data_.size());
+		out.write(data_.data(), data_.size());
+		write_array(out, offsets_);
+	}
+
+	void load(std::istream &in) {
+		uint64_t bytes;
+		read_pod(in, bytes);
+		data_.resize(bytes);
+		if (!in.read(&data_[0], bytes)) {
+			throw "Unexpected end of stream!";
+		}
+		read_array(in, offsets_);
+	}
+
+private:
+	std::string data_;
+	std::vector<uint64_t> offsets_;  // each document's record in data_
+
+	friend class SnippetStoreBuilder;
+
+
+	void check(unsigned long doc) const {
+		if (doc >= offsets_.size()) {
+			throw "Document ID out of range!";
+		}
+	}
+
+	static void match_tokens(const char* hashes, unsigned long tokens, const std::vector<uint32_t> &query,
+			std::vector<std::pair<uint32_t, uint32_t>> &matches) {
+		unsigned long t = 0;
+
+#ifdef __SSE2__
+		for (; t + 4 <= tokens; t += 4) {
+			__m128i block = _mm_loadu_si128((const __m128i*) (hashes + 4 * t));
+			__m128i any = _mm_setzero_si128();
+			for (uint32_t hash : query) {
+				any = _mm_or_si128(any, _mm_cmpeq_epi32(block, _mm_set1_epi32(hash)));
+			}
+			unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(any));
+			while (mask) {
+				unsigned long token = t + __builtin_ctz(mask);
+				push_matches(hashes, token, query, matches);
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		for (; t < tokens; t++) {
+			push_matches(hashes, t, query, matches);
+		}
+	}
+
+	static void push_matches(const char* hashes, unsigned long token, const std::vector<uint32_t> &query,
+			std::vector<std::pair<uint32_t, uint32_t>> &matches) {
+		uint32_t hash;
+		std::memcpy(&hash, hashes + 4 * token, 4);
+		for (unsigned long q = 0; q < query.size(); q++) {
+			if (query[q] == hash) {
+				matches.push_back(std::make_pair((uint32_t) token, (uint32_t) q));
+			}
+		}
+	}
+};
+
+class SnippetStoreBuilder {
+public:
+	explicit SnippetStoreBuilder(unsigned long max_text = 1UL << 16) : max_text_(max_text) {}
+
+	// Returns the new document's ID; IDs are assigned in insertion order
+	unsigned long add(const std::string &text) {
+		unsigned long length = std::min(text.size(), max_text_);
+		store_.offsets_.push_back(store_.data_.size());
+		write_varint(store_.data_, length);
+		store_.data_.append(text, 0, length);
+
+		hashes_.clear();
+		starts_.clear();
+		sentences_.clear();
+		tokenize_offsets(text.data(), length, [&](const char* term, unsigned long n, unsigned long start) {
+			if (starts_.empty() || ends_sentence(text, starts_.back(), start)) {
+				sentences_.push_back(starts_.size());
+			}
+			hashes_.push_back(term_hash(term, n));
+			starts_.push_back(start);
+		});
+
+		write_varint(store_.data_, hashes_.size());
+		store_.data_.append((const char*) hashes_.data(), hashes_.size() * 4);
+		write_deltas(starts_);
+		write_varint(store_.data_, sentences_.size());
+		write_deltas(sentences_);
+		return store_.offsets_.size() - 1;
+	}
+
+	unsigned long size() const {
+		return store_.offsets_.size();
+	}
+
+	SnippetStore build() const {
+		return store_;
+	}
+
+private:
+	unsigned long max_text_;
+	SnippetStore store_;
+	std::vector<uint32_t> hashes_;
+	std::vector<uint32_t> starts_;
+	std::vector<uint32_t> sentences_;
+
+
+	// A '.', '!' or '?' followed by whitespace between the token at
+	// previous and the one at start
+	static bool ends_sentence(const std::string &text, unsigned long previous, unsigned long start) {
+		unsigned long i = previous;
+		while (i < start && is_term_char(text[i])) {
+			i++;
+		}
+		for (; i + 1 < start; i++) {
+			if ((text[i] == '.' || text[i] == '!' || text[i] == '?') && std::isspace((unsigned char) text[i + 1])) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void write_deltas(const std::vector<uint32_t> &vals) {
+		uint32_t previous = 0;
+		for (uint32_t val : vals) {
+			write_varint(store_.data_, val - previous);
+			previous = val;
+		}
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,295 @@
+// Dedupe Test File
+
+#include "dedupe.h"
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <set>
+
+using namespace SE;
+
+void test_signature();
+void test_signature_simd();
+void test_similarity_estimate();
+void test_identical();
+void test_near_duplicates();
+void test_distinct();
+void test_empty_and_short();
+void test_bad_options();
+
+std::vector<std::string> make_words(std::mt19937_64 &rng, unsigned long n);
+std::vector<std::string> edit(std::mt19937_64 &rng, std::vector<std::string> words, unsigned long changes);
+std::vector<uint32_t> sign(const MinHasher &hasher, const std::vector<std::string> &words);
+double jaccard(const std::vector<std::string> &a, const std::vector<std::string> &b, unsigned long shingle);
+
+
+int main() {
+#ifdef __AVX2__
+	printf("Running dedupe test cases (AVX2 kernels)\n");
+#else
+	printf("Running dedupe test cases (scalar kernels)\n");
+#endif
+
+	// Test Signatures
+	test_signature();
+	test_signature_simd();
+	test_similarity_estimate();
+
+	// Test Detection
+	test_identical();
+	test_near_duplicates();
+	test_distinct();
+	test_empty_and_short();
+	test_bad_options();
+
+	printf("All dedupe test cases passed!\n");
+	return 0;
+}
+
+// Testing Signatures
+
+void test_signature() {
+	printf("Testing MinHasher signature()\n");
+
+	MinHasher hasher;
+	assert(hasher.size() == 64);
+
+	std::mt19937_64 rng(1);
+	std::vector<std::string> words = make_words(rng, 100);
+	std::vector<uint32_t> a = sign(hasher, words);
+	assert(a.size() == 64);
+	assert(a == sign(hasher, words));
+
+	// Moving a block of text only changes the shingles across the cut
+	std::vector<std::string> rotated(words.begin() + 50, words.end());
+	rotated.insert(rotated.end(), words.begin(), words.begin() + 50);
+	assert(MinHasher::similarity(a.data(), sign(hasher, rotated).data(), 64) > 0.8);
+
+	std::set<uint32_t> distinct(a.begin(), a.end());
+	assert(distinct.size() > 60);
+
+	std::vector<uint32_t> empty = { 1, 2, 3 };
+	hasher.signature({}, empty);
+	assert(empty.empty());
+
+	printf("Passed!\n");
+}
+
+void test_signature_simd() {
+	printf("Testing signature() against the scalar hash\n");
+
+	DedupeOptions options;
+	options.bands = 5;
+	options.rows = 3;
+	MinHasher hasher(options);
+
+	// 15 seeds: one block of 8 plus a scalar tail when built with AVX2
+	std::mt19937_64 rng(2);
+	std::vector<uint32_t> shingles(37);
+	for (uint32_t &s : shingles) {
+		s = rng();
+	}
+	std::vector<uint32_t> out(hasher.size());
+	hasher.signature(shingles.data(), shingles.size(), out.data());
+	for (unsigned long s = 0; s < hasher.size(); s++) {
+		uint32_t min = 0xFFFFFFFFU;
+		for (uint32_t shingle : shingles) {
+			uint32_t h = MinHasher::mix(shingle ^ hasher.seeds()[s]);
+			min = h < min ? h : min;
+		}
+		assert(out[s] == min);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_similarity_estimate() {
+	printf("Testing signature similarity against Jaccard similarity\n");
+
+	DedupeOptions options;
+	options.bands = 32;
+	options.rows = 8;
+	MinHasher hasher(options);
+
+	std::mt19937_64 rng(3);
+	for (unsigned long changes : { 0, 2, 10, 30, 80 }) {
+		std::vector<std::string> a = make_words(rng, 300);
+		std::vector<std::string> b = edit(rng, a, changes);
+		double expected = jaccard(a, b, options.shingle);
+		double estimate = MinHasher::similarity(sign(hasher, a).data(), sign(hasher, b).data(), hasher.size());
+		// 256 hashes: standard error at most 1 / 32
+		assert(std::fabs(estimate - expected) < 0.1);
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Detection
+
+void test_identical() {
+	printf("Testing DuplicateDetector with identical documents\n");
+
+	MinHasher hasher;
+	DuplicateDetector detector;
+	std::mt19937_64 rng(4);
+	std::vector<std::string> words = make_words(rng, 200);
+
+	assert(detector.add("http://a/", sign(hasher, words)) == DuplicateDetector::NOT_DUPLICATE);
+	assert(detector.add("http://b/", sign(hasher, words)) == 0);
+	assert(detector.add("http://c/", sign(hasher, words)) == 0);
+	assert(detector.size() == 1);
+	assert(detector.url(0) == "http://a/");
+	assert(detector.duplicates().size() == 2);
+	assert(detector.duplicates()[0] == std::make_pair(std::string("http://b/"), 0UL));
+	assert(detector.duplicates()[1] == std::make_pair(std::string("http://c/"), 0UL));
+	assert(detector.stats().documents == 3);
+	assert(detector.stats().duplicates == 2);
+
+	try {
+		detector.url(1);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_near_duplicates() {
+	printf("Testing DuplicateDetector with near-duplicates\n");
+
+	MinHasher hasher;
+	DuplicateDetector detector;
+	std::mt19937_64 rng(5);
+
+	// 50 originals, each followed by copies with a few words changed
+	unsigned long found = 0, copies = 0;
+	for (unsigned long d = 0; d < 50; d++) {
+		std::vector<std::string> words = make_words(rng, 200 + rng() % 300);
+		unsigned long id = detector.size();
+		assert(detector.add("orig" + std::to_string(d), sign(hasher, words)) == DuplicateDetector::NOT_DUPLICATE);
+		for (unsigned long c = 0; c < 3; c++) {
+			unsigned long match = detector.add("copy" + std::to_string(d), sign(hasher, edit(rng, words, 1 + c)));
+			assert(match == id || match == DuplicateDetector::NOT_DUPLICATE);
+			found += match == id;
+			copies++;
+		}
+	}
+	// Small edits leave the Jaccard similarity around 0.9 to 0.98
+	assert(found >= copies * 95 / 100);
+	for (const auto &dup : detector.duplicates()) {
+		assert(dup.first.substr(4) == detector.url(dup.second).substr(4));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_distinct() {
+	printf("Testing DuplicateDetector with distinct documents\n");
+
+	MinHasher hasher;
+	DuplicateDetector detector;
+	std::mt19937_64 rng(6);
+
+	// Same vocabulary, different text, plus pairs sharing half their text
+	for (unsigned long d = 0; d < 500; d++) {
+		std::vector<std::string> words = make_words(rng, 100 + rng() % 200);
+		assert(detector.add(std::to_string(d), sign(hasher, words)) == DuplicateDetector::NOT_DUPLICATE);
+		if (d % 10 == 0) {
+			std::vector<std::string> half(words.begin(), words.begin() + words.size() / 2);
+			std::vector<std::string> rest = make_words(rng, words.size() / 2);
+			half.insert(half.end(), rest.begin(), rest.end());
+			assert(detector.add(std::to_string(d) + "h", sign(hasher, half)) == DuplicateDetector::NOT_DUPLICATE);
+		}
+	}
+	assert(detector.stats().duplicates == 0);
+	assert(detector.size() == 550);
+	assert(detector.memory_bytes() > 550 * 64 * 4);
+
+	printf("Passed!\n");
+}
+
+void test_empty_and_short() {
+	printf("Testing empty and short documents\n");
+
+	MinHasher hasher;
+	DuplicateDetector detector;
+
+	// Documents shorter than a shingle still match exact copies
+	assert(detector.add("a", sign(hasher, { "hello", "world" })) == DuplicateDetector::NOT_DUPLICATE);
+	assert(detector.add("b", sign(hasher, { "hello", "world" })) == 0);
+	assert(detector.add("c", sign(hasher, { "world", "hello" })) == DuplicateDetector::NOT_DUPLICATE);
+
+	// Empty documents are never duplicates
+	assert(detector.add("d", {}) == DuplicateDetector::NOT_DUPLICATE);
+	assert(detector.add("e", {}) == DuplicateDetector::NOT_DUPLICATE);
+	assert(detector.size() == 4);
+
+	try {
+		detector.add("f", { 1, 2, 3 });
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_bad_options() {
+	printf("Testing bad options\n");
+
+	DedupeOptions options;
+	options.rows = 0;
+	try {
+		MinHasher hasher(options);
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		DuplicateDetector detector(options);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Words w0 ... w4999, so shingles rarely repeat across documents
+std::vector<std::string> make_words(std::mt19937_64 &rng, unsigned long n) {
+	std::vector<std::string> words;
+	for (unsigned long i = 0; i < n; i++) {
+		words.push_back("w" + std::to_string(rng() % 5000));
+	}
+	return words;
+}
+
+// Replaces changes random words with words outside make_words' vocabulary
+std::vector<std::string> edit(std::mt19937_64 &rng, std::vector<std::string> words, unsigned long changes) {
+	for (unsigned long c = 0; c < changes; c++) {
+		words[rng() % words.size()] = "x" + std::to_string(rng());
+	}
+	return words;
+}
+
+std::vector<uint32_t> sign(const MinHasher &hasher, const std::vector<std::string> &words) {
+	std::vector<uint32_t> signature;
+	hasher.signature(words, signature);
+	return signature;
+}
+
+double jaccard(const std::vector<std::string> &a, const std::vector<std::string> &b, unsigned long shingle) {
+	auto shingles = [shingle](const std::vector<std::string> &words) {
+		std::set<std::vector<std::string>> out;
+		for (unsigned long i = 0; i + shingle <= words.size(); i++) {
+			out.insert(std::vector<std::string>(words.begin() + i, words.begin() + i + shingle));
+		}
+		return out;
+	};
+	std::set<std::vector<std::string>> x = shingles(a), y = shingles(b);
+	unsigned long common = 0;
+	for (const auto &s : x) {
+		common += y.count(s);
+	}
+	return (double) common / (x.size() + y.size() - common);
+}
@@ -0,0 +1,289 @@
+// Docstore Test File
+
+#include "docstore.h"
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <sstream>
+
+using namespace SE;
+
+void test_varint();
+void test_packed_array();
+void test_empty_store();
+void test_url_lookup();
+void test_find();
+void test_columns();
+void test_duplicate_url();
+void test_save_load();
+void test_memory();
+
+void build_corpus(DocStoreBuilder &builder, std::vector<std::string> &urls, unsigned long n);
+
+const unsigned long corpus_size = 20000;
+
+
+int main() {
+	printf("Running docstore test cases\n");
+
+	// Test Coding
+	test_varint();
+	test_packed_array();
+
+	// Test Store
+	test_empty_store();
+	test_url_lookup();
+	test_find();
+	test_columns();
+	test_duplicate_url();
+	test_save_load();
+	test_memory();
+
+	printf("All docstore test cases passed!\n");
+	return 0;
+}
+
+// Testing Coding
+
+void test_varint() {
+	printf("Testing write_varint()/read_varint()\n");
+
+	uint64_t vals[] = { 0, 1, 127, 128, 300, 16383, 16384, 1UL << 35, ~0ULL };
+	std::string buf;
+	for (uint64_t val : vals) {
+		write_varint(buf, val);
+	}
+	assert(buf.size() == 1 + 1 + 1 + 2 + 2 + 2 + 3 + 6 + 10);
+
+	const char* in = buf.data();
+	for (uint64_t val : vals) {
+		assert(read_varint(in) == val);
+	}
+	assert(in == buf.data() + buf.size());
+
+	// Checked reads stop at the end instead of running past it
+	in = buf.data();
+	uint64_t val;
+	for (uint64_t expected : vals) {
+		assert(read_varint_checked(in, buf.data() + buf.size(), val) && val == expected);
+	}
+	in = buf.data() + buf.size() - 10;
+	assert(!read_varint_checked(in, buf.data() + buf.size() - 1, val));
+	std::string endless(11, '\x80');
+	in = endless.data();
+	assert(!read_varint_checked(in, endless.data() + endless.size(), val));
+
+	printf("Passed!\n");
+}
+
+void test_packed_array() {
+	printf("Testing PackedArray get()\n");
+
+	std::mt19937_64 rng(1);
+	unsigned long widths[] = { 0, 1, 7, 13, 32, 63, 64 };
+	for (unsigned long width : widths) {
+		std::vector<uint64_t> vals(1000);
+		uint64_t base = rng();
+		for (uint64_t &val : vals) {
+			uint64_t noise = width == 64 ? rng() : width ? rng() & ((1ULL << width) - 1) : 0;
+			val = width == 64 ? noise : base / 2 + noise;
+		}
+
+		PackedArray packed(vals);
+		assert(packed.size() == vals.size());
+		for (unsigned long i = 0; i < vals.size(); i++) {
+			assert(packed.get(i) == vals[i]);
+		}
+	}
+
+	{
+		std::vector<uint64_t> constant(500, 42);
+		PackedArray packed(constant);
+		for (unsigned long i = 0; i < 500; i++) {
+			assert(packed.get(i) == 42);
+		}
+		// Constant blocks store no payload words beyond padding
+		assert(packed.memory_bytes() < 200);
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Store
+
+void test_empty_store() {
+	printf("Testing empty DocStore\n");
+
+	DocStore store = DocStoreBuilder().build();
+	assert(store.size() == 0);
+	assert(store.find("http://a") == DocStore::NOT_FOUND);
+	assert(store.average_length() == 0);
+
+	try {
+		store.url(0);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_url_lookup() {
+	printf("Testing DocStore url()\n");
+
+	DocStoreBuilder builder;
+	std::vector<std::string> urls;
+	build_corpus(builder, urls, corpus_size);
+	DocStore store = builder.build();
+
+	assert(store.size() == corpus_size);
+	for (unsigned long doc = 0; doc < corpus_size; doc++) {
+		assert(store.url(doc) == urls[doc]);
+	}
+
+	try {
+		store.url(corpus_size);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_find() {
+	printf("Testing DocStore find()\n");
+
+	DocStoreBuilder builder;
+	std::vector<std::string> urls;
+	build_corpus(builder, urls, corpus_size);
+	DocStore store = builder.build();
+
+	for (unsigned long doc = 0; doc < corpus_size; doc++) {
+		assert(store.find(urls[doc]) == doc);
+	}
+
+	// Before the first, after the last, between neighbours and prefixes
+	assert(store.find("") == DocStore::NOT_FOUND);
+	assert(store.find("aaa") == DocStore::NOT_FOUND);
+	assert(store.find("zzz") == DocStore::NOT_FOUND);
+	assert(store.find(urls[0] + "x") == DocStore::NOT_FOUND);
+	assert(store.find(urls[5].substr(0, urls[5].size() - 1)) == DocStore::NOT_FOUND);
+
+	printf("Passed!\n");
+}
+
+void test_columns() {
+	printf("Testing DocStore length()/norm()/crawl_time()\n");
+
+	DocStoreBuilder builder;
+	std::vector<std::string> urls;
+	build_corpus(builder, urls, corpus_size);
+	DocStore store = builder.build();
+
+	double total = 0;
+	for (unsigned long doc = 0; doc < corpus_size; doc++) {
+		assert(store.length(doc) == 100 + doc % 977);
+		assert(std::fabs(store.norm(doc) - (1.0f + doc * 0.01f)) <= (1.0f + doc * 0.01f) / 128);
+		assert(store.crawl_time(doc) == 1700000000UL + doc * 37);
+		total += store.length(doc);
+	}
+	assert(std::fabs(store.average_length() - total / corpus_size) < 1e-6);
+
+	printf("Passed!\n");
+}
+
+void test_duplicate_url() {
+	printf("Testing DocStoreBuilder duplicate URLs\n");
+
+	DocStoreBuilder builder;
+	assert(builder.add("http://a", 1, 1, 1) == 0);
+	assert(builder.add("http://b", 1, 1, 1) == 1);
+	assert(builder.add("http://a", 1, 1, 1) == 2);
+	assert(builder.size() == 3);
+
+	try {
+		builder.build();
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_save_load() {
+	printf("Testing DocStore save()/load()\n");
+
+	DocStoreBuilder builder;
+	std::vector<std::string> urls;
+	build_corpus(builder, urls, 1000);
+	DocStore store = builder.build();
+
+	std::stringstream stream;
+	store.save(stream);
+
+	DocStore loaded;
+	loaded.load(stream);
+	assert(loaded.size() == store.size());
+	assert(loaded.memory_bytes() == store.memory_bytes());
+	for (unsigned long doc = 0; doc < 1000; doc++) {
+		assert(loaded.url(doc) == urls[doc]);
+		assert(loaded.find(urls[doc]) == doc);
+		assert(loaded.length(doc) == store.length(doc));
+		assert(loaded.norm(doc) == store.norm(doc));
+		assert(loaded.crawl_time(doc) == store.crawl_time(doc));
+	}
+
+	std::stringstream truncated(stream.str().substr(0, 100));
+	try {
+		loaded.load(truncated);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_memory() {
+	printf("Testing DocStore memory_bytes()\n");
+
+	DocStoreBuilder builder;
+	std::vector<std::string> urls;
+	build_corpus(builder, urls, corpus_size);
+	DocStore store = builder.build();
+
+	// Per-document records of an owned string plus three fields
+	unsigned long naive = 0;
+	for (const std::string &url : urls) {
+		naive += sizeof(std::string) + url.capacity() + 1 + sizeof(uint32_t) + sizeof(float) + sizeof(uint64_t);
+	}
+
+	printf("  records: %lu bytes, columnar: %lu bytes (%.1fx)\n", naive, store.memory_bytes(),
+			(double) naive / store.memory_bytes());
+	assert(store.memory_bytes() * 2 < naive);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Hosts and paths with heavy shared prefixes, inserted in shuffled order
+void build_corpus(DocStoreBuilder &builder, std::vector<std::string> &urls, unsigned long n) {
+	std::vector<std::string> all;
+	for (unsigned long i = 0; i < n; i++) {
+		all.push_back("https://www.site" + std::to_string(i % 97) + ".example.com/articles/"
+				+ std::to_string(i / 97) + "/page-" + std::to_string(i) + ".html");
+	}
+	std::mt19937_64 rng(7);
+	std::shuffle(all.begin(), all.end(), rng);
+
+	urls.clear();
+	for (unsigned long doc = 0; doc < n; doc++) {
+		urls.push_back(all[doc]);
+		assert(builder.add(all[doc], 100 + doc % 977, 1.0f + doc * 0.01f, 1700000000UL + doc * 37) == doc);
+	}
+}
@@ -0,0 +1,402 @@
+// FST Test File
+
+#include "fst.h"
+#include <stdio.h>
+#include <cassert>
+#include <map>
+#include <random>
+
+using namespace SE;
+
+typedef std::map<std::string, uint64_t> Dictionary;
+
+void test_get();
+void test_empty();
+void test_empty_key();
+void test_outputs();
+void test_bad_order();
+void test_shared_suffixes();
+void test_each();
+void test_prefix();
+void test_wildcard();
+void test_fuzzy();
+void test_random_dictionary();
+
+Fst build(const Dictionary &dictionary);
+Dictionary make_dictionary(unsigned long size, unsigned long seed);
+bool matches(const std::string &pattern, const std::string &key);
+unsigned long edit_distance(const std::string &a, const std::string &b);
+
+
+int main() {
+	printf("Running FST test cases\n");
+
+	// Test Construction
+	test_get();
+	test_empty();
+	test_empty_key();
+	test_outputs();
+	test_bad_order();
+	test_shared_suffixes();
+
+	// Test Enumeration
+	test_each();
+	test_prefix();
+	test_wildcard();
+	test_fuzzy();
+	test_random_dictionary();
+
+	printf("All FST test cases passed!\n");
+	return 0;
+}
+
+// Testing Construction
+
+void test_get() {
+	printf("Testing get()\n");
+
+	Dictionary words = { { "cat", 0 }, { "cats", 1 }, { "dog", 2 }, { "dogs", 3 }, { "do", 4 } };
+	Fst fst = build(words);
+	assert(fst.size() == 5);
+	for (auto &word : words) {
+		uint64_t value = 99;
+		assert(fst.get(word.first, value));
+		assert(value == word.second);
+	}
+	uint64_t value;
+	assert(!fst.get("ca", value));
+	assert(!fst.get("catz", value));
+	assert(!fst.get("d", value));
+	assert(!fst.get("", value));
+	assert(!fst.get("zebra", value));
+
+	// Round trip through the bytes
+	Fst copy(fst.data());
+	assert(copy.get("dogs", value) && value == 3);
+
+	printf("Passed!\n");
+}
+
+void test_empty() {
+	printf("Testing an empty FST\n");
+
+	Fst fst;
+	uint64_t value;
+	assert(fst.size() == 0);
+	assert(!fst.get("", value));
+	assert(!fst.get("a", value));
+	unsigned long calls = 0;
+	fst.each([&](const std::string&, uint64_t) {
+		calls++;
+	});
+	assert(calls == 0);
+
+	try {
+		Fst bad(std::string("abc"));
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_empty_key() {
+	printf("Testing the empty key\n");
+
+	Fst fst = build({ { "", 7 }, { "a", 3 }, { "ab", 9 } });
+	uint64_t value;
+	assert(fst.get("", value) && value == 7);
+	assert(fst.get("a", value) && value == 3);
+	assert(fst.get("ab", value) && value == 9);
+
+	printf("Passed!\n");
+}
+
+void test_outputs() {
+	printf("Testing arbitrary outputs\n");
+
+	// Values need not follow key order
+	Dictionary words = { { "a", 1000000 }, { "ab", 5 }, { "abc", 0 }, { "abd", 1ULL << 60 }, { "b", 5 },
+			{ "\xff\xfe", 42 } };
+	Fst fst = build(words);
+	for (auto &word : words) {
+		uint64_t value;
+		assert(fst.get(word.first, value) && value == word.second);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_bad_order() {
+	printf("Testing keys out of order\n");
+
+	FstBuilder builder;
+	builder.add("b", 0);
+	try {
+		builder.add("a", 1);
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		builder.add("b", 1);
+		assert(false);
+	} catch (const char* e) {
+	}
+	builder.finish();
+	try {
+		builder.add("c", 1);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_shared_suffixes() {
+	printf("Testing shared suffixes\n");
+
+	// Every key ends in the same suffix: stored once, not 26 times
+	Dictionary words;
+	for (char c = 'a'; c <= 'z'; c++) {
+		words[std::string(1, c) + "-suffix-shared-by-all"] = 0;
+	}
+	FstBuilder builder;
+	for (auto &word : words) {
+		builder.add(word.first, word.second);
+	}
+	std::string bytes = builder.finish();
+	assert(bytes.size() < 26 * 4 + 22 * 4 + 16);
+
+	Fst fst(bytes);
+	uint64_t value;
+	assert(fst.get("q-suffix-shared-by-all", value) && value == 0);
+	assert(!fst.get("q-suffix-shared-by", value));
+
+	printf("Passed!\n");
+}
+
+// Testing Enumeration
+
+void test_each() {
+	printf("Testing each()\n");
+
+	Dictionary words = make_dictionary(500, 1);
+	Fst fst = build(words);
+	Dictionary seen;
+	std::string last;
+	fst.each([&](const std::string &key, uint64_t value) {
+		assert(seen.empty() || key > last);
+		seen[key] = value;
+		last = key;
+	});
+	assert(seen == words);
+
+	printf("Passed!\n");
+}
+
+void test_prefix() {
+	printf("Testing prefix()\n");
+
+	Dictionary words = { { "car", 0 }, { "card", 1 }, { "care", 2 }, { "cart", 3 }, { "cat", 4 }, { "dog", 5 } };
+	Fst fst = build(words);
+	std::vector<std::string> keys;
+	fst.prefix("car", [&](const std::string &key, uint64_t value) {
+		assert(words[key] == value);
+		keys.push_back(key);
+	});
+	assert(keys == std::vector<std::string>({ "car", "card", "care", "cart" }));
+	keys.clear();
+	fst.prefix("", [&](const std::string &key, uint64_t) {
+		keys.push_back(key);
+	});
+	assert(keys.size() == 6);
+	keys.clear();
+	fst.prefix("cab", [&](const std::string &key, uint64_t) {
+		keys.push_back(key);
+	});
+	fst.prefix("cards", [&](const std::string &key, uint64_t) {
+		keys.push_back(key);
+	});
+	assert(keys.empty());
+
+	printf("Passed!\n");
+}
+
+void test_wildcard() {
+	printf("Testing wildcard()\n");
+
+	Dictionary words = { { "car", 0 }, { "card", 1 }, { "care", 2 }, { "cart", 3 }, { "cat", 4 }, { "scar", 5 } };
+	Fst fst = build(words);
+	auto run = [&](const std::string &pattern) {
+		std::vector<std::string> keys;
+		fst.wildcard(pattern, [&](const std::string &key, uint64_t value) {
+			assert(words[key] == value);
+			keys.push_back(key);
+		});
+		return keys;
+	};
+	assert(run("ca?") == std::vector<std::string>({ "car", "cat" }));
+	assert(run("car*") == std::vector<std::string>({ "car", "card", "care", "cart" }));
+	assert(run("*car") == std::vector<std::string>({ "car", "scar" }));
+	assert(run("*a*") == std::vector<std::string>({ "car", "card", "care", "cart", "cat", "scar" }));
+	assert(run("c**t") == std::vector<std::string>({ "cart", "cat" }));
+	assert(run("ca?e") == std::vector<std::string>({ "care" }));
+	assert(run("???") == std::vector<std::string>({ "car", "cat" }));
+	assert(run("car") == std::vector<std::string>({ "car" }));
+	assert(run("x*").empty());
+
+	try {
+		run(std::string(64, '*'));
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_fuzzy() {
+	printf("Testing fuzzy()\n");
+
+	Dictionary words = { { "car", 0 }, { "card", 1 }, { "care", 2 }, { "cart", 3 }, { "cat", 4 }, { "scar", 5 },
+			{ "bar", 6 }, { "arc", 7 } };
+	Fst fst = build(words);
+	auto run = [&](const std::string &term, unsigned long edits) {
+		std::map<std::string, unsigned long> found;
+		fst.fuzzy(term, edits, [&](const std::string &key, uint64_t value, unsigned long distance) {
+			assert(words[key] == value);
+			found[key] = distance;
+		});
+		return found;
+	};
+	std::map<std::string, unsigned long> found = run("car", 0);
+	assert(found.size() == 1 && found["car"] == 0);
+	found = run("car", 1);
+	assert(found.size() == 7);
+	assert(found["card"] == 1 && found["scar"] == 1 && found["bar"] == 1 && !found.count("arc"));
+	found = run("car", 2);
+	assert(found.size() == 8 && found["arc"] == 2);
+	found = run("cra", 1);
+	assert(found.empty());
+	found = run("", 3);
+	assert(found.size() == 4 && found["cat"] == 3);
+
+	printf("Passed!\n");
+}
+
+void test_random_dictionary() {
+	printf("Testing a random dictionary against brute force\n");
+
+	Dictionary words = make_dictionary(3000, 2);
+	Fst fst = build(words);
+	std::mt19937_64 rng(3);
+
+	for (auto &word : words) {
+		uint64_t value;
+		assert(fst.get(word.first, value) && value == word.second);
+	}
+
+	for (unsigned long q = 0; q < 100; q++) {
+		auto it = words.begin();
+		std::advance(it, rng() % words.size());
+		std::string term = it->first;
+		// Mutate a byte so misses are tried too
+		if (q % 2 && !term.empty()) {
+			term[rng() % term.size()] = 'a' + rng() % 4;
+		}
+
+		std::string prefix = term.substr(0, rng() % 4);
+		Dictionary expected_prefix, got_prefix;
+		std::string pattern = term;
+		pattern[rng() % pattern.size()] = '?';
+		pattern.insert(rng() % pattern.size(), "*");
+		Dictionary expected_wildcard, got_wildcard;
+		unsigned long edits = q % 3;
+		std::map<std::string, unsigned long> expected_fuzzy, got_fuzzy;
+
+		for (auto &word : words) {
+			if (word.first.compare(0, prefix.size(), prefix) == 0) {
+				expected_prefix.insert(word);
+			}
+			if (matches(pattern, word.first)) {
+				expected_wildcard.insert(word);
+			}
+			unsigned long distance = edit_distance(term, word.first);
+			if (distance <= edits) {
+				expected_fuzzy[word.first] = distance;
+			}
+		}
+		fst.prefix(prefix, [&](const std::string &key, uint64_t value) {
+			got_prefix[key] = value;
+		});
+		fst.wildcard(pattern, [&](const std::string &key, uint64_t value) {
+			got_wildcard[key] = value;
+		});
+		fst.fuzzy(term, edits, [&](const std::string &key, uint64_t value, unsigned long distance) {
+			assert(words[key] == value);
+			got_fuzzy[key] = distance;
+		});
+		assert(got_prefix == expected_prefix);
+		assert(got_wildcard == expected_wildcard);
+		assert(got_fuzzy == expected_fuzzy);
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+Fst build(const Dictionary &dictionary) {
+	FstBuilder builder;
+	for (auto &entry : dictionary) {
+		builder.add(entry.first, entry.second);
+	}
+	assert(builder.size() == dictionary.size());
+	return Fst(builder.finish());
+}
+
+// Short words over a small alphabet, so keys share prefixes and suffixes
+Dictionary make_dictionary(unsigned long size, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	Dictionary dictionary;
+	while (dictionary.size() < size) {
+		std::string word;
+		unsigned long length = 1 + rng() % 8;
+		for (unsigned long i = 0; i < length; i++) {
+			word.push_back('a' + rng() % 6);
+		}
+		dictionary[word] = rng() % 100000;
+	}
+	return dictionary;
+}
+
+bool matches(const std::string &pattern, const std::string &key) {
+	if (pattern.empty()) {
+		return key.empty();
+	}
+	if (pattern[0] == '*') {
+		for (unsigned long skip = 0; skip <= key.size(); skip++) {
+			if (matches(pattern.substr(1), key.substr(skip))) {
+				return true;
+			}
+		}
+		return false;
+	}
+	return !key.empty() && (pattern[0] == '?' || pattern[0] == key[0]) && matches(pattern.substr(1), key.substr(1));
+}
+
+unsigned long edit_distance(const std::string &a, const std::string &b) {
+	std::vector<unsigned long> row(b.size() + 1);
+	for (unsigned long j = 0; j <= b.size(); j++) {
+		row[j] = j;
+	}
+	for (unsigned long i = 1; i <= a.size(); i++) {
+		unsigned long diagonal = row[0];
+		row[0] = i;
+		for (unsigned long j = 1; j <= b.size(); j++) {
+			unsigned long above = row[j];
+			row[j] = std::min(std::min(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] != b[j - 1]));
+			diagonal = above;
+		}
+	}
+	return row[b.size()];
+}
@@ -0,0 +1,505 @@
+// Indexer Test File
+
+#include "indexer.h"
+#include <stdio.h>
+#include <cassert>
+#include <filesystem>
+#include <map>
+#include <random>
+
+using namespace SE;
+
+typedef std::map<std::string, std::vector<std::pair<uint32_t, uint32_t>>> Expected;
+
+void test_run_round_trip();
+void test_run_positions();
+void test_single_run();
+void test_many_runs();
+void test_multi_pass_merge();
+void test_merge_budget();
+void test_empty_index();
+void test_bad_options();
+void test_add_after_finish();
+void test_positions();
+void test_positions_many_runs();
+void test_no_positions();
+
+std::vector<std::vector<std::string>> make_corpus(unsigned long docs, unsigned long vocabulary, unsigned long seed);
+Expected expected_postings(const std::vector<std::vector<std::string>> &corpus);
+void check_index(const std::string &directory, const Expected &expected);
+std::string fresh_directory(const std::string &name);
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_indexer";
+
+
+int main() {
+	printf("Running indexer test cases\n");
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	// Test Run Files
+	test_run_round_trip();
+	test_run_positions();
+
+	// Test Builder
+	test_single_run();
+	test_many_runs();
+	test_multi_pass_merge();
+	test_merge_budget();
+	test_empty_index();
+	test_bad_options();
+	test_add_after_finish();
+
+	// Test Positions
+	test_positions();
+	test_positions_many_runs();
+	test_no_positions();
+
+	std::filesystem::remove_all(root);
+	printf("All indexer test cases passed!\n");
+	return 0;
+}
+
+// Testing Run Files
+
+void test_run_round_trip() {
+	printf("Testing run file round trip\n");
+
+	std::string path = fresh_directory("run") + "/run";
+	std::vector<Posting> postings;
+	for (uint32_t term = 0; term < 50; term += 3) {
+		for (uint32_t doc = term; doc < 5000; doc += 7 + term) {
+			postings.push_back({ term, doc, doc % 5 + 1 });
+		}
+	}
+	postings.push_back({ 0xfffffff0U, 0xfffffff0U, 0xffffffffU });
+
+	{
+		FileWriter writer(path, 64);
+		Posting last = {};
+		for (unsigned long i = 0; i < postings.size(); i++) {
+			write_run_record(writer.buffer(), postings[i], last, i == 0);
+			writer.maybe_flush();
+		}
+		writer.close();
+	}
+
+	// A tiny window forces refills with records split across them
+	RunReader reader(path, 16);
+	for (const Posting &expected : postings) {
+		assert(reader.valid());
+		Posting p = reader.posting();
+		assert(p.term == expected.term && p.doc == expected.doc && p.tf == expected.tf);
+		reader.next();
+	}
+	assert(!reader.valid());
+
+	printf("Passed!\n");
+}
+
+void test_run_positions() {
+	printf("Testing run file positions\n");
+
+	std::string path = fresh_directory("run_positions") + "/run";
+	std::vector<Posting> postings;
+	std::vector<std::vector<uint32_t>> positions;
+	for (uint32_t doc = 0; doc < 300; doc++) {
+		std::vector<uint32_t> list;
+		for (uint32_t p = doc % 7; list.size() < doc % 40 + 1; p += doc % 3 + 1) {
+			list.push_back(p * 1000);
+		}
+		postings.push_back({ doc % 2, doc, (uint32_t) list.size() });
+		positions.push_back(list);
+	}
+	std::sort(postings.begin(), postings.end(), [](const Posting &a, const Posting &b) {
+		return a.term != b.term ? a.term < b.term : a.doc < b.doc;
+	});
+
+	{
+		FileWriter writer(path, 64);
+		Posting last = {};
+		for (unsigned long i = 0; i < postings.size(); i++) {
+			write_run_record(writer.buffer(), postings[i], last, i == 0, positions[postings[i].doc].data());
+			writer.maybe_flush();
+		}
+		writer.close();
+	}
+
+	// Position lists far longer than the window
+	RunReader reader(path, 16, true);
+	for (const Posting &expected : postings) {
+		assert(reader.valid());
+		assert(reader.posting().doc == expected.doc && reader.posting().tf == expected.tf);
+		const std::vector<uint32_t> &list = positions[expected.doc];
+		assert(std::equal(list.begin(), list.end(), reader.positions()));
+		reader.next();
+	}
+	assert(!reader.valid());
+
+	printf("Passed!\n");
+}
+
+// Testing Builder
+
+void test_single_run() {
+	printf("Testing a build that fits in memory\n");
+
+	std::vector<std::vector<std::string>> corpus = {
+		{ "the", "quick", "brown", "fox" },
+		{ "the", "lazy", "dog", "the", "end" },
+		{},
+		{ "fox", "fox", "fox" },
+	};
+	std::string dir = fresh_directory("single");
+	IndexBuilder builder(dir);
+	for (unsigned long i = 0; i < corpus.size(); i++) {
+		assert(builder.add(corpus[i]) == i);
+	}
+	builder.finish();
+
+	assert(builder.stats().documents == 4);
+	assert(builder.stats().runs == 1);
+	assert(builder.stats().merge_passes == 1);
+	assert(builder.stats().postings == 4 + 4 + 1);
+
+	InvertedIndex index(dir);
+	assert(index.term_count() == 7);
+	assert(index.df("the") == 2);
+	assert(index.df("fox") == 2);
+	assert(index.df("cat") == 0);
+
+	std::vector<std::pair<uint32_t, uint32_t>> list;
+	assert(index.postings("the", list) == 2);
+	assert(list[0] == std::make_pair(0U, 1U) && list[1] == std::make_pair(1U, 2U));
+	list.clear();
+	index.postings("fox", list);
+	assert(list[0] == std::make_pair(0U, 1U) && list[1] == std::make_pair(3U, 3U));
+	assert(index.postings("cat", list) == 0);
+
+	// Terms come back in byte order and the runs are gone
+	std::vector<std::string> terms = index.terms();
+	assert(terms.size() == 7 && std::is_sorted(terms.begin(), terms.end()));
+	std::vector<std::string> expanded;
+	index.dictionary().prefix("th", [&](const std::string &term, uint64_t rank) {
+		assert(terms[rank] == term);
+		expanded.push_back(term);
+	});
+	assert(expanded == std::vector<std::string>({ "the" }));
+	assert(!std::filesystem::exists(dir + "/run-0"));
+
+	printf("Passed!\n");
+}
+
+void test_many_runs() {
+	printf("Testing a build spilling many runs\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(3000, 2000, 1);
+	std::string dir = fresh_directory("many");
+	IndexBuilderOptions options;
+	options.memory_budget = 1 << 20;
+	options.read_buffer = 4096;
+	options.write_buffer = 4096;
+	IndexBuilder builder(dir, options);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	builder.finish();
+
+	assert(builder.stats().runs > 3);
+	assert(builder.stats().merge_passes == 1);
+	assert(builder.stats().peak_bytes <= options.memory_budget);
+	check_index(dir, expected_postings(corpus));
+	for (unsigned long r = 0; r < builder.stats().runs; r++) {
+		assert(!std::filesystem::exists(dir + "/run-" + std::to_string(r)));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_multi_pass_merge() {
+	printf("Testing intermediate merge passes\n");
+
+	// Budget for two read buffers: every pass merges pairs of runs
+	std::vector<std::vector<std::string>> corpus = make_corpus(2000, 500, 2);
+	std::string dir = fresh_directory("passes");
+	IndexBuilderOptions options;
+	options.memory_budget = 256 << 10;
+	options.read_buffer = 128 << 10;
+	options.write_buffer = 1024;
+	IndexBuilder builder(dir, options);
+	assert(builder.fan_in() == 2);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	builder.finish();
+
+	assert(builder.stats().runs > 4);
+	assert(builder.stats().merge_passes > 2);
+	check_index(dir, expected_postings(corpus));
+	assert(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) == 3);
+
+	printf("Passed!\n");
+}
+
+void test_merge_budget() {
+	printf("Testing merge memory against the budget\n");
+
+	// The vocabulary takes about half the budget, so the merge may only
+	// read through what is left
+	std::vector<std::vector<std::string>> corpus = make_corpus(12000, 20000, 4);
+	std::string dir = fresh_directory("merge_budget");
+	IndexBuilderOptions options;
+	options.positions = true;
+	options.memory_budget = 4 << 20;
+	options.read_buffer = 256 << 10;
+	options.write_buffer = 64 << 10;
+	IndexBuilder builder(dir, options);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	assert(builder.fan_in() < options.memory_budget / options.read_buffer / 2);
+	unsigned long fan = builder.fan_in();
+	builder.finish();
+
+	assert(builder.stats().runs > fan);
+	assert(builder.stats().merge_passes > 1);
+	assert(builder.stats().peak_bytes <= options.memory_budget);
+	check_index(dir, expected_postings(corpus));
+
+	printf("Passed!\n");
+}
+
+void test_empty_index() {
+	printf("Testing an empty index\n");
+
+	std::string dir = fresh_directory("empty");
+	IndexBuilder builder(dir);
+	builder.finish();
+
+	InvertedIndex index(dir);
+	assert(index.term_count() == 0);
+	assert(index.df("anything") == 0);
+
+	printf("Passed!\n");
+}
+
+void test_bad_options() {
+	printf("Testing bad options\n");
+
+	try {
+		IndexBuilder builder((root / "missing").string());
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	IndexBuilderOptions options;
+	options.memory_budget = 1000;
+	options.read_buffer = 1000;
+	try {
+		IndexBuilder builder(fresh_directory("bad"), options);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	// A vocabulary that leaves no room for postings
+	options.memory_budget = 256 << 10;
+	options.read_buffer = 4096;
+	IndexBuilder builder(fresh_directory("bad"), options);
+	std::vector<std::string> terms;
+	for (unsigned long i = 0; i < 5000; i++) {
+		terms.push_back("term" + std::to_string(i));
+	}
+	try {
+		builder.add(terms);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	try {
+		InvertedIndex index((root / "missing").string());
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_add_after_finish() {
+	printf("Testing add() after finish()\n");
+
+	IndexBuilder builder(fresh_directory("finished"));
+	builder.add({ "a" });
+	builder.finish();
+	try {
+		builder.add({ "b" });
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		builder.finish();
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Positions
+
+void test_positions() {
+	printf("Testing a build with positions\n");
+
+	std::string dir = fresh_directory("positions");
+	IndexBuilderOptions options;
+	options.positions = true;
+	IndexBuilder builder(dir, options);
+	builder.add({ "to", "be", "or", "not", "to", "be" });
+	builder.add({ "be", "quick" });
+	builder.add({ "quick" });
+	builder.finish();
+	assert(builder.stats().positions == 6 + 2 + 1);
+
+	InvertedIndex index(dir);
+	assert(index.has_positions());
+	TermPositions list;
+	std::vector<uint32_t> positions;
+	assert(index.positions("be", list));
+	assert(list.size() == 2);
+	assert(list.docs()[0] == 0 && list.docs()[1] == 1);
+	assert(list.tf(0) == 2 && list.tf(1) == 1);
+	list.positions(1, positions);
+	assert(positions == std::vector<uint32_t>({ 0 }));
+	// Going back rewinds
+	list.positions(0, positions);
+	assert(positions == std::vector<uint32_t>({ 1, 5 }));
+
+	assert(index.positions("quick", list));
+	list.positions(1, positions);
+	assert(positions == std::vector<uint32_t>({ 0 }));
+	assert(!index.positions("cat", list));
+	assert(list.size() == 0);
+
+	// Plain postings read the same as without positions
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	index.postings("to", pairs);
+	assert(pairs.size() == 1 && pairs[0] == std::make_pair(0U, 2U));
+
+	printf("Passed!\n");
+}
+
+void test_positions_many_runs() {
+	printf("Testing positions through spilled runs and merge passes\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(2000, 300, 3);
+	std::string dir = fresh_directory("positions_runs");
+	IndexBuilderOptions options;
+	options.positions = true;
+	options.memory_budget = 256 << 10;
+	options.read_buffer = 128 << 10;
+	options.write_buffer = 1024;
+	IndexBuilder builder(dir, options);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	builder.finish();
+	assert(builder.stats().runs > 4);
+	assert(builder.stats().merge_passes > 2);
+	assert(builder.stats().peak_bytes <= options.memory_budget);
+	check_index(dir, expected_postings(corpus));
+
+	// Every term's positions against the corpus
+	std::map<std::string, std::map<uint32_t, std::vector<uint32_t>>> expected;
+	for (uint32_t doc = 0; doc < corpus.size(); doc++) {
+		for (uint32_t p = 0; p < corpus[doc].size(); p++) {
+			expected[corpus[doc][p]][doc].push_back(p);
+		}
+	}
+	InvertedIndex index(dir);
+	TermPositions list;
+	std::vector<uint32_t> positions;
+	for (auto &term : expected) {
+		assert(index.positions(term.first, list));
+		assert(list.size() == term.second.size());
+		unsigned long i = 0;
+		for (auto &doc : term.second) {
+			assert(list.docs()[i] == doc.first);
+			// Every other list, so skipping is exercised too
+			if (i % 2 == 0) {
+				list.positions(i, positions);
+				assert(positions == doc.second);
+			}
+			i++;
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_no_positions() {
+	printf("Testing positions() on an index without them\n");
+
+	std::string dir = fresh_directory("no_positions");
+	IndexBuilder builder(dir);
+	builder.add({ "a" });
+	builder.finish();
+
+	InvertedIndex index(dir);
+	assert(!index.has_positions());
+	assert(!std::filesystem::exists(dir + "/positions"));
+	TermPositions list;
+	try {
+		index.positions("a", list);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Zipf-like term choice over a vocabulary of "t<n>" terms
+std::vector<std::vector<std::string>> make_corpus(unsigned long docs, unsigned long vocabulary, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	std::vector<std::vector<std::string>> corpus(docs);
+	for (std::vector<std::string> &doc : corpus) {
+		unsigned long length = rng() % 100;
+		for (unsigned long i = 0; i < length; i++) {
+			unsigned long term = (rng() % vocabulary) * (rng() % vocabulary) / vocabulary;
+			doc.push_back("t" + std::to_string(term));
+		}
+	}
+	return corpus;
+}
+
+Expected expected_postings(const std::vector<std::vector<std::string>> &corpus) {
+	Expected expected;
+	for (uint32_t doc = 0; doc < corpus.size(); doc++) {
+		std::map<std::string, uint32_t> counts;
+		for (const std::string &term : corpus[doc]) {
+			counts[term]++;
+		}
+		for (auto &count : counts) {
+			expected[count.first].push_back({ doc, count.second });
+		}
+	}
+	return expected;
+}
+
+void check_index(const std::string &directory, const Expected &expected) {
+	InvertedIndex index(directory);
+	assert(index.term_count() == expected.size());
+	for (auto &term : expected) {
+		std::vector<std::pair<uint32_t, uint32_t>> list;
+		assert(index.postings(term.first, list) == term.second.size());
+		assert(list == term.second);
+	}
+}
+
+std::string fresh_directory(const std::string &name) {
+	std::filesystem::path dir = root / name;
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	return dir.string();
+}
@@ -0,0 +1,463 @@
+// Ingest Test File
+
+#include "ingest.h"
+#include <stdio.h>
+#include <cassert>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace SE;
+
+void test_tokenize();
+void test_strip_markup();
+void test_queue_order();
+void test_queue_backpressure();
+void test_queue_close();
+void test_archive_source();
+void test_directory_source();
+void test_pipeline();
+void test_pipeline_backpressure();
+void test_pipeline_failure();
+void test_pipeline_dedupe();
+
+std::string make_page(unsigned long i);
+std::string make_article(unsigned long i, unsigned long edits);
+
+const unsigned long page_count = 500;
+
+
+int main() {
+	printf("Running ingest test cases\n");
+
+	// Test Parsing
+	test_tokenize();
+	test_strip_markup();
+
+	// Test Queue
+	test_queue_order();
+	test_queue_backpressure();
+	test_queue_close();
+
+	// Test Sources
+	test_archive_source();
+	test_directory_source();
+
+	// Test Pipeline
+	test_pipeline();
+	test_pipeline_backpressure();
+	test_pipeline_failure();
+	test_pipeline_dedupe();
+
+	printf("All ingest test cases passed!\n");
+	return 0;
+}
+
+// Testing Parsing
+
+void test_tokenize() {
+	printf("Testing tokenize()\n");
+
+	{
+		std::vector<std::string> terms;
+		tokenize("Hello, World! C++17 is 2x-faster", terms);
+
+		const char* expected[] = { "hello", "world", "c", "17", "is", "2x", "faster" };
+		assert(terms.size() == 7);
+		for (unsigned long i = 0; i < terms.size(); i++) {
+			assert(terms[i] == expected[i]);
+		}
+	}
+
+	{
+		std::vector<std::string> terms;
+		tokenize("", terms);
+		assert(terms.empty());
+		tokenize("  ...  ", terms);
+		assert(terms.empty());
+	}
+
+	{
+		std::vector<std::string> terms;
+		tokenize(std::string(200, 'A') + " b", terms);
+		assert(terms.size() == 2);
+		assert(terms[0] == std::string(MAX_TERM_LENGTH, 'a'));
+		assert(terms[1] == "b");
+	}
+
+	{
+		std::vector<unsigned long> starts;
+		tokenize_offsets(" Hi, x-RAY  ok", 14, [&](const char*, unsigned long, unsigned long start) {
+			starts.push_back(start);
+		});
+		assert(starts == std::vector<unsigned long>({ 1, 5, 7, 12 }));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_strip_markup() {
+	printf("Testing strip_markup()\n");
+
+	std::string html = "<html><head><title>Cats</title><style>p { color: red }</style>"
+			"<script>var dogs = 1;</script></head><body><p>Cats&amp;mice</p>"
+			"<!-- <p>hidden</p> --><b>bold</b>text</body></html>";
+	std::string text;
+	strip_markup(html.data(), html.size(), text);
+
+	std::vector<std::string> terms;
+	tokenize(text, terms);
+
+	const char* expected[] = { "cats", "cats", "mice", "bold", "text" };
+	assert(terms.size() == 5);
+	for (unsigned long i = 0; i < terms.size(); i++) {
+		assert(terms[i] == expected[i]);
+	}
+
+	strip_markup("a < b", 5, text);
+	assert(text.find('a') != std::string::npos);
+
+	printf("Passed!\n");
+}
+
+// Testing Queue
+
+void test_queue_order() {
+	printf("Testing BoundedQueue push()/pop()\n");
+
+	BoundedQueue<int> queue(8);
+	assert(queue.capacity() == 8);
+
+	for (int i = 0; i < 8; i++) {
+		assert(queue.push(int(i)));
+		assert(queue.depth() == (unsigned long) i + 1);
+	}
+
+	int val = -1;
+	for (int i = 0; i < 8; i++) {
+		assert(queue.pop(val));
+		assert(val == i);
+	}
+	assert(queue.depth() == 0);
+	assert(queue.max_depth() == 8);
+
+	printf("Passed!\n");
+}
+
+void test_queue_backpressure() {
+	printf("Testing BoundedQueue backpressure\n");
+
+	BoundedQueue<int> queue(2);
+	std::atomic<int> pushed{0};
+
+	std::thread producer([&] {
+		for (int i = 0; i < 10; i++) {
+			queue.push(int(i));
+			pushed++;
+		}
+		queue.close();
+	});
+
+	// The producer must stall once the queue holds capacity items
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	assert(pushed == 2);
+	assert(queue.depth() == 2);
+
+	int val = -1, expected = 0;
+	while (queue.pop(val)) {
+		assert(val == expected++);
+		assert(queue.max_depth() <= 2);
+	}
+	producer.join();
+	assert(expected == 10);
+
+	printf("Passed!\n");
+}
+
+void test_queue_close() {
+	printf("Testing BoundedQueue close()\n");
+
+	BoundedQueue<int> queue(4);
+	queue.push(1);
+	queue.close();
+
+	assert(!queue.push(2));
+
+	int val = 0;
+	assert(queue.pop(val) && val == 1);
+	assert(!queue.pop(val));
+
+	// Closing wakes a blocked consumer
+	BoundedQueue<int> empty(4);
+	std::thread consumer([&] {
+		int v;
+		assert(!empty.pop(v));
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	empty.close();
+	consumer.join();
+
+	printf("Passed!\n");
+}
+
+// Testing Sources
+
+void test_archive_source() {
+	printf("Testing ArchiveSource\n");
+
+	std::stringstream archive;
+	for (unsigned long i = 0; i < 20; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), make_page(i));
+	}
+	// A record without a target URI is skipped
+	archive << "WARC/1.0\r\nWARC-Type: warcinfo\r\nContent-Length: 3\r\n\r\nabc\r\n\r\n";
+
+	ArchiveSource source(archive);
+	Document doc;
+	for (unsigned long i = 0; i < 20; i++) {
+		assert(source.next(doc));
+		assert(doc.url == "http://example.com/" + std::to_string(i));
+		assert(doc.raw == make_page(i));
+	}
+	assert(!source.next(doc));
+
+	std::stringstream truncated;
+	truncated << "WARC/1.0\r\nWARC-Target-URI: x\r\nContent-Length: 100\r\n\r\nshort";
+	ArchiveSource bad(truncated);
+	try {
+		bad.next(doc);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_directory_source() {
+	printf("Testing DirectorySource\n");
+
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_ingest";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root / "a" / "b");
+	std::filesystem::create_directories(root / "empty");
+
+	std::map<std::string, std::string> pages;
+	for (unsigned long i = 0; i < 12; i++) {
+		std::filesystem::path dir = i % 3 == 0 ? root : i % 3 == 1 ? root / "a" : root / "a" / "b";
+		std::filesystem::path file = dir / ("page" + std::to_string(i) + ".html");
+		std::ofstream(file) << make_page(i);
+		pages["file://" + file.string()] = make_page(i);
+	}
+
+	DirectorySource source(root.string());
+	Document doc;
+	unsigned long seen = 0;
+	while (source.next(doc)) {
+		assert(pages.count(doc.url) == 1);
+		assert(pages[doc.url] == doc.raw);
+		seen++;
+	}
+	assert(seen == 12);
+
+	std::filesystem::remove_all(root);
+
+	printf("Passed!\n");
+}
+
+// Testing Pipeline
+
+void test_pipeline() {
+	printf("Testing IngestPipeline run()\n");
+
+	std::stringstream archive;
+	for (unsigned long i = 0; i < page_count; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), make_page(i));
+	}
+
+	ArchiveSource source(archive);
+	std::map<std::string, unsigned long> term_counts;
+	std::map<std::string, unsigned long> doc_terms;
+
+	IngestOptions options;
+	options.queue_capacity = 8;
+	options.parse_threads = 3;
+	options.tokenize_threads = 2;
+
+	IngestPipeline pipeline(source, [&](Document &doc) {
+		assert(doc.raw.empty());
+		doc_terms[doc.url] = doc.terms.size();
+		for (const std::string &term : doc.terms) {
+			term_counts[term]++;
+		}
+	}, options);
+	pipeline.run();
+
+	assert(doc_terms.size() == page_count);
+	for (unsigned long i = 0; i < page_count; i++) {
+		// "page", "number", i, "shared", "words", and i % 7 copies of "extra"
+		assert(doc_terms["http://example.com/" + std::to_string(i)] == 5 + i % 7);
+	}
+	assert(term_counts["page"] == page_count);
+	assert(term_counts["shared"] == page_count);
+	assert(term_counts.count("script") == 0);
+
+	for (int s = FETCH; s < STAGE_COUNT; s++) {
+		assert(pipeline.stats((Stage) s).documents == page_count);
+		if (s != FETCH) {
+			assert(pipeline.queue((Stage) s).max_depth() <= options.queue_capacity);
+			assert(pipeline.queue((Stage) s).depth() == 0);
+		}
+	}
+
+	pipeline.print_stats(stdout);
+
+	printf("Passed!\n");
+}
+
+void test_pipeline_backpressure() {
+	printf("Testing IngestPipeline backpressure\n");
+
+	std::stringstream archive;
+	for (unsigned long i = 0; i < 100; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), make_page(i));
+	}
+
+	ArchiveSource source(archive);
+	IngestOptions options;
+	options.queue_capacity = 2;
+
+	// A slow index stage must stall fetching rather than let documents pile up
+	std::atomic<unsigned long> max_in_flight{0};
+	IngestPipeline* handle = nullptr;
+	IngestPipeline pipeline(source, [&](Document &) {
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+		unsigned long in_flight = handle->stats(FETCH).documents - handle->stats(INDEX).documents;
+		if (in_flight > max_in_flight) {
+			max_in_flight = in_flight;
+		}
+	}, options);
+	handle = &pipeline;
+	pipeline.run();
+
+	assert(pipeline.stats(INDEX).documents == 100);
+	assert(pipeline.stats(FETCH).blocked_ns > 0);
+	// 3 queues of 2 plus one document held by each of the 4 stage threads
+	assert(max_in_flight <= 3 * options.queue_capacity + 4);
+
+	printf("Passed!\n");
+}
+
+void test_pipeline_failure() {
+	printf("Testing IngestPipeline failure\n");
+
+	std::stringstream archive;
+	for (unsigned long i = 0; i < 100; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), make_page(i));
+	}
+
+	ArchiveSource source(archive);
+	unsigned long indexed = 0;
+	IngestPipeline pipeline(source, [&](Document &) {
+		if (++indexed == 10) {
+			throw "Index full!";
+		}
+	});
+
+	try {
+		pipeline.run();
+		assert(false);
+	} catch (const char* msg) {
+		assert(std::string(msg) == "Index full!");
+	}
+	assert(indexed == 10);
+
+	try {
+		IngestOptions options;
+		options.parse_threads = 0;
+		IngestPipeline bad(source, [](Document &) {}, options);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_pipeline_dedupe() {
+	printf("Testing IngestPipeline dedupe\n");
+
+	// 100 articles; every third is mirrored as is and every fifth is
+	// republished with a couple of words changed
+	std::stringstream archive;
+	unsigned long copies = 0;
+	for (unsigned long i = 0; i < 100; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), make_article(i, 0));
+		if (i % 3 == 0) {
+			ArchiveSource::write_record(archive, "http://mirror.com/" + std::to_string(i), make_article(i, 0));
+			copies++;
+		}
+		if (i % 5 == 0) {
+			ArchiveSource::write_record(archive, "http://reprint.com/" + std::to_string(i), make_article(i, 2));
+			copies++;
+		}
+	}
+
+	ArchiveSource source(archive);
+	IngestOptions options;
+	options.dedupe = true;
+	options.tokenize_threads = 2;
+	std::map<std::string, unsigned long> indexed;
+	IngestPipeline pipeline(source, [&](Document &doc) {
+		assert(doc.signature.size() == 64);
+		indexed[doc.url.substr(doc.url.rfind('/') + 1)]++;
+	}, options);
+	pipeline.run();
+
+	// One copy of each article reaches the sink, whichever came first
+	assert(indexed.size() == 100);
+	for (const auto &article : indexed) {
+		assert(article.second == 1);
+	}
+	const DuplicateDetector &detector = pipeline.duplicates();
+	assert(detector.size() == 100);
+	assert(detector.duplicates().size() == copies);
+	for (const auto &dup : detector.duplicates()) {
+		const std::string &canonical = detector.url(dup.second);
+		assert(dup.first.substr(dup.first.rfind('/')) == canonical.substr(canonical.rfind('/')));
+	}
+	assert(detector.stats().documents == 100 + copies);
+	assert(pipeline.stats(INDEX).documents == 100 + copies);
+
+	pipeline.print_stats(stdout);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+std::string make_page(unsigned long i) {
+	std::string page = "<html><head><script>var script = 1;</script></head><body>"
+			"<h1>Page number " + std::to_string(i) + "</h1><p>shared words";
+	for (unsigned long j = 0; j < i % 7; j++) {
+		page += " extra";
+	}
+	return page + "</p></body></html>";
+}
+
+// 300 words of article i; each edit replaces one word
+std::string make_article(unsigned long i, unsigned long edits) {
+	std::mt19937_64 rng(i);
+	std::vector<std::string> words;
+	for (unsigned long j = 0; j < 300; j++) {
+		words.push_back("w" + std::to_string(rng() % 3000));
+	}
+	for (unsigned long e = 0; e < edits; e++) {
+		words[rng() % words.size()] = "edited";
+	}
+	std::string page = "<html><body><p>";
+	for (const std::string &word : words) {
+		page += word + " ";
+	}
+	return page + "</p></body></html>";
+}
@@ -0,0 +1,216 @@
+// Instrument Test File
+
+#ifndef SE_INSTRUMENT
+#define SE_INSTRUMENT
+#endif
+#include "instrument.h"
+#include "ingest.h"
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+#include <sstream>
+
+SE_DEFINE_COUNTER(test_events);
+SE_DEFINE_HISTOGRAM(test_latency_ns);
+SE_DEFINE_HISTOGRAM(test_sleep_ns);
+
+using namespace SE;
+
+void test_buckets();
+void test_counter();
+void test_counter_threads();
+void test_histogram();
+void test_timer();
+void test_dump_json();
+void test_dump_prometheus();
+void test_pipeline_metrics();
+
+
+int main() {
+	printf("Running instrument test cases\n");
+
+	test_buckets();
+	test_counter();
+	test_counter_threads();
+	test_histogram();
+	test_timer();
+	test_dump_json();
+	test_dump_prometheus();
+	test_pipeline_metrics();
+
+	printf("All instrument test cases passed!\n");
+	return 0;
+}
+
+void test_buckets() {
+	printf("Testing bucket_of()/bucket_value()\n");
+
+	for (uint64_t val = 0; val < 16; val++) {
+		assert(instrument::bucket_of(val) == val);
+		assert(instrument::bucket_value(val) == val);
+	}
+
+	unsigned long prev = 0;
+	for (uint64_t val = 1; val < (1ULL << 40); val = val * 3 / 2 + 1) {
+		unsigned long bucket = instrument::bucket_of(val);
+		assert(bucket >= prev);
+		assert(bucket < instrument::BUCKETS);
+		prev = bucket;
+
+		// Representative value within 1/16 of the sample
+		double err = std::fabs((double) instrument::bucket_value(bucket) - val) / val;
+		assert(err <= 1.0 / 16);
+	}
+	assert(instrument::bucket_of(~0ULL) == instrument::BUCKETS - 1);
+
+	printf("Passed!\n");
+}
+
+void test_counter() {
+	printf("Testing SE_COUNT()\n");
+
+	uint64_t before = instrument::snapshot().counter("test_events");
+	for (int i = 0; i < 100; i++) {
+		SE_COUNT(test_events, 2);
+	}
+	assert(instrument::snapshot().counter("test_events") == before + 200);
+	assert(instrument::snapshot().counter("no_such_counter") == 0);
+
+	printf("Passed!\n");
+}
+
+void test_counter_threads() {
+	printf("Testing SE_COUNT() across threads\n");
+
+	uint64_t before = instrument::snapshot().counter("test_events");
+
+	// Counts of exited threads must survive in the totals
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++) {
+		threads.emplace_back([] {
+			for (int i = 0; i < 10000; i++) {
+				SE_COUNT(test_events, 1);
+			}
+		});
+	}
+	for (std::thread &t : threads) {
+		t.join();
+	}
+	assert(instrument::snapshot().counter("test_events") == before + 80000);
+
+	// Live threads are read while still running
+	std::atomic<bool> counted{false}, done{false};
+	std::thread live([&] {
+		SE_COUNT(test_events, 5);
+		counted = true;
+		while (!done) {
+			std::this_thread::yield();
+		}
+	});
+	while (!counted) {
+		std::this_thread::yield();
+	}
+	assert(instrument::snapshot().counter("test_events") == before + 80005);
+	done = true;
+	live.join();
+
+	printf("Passed!\n");
+}
+
+void test_histogram() {
+	printf("Testing SE_RECORD()\n");
+
+	for (uint64_t val = 1; val <= 10000; val++) {
+		SE_RECORD(test_latency_ns, val);
+	}
+
+	const instrument::HistogramSummary* h = instrument::snapshot().histogram("test_latency_ns");
+	assert(h != nullptr);
+	assert(h->count == 10000);
+	assert(h->sum == 10000ULL * 10001 / 2);
+	assert(h->max == 10000);
+	assert(std::fabs(h->p50 - 5000.0) <= 5000.0 / 16);
+	assert(std::fabs(h->p90 - 9000.0) <= 9000.0 / 16);
+	assert(std::fabs(h->p99 - 9900.0) <= 9900.0 / 16);
+	assert(h->p999 <= h->max);
+
+	assert(instrument::snapshot().histogram("no_such_histogram") == nullptr);
+
+	printf("Passed!\n");
+}
+
+void test_timer() {
+	printf("Testing SE_TIME()\n");
+
+	for (int i = 0; i < 3; i++) {
+		SE_TIME(test_sleep_ns);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	const instrument::HistogramSummary* h = instrument::snapshot().histogram("test_sleep_ns");
+	assert(h->count == 3);
+	assert(h->p50 >= 1800000);
+	assert(h->sum >= 6000000);
+
+	printf("Passed!\n");
+}
+
+void test_dump_json() {
+	printf("Testing dump_json()\n");
+
+	std::stringstream out;
+	instrument::dump_json(out);
+	std::string json = out.str();
+
+	assert(json.front() == '{');
+	assert(json.find("\"counters\":{") != std::string::npos);
+	assert(json.find("\"test_events\":") != std::string::npos);
+	assert(json.find("\"test_latency_ns\":{\"count\":10000,") != std::string::npos);
+
+	int depth = 0;
+	for (char c : json) {
+		depth += c == '{' ? 1 : c == '}' ? -1 : 0;
+		assert(depth >= 0);
+	}
+	assert(depth == 0);
+
+	printf("Passed!\n");
+}
+
+void test_dump_prometheus() {
+	printf("Testing dump_prometheus()\n");
+
+	std::stringstream out;
+	instrument::dump_prometheus(out);
+	std::string text = out.str();
+
+	assert(text.find("# TYPE se_test_events counter\n") != std::string::npos);
+	assert(text.find("# TYPE se_test_latency_ns summary\n") != std::string::npos);
+	assert(text.find("se_test_latency_ns{quantile=\"0.99\"} ") != std::string::npos);
+	assert(text.find("se_test_latency_ns_count 10000\n") != std::string::npos);
+
+	printf("Passed!\n");
+}
+
+void test_pipeline_metrics() {
+	printf("Testing ingest metrics\n");
+
+	std::stringstream archive;
+	for (int i = 0; i < 50; i++) {
+		ArchiveSource::write_record(archive, "http://example.com/" + std::to_string(i), "<p>one two three</p>");
+	}
+
+	ArchiveSource source(archive);
+	IngestPipeline pipeline(source, [](Document &) {});
+	pipeline.run();
+
+	instrument::Snapshot snap = instrument::snapshot();
+	assert(snap.counter("documents_ingested") == 50);
+	assert(snap.counter("terms_tokenized") == 150);
+	assert(snap.histogram("ingest_parse_ns")->count == 50);
+	assert(snap.histogram("ingest_index_ns")->count == 50);
+	// One extra fetch call discovers the end of the archive
+	assert(snap.histogram("ingest_fetch_ns")->count == 51);
+
+	printf("Passed!\n");
+}
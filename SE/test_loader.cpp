@@ -0,0 +1,291 @@
+// Loader Test File
+
+#include "loader.h"
+#include <stdio.h>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace SE;
+
+void test_buffer_pool();
+void test_load_uring();
+void test_load_threads();
+void test_load_tokenize();
+void test_load_throwing_callback();
+void test_loader_source();
+
+void make_files(std::vector<std::string> &paths, std::vector<std::string> &contents);
+void check_load(FileLoader &loader, unsigned long buffer_size);
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_loader";
+const unsigned long small_buffer = 4096;
+
+
+int main() {
+	printf("Running loader test cases\n");
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	test_buffer_pool();
+	test_load_uring();
+	test_load_threads();
+	test_load_tokenize();
+	test_load_throwing_callback();
+	test_loader_source();
+
+	std::filesystem::remove_all(root);
+
+	printf("All loader test cases passed!\n");
+	return 0;
+}
+
+void test_buffer_pool() {
+	printf("Testing BufferPool\n");
+
+	{
+		BufferPool pool(4, 100);
+		assert(pool.count() == 4);
+		assert(pool.buffer_size() == 4096);
+
+		std::vector<unsigned long> taken;
+		for (int i = 0; i < 4; i++) {
+			taken.push_back(pool.acquire());
+			assert(((unsigned long) pool.buffer(taken.back())) % 4096 == 0);
+		}
+
+		// A fifth acquire blocks until a buffer comes back
+		std::atomic<bool> acquired{false};
+		std::thread waiter([&] {
+			pool.release(pool.acquire());
+			acquired = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		assert(!acquired);
+		pool.release(taken[0]);
+		waiter.join();
+		assert(acquired);
+	}
+
+	try {
+		BufferPool pool(0, 4096);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_load_uring() {
+	printf("Testing FileLoader io_uring load()\n");
+
+	LoaderOptions options;
+	options.buffer_size = small_buffer;
+	options.queue_depth = 8;
+	FileLoader loader(options);
+
+	if (!loader.using_io_uring()) {
+		printf("io_uring unavailable, skipping\n");
+	} else {
+		check_load(loader, small_buffer);
+		// Only a ring whose probe reports every opcode the loader submits
+		// is used
+		IoUring ring;
+		assert(ring.init(8));
+		assert(ring.supports(IORING_OP_OPENAT) && ring.supports(IORING_OP_CLOSE));
+		assert(ring.supports(IORING_OP_READ) || ring.supports(IORING_OP_READ_FIXED));
+		assert(!ring.supports(255));
+		// One io_uring_enter services many files
+		assert(loader.stats().syscalls < loader.stats().files);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_load_threads() {
+	printf("Testing FileLoader thread pool load()\n");
+
+	LoaderOptions options;
+	options.buffer_size = small_buffer;
+	options.queue_depth = 8;
+	options.threads = 3;
+	options.force_sync = true;
+	FileLoader loader(options);
+	assert(!loader.using_io_uring());
+
+	check_load(loader, small_buffer);
+
+	printf("Passed!\n");
+}
+
+void test_load_tokenize() {
+	printf("Testing FileLoader zero-copy tokenize\n");
+
+	std::vector<std::string> paths;
+	for (int i = 0; i < 50; i++) {
+		paths.push_back((root / ("doc" + std::to_string(i))).string());
+		std::ofstream(paths.back()) << "alpha beta " << i;
+	}
+
+	for (int sync = 0; sync < 2; sync++) {
+		LoaderOptions options;
+		options.force_sync = sync;
+		FileLoader loader(options);
+
+		unsigned long terms = 0, alphas = 0;
+		loader.load(paths, [&](const LoadedFile &file) {
+			assert(file.error == 0);
+			tokenize(file.data, file.length, [&](const char* term, unsigned long length) {
+				terms++;
+				alphas += std::string(term, length) == "alpha";
+			});
+		});
+		assert(terms == 150);
+		assert(alphas == 50);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_load_throwing_callback() {
+	printf("Testing FileLoader load() with a throwing callback\n");
+
+	std::vector<std::string> paths;
+	for (int i = 0; i < 40; i++) {
+		paths.push_back((root / ("throw" + std::to_string(i))).string());
+		std::ofstream(paths.back()) << "gamma " << i;
+	}
+
+	for (int sync = 0; sync < 2; sync++) {
+		LoaderOptions options;
+		options.queue_depth = 4;
+		options.threads = 3;
+		options.force_sync = sync;
+		FileLoader loader(options);
+
+		// The exception reaches the caller with every worker joined
+		unsigned long calls = 0;
+		try {
+			loader.load(paths, [&](const LoadedFile &file) {
+				if (++calls == 5) {
+					throw "callback failed";
+				}
+			});
+			assert(false);
+		} catch (const char* e) {
+		}
+		assert(calls == 5);
+
+		// No buffer or ring entry is left behind for the next load
+		for (int round = 0; round < 3; round++) {
+			unsigned long loaded = 0;
+			loader.load(paths, [&](const LoadedFile &file) {
+				assert(file.error == 0);
+				loaded++;
+			});
+			assert(loaded == paths.size());
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_loader_source() {
+	printf("Testing LoaderSource\n");
+
+	std::filesystem::path tree = root / "tree";
+	std::filesystem::create_directories(tree / "a" / "b");
+	std::filesystem::create_directories(tree / "empty");
+	std::map<std::string, std::string> pages;
+	for (unsigned long i = 0; i < 30; i++) {
+		std::filesystem::path dir = i % 3 == 0 ? tree : i % 3 == 1 ? tree / "a" : tree / "a" / "b";
+		std::filesystem::path file = dir / ("page" + std::to_string(i) + ".html");
+		std::string page = "<p>page " + std::to_string(i) + "</p>" + std::string(i * 300, 'x');
+		std::ofstream(file) << page;
+		pages["file://" + file.string()] = page;
+	}
+
+	for (int sync = 0; sync < 2; sync++) {
+		// Small buffers and batches, so pages overflow and span several batches
+		LoaderOptions options;
+		options.buffer_size = small_buffer;
+		options.queue_depth = 2;
+		options.force_sync = sync;
+
+		// Same documents in the same order as DirectorySource
+		LoaderSource source(tree.string(), options);
+		DirectorySource expected(tree.string());
+		Document doc, want;
+		unsigned long seen = 0;
+		while (source.next(doc)) {
+			assert(expected.next(want));
+			assert(doc.url == want.url);
+			assert(doc.raw == want.raw);
+			assert(pages[doc.url] == doc.raw);
+			seen++;
+		}
+		assert(!expected.next(want));
+		assert(seen == 30);
+		assert(source.loader().stats().files == 30);
+		assert(source.loader().stats().overflows > 0);
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Empty, small, exactly one buffer, multi-buffer, and missing files
+void make_files(std::vector<std::string> &paths, std::vector<std::string> &contents) {
+	unsigned long sizes[] = { 0, 1, 100, small_buffer - 1, small_buffer, small_buffer + 1, 5 * small_buffer + 7 };
+
+	for (int copy = 0; copy < 10; copy++) {
+		for (unsigned long size : sizes) {
+			std::string content;
+			for (unsigned long i = 0; i < size; i++) {
+				content.push_back('a' + (i * 7 + size + copy) % 26);
+			}
+			std::string path = (root / ("f" + std::to_string(copy) + "_" + std::to_string(size))).string();
+			std::ofstream(path, std::ios::binary) << content;
+			paths.push_back(path);
+			contents.push_back(content);
+		}
+		paths.push_back((root / ("missing" + std::to_string(copy))).string());
+		contents.push_back("");
+	}
+}
+
+void check_load(FileLoader &loader, unsigned long buffer_size) {
+	std::vector<std::string> paths, contents;
+	make_files(paths, contents);
+
+	std::vector<int> seen(paths.size(), 0);
+	loader.load(paths, [&](const LoadedFile &file) {
+		assert(file.index < paths.size());
+		seen[file.index]++;
+
+		if (paths[file.index].find("missing") != std::string::npos) {
+			assert(file.error == ENOENT);
+		} else {
+			assert(file.error == 0);
+			assert(std::string(file.data, file.length) == contents[file.index]);
+		}
+	});
+
+	for (unsigned long i = 0; i < seen.size(); i++) {
+		assert(seen[i] == 1);
+	}
+	assert(loader.stats().files == paths.size());
+	assert(loader.stats().errors == 10);
+	assert(loader.stats().overflows >= 20);
+
+	// The loader is reusable
+	unsigned long calls = 0;
+	loader.load(paths, [&](const LoadedFile &) { calls++; });
+	assert(calls == paths.size());
+
+	loader.load(std::vector<std::string>(), [&](const LoadedFile &) { assert(false); });
+}
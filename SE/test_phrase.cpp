@@ -0,0 +1,329 @@
+// Phrase Test File
+
+#include "phrase.h"
+#include "bitvector.h"
+#include "roaring.h"
+#include <stdio.h>
+#include <cassert>
+#include <filesystem>
+#include <random>
+
+using namespace SE;
+
+void test_gallop();
+void test_phrase();
+void test_repeated_terms();
+void test_missing_terms();
+void test_near();
+void test_against_scan();
+void test_filtered();
+void test_requires_positions();
+
+std::string build_index(const std::string &name, const std::vector<std::vector<std::string>> &corpus,
+		bool positions = true);
+bool scan_phrase(const std::vector<std::string> &doc, const std::vector<std::string> &phrase);
+bool scan_near(const std::vector<std::string> &doc, const std::vector<std::string> &terms, unsigned long window);
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_phrase";
+
+const std::vector<std::vector<std::string>> quotes = {
+	{ "to", "be", "or", "not", "to", "be" },
+	{ "not", "to", "be", "confused" },
+	{ "be", "to", "or", "be", "not" },
+	{ "the", "quick", "brown", "fox" },
+	{ "quick", "the", "fox", "brown" },
+};
+
+
+int main() {
+	printf("Running phrase test cases\n");
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	// Test Intersection
+	test_gallop();
+
+	// Test Queries
+	test_phrase();
+	test_repeated_terms();
+	test_missing_terms();
+	test_near();
+	test_against_scan();
+	test_filtered();
+	test_requires_positions();
+
+	std::filesystem::remove_all(root);
+	printf("All phrase test cases passed!\n");
+	return 0;
+}
+
+// Testing Intersection
+
+void test_gallop() {
+	printf("Testing gallop()\n");
+
+	std::vector<uint32_t> docs;
+	for (uint32_t i = 0; i < 1000; i++) {
+		docs.push_back(3 * i);
+	}
+	for (unsigned long from = 0; from < 1000; from += 37) {
+		for (uint32_t target = 0; target < 3100; target += 7) {
+			unsigned long expected = std::max(from, (unsigned long) ((target + 2) / 3));
+			assert(gallop(docs, from, target) == std::min(expected, 1000UL));
+		}
+	}
+	assert(gallop(docs, 1000, 0) == 1000);
+	assert(gallop(std::vector<uint32_t>(), 0, 5) == 0);
+
+	printf("Passed!\n");
+}
+
+// Testing Queries
+
+void test_phrase() {
+	printf("Testing phrase()\n");
+
+	InvertedIndex index(build_index("phrase", quotes));
+	PhraseMatcher phrases(index);
+
+	std::vector<uint32_t> docs;
+	assert(phrases.phrase({ "to", "be" }, docs) == 2);
+	assert(docs == std::vector<uint32_t>({ 0, 1 }));
+	docs.clear();
+	assert(phrases.phrase({ "not", "to", "be" }, docs) == 2);
+	docs.clear();
+	assert(phrases.phrase({ "or", "not", "to" }, docs) == 1 && docs[0] == 0);
+	docs.clear();
+	assert(phrases.phrase({ "quick", "brown" }, docs) == 1 && docs[0] == 3);
+	docs.clear();
+	assert(phrases.phrase({ "brown", "quick" }, docs) == 0);
+	// One term is every document holding it
+	assert(phrases.phrase({ "fox" }, docs) == 2);
+	docs.clear();
+	assert(phrases.phrase({}, docs) == 0);
+
+	printf("Passed!\n");
+}
+
+void test_repeated_terms() {
+	printf("Testing phrases repeating a term\n");
+
+	std::vector<std::vector<std::string>> corpus = {
+		{ "la", "la", "land" },
+		{ "la", "land", "la" },
+		{ "la", "la", "la" },
+	};
+	InvertedIndex index(build_index("repeated", corpus));
+	PhraseMatcher phrases(index);
+
+	std::vector<uint32_t> docs;
+	assert(phrases.phrase({ "la", "la" }, docs) == 2);
+	assert(docs == std::vector<uint32_t>({ 0, 2 }));
+	docs.clear();
+	assert(phrases.phrase({ "la", "la", "la" }, docs) == 1 && docs[0] == 2);
+	docs.clear();
+	assert(phrases.phrase({ "la", "land", "la" }, docs) == 1 && docs[0] == 1);
+
+	printf("Passed!\n");
+}
+
+void test_missing_terms() {
+	printf("Testing queries with absent terms\n");
+
+	InvertedIndex index(build_index("missing", quotes));
+	PhraseMatcher phrases(index);
+
+	std::vector<uint32_t> docs;
+	assert(phrases.phrase({ "to", "zebra" }, docs) == 0);
+	assert(phrases.phrase({ "zebra" }, docs) == 0);
+	assert(phrases.near({ "to", "zebra" }, 10, docs) == 0);
+	assert(docs.empty());
+
+	printf("Passed!\n");
+}
+
+void test_near() {
+	printf("Testing near()\n");
+
+	InvertedIndex index(build_index("near", quotes));
+	PhraseMatcher phrases(index);
+
+	std::vector<uint32_t> docs;
+	// Adjacent in either order
+	assert(phrases.near({ "fox", "brown" }, 2, docs) == 2);
+	docs.clear();
+	assert(phrases.near({ "quick", "fox" }, 2, docs) == 0);
+	assert(phrases.near({ "quick", "fox" }, 3, docs) == 2);
+	docs.clear();
+	assert(phrases.near({ "the", "quick", "fox" }, 3, docs) == 1 && docs[0] == 4);
+	docs.clear();
+	assert(phrases.near({ "the", "quick", "fox" }, 4, docs) == 2);
+	docs.clear();
+	// Duplicates collapse; windows smaller than the terms never match
+	assert(phrases.near({ "or", "or", "not" }, 2, docs) == 1 && docs[0] == 0);
+	docs.clear();
+	assert(phrases.near({ "or", "not" }, 1, docs) == 0);
+
+	printf("Passed!\n");
+}
+
+void test_against_scan() {
+	printf("Testing queries against a scan of the corpus\n");
+
+	// Small vocabulary, so phrases of several terms still occur
+	std::mt19937_64 rng(5);
+	std::vector<std::vector<std::string>> corpus(1500);
+	for (std::vector<std::string> &doc : corpus) {
+		unsigned long length = rng() % 60;
+		for (unsigned long i = 0; i < length; i++) {
+			doc.push_back("w" + std::to_string(rng() % 12 * (rng() % 12) / 6));
+		}
+	}
+	InvertedIndex index(build_index("scan", corpus));
+	PhraseMatcher phrases(index);
+
+	for (unsigned long q = 0; q < 300; q++) {
+		std::vector<std::string> terms;
+		for (unsigned long i = 0; i < q % 4 + 1; i++) {
+			terms.push_back("w" + std::to_string(rng() % 12 * (rng() % 12) / 6));
+		}
+		unsigned long window = terms.size() + q % 5;
+
+		std::vector<uint32_t> expected_phrase, expected_near, docs;
+		for (uint32_t doc = 0; doc < corpus.size(); doc++) {
+			if (scan_phrase(corpus[doc], terms)) {
+				expected_phrase.push_back(doc);
+			}
+			if (scan_near(corpus[doc], terms, window)) {
+				expected_near.push_back(doc);
+			}
+		}
+		phrases.phrase(terms, docs);
+		assert(docs == expected_phrase);
+		docs.clear();
+		phrases.near(terms, window, docs);
+		assert(docs == expected_near);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_filtered() {
+	printf("Testing phrase_filtered()/near_filtered()\n");
+
+	std::mt19937_64 rng(9);
+	std::vector<std::vector<std::string>> corpus(1000);
+	for (std::vector<std::string> &doc : corpus) {
+		unsigned long length = rng() % 40;
+		for (unsigned long i = 0; i < length; i++) {
+			doc.push_back("w" + std::to_string(rng() % 8 * (rng() % 8) / 4));
+		}
+	}
+	InvertedIndex index(build_index("filtered", corpus));
+	PhraseMatcher phrases(index);
+
+	// A dense filter of about half the documents and a sparse one
+	SL::bitvector live(corpus.size());
+	SL::roaring_bitmap sparse;
+	for (uint32_t doc = 0; doc < corpus.size(); doc++) {
+		if (rng() % 2) {
+			live.set(doc);
+		}
+		if (doc % 37 == 5) {
+			sparse.add(doc);
+		}
+	}
+
+	for (unsigned long q = 0; q < 200; q++) {
+		std::vector<std::string> terms;
+		for (unsigned long i = 0; i < q % 3 + 1; i++) {
+			terms.push_back("w" + std::to_string(rng() % 8 * (rng() % 8) / 4));
+		}
+		unsigned long window = terms.size() + q % 4;
+
+		std::vector<uint32_t> expected_live, expected_sparse, expected_near, docs;
+		for (uint32_t doc = 0; doc < corpus.size(); doc++) {
+			bool phrase = scan_phrase(corpus[doc], terms);
+			if (phrase && live.test(doc)) {
+				expected_live.push_back(doc);
+			}
+			if (phrase && sparse.contains(doc)) {
+				expected_sparse.push_back(doc);
+			}
+			if (live.test(doc) && scan_near(corpus[doc], terms, window)) {
+				expected_near.push_back(doc);
+			}
+		}
+		assert(phrases.phrase_filtered(terms, live, docs) == expected_live.size());
+		assert(docs == expected_live);
+		docs.clear();
+		phrases.phrase_filtered(terms, sparse, docs);
+		assert(docs == expected_sparse);
+		docs.clear();
+		phrases.near_filtered(terms, window, live, docs);
+		assert(docs == expected_near);
+		docs.clear();
+		assert(phrases.phrase_filtered(terms, SL::bitvector(corpus.size()), docs) == 0);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_requires_positions() {
+	printf("Testing an index without positions\n");
+
+	InvertedIndex index(build_index("plain", quotes, false));
+	try {
+		PhraseMatcher phrases(index);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+std::string build_index(const std::string &name, const std::vector<std::vector<std::string>> &corpus,
+		bool positions) {
+	std::filesystem::path dir = root / name;
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	IndexBuilderOptions options;
+	options.positions = positions;
+	options.memory_budget = 1 << 20;
+	options.read_buffer = 4096;
+	IndexBuilder builder(dir.string(), options);
+	for (const std::vector<std::string> &doc : corpus) {
+		builder.add(doc);
+	}
+	builder.finish();
+	return dir.string();
+}
+
+bool scan_phrase(const std::vector<std::string> &doc, const std::vector<std::string> &phrase) {
+	if (phrase.empty()) {
+		return false;
+	}
+	for (unsigned long start = 0; start + phrase.size() <= doc.size(); start++) {
+		if (std::equal(phrase.begin(), phrase.end(), doc.begin() + start)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool scan_near(const std::vector<std::string> &doc, const std::vector<std::string> &terms, unsigned long window) {
+	for (unsigned long start = 0; start < doc.size(); start++) {
+		bool all = true;
+		for (const std::string &term : terms) {
+			unsigned long end = std::min(start + window, (unsigned long) doc.size());
+			all = all && std::find(doc.begin() + start, doc.begin() + end, term) != doc.begin() + end;
+		}
+		if (all && !terms.empty()) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,399 @@
+// Quantize Test File
+
+#include "quantize.h"
+#include "bitvector.h"
+#include "roaring.h"
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+
+using namespace SE;
+
+void test_scalar_roundtrip();
+void test_scalar_score();
+void test_product_roundtrip();
+void test_product_score();
+void test_index_blocks();
+void test_top_k();
+void test_search_filtered();
+void test_recall();
+
+void make_corpus(std::vector<float> &data, unsigned long n, unsigned long dim, unsigned long seed);
+std::vector<ScoredDoc> exact_search(const std::vector<float> &data, unsigned long dim,
+		const float* query, unsigned long k);
+double recall(const std::vector<ScoredDoc> &truth, const std::vector<ScoredDoc> &found);
+
+const unsigned long dim = 64;
+const unsigned long corpus_size = 4000;
+const unsigned long query_count = 50;
+const unsigned long top = 10;
+
+
+int main() {
+#ifdef __AVX2__
+	printf("Running quantize test cases (AVX2 kernels)\n");
+#else
+	printf("Running quantize test cases (scalar kernels)\n");
+#endif
+
+	test_scalar_roundtrip();
+	test_scalar_score();
+	test_product_roundtrip();
+	test_product_score();
+	test_index_blocks();
+	test_top_k();
+	test_search_filtered();
+	test_recall();
+
+	printf("All quantize test cases passed!\n");
+	return 0;
+}
+
+void test_scalar_roundtrip() {
+	printf("Testing ScalarQuantizer encode()/decode()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 500, dim, 1);
+
+	ScalarQuantizer sq(dim);
+	sq.train(data.data(), 500);
+	assert(sq.code_size() == dim);
+
+	std::vector<uint8_t> codes(dim);
+	std::vector<float> decoded(dim);
+	for (unsigned long i = 0; i < 500; i++) {
+		sq.encode(&data[i * dim], codes.data());
+		sq.decode(codes.data(), decoded.data());
+		for (unsigned long d = 0; d < dim; d++) {
+			// Within half a quantization step of a 255 level range of [-1, 1]
+			assert(std::fabs(decoded[d] - data[i * dim + d]) <= 2.0f / 255);
+		}
+	}
+
+	try {
+		sq.train(data.data(), 0);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_scalar_score() {
+	printf("Testing ScalarQuantizer score()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 200, dim, 2);
+
+	ScalarQuantizer sq(dim);
+	sq.train(data.data(), 200);
+
+	std::vector<float> table(dim);
+	std::vector<uint8_t> codes(dim);
+	std::vector<float> decoded(dim);
+
+	const float* query = &data[0];
+	float bias = sq.compute_table(query, table.data());
+
+	for (unsigned long i = 0; i < 200; i++) {
+		sq.encode(&data[i * dim], codes.data());
+		sq.decode(codes.data(), decoded.data());
+
+		float expected = 0;
+		for (unsigned long d = 0; d < dim; d++) {
+			expected += query[d] * decoded[d];
+		}
+		assert(std::fabs(sq.score(table.data(), bias, codes.data()) - expected) < 1e-3f);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_product_roundtrip() {
+	printf("Testing ProductQuantizer encode()/decode()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 1000, dim, 3);
+
+	try {
+		ProductQuantizer bad(dim, 7);
+		assert(false);
+	} catch (...) {
+		assert(true);
+	}
+
+	ProductQuantizer pq(dim, dim / 8);
+	pq.train(data.data(), 1000);
+	assert(pq.code_size() == dim / 8);
+
+	// Reconstruction must beat the trivial all-zero reconstruction by far
+	std::vector<uint8_t> codes(pq.code_size());
+	std::vector<float> decoded(dim);
+	double err = 0, energy = 0;
+	for (unsigned long i = 0; i < 1000; i++) {
+		pq.encode(&data[i * dim], codes.data());
+		pq.decode(codes.data(), decoded.data());
+		for (unsigned long d = 0; d < dim; d++) {
+			double diff = decoded[d] - data[i * dim + d];
+			err += diff * diff;
+			energy += data[i * dim + d] * data[i * dim + d];
+		}
+	}
+	assert(err < energy * 0.5);
+
+	printf("Passed!\n");
+}
+
+void test_product_score() {
+	printf("Testing ProductQuantizer score()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 600, dim, 4);
+
+	ProductQuantizer pq(dim, 16);
+	pq.train(data.data(), 600);
+
+	std::vector<float> table(16 * ProductQuantizer::CENTROIDS);
+	std::vector<uint8_t> codes(16);
+	std::vector<float> decoded(dim);
+
+	const float* query = &data[dim];
+	pq.compute_table(query, table.data());
+
+	for (unsigned long i = 0; i < 600; i++) {
+		pq.encode(&data[i * dim], codes.data());
+		pq.decode(codes.data(), decoded.data());
+
+		float expected = 0;
+		for (unsigned long d = 0; d < dim; d++) {
+			expected += query[d] * decoded[d];
+		}
+		assert(std::fabs(pq.score(table.data(), codes.data()) - expected) < 1e-4f);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_index_blocks() {
+	printf("Testing QuantizedIndex score_all()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 300, dim, 5);
+
+	ScalarQuantizer sq(dim);
+	sq.train(data.data(), 300);
+	ProductQuantizer pq(dim, 8);
+	pq.train(data.data(), 300);
+
+	// Sizes straddling block boundaries
+	unsigned long sizes[] = { 1, 7, 8, 9, 17, 300 };
+	for (unsigned long n : sizes) {
+		QuantizedIndex sq_index(sq);
+		QuantizedIndex pq_index(pq);
+		sq_index.add(data.data(), n);
+		pq_index.add(data.data(), n);
+		assert(sq_index.size() == n);
+		assert(pq_index.size() == n);
+
+		const float* query = &data[2 * dim];
+		std::vector<float> sq_scores(n), pq_scores(n);
+		sq_index.score_all(query, sq_scores.data());
+		pq_index.score_all(query, pq_scores.data());
+
+		std::vector<float> table(dim);
+		std::vector<float> pq_table(8 * ProductQuantizer::CENTROIDS);
+		float bias = sq.compute_table(query, table.data());
+		pq.compute_table(query, pq_table.data());
+
+		std::vector<uint8_t> codes(dim);
+		for (unsigned long i = 0; i < n; i++) {
+			sq.encode(&data[i * dim], codes.data());
+			assert(std::fabs(sq_scores[i] - sq.score(table.data(), bias, codes.data())) < 1e-3f);
+
+			pq.encode(&data[i * dim], codes.data());
+			assert(std::fabs(pq_scores[i] - pq.score(pq_table.data(), codes.data())) < 1e-4f);
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_top_k() {
+	printf("Testing QuantizedIndex::top_k()\n");
+
+	float scores[] = { 0.5f, 0.9f, 0.1f, 0.9f, 0.7f, -0.2f };
+
+	std::vector<ScoredDoc> best = QuantizedIndex::top_k(scores, 6, 3);
+	assert(best.size() == 3);
+	assert(best[0].second == 1 && best[1].second == 3 && best[2].second == 4);
+
+	assert(QuantizedIndex::top_k(scores, 6, 0).empty());
+	assert(QuantizedIndex::top_k(scores, 6, 10).size() == 6);
+	assert(QuantizedIndex::top_k(scores, 6, 10).back().second == 5);
+
+	printf("Passed!\n");
+}
+
+void test_search_filtered() {
+	printf("Testing QuantizedIndex::search_filtered()\n");
+
+	std::vector<float> data;
+	make_corpus(data, 500, dim, 11);
+	ScalarQuantizer sq(dim);
+	sq.train(data.data(), 500);
+	QuantizedIndex index(sq);
+	index.add(data.data(), 500);
+
+	// Live documents: every third one deleted
+	SL::bitvector live(500, true);
+	SL::bitvector deleted(500);
+	for (unsigned long doc = 0; doc < 500; doc += 3) {
+		deleted.set(doc);
+	}
+	live.and_not(deleted);
+
+	SL::roaring_bitmap sparse;
+	sparse.add(7);
+	sparse.add(123);
+	sparse.add(499);
+
+	const float* query = &data[9 * dim];
+	std::vector<float> scores(500);
+	index.score_all(query, scores.data());
+
+	std::vector<ScoredDoc> hits = index.search_filtered(query, 20, live);
+	assert(hits.size() == 20);
+	for (const ScoredDoc &hit : hits) {
+		assert(hit.second % 3 != 0);
+		assert(hit.first == scores[hit.second]);
+	}
+
+	// Same answer as masking the scores by hand
+	std::vector<float> masked(scores);
+	for (unsigned long doc = 0; doc < 500; doc += 3) {
+		masked[doc] = -FLT_MAX;
+	}
+	std::vector<ScoredDoc> expected = QuantizedIndex::top_k(masked.data(), 500, 20);
+	for (unsigned long i = 0; i < 20; i++) {
+		assert(hits[i].second == expected[i].second);
+	}
+
+	// Fewer members than k returns only the members
+	hits = index.search_filtered(query, 10, sparse);
+	assert(hits.size() == 3);
+	for (const ScoredDoc &hit : hits) {
+		assert(sparse.contains(hit.second));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_recall() {
+	printf("Testing QuantizedIndex search() recall\n");
+
+	std::vector<float> data;
+	make_corpus(data, corpus_size, dim, 6);
+	std::vector<float> queries;
+	make_corpus(queries, query_count, dim, 7);
+
+	ScalarQuantizer sq(dim);
+	sq.train(data.data(), corpus_size);
+	ProductQuantizer pq(dim, dim / 8);
+	pq.train(data.data(), corpus_size);
+
+	QuantizedIndex sq_index(sq);
+	QuantizedIndex pq_index(pq);
+	sq_index.add(data.data(), corpus_size);
+	pq_index.add(data.data(), corpus_size);
+
+	double sq_recall = 0, pq_recall = 0, pq_rerank_recall = 0;
+	for (unsigned long q = 0; q < query_count; q++) {
+		const float* query = &queries[q * dim];
+		std::vector<ScoredDoc> truth = exact_search(data, dim, query, top);
+
+		sq_recall += recall(truth, sq_index.search(query, top));
+		pq_recall += recall(truth, pq_index.search(query, top));
+
+		std::vector<ScoredDoc> reranked = pq_index.search(query, top, data.data(), 10 * top);
+		pq_rerank_recall += recall(truth, reranked);
+
+		// Reranked scores are exact
+		assert(std::fabs(reranked[0].first - truth[0].first) < 1e-4f || reranked[0].first < truth[0].first);
+	}
+	sq_recall /= query_count;
+	pq_recall /= query_count;
+	pq_rerank_recall /= query_count;
+
+	unsigned long float_bytes = dim * sizeof(float);
+	printf("  float: %lu bytes/doc\n", float_bytes);
+	printf("  int8 scalar: %lu bytes/doc (%lux), recall@%lu %.3f\n", sq_index.bytes_per_doc(),
+			float_bytes / sq_index.bytes_per_doc(), top, sq_recall);
+	printf("  product: %lu bytes/doc (%lux), recall@%lu %.3f, reranked %.3f\n", pq_index.bytes_per_doc(),
+			float_bytes / pq_index.bytes_per_doc(), top, pq_recall, pq_rerank_recall);
+
+	assert(float_bytes / sq_index.bytes_per_doc() == 4);
+	assert(float_bytes / pq_index.bytes_per_doc() == 32);
+	assert(sq_recall >= 0.9);
+	assert(pq_recall >= 0.25);
+	assert(pq_rerank_recall >= 0.9);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Clustered unit vectors, closer to real document embeddings than uniform noise
+void make_corpus(std::vector<float> &data, unsigned long n, unsigned long dim, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	std::mt19937_64 center_rng(99);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+
+	const unsigned long clusters = 40;
+	std::vector<float> centers(clusters * dim);
+	for (unsigned long i = 0; i < centers.size(); i++) {
+		centers[i] = normal(center_rng);
+	}
+
+	data.resize(n * dim);
+	for (unsigned long i = 0; i < n; i++) {
+		unsigned long c = rng() % clusters;
+		float norm = 0;
+		for (unsigned long d = 0; d < dim; d++) {
+			float v = centers[c * dim + d] + 0.6f * normal(rng);
+			data[i * dim + d] = v;
+			norm += v * v;
+		}
+		norm = std::sqrt(norm);
+		for (unsigned long d = 0; d < dim; d++) {
+			data[i * dim + d] /= norm;
+		}
+	}
+}
+
+std::vector<ScoredDoc> exact_search(const std::vector<float> &data, unsigned long dim,
+		const float* query, unsigned long k) {
+	unsigned long n = data.size() / dim;
+	std::vector<float> scores(n);
+	for (unsigned long i = 0; i < n; i++) {
+		float dot = 0;
+		for (unsigned long d = 0; d < dim; d++) {
+			dot += query[d] * data[i * dim + d];
+		}
+		scores[i] = dot;
+	}
+	return QuantizedIndex::top_k(scores.data(), n, k);
+}
+
+double recall(const std::vector<ScoredDoc> &truth, const std::vector<ScoredDoc> &found) {
+	unsigned long hits = 0;
+	for (const ScoredDoc &t : truth) {
+		for (const ScoredDoc &f : found) {
+			if (f.second == t.second) {
+				hits++;
+				break;
+			}
+		}
+	}
+	return (double) hits / truth.size();
+}
@@ -0,0 +1,412 @@
+// Scoring Test File
+
+#include "scoring.h"
+#include "bitvector.h"
+#include "roaring.h"
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+
+using namespace SE;
+
+void test_tfidf();
+void test_bm25();
+void test_bm25_params();
+void test_bm25f();
+void test_dirichlet();
+void test_custom_model();
+void test_term_scorer();
+void test_term_scorer_models();
+void test_term_scorer_arena();
+void test_term_scorer_filtered();
+
+bool close(float a, float b);
+CollectionStats make_collection();
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_scoring";
+
+// Counts matches, ignoring everything but tf
+struct MatchCount {
+	static constexpr unsigned long FIELDS = 1;
+	static constexpr DocValue DOC_VALUE = DOC_LENGTH;
+
+	struct Term {
+		float weight;
+	};
+
+	static Term prepare(const CollectionStats&, const TermStats&, float query_weight) {
+		return { query_weight };
+	}
+
+	static float score(const Term &term, const float*, const float*) {
+		return term.weight;
+	}
+};
+
+struct FlatBM25 {
+	static constexpr float k1 = 2.0f;
+	static constexpr float b = 0.0f;
+};
+
+
+int main() {
+	printf("Running scoring test cases\n");
+
+	// Test Models
+	test_tfidf();
+	test_bm25();
+	test_bm25_params();
+	test_bm25f();
+	test_dirichlet();
+	test_custom_model();
+
+	// Test TermScorer
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	test_term_scorer();
+	test_term_scorer_models();
+	test_term_scorer_arena();
+	test_term_scorer_filtered();
+	std::filesystem::remove_all(root);
+
+	printf("All scoring test cases passed!\n");
+	return 0;
+}
+
+// Testing Models
+
+void test_tfidf() {
+	printf("Testing TfIdfCosine\n");
+
+	CollectionStats collection = make_collection();
+	TermStats term = { 10, 30 };
+	float tf[] = { 1, 4 };
+	float norm[] = { 2, 0.5f };
+	float scores[] = { 1, 0 };
+
+	PostingBlock<1> block;
+	block.size = 2;
+	block.tf[0] = tf;
+	block.doc[0] = norm;
+	score_block<TfIdfCosine>(TfIdfCosine::prepare(collection, term, 2), block, scores);
+
+	float idf = std::log(1000.0f / 10);
+	assert(close(scores[0], 1 + 2 * idf * idf / 2));
+	assert(close(scores[1], 2 * idf * idf * (1 + std::log(4.0f)) / 0.5f));
+
+	printf("Passed!\n");
+}
+
+void test_bm25() {
+	printf("Testing BM25\n");
+
+	CollectionStats collection = make_collection();
+	TermStats term = { 10, 30 };
+	float tf[] = { 1, 3, 3 };
+	float length[] = { 100, 100, 400 };
+	float scores[3] = {};
+
+	PostingBlock<1> block;
+	block.size = 3;
+	block.tf[0] = tf;
+	block.doc[0] = length;
+	score_block<BM25<>>(BM25<>::prepare(collection, term, 1), block, scores);
+
+	float idf = std::log(1 + (1000 - 10 + 0.5f) / (10 + 0.5f));
+	for (unsigned long i = 0; i < 3; i++) {
+		float expected = idf * tf[i] * 2.2f / (tf[i] + 1.2f * (0.25f + 0.75f * length[i] / 200));
+		assert(close(scores[i], expected));
+	}
+	// More matches score higher, longer documents lower
+	assert(scores[1] > scores[0] && scores[2] < scores[1]);
+
+	printf("Passed!\n");
+}
+
+void test_bm25_params() {
+	printf("Testing BM25 with custom parameters\n");
+
+	// b = 0 ignores length
+	CollectionStats collection = make_collection();
+	TermStats term = { 10, 30 };
+	float tf[] = { 3, 3 };
+	float length[] = { 10, 10000 };
+	float scores[2] = {};
+
+	PostingBlock<1> block;
+	block.size = 2;
+	block.tf[0] = tf;
+	block.doc[0] = length;
+	score_block<BM25<FlatBM25>>(BM25<FlatBM25>::prepare(collection, term, 1), block, scores);
+
+	float idf = std::log(1 + (1000 - 10 + 0.5f) / (10 + 0.5f));
+	assert(close(scores[0], scores[1]));
+	assert(close(scores[0], idf * 3 * 3 / (3 + 2)));
+
+	printf("Passed!\n");
+}
+
+void test_bm25f() {
+	printf("Testing BM25F\n");
+
+	CollectionStats collection = make_collection();
+	collection.average_length[0] = 8;
+	TermStats term = { 10, 30 };
+	float title_tf[] = { 1, 0 };
+	float body_tf[] = { 0, 1 };
+	float title_length[] = { 8, 8 };
+	float body_length[] = { 200, 200 };
+	float scores[2] = {};
+
+	PostingBlock<2> block;
+	block.size = 2;
+	block.tf[0] = title_tf;
+	block.tf[1] = body_tf;
+	block.doc[0] = title_length;
+	block.doc[1] = body_length;
+	score_block<BM25F<>>(BM25F<>::prepare(collection, term, 1), block, scores);
+
+	// At average length a field's pseudo-tf is tf * weight
+	float idf = std::log(1 + (1000 - 10 + 0.5f) / (10 + 0.5f));
+	assert(close(scores[0], idf * 2.2f * 2 / (2 + 1.2f)));
+	assert(close(scores[1], idf * 2.2f * 1 / (1 + 1.2f)));
+	assert(scores[0] > scores[1]);
+
+	printf("Passed!\n");
+}
+
+void test_dirichlet() {
+	printf("Testing Dirichlet\n");
+
+	CollectionStats collection = make_collection();
+	TermStats term = { 10, 400 };
+	float tf[] = { 2, 1 };
+	float length[] = { 100, 100000 };
+	float scores[2] = {};
+
+	PostingBlock<1> block;
+	block.size = 2;
+	block.tf[0] = tf;
+	block.doc[0] = length;
+	score_block<Dirichlet<>>(Dirichlet<>::prepare(collection, term, 1), block, scores);
+
+	float p = 400.0f / 200000;
+	assert(close(scores[0], std::log(1 + 2 / (2000 * p)) + std::log(2000.0f / 2100)));
+	// Swamped by length: floored at zero
+	assert(scores[1] == 0);
+
+	printf("Passed!\n");
+}
+
+void test_custom_model() {
+	printf("Testing a custom model\n");
+
+	float tf[] = { 1, 7, 2 };
+	float length[] = { 1, 1, 1 };
+	float scores[3] = { 0, 1, 2 };
+
+	PostingBlock<1> block;
+	block.size = 3;
+	block.tf[0] = tf;
+	block.doc[0] = length;
+	score_block<MatchCount>(MatchCount::prepare(make_collection(), TermStats(), 3), block, scores);
+	assert(scores[0] == 3 && scores[1] == 4 && scores[2] == 5);
+
+	printf("Passed!\n");
+}
+
+// Testing TermScorer
+
+void test_term_scorer() {
+	printf("Testing TermScorer\n");
+
+	std::vector<std::vector<std::string>> corpus = {
+		{ "red", "fish" },
+		{ "blue", "fish", "fish" },
+		{ "red", "red", "red", "car", "car", "car", "car", "car" },
+		{ "green", "tree" },
+	};
+	IndexBuilder builder(root.string());
+	DocStoreBuilder docs;
+	for (unsigned long i = 0; i < corpus.size(); i++) {
+		builder.add(corpus[i]);
+		docs.add("http://example.com/" + std::to_string(i), corpus[i].size(), 1.0f, 0);
+	}
+	builder.finish();
+	InvertedIndex index(root.string());
+	DocStore store = docs.build();
+
+	TermScorer<BM25<>> scorer(index, store);
+	assert(scorer.collection().documents == 4);
+	assert(close(scorer.collection().average_length[0], 15.0f / 4));
+	assert(scorer.collection().total_terms == 15);
+
+	// Matches the kernel applied by hand
+	std::vector<ScoredDoc> hits = scorer.search({ "fish" }, 10);
+	assert(hits.size() == 2);
+	assert(hits[0].second == 1 && hits[1].second == 0);
+	BM25<>::Term term = BM25<>::prepare(scorer.collection(), { 2, 3 }, 1);
+	float tf = 2, length = 3;
+	assert(close(hits[0].first, BM25<>::score(term, &tf, &length)));
+
+	// Unknown terms add nothing; k limits the results
+	hits = scorer.search({ "red", "fish", "zebra" }, 2);
+	assert(hits.size() == 2);
+	assert(scorer.search({ "zebra" }, 10).empty());
+	assert(scorer.search({}, 10).empty());
+
+	// A repeated query term counts twice
+	std::vector<ScoredDoc> once = scorer.search({ "tree" }, 1);
+	std::vector<ScoredDoc> twice = scorer.search({ "tree", "tree" }, 1);
+	assert(once[0].second == 3 && twice[0].second == 3);
+	assert(close(twice[0].first, 2 * once[0].first));
+
+	printf("Passed!\n");
+}
+
+void test_term_scorer_models() {
+	printf("Testing TermScorer with each model\n");
+
+	// Document 0 is short with one match, document 1 long with two
+	std::vector<std::vector<std::string>> corpus = { { "a", "b" }, {}, {}, {}, {} };
+	corpus[1] = { "a", "a" };
+	for (unsigned long i = 0; i < 40; i++) {
+		corpus[1].push_back("filler");
+	}
+	corpus[2] = { "c" };
+	std::filesystem::path dir = root / "models";
+	std::filesystem::create_directories(dir);
+	IndexBuilder builder(dir.string());
+	DocStoreBuilder docs;
+	for (unsigned long i = 0; i < corpus.size(); i++) {
+		builder.add(corpus[i]);
+		docs.add("http://example.com/" + std::to_string(i), corpus[i].size(), 1.0f + i, 0);
+	}
+	builder.finish();
+	InvertedIndex index(dir.string());
+	DocStore store = docs.build();
+
+	// Cosine divides by the norm, so the long document's larger norm loses
+	assert(TermScorer<TfIdfCosine>(index, store).search({ "a" }, 1)[0].second == 0);
+	assert(TermScorer<BM25<>>(index, store).search({ "a" }, 1)[0].second == 0);
+	assert(TermScorer<BM25<FlatBM25>>(index, store).search({ "a" }, 1)[0].second == 1);
+	// The long document's smoothing penalty outweighs its matches
+	std::vector<ScoredDoc> lm = TermScorer<Dirichlet<>>(index, store).search({ "a" }, 2);
+	assert(lm.size() == 1 && lm[0].second == 0);
+	std::vector<ScoredDoc> counts = TermScorer<MatchCount>(index, store).search({ "a", "b" }, 5);
+	assert(counts.size() == 2 && counts[0].second == 0 && counts[0].first == 2 && counts[1].first == 1);
+
+	printf("Passed!\n");
+}
+
+void test_term_scorer_arena() {
+	printf("Testing TermScorer scratch allocation\n");
+
+	std::vector<std::vector<std::string>> corpus;
+	for (unsigned long d = 0; d < 500; d++) {
+		corpus.push_back({ "t" + std::to_string(d % 7), "t" + std::to_string(d % 11), "t" + std::to_string(d % 13) });
+	}
+	std::filesystem::path dir = root / "arena";
+	std::filesystem::create_directories(dir);
+	IndexBuilder builder(dir.string());
+	DocStoreBuilder docs;
+	for (unsigned long i = 0; i < corpus.size(); i++) {
+		builder.add(corpus[i]);
+		docs.add("http://example.com/" + std::to_string(i), corpus[i].size(), 1.0f, 0);
+	}
+	builder.finish();
+	InvertedIndex index(dir.string());
+	DocStore store = docs.build();
+	TermScorer<BM25<>> scorer(index, store);
+
+	// Heap, a caller's arena and the per-query arena rank the same
+	std::vector<std::string> query = { "t3", "t5", "t3", "t12" };
+	std::vector<ScoredDoc> heap = scorer.search(query, 20, std::allocator<char>());
+	SL::arena arena;
+	for (int round = 0; round < 3; round++) {
+		assert(scorer.search(query, 20, SL::arena_allocator<char>(arena)) == heap);
+		arena.reset();
+	}
+	assert(scorer.search(query, 20) == heap);
+
+	// Once this thread's pool has blocks, queries take none from the system
+	SL::arena_stats before = SL::arena::stats();
+	for (int round = 0; round < 10; round++) {
+		assert(scorer.search(query, 20) == heap);
+	}
+	assert(SL::arena::stats().system_blocks == before.system_blocks);
+
+	printf("Passed!\n");
+}
+
+void test_term_scorer_filtered() {
+	printf("Testing TermScorer search_filtered()\n");
+
+	std::vector<std::vector<std::string>> corpus;
+	for (unsigned long d = 0; d < 300; d++) {
+		corpus.push_back({ "t" + std::to_string(d % 7), "t" + std::to_string(d % 11), "t" + std::to_string(d % 13) });
+	}
+	std::filesystem::path dir = root / "filtered";
+	std::filesystem::create_directories(dir);
+	IndexBuilder builder(dir.string());
+	DocStoreBuilder docs;
+	for (unsigned long i = 0; i < corpus.size(); i++) {
+		builder.add(corpus[i]);
+		docs.add("http://example.com/" + std::to_string(i), corpus[i].size(), 1.0f, 0);
+	}
+	builder.finish();
+	InvertedIndex index(dir.string());
+	DocStore store = docs.build();
+	TermScorer<BM25<>> scorer(index, store);
+
+	// Live documents: every third one deleted
+	SL::bitvector live(300, true);
+	SL::bitvector deleted(300);
+	for (unsigned long doc = 0; doc < 300; doc += 3) {
+		deleted.set(doc);
+	}
+	live.and_not(deleted);
+
+	// Same scores as unfiltered, with the deleted documents left out
+	std::vector<std::string> query = { "t3", "t5", "t12" };
+	std::vector<ScoredDoc> all = scorer.search(query, 300);
+	std::vector<ScoredDoc> expected;
+	for (const ScoredDoc &hit : all) {
+		if (hit.second % 3 != 0 && expected.size() < 20) {
+			expected.push_back(hit);
+		}
+	}
+	std::vector<ScoredDoc> hits = scorer.search_filtered(query, 20, live);
+	assert(hits.size() == 20);
+	assert(hits == expected);
+	assert(scorer.search_filtered(query, 20, live, std::allocator<char>()) == expected);
+	assert(scorer.search_filtered(query, 300, AllDocuments()) == all);
+
+	// Sparse filters, including members matching no term and past the end
+	SL::roaring_bitmap sparse;
+	sparse.add(3);
+	sparse.add(4);
+	sparse.add(5);
+	sparse.add(1000);
+	hits = scorer.search_filtered({ "t3" }, 10, sparse);
+	assert(hits.size() == 1 && hits[0].second == 3);
+	assert(scorer.search_filtered(query, 10, SL::roaring_bitmap()).empty());
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+bool close(float a, float b) {
+	return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(b));
+}
+
+CollectionStats make_collection() {
+	CollectionStats collection;
+	collection.documents = 1000;
+	collection.total_terms = 200000;
+	collection.average_length[0] = 200;
+	collection.average_length[1] = 200;
+	return collection;
+}
@@ -0,0 +1,429 @@
+// Server Test File
+
+#include "server.h"
+#include "shard.h"
+#include <stdio.h>
+#include <cassert>
+#include <filesystem>
+#include <random>
+
+using namespace SE;
+
+void test_addresses();
+void test_unix_listener();
+void test_tcp_listener();
+void test_pipelining();
+void test_many_clients();
+void test_bad_request();
+void test_failing_search();
+void test_stalled_clients();
+void test_stop();
+
+std::vector<std::vector<std::string>> make_queries(unsigned long count, unsigned long seed);
+Deadline seconds_from_now(long seconds);
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_server";
+
+// Serves the shard on a background thread for the scope of one test
+struct RunningServer {
+	QueryServer<ShardServer> server;
+	std::thread thread;
+
+	RunningServer(const ShardServer &shard, ServerOptions options = ServerOptions()) : server(shard, options) {}
+
+	void start() {
+		thread = std::thread([this]() {
+			server.serve();
+		});
+	}
+
+	~RunningServer() {
+		server.stop();
+		thread.join();
+	}
+};
+
+// Throws on the term "fail", as a searcher might on a bad read
+struct FailingSearcher {
+	std::vector<ScoredDoc> search(const QueryRequest &request) const {
+		for (const std::string &term : request.terms) {
+			if (term == "fail") {
+				throw "Search failed!";
+			}
+		}
+		return shard->search(request);
+	}
+
+	const ShardServer* shard;
+};
+
+std::unique_ptr<ShardServer> shard;
+
+
+int main() {
+	printf("Running server test cases\n");
+
+	// One small index for every test
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	IndexBuilderOptions options;
+	options.memory_budget = 1 << 20;
+	options.read_buffer = 4096;
+	ShardedIndexBuilder builder(root.string(), 1, options);
+	std::mt19937_64 rng(1);
+	for (unsigned long d = 0; d < 500; d++) {
+		std::vector<std::string> terms;
+		for (unsigned long i = 0; i < 5 + rng() % 40; i++) {
+			terms.push_back("t" + std::to_string(rng() % (1 + rng() % 60)));
+		}
+		builder.add("http://example.com/" + std::to_string(d), terms);
+	}
+	builder.finish();
+	shard.reset(new ShardServer(ShardedIndexBuilder::shard_directory(root.string(), 0)));
+
+	// Test Addresses
+	test_addresses();
+
+	// Test Serving
+	test_unix_listener();
+	test_tcp_listener();
+	test_pipelining();
+	test_many_clients();
+	test_bad_request();
+	test_failing_search();
+	test_stalled_clients();
+	test_stop();
+
+	shard.reset();
+	std::filesystem::remove_all(root);
+	printf("All server test cases passed!\n");
+	return 0;
+}
+
+// Testing Addresses
+
+void test_addresses() {
+	printf("Testing addresses\n");
+
+	assert(is_unix_address("/tmp/x.sock"));
+	assert(is_unix_address("./x.sock"));
+	assert(!is_unix_address("127.0.0.1:80"));
+	assert(!is_unix_address(":0"));
+
+	sockaddr_in in = tcp_address("127.0.0.1:8080");
+	assert(ntohs(in.sin_port) == 8080);
+	assert(ntohl(in.sin_addr.s_addr) == 0x7F000001);
+	in = tcp_address(":0");
+	assert(in.sin_port == 0 && in.sin_addr.s_addr == INADDR_ANY);
+
+	for (const char* bad : { "localhost", "127.0.0.1:", "127.0.0.1:99999", "127.0.0.1:8x", "nohost:80" }) {
+		try {
+			tcp_address(bad);
+			assert(false);
+		} catch (const char* e) {
+		}
+	}
+
+	// Nothing listens there
+	assert(connect_address((root / "nobody.sock").string()) < 0);
+
+	printf("Passed!\n");
+}
+
+// Testing Serving
+
+void test_unix_listener() {
+	printf("Testing QueryServer on a Unix socket\n");
+
+	RunningServer running(*shard);
+	std::string address = (root / "server.sock").string();
+	assert(running.server.listen(address) == 0);
+	running.start();
+
+	QueryClient client(address);
+	std::vector<ScoredDoc> hits;
+	for (const std::vector<std::string> &terms : make_queries(50, 2)) {
+		QueryRequest request;
+		request.k = 1 + terms.size() * 3;
+		request.terms = terms;
+		assert(client.search(request, hits, seconds_from_now(5)));
+		assert(hits == shard->search(request));
+	}
+	QueryRequest request;
+	request.terms = { "absent" };
+	assert(client.search(request, hits, seconds_from_now(5)));
+	assert(hits.empty());
+
+	ServerStats stats = running.server.stats();
+	assert(stats.connections == 1);
+	assert(stats.requests == 51);
+	assert(stats.bad_requests == 0);
+
+	printf("Passed!\n");
+}
+
+void test_tcp_listener() {
+	printf("Testing QueryServer on TCP\n");
+
+	RunningServer running(*shard);
+	unsigned long port = running.server.listen("127.0.0.1:0");
+	assert(port != 0);
+	std::string unix_address = (root / "server.sock").string();
+	running.server.listen(unix_address);
+	running.start();
+
+	// Both listeners reach the same index
+	QueryClient tcp("127.0.0.1:" + std::to_string(port));
+	QueryClient local(unix_address);
+	std::vector<ScoredDoc> tcp_hits, local_hits;
+	for (const std::vector<std::string> &terms : make_queries(20, 3)) {
+		QueryRequest request;
+		request.terms = terms;
+		assert(tcp.search(request, tcp_hits, seconds_from_now(5)));
+		assert(local.search(request, local_hits, seconds_from_now(5)));
+		assert(tcp_hits == local_hits);
+		assert(tcp_hits == shard->search(request));
+	}
+	assert(running.server.stats().connections == 2);
+
+	printf("Passed!\n");
+}
+
+void test_pipelining() {
+	printf("Testing pipelined requests\n");
+
+	ServerOptions options;
+	options.workers = 3;
+	RunningServer running(*shard, options);
+	std::string address = (root / "server.sock").string();
+	running.server.listen(address);
+	running.start();
+
+	// Every request goes out before any answer is read
+	QueryClient client(address);
+	std::vector<std::vector<std::string>> queries = make_queries(200, 4);
+	for (unsigned long q = 0; q < queries.size(); q++) {
+		QueryRequest request;
+		request.k = 1 + q % 15;
+		request.terms = queries[q];
+		assert(client.send(request));
+	}
+	std::vector<ScoredDoc> hits;
+	for (unsigned long q = 0; q < queries.size(); q++) {
+		QueryRequest request;
+		request.k = 1 + q % 15;
+		request.terms = queries[q];
+		assert(client.receive(hits, seconds_from_now(5)));
+		assert(hits == shard->search(request));
+	}
+	assert(!client.receive(hits, std::chrono::steady_clock::now()));
+
+	printf("Passed!\n");
+}
+
+void test_many_clients() {
+	printf("Testing concurrent clients\n");
+
+	ServerOptions options;
+	options.workers = 4;
+	RunningServer running(*shard, options);
+	std::string address = (root / "server.sock").string();
+	running.server.listen(address);
+	running.start();
+
+	std::atomic<unsigned long> answered{0};
+	std::vector<std::thread> clients;
+	for (unsigned long c = 0; c < 8; c++) {
+		clients.emplace_back([&, c]() {
+			QueryClient client(address);
+			std::vector<ScoredDoc> hits;
+			for (const std::vector<std::string> &terms : make_queries(100, 10 + c)) {
+				QueryRequest request;
+				request.terms = terms;
+				assert(client.search(request, hits, seconds_from_now(10)));
+				assert(hits == shard->search(request));
+				answered++;
+			}
+		});
+	}
+	for (std::thread &client : clients) {
+		client.join();
+	}
+	assert(answered == 800);
+	assert(running.server.stats().requests == 800);
+	assert(running.server.stats().connections == 8);
+
+	printf("Passed!\n");
+}
+
+void test_bad_request() {
+	printf("Testing a malformed request\n");
+
+	RunningServer running(*shard);
+	std::string address = (root / "server.sock").string();
+	running.server.listen(address);
+	running.start();
+
+	// The bad connection is closed; others carry on
+	int fd = connect_address(address);
+	assert(fd >= 0);
+	assert(send_frame(fd, std::string(12, '\xff')));
+	FrameBuffer buffer;
+	std::string reply;
+	assert(!recv_frame(fd, buffer, reply, seconds_from_now(5)));
+	::close(fd);
+
+	QueryClient client(address);
+	QueryRequest request;
+	request.terms = { "t1" };
+	std::vector<ScoredDoc> hits;
+	assert(client.search(request, hits, seconds_from_now(5)));
+	assert(hits == shard->search(request));
+	assert(running.server.stats().bad_requests == 1);
+	assert(running.server.stats().requests == 1);
+
+	printf("Passed!\n");
+}
+
+void test_failing_search() {
+	printf("Testing a request the searcher throws on\n");
+
+	FailingSearcher searcher = { shard.get() };
+	QueryServer<FailingSearcher> server(searcher);
+	std::string address = (root / "server.sock").string();
+	server.listen(address);
+	std::thread thread([&]() {
+		server.serve();
+	});
+
+	// Its connection is closed; the worker lives on for the next one
+	QueryClient failing(address);
+	QueryRequest request;
+	request.terms = { "t1", "fail" };
+	std::vector<ScoredDoc> hits;
+	assert(!failing.search(request, hits, seconds_from_now(5)));
+
+	QueryClient client(address);
+	request.terms = { "t1" };
+	assert(client.search(request, hits, seconds_from_now(5)));
+	assert(hits == shard->search(request));
+	assert(server.stats().bad_requests == 1);
+	assert(server.stats().requests == 1);
+
+	server.stop();
+	thread.join();
+
+	printf("Passed!\n");
+}
+
+void test_stalled_clients() {
+	printf("Testing clients that stop reading\n");
+
+	ServerOptions options;
+	options.workers = 2;
+	std::unique_ptr<RunningServer> running(new RunningServer(*shard, options));
+	std::string address = (root / "server.sock").string();
+	running->server.listen(address);
+	running->start();
+
+	// More of them than workers, each pipelining far more replies than
+	// the sockets and the server's queue hold, then reading none
+	QueryRequest request;
+	request.k = MAX_K;
+	request.terms = { "t1" };
+	std::string requests;
+	for (unsigned long q = 0; q < 4000; q++) {
+		append_frame(requests, encode_request(request));
+	}
+	std::vector<int> stalled;
+	for (unsigned long c = 0; c < 3; c++) {
+		stalled.push_back(connect_address(address));
+		assert(stalled.back() >= 0);
+		assert(::send(stalled.back(), requests.data(), requests.size(), 0) == (ssize_t) requests.size());
+	}
+
+	// Other clients are still answered
+	QueryClient client(address);
+	std::vector<ScoredDoc> hits;
+	QueryRequest other;
+	other.terms = { "t2", "t3" };
+	for (unsigned long q = 0; q < 3; q++) {
+		assert(client.search(other, hits, seconds_from_now(5)));
+		assert(hits == shard->search(other));
+	}
+
+	// Reading again, a stalled client gets every reply in order
+	std::vector<ScoredDoc> expected = shard->search(request);
+	FrameBuffer buffer;
+	std::string reply;
+	for (unsigned long q = 0; q < 4000; q++) {
+		assert(recv_frame(stalled[0], buffer, reply, seconds_from_now(5)));
+		assert(decode_hits(reply, hits) && hits == expected);
+	}
+
+	// stop() returns with the others still stalled
+	running.reset();
+	for (int fd : stalled) {
+		::close(fd);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_stop() {
+	printf("Testing stop()\n");
+
+	QueryServer<ShardServer> server(*shard);
+	try {
+		server.serve();
+		assert(false);
+	} catch (const char* e) {
+	}
+	ServerOptions options;
+	options.workers = 0;
+	try {
+		QueryServer<ShardServer> bad(*shard, options);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	// Open connections don't keep serve() from returning, and a stop()
+	// before serve() starts is not lost
+	std::string address = (root / "server.sock").string();
+	server.listen(address);
+	QueryClient client(address);
+	server.stop();
+	server.serve();
+
+	// Served again after a stop
+	std::thread thread([&]() {
+		server.serve();
+	});
+	QueryClient again(address);
+	QueryRequest request;
+	request.terms = { "t2" };
+	std::vector<ScoredDoc> hits;
+	assert(again.search(request, hits, seconds_from_now(5)));
+	server.stop();
+	thread.join();
+	assert(!again.search(request, hits, seconds_from_now(1)));
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+std::vector<std::vector<std::string>> make_queries(unsigned long count, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	std::vector<std::vector<std::string>> queries(count);
+	for (std::vector<std::string> &terms : queries) {
+		for (unsigned long t = 0; t <= rng() % 3; t++) {
+			terms.push_back("t" + std::to_string(rng() % 70));
+		}
+	}
+	return queries;
+}
+
+Deadline seconds_from_now(long seconds) {
+	return std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+}
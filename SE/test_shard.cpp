@@ -0,0 +1,593 @@
+// Shard Test File
+
+#include "shard.h"
+#include <stdio.h>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <thread>
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace SE;
+
+void test_request_messages();
+void test_hit_messages();
+void test_garbled_messages();
+void test_frame_buffer();
+void test_sharded_build();
+void test_scatter_gather();
+void test_dead_shard();
+void test_shard_deadline();
+void test_blocked_shard();
+void test_stalled_client();
+
+std::vector<std::vector<std::string>> make_corpus(unsigned long documents);
+void build_shards(const std::string &directory, unsigned long shards, const std::vector<std::vector<std::string>> &corpus);
+std::vector<ScoredDoc> merged_search(const std::vector<std::unique_ptr<ShardServer>> &servers,
+		const std::vector<std::string> &terms, unsigned long k);
+pid_t start_shard(const std::string &directory, const std::string &socket_path);
+void stop_shard(pid_t pid);
+
+const std::filesystem::path root = std::filesystem::temp_directory_path() / "se_test_shard";
+
+
+int main() {
+	printf("Running shard test cases\n");
+
+	// Test Messages
+	test_request_messages();
+	test_hit_messages();
+	test_garbled_messages();
+	test_frame_buffer();
+
+	// Test Serving
+	test_sharded_build();
+	test_scatter_gather();
+	test_dead_shard();
+	test_shard_deadline();
+	test_blocked_shard();
+	test_stalled_client();
+
+	std::filesystem::remove_all(root);
+	printf("All shard test cases passed!\n");
+	return 0;
+}
+
+// Testing Messages
+
+void test_request_messages() {
+	printf("Testing encode_request()/decode_request()\n");
+
+	QueryRequest request;
+	request.k = 25;
+	request.terms = { "alpha", "", std::string(300, 'x'), "alpha" };
+	QueryRequest decoded;
+	assert(decode_request(encode_request(request), decoded));
+	assert(decoded.k == 25);
+	assert(decoded.terms == request.terms);
+
+	request.terms.clear();
+	assert(decode_request(encode_request(request), decoded));
+	assert(decoded.terms.empty());
+
+	// k sizes the server's heap, so anything over MAX_K is malformed
+	request.k = MAX_K;
+	assert(decode_request(encode_request(request), decoded) && decoded.k == MAX_K);
+	request.k = MAX_K + 1;
+	assert(!decode_request(encode_request(request), decoded));
+	std::string huge;
+	write_varint(huge, ~0UL);
+	write_varint(huge, 0);
+	assert(!decode_request(huge, decoded));
+
+	printf("Passed!\n");
+}
+
+void test_hit_messages() {
+	printf("Testing encode_hits()/decode_hits()\n");
+
+	std::vector<ScoredDoc> hits = { { 12.5f, 7 }, { 3.25f, 0 }, { 1e-20f, 4000000000UL }, { 0.1f, 12345 } };
+	std::vector<ScoredDoc> decoded = { { 1.0f, 1 } };
+	assert(decode_hits(encode_hits(hits), decoded));
+	assert(decoded == hits);
+	assert(decode_hits(encode_hits({}), decoded));
+	assert(decoded.empty());
+
+	printf("Passed!\n");
+}
+
+void test_garbled_messages() {
+	printf("Testing garbled messages\n");
+
+	QueryRequest request;
+	request.terms = { "alpha", "beta" };
+	std::string bytes = encode_request(request);
+	QueryRequest decoded;
+	for (unsigned long size = 0; size < bytes.size(); size++) {
+		assert(!decode_request(bytes.substr(0, size), decoded));
+	}
+	assert(!decode_request(bytes + "x", decoded));
+	assert(!decode_request(std::string(12, '\xff'), decoded));
+
+	std::string hits = encode_hits({ { 2.0f, 1 }, { 1.0f, 2 } });
+	std::vector<ScoredDoc> decoded_hits;
+	for (unsigned long size = 0; size < hits.size(); size++) {
+		assert(!decode_hits(hits.substr(0, size), decoded_hits));
+	}
+	assert(!decode_hits(hits + "x", decoded_hits));
+
+	printf("Passed!\n");
+}
+
+void test_frame_buffer() {
+	printf("Testing FrameBuffer\n");
+
+	int fds[2];
+	assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	FrameBuffer buffer;
+	std::string payload;
+
+	// Nothing to read yet is not the end of the stream
+	assert(buffer.fill(fds[1]));
+	assert(!buffer.next(payload));
+
+	// Two frames at once, then a third split inside its header and payload
+	assert(send_frame(fds[0], "first"));
+	assert(send_frame(fds[0], ""));
+	assert(buffer.fill(fds[1]));
+	assert(buffer.next(payload) && payload == "first");
+	assert(buffer.next(payload) && payload.empty());
+	assert(!buffer.next(payload));
+
+	std::string big(100000, 'b');
+	std::string frame(4, '\0');
+	uint32_t length = big.size();
+	std::memcpy(&frame[0], &length, 4);
+	frame += big;
+	assert(::send(fds[0], frame.data(), 2, 0) == 2);
+	assert(buffer.fill(fds[1]));
+	assert(!buffer.next(payload));
+	std::thread writer([&]() {
+		assert(::send(fds[0], frame.data() + 2, frame.size() - 2, 0) == (ssize_t) frame.size() - 2);
+	});
+	Deadline deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	assert(recv_frame(fds[1], buffer, payload, deadline));
+	writer.join();
+	assert(payload == big);
+
+	// Nothing more arrives before a deadline already passed
+	assert(!recv_frame(fds[1], buffer, payload, std::chrono::steady_clock::now()));
+
+	// Oversized frames and closed peers end the stream
+	length = MAX_FRAME + 1;
+	assert(::send(fds[0], &length, 4, 0) == 4);
+	assert(!buffer.fill(fds[1]));
+	buffer.clear();
+	::close(fds[0]);
+	assert(!buffer.fill(fds[1]));
+	::close(fds[1]);
+
+	printf("Passed!\n");
+}
+
+// Testing Serving
+
+void test_sharded_build() {
+	printf("Testing ShardedIndexBuilder and ShardServer search()\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(300);
+	build_shards(root.string(), 3, corpus);
+
+	std::vector<std::unique_ptr<ShardServer>> servers;
+	for (unsigned long s = 0; s < 3; s++) {
+		servers.emplace_back(new ShardServer(ShardedIndexBuilder::shard_directory(root.string(), s)));
+		assert(servers[s]->shard() == s);
+		assert(servers[s]->shards() == 3);
+	}
+
+	// Every document holding the term is found once, on its own shard
+	for (const char* term : { "t0", "t7", "t31" }) {
+		std::set<unsigned long> expected;
+		for (unsigned long d = 0; d < corpus.size(); d++) {
+			if (std::find(corpus[d].begin(), corpus[d].end(), term) != corpus[d].end()) {
+				expected.insert(d);
+			}
+		}
+		assert(!expected.empty());
+
+		QueryRequest request;
+		request.k = corpus.size();
+		request.terms = { term };
+		std::set<unsigned long> found;
+		for (unsigned long s = 0; s < 3; s++) {
+			std::vector<ScoredDoc> hits = servers[s]->search(request);
+			for (unsigned long i = 0; i < hits.size(); i++) {
+				assert(hits[i].second % 3 == s);
+				assert(i == 0 || !ranks_before(hits[i], hits[i - 1]));
+				found.insert(hits[i].second);
+			}
+		}
+		assert(found == expected);
+	}
+
+	// One shard is the whole collection under the same IDs
+	build_shards((root / "single").string(), 1, corpus);
+	std::string directory = ShardedIndexBuilder::shard_directory((root / "single").string(), 0);
+	ShardServer single(directory);
+	InvertedIndex index(directory);
+	DocStore docs;
+	std::ifstream in(directory + "/docstore", std::ios::binary);
+	docs.load(in);
+	assert(docs.size() == corpus.size());
+	assert(docs.url(17) == "http://example.com/17");
+	QueryRequest request;
+	request.terms = { "t1", "t2", "t9" };
+	std::vector<ScoredDoc> hits = single.search(request);
+	assert(hits.size() == 10);
+	assert(hits == TermScorer<BM25<>>(index, docs).search(request.terms, 10));
+
+	// Snippets are stored per shard under local IDs and looked up globally
+	for (unsigned long s = 0; s < 3; s++) {
+		Snippet snippet = servers[s]->snippet(3 + s, { corpus[3 + s][0] });
+		assert(!snippet.highlights.empty());
+		assert(snippet.text.compare(snippet.highlights[0].first, corpus[3 + s][0].size(), corpus[3 + s][0]) == 0);
+		assert(single.snippet(3 + s, { "document" }).format() == servers[s]->snippet(3 + s, { "document" }).format());
+	}
+	assert(single.snippet(42, { "document" }).format().find("<b>Document</b> 42.") == 0);
+	try {
+		servers[0]->snippet(1, { "t1" });
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	try {
+		ShardedIndexBuilder bad(root.string(), 0);
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		ShardServer missing((root / "missing").string());
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_scatter_gather() {
+	printf("Testing ShardCoordinator search()\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(600);
+	build_shards(root.string(), 4, corpus);
+	std::vector<std::unique_ptr<ShardServer>> servers;
+	std::vector<std::string> sockets;
+	std::vector<pid_t> pids;
+	for (unsigned long s = 0; s < 4; s++) {
+		std::string directory = ShardedIndexBuilder::shard_directory(root.string(), s);
+		servers.emplace_back(new ShardServer(directory));
+		sockets.push_back((root / ("shard-" + std::to_string(s) + ".sock")).string());
+		pids.push_back(start_shard(directory, sockets[s]));
+	}
+
+	CoordinatorOptions options;
+	options.shard_deadline_us = 5000000;
+	ShardCoordinator coordinator(sockets, options);
+	assert(coordinator.shards() == 4);
+
+	std::mt19937_64 rng(5);
+	for (unsigned long q = 0; q < 50; q++) {
+		std::vector<std::string> terms;
+		for (unsigned long t = 0; t <= q % 3; t++) {
+			terms.push_back("t" + std::to_string(rng() % 60));
+		}
+		unsigned long k = 1 + q % 20;
+		SearchResult result = coordinator.search(terms, k);
+		assert(!result.partial);
+		assert(result.shards_answered == 4);
+		assert(result.hits == merged_search(servers, terms, k));
+	}
+
+	// Terms nobody has
+	SearchResult result = coordinator.search({ "absent" }, 10);
+	assert(result.hits.empty() && !result.partial);
+
+	assert(coordinator.stats().queries == 51);
+	assert(coordinator.stats().partial == 0);
+	assert(coordinator.stats().timeouts == 0 && coordinator.stats().failures == 0);
+
+	for (pid_t pid : pids) {
+		stop_shard(pid);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_dead_shard() {
+	printf("Testing a dead shard\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(300);
+	build_shards(root.string(), 2, corpus);
+	std::vector<std::unique_ptr<ShardServer>> servers;
+	std::vector<std::string> sockets;
+	std::vector<pid_t> pids;
+	for (unsigned long s = 0; s < 2; s++) {
+		std::string directory = ShardedIndexBuilder::shard_directory(root.string(), s);
+		servers.emplace_back(new ShardServer(directory));
+		sockets.push_back((root / ("shard-" + std::to_string(s) + ".sock")).string());
+		pids.push_back(start_shard(directory, sockets[s]));
+	}
+
+	CoordinatorOptions options;
+	options.shard_deadline_us = 5000000;
+	ShardCoordinator coordinator(sockets, options);
+	std::vector<std::string> terms = { "t0", "t3" };
+	SearchResult result = coordinator.search(terms, 10);
+	assert(!result.partial);
+
+	// Shard 1 dies with its connection open: the answer comes from shard 0
+	stop_shard(pids[1]);
+	result = coordinator.search(terms, 10);
+	assert(result.partial);
+	assert(result.shards_answered == 1);
+	assert(!result.hits.empty());
+	for (const ScoredDoc &hit : result.hits) {
+		assert(hit.second % 2 == 0);
+	}
+	assert(coordinator.stats().failures == 1);
+
+	// Nothing listens now: the reconnect fails at once
+	std::filesystem::remove(sockets[1]);
+	result = coordinator.search(terms, 10);
+	assert(result.partial && result.shards_answered == 1);
+	assert(coordinator.stats().failures == 2);
+
+	// Restarted, it is picked up again
+	pids[1] = start_shard(ShardedIndexBuilder::shard_directory(root.string(), 1), sockets[1]);
+	result = coordinator.search(terms, 10);
+	assert(!result.partial);
+	assert(result.hits == merged_search(servers, terms, 10));
+	assert(coordinator.stats().partial == 2);
+	assert(coordinator.stats().timeouts == 0);
+
+	for (pid_t pid : pids) {
+		stop_shard(pid);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_shard_deadline() {
+	printf("Testing the shard deadline\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(300);
+	build_shards(root.string(), 2, corpus);
+	std::string directory = ShardedIndexBuilder::shard_directory(root.string(), 0);
+	ShardServer server(directory);
+	std::vector<std::string> sockets = { (root / "shard-0.sock").string(), (root / "silent.sock").string() };
+	pid_t pid = start_shard(directory, sockets[0]);
+
+	// Accepts connections (the kernel queues them) but never answers
+	int silent = listen_unix(sockets[1]);
+
+	CoordinatorOptions options;
+	options.shard_deadline_us = 20000;
+	ShardCoordinator coordinator(sockets, options);
+	std::vector<std::string> terms = { "t0", "t3" };
+	for (unsigned long q = 0; q < 3; q++) {
+		auto start = std::chrono::steady_clock::now();
+		SearchResult result = coordinator.search(terms, 10);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		assert(elapsed >= 0.019 && elapsed < 2.0);
+		assert(result.partial);
+		assert(result.shards_answered == 1);
+		QueryRequest request;
+		request.k = 10;
+		request.terms = terms;
+		assert(result.hits == server.search(request));
+	}
+	assert(coordinator.stats().timeouts == 3);
+	assert(coordinator.stats().failures == 0);
+	assert(coordinator.stats().partial == 3);
+
+	::close(silent);
+	stop_shard(pid);
+
+	printf("Passed!\n");
+}
+
+void test_blocked_shard() {
+	printf("Testing shards that would block connect and send\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(300);
+	build_shards(root.string(), 1, corpus);
+	std::string directory = ShardedIndexBuilder::shard_directory(root.string(), 0);
+	std::vector<std::string> sockets = { (root / "shard-0.sock").string(), (root / "full.sock").string(),
+			(root / "deaf.sock").string() };
+	pid_t pid = start_shard(directory, sockets[0]);
+
+	// Never accepts, and its backlog is full: a blocking connect would wait
+	int full = listen_unix(sockets[1]);
+	std::vector<int> backlog;
+	while (true) {
+		bool connecting;
+		int fd = start_connect_unix(sockets[1], connecting);
+		if (fd < 0) {
+			break;
+		}
+		backlog.push_back(fd);
+	}
+
+	// Queues connections but never reads: a blocking send of a query
+	// larger than the socket buffer would wait
+	int deaf = listen_unix(sockets[2]);
+
+	CoordinatorOptions options;
+	options.shard_deadline_us = 50000;
+	ShardCoordinator coordinator(sockets, options);
+	for (unsigned long q = 0; q < 2; q++) {
+		auto start = std::chrono::steady_clock::now();
+		SearchResult result = coordinator.search({ "t0", std::string(4 << 20, 'x') }, 10);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		assert(elapsed >= 0.049 && elapsed < 2.0);
+		assert(result.partial);
+		assert(result.shards_answered == 1);
+	}
+	assert(coordinator.stats().failures == 2);
+	assert(coordinator.stats().timeouts == 2);
+
+	for (int fd : backlog) {
+		::close(fd);
+	}
+	::close(full);
+	::close(deaf);
+	stop_shard(pid);
+
+	printf("Passed!\n");
+}
+
+void test_stalled_client() {
+	printf("Testing a client that stops reading\n");
+
+	std::vector<std::vector<std::string>> corpus = make_corpus(300);
+	build_shards(root.string(), 1, corpus);
+	std::string directory = ShardedIndexBuilder::shard_directory(root.string(), 0);
+	ShardServer server(directory);
+	std::string socket_path = (root / "shard-0.sock").string();
+	pid_t pid = start_shard(directory, socket_path);
+
+	// Pipelines far more replies than the sockets and the server's queue
+	// hold, then reads none of them
+	QueryRequest request;
+	request.k = MAX_K;
+	request.terms = { "t0" };
+	std::string requests;
+	for (unsigned long q = 0; q < 4000; q++) {
+		append_frame(requests, encode_request(request));
+	}
+	int stalled = connect_unix(socket_path);
+	assert(stalled >= 0);
+	assert(::send(stalled, requests.data(), requests.size(), 0) == (ssize_t) requests.size());
+
+	// Other clients are still answered
+	CoordinatorOptions options;
+	options.shard_deadline_us = 5000000;
+	ShardCoordinator coordinator({ socket_path }, options);
+	for (unsigned long q = 0; q < 3; q++) {
+		SearchResult result = coordinator.search({ "t0", "t3" }, 10);
+		assert(!result.partial);
+	}
+	assert(coordinator.stats().timeouts == 0);
+
+	// Oversized k drops the connection instead of reaching the scorer
+	int greedy = connect_unix(socket_path);
+	assert(greedy >= 0);
+	std::string bad;
+	write_varint(bad, (uint64_t) MAX_K + 1);
+	write_varint(bad, 0);
+	assert(send_frame(greedy, bad));
+	FrameBuffer greedy_buffer;
+	std::string reply;
+	assert(!recv_frame(greedy, greedy_buffer, reply, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+	::close(greedy);
+
+	// Reading again, the stalled client gets every reply in order
+	std::vector<ScoredDoc> expected = server.search(request);
+	FrameBuffer buffer;
+	std::vector<ScoredDoc> hits;
+	for (unsigned long q = 0; q < 4000; q++) {
+		assert(recv_frame(stalled, buffer, reply, std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+		assert(decode_hits(reply, hits) && hits == expected);
+	}
+	::close(stalled);
+	stop_shard(pid);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+// Zipf-like draws over t0 ... t59, so low terms are common
+std::vector<std::vector<std::string>> make_corpus(unsigned long documents) {
+	std::mt19937_64 rng(documents);
+	std::vector<std::vector<std::string>> corpus(documents);
+	for (std::vector<std::string> &terms : corpus) {
+		unsigned long length = 5 + rng() % 40;
+		for (unsigned long i = 0; i < length; i++) {
+			unsigned long term = rng() % 60;
+			term = rng() % (term + 1);
+			terms.push_back("t" + std::to_string(term));
+		}
+	}
+	return corpus;
+}
+
+void build_shards(const std::string &directory, unsigned long shards, const std::vector<std::vector<std::string>> &corpus) {
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	IndexBuilderOptions options;
+	options.memory_budget = 1 << 20;
+	options.read_buffer = 4096;
+	ShardedIndexBuilder builder(directory, shards, options);
+	assert(builder.shards() == shards);
+	for (unsigned long d = 0; d < corpus.size(); d++) {
+		std::string text = "Document " + std::to_string(d) + ".";
+		for (const std::string &term : corpus[d]) {
+			text += " " + term;
+		}
+		assert(builder.add("http://example.com/" + std::to_string(d), corpus[d], text) == d);
+	}
+	builder.finish();
+}
+
+// What a coordinator should answer, from in-process shards
+std::vector<ScoredDoc> merged_search(const std::vector<std::unique_ptr<ShardServer>> &servers,
+		const std::vector<std::string> &terms, unsigned long k) {
+	QueryRequest request;
+	request.k = k;
+	request.terms = terms;
+	std::vector<ScoredDoc> hits;
+	for (const std::unique_ptr<ShardServer> &server : servers) {
+		std::vector<ScoredDoc> shard_hits = server->search(request);
+		hits.insert(hits.end(), shard_hits.begin(), shard_hits.end());
+	}
+	std::sort(hits.begin(), hits.end(), ranks_before);
+	hits.resize(std::min(k, (unsigned long) hits.size()));
+	return hits;
+}
+
+// Forks a shard server process; returns once it is listening
+pid_t start_shard(const std::string &directory, const std::string &socket_path) {
+	int ready[2];
+	assert(::pipe(ready) == 0);
+	fflush(stdout);
+	pid_t pid = ::fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		::close(ready[0]);
+		try {
+			ShardServer server(directory);
+			server.listen(socket_path);
+			char byte = 1;
+			if (::write(ready[1], &byte, 1) != 1) {
+				_exit(1);
+			}
+			server.serve();
+		} catch (const char* e) {
+			fprintf(stderr, "Shard server: %s\n", e);
+		}
+		_exit(1);
+	}
+	::close(ready[1]);
+	char byte;
+	assert(::read(ready[0], &byte, 1) == 1);
+	::close(ready[0]);
+	return pid;
+}
+
+void stop_shard(pid_t pid) {
+	::kill(pid, SIGKILL);
+	int status;
+	::waitpid(pid, &status, 0);
+}
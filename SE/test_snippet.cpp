@@ -0,0 +1,346 @@
+// Snippet Test File
+
+#include "snippet.h"
+#include <stdio.h>
+#include <cassert>
+#include <random>
+#include <sstream>
+
+using namespace SE;
+
+void test_find_term();
+void test_find_term_random();
+void test_sentence_start();
+void test_best_window();
+void test_no_match();
+void test_budget();
+void test_case_and_repeats();
+void test_format();
+void test_save_load();
+void test_random_snippets();
+
+std::vector<unsigned long> naive_find(const std::string &text, const std::string &term);
+std::string make_text(std::mt19937_64 &rng, unsigned long sentences);
+SnippetStore build(const std::vector<std::string> &texts);
+
+
+int main() {
+	printf("Running snippet test cases\n");
+
+	// Test Highlighting
+	test_find_term();
+	test_find_term_random();
+
+	// Test Snippets
+	test_sentence_start();
+	test_best_window();
+	test_no_match();
+	test_budget();
+	test_case_and_repeats();
+	test_format();
+	test_save_load();
+	test_random_snippets();
+
+	printf("All snippet test cases passed!\n");
+	return 0;
+}
+
+// Testing Highlighting
+
+void test_find_term() {
+	printf("Testing find_term()\n");
+
+	std::string text = "Cat, cats and a CAT! concatenate cat-cat. The category: cat";
+	std::vector<unsigned long> found;
+	find_term(text.data(), text.size(), "cat", [&](unsigned long at) {
+		found.push_back(at);
+	});
+	assert(found == std::vector<unsigned long>({ 0, 16, 33, 37, 56 }));
+	assert(found == naive_find(text, "cat"));
+
+	found.clear();
+	find_term(text.data(), text.size(), "dog", [&](unsigned long at) {
+		found.push_back(at);
+	});
+	find_term(text.data(), 2, "cat", [&](unsigned long at) {
+		found.push_back(at);
+	});
+	find_term(text.data(), text.size(), "", [&](unsigned long at) {
+		found.push_back(at);
+	});
+	assert(found.empty());
+
+	// Bytes that OR 0x20 maps onto term characters are not matches
+	std::string odd = std::string("\x10") + "1 " + std::string(20, ' ') + "01 \x10\x11 01";
+	find_term(odd.data(), odd.size(), "01", [&](unsigned long at) {
+		found.push_back(at);
+	});
+	assert(found == naive_find(odd, "01"));
+	assert(found.size() == 2);
+
+	printf("Passed!\n");
+}
+
+void test_find_term_random() {
+	printf("Testing find_term() against a naive search\n");
+
+	std::mt19937_64 rng(1);
+	const char alphabet[] = "abAB1 .-\x10";
+	for (unsigned long round = 0; round < 2000; round++) {
+		std::string text;
+		unsigned long length = rng() % 80;
+		for (unsigned long i = 0; i < length; i++) {
+			text.push_back(alphabet[rng() % 9]);
+		}
+		std::string term;
+		for (unsigned long i = 0, n = 1 + rng() % 4; i < n; i++) {
+			term.push_back("ab1"[rng() % 3]);
+		}
+		std::vector<unsigned long> found;
+		find_term(text.data(), text.size(), term, [&](unsigned long at) {
+			found.push_back(at);
+		});
+		assert(found == naive_find(text, term));
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Snippets
+
+void test_sentence_start() {
+	printf("Testing a snippet from the start of its sentence\n");
+
+	SnippetStore store = build({ "The first sentence is about nothing. Neither is the second one! "
+			"Now the quick brown fox jumps over the lazy dog. And then it rests." });
+	Snippet snippet = store.snippet(0, { "fox" });
+	assert(snippet.text.rfind("Now the", 0) == 0);
+	assert(snippet.highlights.size() == 1);
+	assert(snippet.text.substr(snippet.highlights[0].first, snippet.highlights[0].second) == "fox");
+	assert(snippet.text.size() <= 200);
+
+	// The whole document fits
+	assert(snippet.text.back() == '.');
+	SnippetOptions options;
+	options.max_bytes = 45;
+	snippet = store.snippet(0, { "fox" }, options);
+	assert(snippet.text == "Now the quick brown fox jumps over the lazy");
+
+	printf("Passed!\n");
+}
+
+void test_best_window() {
+	printf("Testing the best window\n");
+
+	// One term three times early on, both terms together later
+	std::string filler;
+	for (unsigned long i = 0; i < 40; i++) {
+		filler += "lorem ipsum dolor sit amet. ";
+	}
+	SnippetStore store = build({ "apple apple apple. " + filler + "An apple and a pear walked in. " + filler });
+	SnippetOptions options;
+	options.max_bytes = 60;
+	Snippet snippet = store.snippet(0, { "apple", "pear" }, options);
+	assert(snippet.text.rfind("An apple and a pear walked in.", 0) == 0);
+	assert(snippet.highlights.size() == 2);
+	assert(snippet.format("[", "]").rfind("An [apple] and a [pear] walked in.", 0) == 0);
+
+	// With one term, the densest window wins
+	snippet = store.snippet(0, { "apple" }, options);
+	assert(snippet.text.rfind("apple apple apple.", 0) == 0);
+	assert(snippet.highlights.size() == 3);
+
+	printf("Passed!\n");
+}
+
+void test_no_match() {
+	printf("Testing a snippet without matches\n");
+
+	SnippetStore store = build({ "Opening words of the document. More words follow here.", "", "..." });
+	SnippetOptions options;
+	options.max_bytes = 20;
+	Snippet snippet = store.snippet(0, { "zebra" }, options);
+	assert(snippet.text == "Opening words of the");
+	assert(snippet.highlights.empty());
+	snippet = store.snippet(0, {}, options);
+	assert(snippet.text == "Opening words of the");
+	snippet = store.snippet(1, { "zebra" });
+	assert(snippet.text.empty() && snippet.highlights.empty());
+	snippet = store.snippet(2, { "zebra" });
+	assert(snippet.text.empty());
+
+	try {
+		store.snippet(3, { "zebra" });
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_budget() {
+	printf("Testing the length budget\n");
+
+	std::mt19937_64 rng(2);
+	std::string text = make_text(rng, 200);
+	SnippetStore store = build({ text });
+	for (unsigned long max_bytes : { 30, 80, 200, 500 }) {
+		SnippetOptions options;
+		options.max_bytes = max_bytes;
+		for (const char* term : { "w1", "w7", "w30", "absent" }) {
+			Snippet snippet = store.snippet(0, { term, "w2" }, options);
+			assert(snippet.text.size() <= max_bytes);
+			assert(!snippet.text.empty());
+			// Cut at token boundaries of the stored text
+			unsigned long at = text.find(snippet.text);
+			assert(at != std::string::npos);
+			assert(at == 0 || !is_term_char(text[at - 1]));
+			unsigned long end = at + snippet.text.size();
+			assert(end == text.size() || !is_term_char(text[end]));
+			assert(is_term_char(snippet.text[0]));
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_case_and_repeats() {
+	printf("Testing case and repeated query terms\n");
+
+	SnippetStore store = build({ "Searching for FOXES? The Fox, a fox and foxes." });
+	Snippet snippet = store.snippet(0, { "FOX", "fox", "Fox!" });
+	assert(snippet.text == "The Fox, a fox and foxes.");
+	assert(snippet.highlights.size() == 2);
+	assert(snippet.highlights[0] == std::make_pair(4U, 3U));
+	assert(snippet.highlights[1] == std::make_pair(11U, 3U));
+	snippet = store.snippet(0, { "foxes", "fox" });
+	assert(snippet.text == "Searching for FOXES? The Fox, a fox and foxes.");
+	assert(snippet.highlights.size() == 4);
+
+	printf("Passed!\n");
+}
+
+void test_format() {
+	printf("Testing format()\n");
+
+	Snippet snippet;
+	snippet.text = "a fox and a dog";
+	assert(snippet.format() == "a fox and a dog");
+	snippet.highlights = { { 2, 3 }, { 12, 3 } };
+	assert(snippet.format() == "a <b>fox</b> and a <b>dog</b>");
+	snippet.highlights = { { 0, 1 } };
+	assert(snippet.format("*", "*") == "*a* fox and a dog");
+
+	printf("Passed!\n");
+}
+
+void test_save_load() {
+	printf("Testing save()/load()\n");
+
+	std::mt19937_64 rng(3);
+	std::vector<std::string> texts;
+	for (unsigned long d = 0; d < 50; d++) {
+		texts.push_back(make_text(rng, 1 + d % 7));
+	}
+	SnippetStore store = build(texts);
+	std::stringstream stream;
+	store.save(stream);
+	SnippetStore loaded;
+	loaded.load(stream);
+	assert(loaded.size() == 50);
+	assert(loaded.memory_bytes() == store.memory_bytes());
+	for (unsigned long d = 0; d < 50; d++) {
+		assert(loaded.text(d) == texts[d]);
+		Snippet a = store.snippet(d, { "w3", "w5" });
+		Snippet b = loaded.snippet(d, { "w3", "w5" });
+		assert(a.text == b.text && a.highlights == b.highlights);
+	}
+
+	// Texts past max_text are cut
+	SnippetStoreBuilder builder(10);
+	builder.add("0123456789 overflow");
+	assert(builder.size() == 1);
+	assert(builder.build().text(0) == "0123456789");
+
+	printf("Passed!\n");
+}
+
+void test_random_snippets() {
+	printf("Testing random snippets against a rescan\n");
+
+	std::mt19937_64 rng(4);
+	std::vector<std::string> texts;
+	for (unsigned long d = 0; d < 200; d++) {
+		texts.push_back(make_text(rng, 1 + rng() % 30));
+	}
+	SnippetStore store = build(texts);
+	for (unsigned long q = 0; q < 1000; q++) {
+		unsigned long doc = rng() % texts.size();
+		std::vector<std::string> terms;
+		for (unsigned long t = 0, n = 1 + rng() % 3; t < n; t++) {
+			terms.push_back("w" + std::to_string(rng() % 40));
+		}
+		SnippetOptions options;
+		options.max_bytes = 40 + rng() % 300;
+		Snippet snippet = store.snippet(doc, terms, options);
+		assert(snippet.text.size() <= options.max_bytes);
+		assert(texts[doc].find(snippet.text) != std::string::npos);
+
+		// Highlights are exactly the snippet's tokens equal to a query term
+		std::vector<std::pair<uint32_t, uint32_t>> expected;
+		tokenize_offsets(snippet.text.data(), snippet.text.size(), [&](const char* t, unsigned long n,
+				unsigned long start) {
+			if (std::find(terms.begin(), terms.end(), std::string(t, n)) != terms.end()) {
+				expected.push_back(std::make_pair((uint32_t) start, (uint32_t) n));
+			}
+		});
+		assert(snippet.highlights == expected);
+
+		// The document has a query term, so the snippet does too
+		bool any = false;
+		for (const std::string &term : terms) {
+			any |= !naive_find(texts[doc], term).empty();
+		}
+		assert(any == !expected.empty());
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+std::vector<unsigned long> naive_find(const std::string &text, const std::string &term) {
+	std::vector<unsigned long> found;
+	std::vector<std::string> terms;
+	tokenize_offsets(text.data(), text.size(), [&](const char* t, unsigned long n, unsigned long start) {
+		if (std::string(t, n) == term) {
+			found.push_back(start);
+		}
+	});
+	return found;
+}
+
+// Sentences of 3 to 20 terms w0 ... w39, some capitalized
+std::string make_text(std::mt19937_64 &rng, unsigned long sentences) {
+	std::string text;
+	for (unsigned long s = 0; s < sentences; s++) {
+		for (unsigned long i = 0, n = 3 + rng() % 18; i < n; i++) {
+			std::string word = "w" + std::to_string(rng() % 40);
+			if (rng() % 5 == 0) {
+				word[0] = 'W';
+			}
+			text += word;
+			text += i + 1 < n ? (rng() % 6 ? " " : ", ") : ". ";
+		}
+	}
+	text.pop_back();
+	return text;
+}
+
+SnippetStore build(const std::vector<std::string> &texts) {
+	SnippetStoreBuilder builder;
+	for (const std::string &text : texts) {
+		builder.add(text);
+	}
+	return builder.build();
+}
@@ -0,0 +1,104 @@
+// tokenizer header file
+//
+// Splits text into lowercase ASCII alphanumeric terms. Works directly on
+// raw byte ranges so callers can tokenize buffers they do not own.
+
+#ifndef SE_TOKENIZER_H
+#define SE_TOKENIZER_H
+
+#include "static_vector.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SE {
+
+// Terms longer than this are truncated; they are almost always base64
+// blobs or URLs glued together rather than words
+const unsigned long MAX_TERM_LENGTH = 64;
+
+// Every byte's lowercase form if it is a term character, 0 if not. Built
+// by the compiler, so classifying a byte is one load from the binary's
+// read-only data and no table is set up at startup.
+constexpr SL::static_vector<unsigned char, 256> make_term_chars() {
+	SL::static_vector<unsigned char, 256> table(256, 0);
+	for (int c = 0; c < 256; c++) {
+		if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+			table[c] = c;
+		} else if (c >= 'A' && c <= 'Z') {
+			table[c] = c + ('a' - 'A');
+		}
+	}
+	return table;
+}
+
+constexpr SL::static_vector<unsigned char, 256> TERM_CHARS = make_term_chars();
+
+inline bool is_term_char(unsigned char c) {
+	return TERM_CHARS.data()[c] != 0;
+}
+
+inline char to_lower(unsigned char c) {
+	unsigned char lower = TERM_CHARS.data()[c];
+	return lower ? lower : c;
+}
+
+// FNV-1a over a term as tokenize emits it
+inline uint32_t term_hash(const char* term, unsigned long length) {
+	uint32_t hash = 2166136261U;
+	for (unsigned long i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char) term[i]) * 16777619U;
+	}
+	return hash;
+}
+
+// Calls emit(const char* term, unsigned long length, unsigned long start)
+// for every term in data, start being the offset of its first byte; term
+// points into a scratch buffer that is reused between calls
+template<class Emit>
+void tokenize_offsets(const char* data, unsigned long length, Emit emit) {
+	char term[MAX_TERM_LENGTH];
+	unsigned long term_length = 0;
+	unsigned long start = 0;
+	bool in_term = false;
+
+	for (unsigned long i = 0; i < length; i++) {
+		unsigned char lower = TERM_CHARS.data()[(unsigned char) data[i]];
+		if (lower) {
+			if (!in_term) {
+				start = i;
+			}
+			if (term_length < MAX_TERM_LENGTH) {
+				term[term_length++] = lower;
+			}
+			in_term = true;
+		} else if (in_term) {
+			emit((const char*) term, term_length, start);
+			term_length = 0;
+			in_term = false;
+		}
+	}
+
+	if (in_term) {
+		emit((const char*) term, term_length, start);
+	}
+}
+
+// Calls emit(const char* term, unsigned long length) for every term in
+// data; term points into a scratch buffer that is reused between calls
+template<class Emit>
+void tokenize(const char* data, unsigned long length, Emit emit) {
+	tokenize_offsets(data, length, [&emit](const char* term, unsigned long term_length, unsigned long) {
+		emit(term, term_length);
+	});
+}
+
+inline void tokenize(const std::string &text, std::vector<std::string> &terms) {
+	tokenize(text.data(), text.size(), [&terms](const char* term, unsigned long length) {
+		terms.emplace_back(term, length);
+	});
+}
+
+
+}
+#endif
@@ -0,0 +1,289 @@
+// algorithm header file
+//
+// Bulk algorithms for building postings, where hundreds of millions of
+// (termID, docID) pairs get sorted and merged:
+//
+//   radix_sort         - LSD radix sort of unsigned keys, optionally carrying
+//                        a parallel vector of values along
+//   radix_sort_by_key  - LSD radix sort of records by an unsigned key
+//   parallel_sort      - sample sort across a thread_pool
+//   merge_runs         - stable k-way merge of sorted runs
+//
+// The radix sorts are stable and need a scratch copy of the input.
+
+#ifndef SL_ALGORITHM_H
+#define SL_ALGORITHM_H
+
+#include "span.h"
+#include "thread_pool.h"
+#include "vector.h"
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace SL {
+
+namespace detail {
+
+constexpr unsigned long RADIX_BITS = 8;
+constexpr unsigned long RADIX = 1UL << RADIX_BITS;
+
+// One byte of the key per pass, least significant first. All histograms are
+// built in a single read; a pass whose byte is the same for every key is
+// skipped, so 64-bit keys holding small values cost only their used bytes.
+template<class T, class KeyFn, class V>
+void lsd_radix_sort(vector<T> &items, KeyFn key, vector<V>* values) {
+	typedef typename std::decay<decltype(key(std::declval<const T&>()))>::type Key;
+	static_assert(std::is_unsigned<Key>::value, "Radix sort keys must be unsigned integers");
+	constexpr unsigned long DIGITS = sizeof(Key);
+
+	unsigned long n = items.size();
+	if (n < 2) {
+		return;
+	}
+	if (values && values->size() != n) {
+		throw "Keys and values differ in size!";
+	}
+
+	vector<unsigned long> counts(DIGITS * RADIX, 0);
+	unsigned long* count = counts.data();
+	const T* src = items.data();
+	for (unsigned long i = 0; i < n; i++) {
+		Key k = key(src[i]);
+		for (unsigned long d = 0; d < DIGITS; d++) {
+			count[d * RADIX + ((k >> (d * RADIX_BITS)) & (RADIX - 1))]++;
+		}
+	}
+
+	vector<T> item_buffer;
+	vector<V> value_buffer;
+	T* from = items.data();
+	T* to = nullptr;
+	V* value_from = values ? values->data() : nullptr;
+	V* value_to = nullptr;
+	bool in_buffer = false;
+
+	for (unsigned long d = 0; d < DIGITS; d++) {
+		unsigned long shift = d * RADIX_BITS;
+		unsigned long* offsets = count + d * RADIX;
+		if (offsets[(key(from[0]) >> shift) & (RADIX - 1)] == n) {
+			continue;
+		}
+
+		if (to == nullptr) {
+			item_buffer.resize(n);
+			to = item_buffer.data();
+			if (values) {
+				value_buffer.resize(n);
+				value_to = value_buffer.data();
+			}
+		}
+
+		unsigned long sum = 0;
+		for (unsigned long b = 0; b < RADIX; b++) {
+			unsigned long c = offsets[b];
+			offsets[b] = sum;
+			sum += c;
+		}
+		for (unsigned long i = 0; i < n; i++) {
+			unsigned long pos = offsets[(key(from[i]) >> shift) & (RADIX - 1)]++;
+			to[pos] = std::move(from[i]);
+			if (values) {
+				value_to[pos] = std::move(value_from[i]);
+			}
+		}
+
+		std::swap(from, to);
+		std::swap(value_from, value_to);
+		in_buffer = !in_buffer;
+	}
+
+	if (in_buffer) {
+		items = std::move(item_buffer);
+		if (values) {
+			*values = std::move(value_buffer);
+		}
+	}
+}
+
+template<class Key>
+struct identity_key {
+	Key operator()(Key k) const {
+		return k;
+	}
+};
+
+}
+
+
+// Sorts unsigned integer keys
+template<class Key>
+void radix_sort(vector<Key> &keys) {
+	detail::lsd_radix_sort(keys, detail::identity_key<Key>(), (vector<char>*) nullptr);
+}
+
+// Sorts keys, applying the same permutation to values
+template<class Key, class Value>
+void radix_sort(vector<Key> &keys, vector<Value> &values) {
+	detail::lsd_radix_sort(keys, detail::identity_key<Key>(), &values);
+}
+
+// Sorts records by key(record), which must return an unsigned integer.
+// Pack composite keys, e.g. ((uint64_t) term << 32) | doc.
+template<class T, class KeyFn>
+void radix_sort_by_key(vector<T> &items, KeyFn key) {
+	detail::lsd_radix_sort(items, key, (vector<char>*) nullptr);
+}
+
+
+// Sample sort: splitters drawn from an oversample cut the input into one
+// bucket per thread, each thread scatters its block into the buckets, then
+// each bucket is sorted on its own. Not stable. Small inputs and single
+// thread pools fall back to std::sort.
+template<class T, class Compare = std::less<T>>
+void parallel_sort(vector<T> &items, thread_pool &pool, Compare comp = Compare()) {
+	const unsigned long SERIAL_CUTOFF = 1UL << 16;
+	const unsigned long OVERSAMPLE = 64;
+	const unsigned long MIN_BUCKET = 4096;
+
+	unsigned long n = items.size();
+	unsigned long parts = std::min(pool.size(), n / MIN_BUCKET);
+	T* data = items.data();
+	if (n < SERIAL_CUTOFF || parts == 1) {
+		std::sort(data, data + n, comp);
+		return;
+	}
+
+	// Splitters from an evenly strided sample
+	vector<T> sample;
+	unsigned long samples = parts * OVERSAMPLE;
+	unsigned long stride = n / samples;
+	sample.reserve(samples);
+	for (unsigned long i = 0; i < samples; i++) {
+		sample.push_back(data[i * stride + (i * 2654435761UL) % stride]);
+	}
+	std::sort(sample.data(), sample.data() + samples, comp);
+	vector<T> splitters;
+	splitters.reserve(parts - 1);
+	for (unsigned long b = 1; b < parts; b++) {
+		splitters.push_back(sample.data()[b * OVERSAMPLE]);
+	}
+	const T* split = splitters.data();
+
+	// counts[block * parts + bucket], then the output offset of each pair
+	vector<unsigned long> counts(parts * parts, 0);
+	vector<unsigned int> buckets(n, 0);
+	unsigned long block_size = (n + parts - 1) / parts;
+	pool.run(parts, [&](unsigned long block) {
+		unsigned long begin = std::min(block * block_size, n);
+		unsigned long end = std::min(begin + block_size, n);
+		unsigned long* count = counts.data() + block * parts;
+		unsigned int* bucket = buckets.data();
+		for (unsigned long i = begin; i < end; i++) {
+			unsigned int b = std::upper_bound(split, split + parts - 1, data[i], comp) - split;
+			bucket[i] = b;
+			count[b]++;
+		}
+	});
+
+	vector<unsigned long> bucket_start(parts + 1, 0);
+	unsigned long offset = 0;
+	for (unsigned long b = 0; b < parts; b++) {
+		bucket_start.data()[b] = offset;
+		for (unsigned long block = 0; block < parts; block++) {
+			unsigned long c = counts.data()[block * parts + b];
+			counts.data()[block * parts + b] = offset;
+			offset += c;
+		}
+	}
+	bucket_start.data()[parts] = n;
+
+	vector<T> out;
+	out.resize(n);
+	T* dst = out.data();
+	pool.run(parts, [&](unsigned long block) {
+		unsigned long begin = std::min(block * block_size, n);
+		unsigned long end = std::min(begin + block_size, n);
+		unsigned long* next = counts.data() + block * parts;
+		const unsigned int* bucket = buckets.data();
+		for (unsigned long i = begin; i < end; i++) {
+			dst[next[bucket[i]]++] = std::move(data[i]);
+		}
+	});
+
+	pool.run(parts, [&](unsigned long b) {
+		std::sort(dst + bucket_start.data()[b], dst + bucket_start.data()[b + 1], comp);
+	});
+	items = std::move(out);
+}
+
+
+// Merges sorted runs into one sorted vector. Equal elements keep the order
+// of their runs, so merging stable sorted runs is itself stable. Uses a
+// binary heap of run heads: O(n log k) comparisons for k runs.
+template<class T, class Compare = std::less<T>>
+vector<T> merge_runs(const vector<span<const T>> &runs, Compare comp = Compare()) {
+	unsigned long k = runs.size();
+	unsigned long total = 0;
+	vector<unsigned long> pos(k, 0);
+	vector<unsigned long> heap;
+	heap.reserve(k);
+	for (unsigned long r = 0; r < k; r++) {
+		total += runs.data()[r].size();
+		if (!runs.data()[r].empty()) {
+			heap.push_back(r);
+		}
+	}
+
+	const span<const T>* run = runs.data();
+	unsigned long* at = pos.data();
+	// Run a goes before run b
+	auto before = [&](unsigned long a, unsigned long b) {
+		const T &x = run[a][at[a]];
+		const T &y = run[b][at[b]];
+		return comp(x, y) || (!comp(y, x) && a < b);
+	};
+	auto sift_down = [&](unsigned long i) {
+		unsigned long* h = heap.data();
+		unsigned long size = heap.size();
+		while (true) {
+			unsigned long smallest = i;
+			unsigned long left = 2 * i + 1;
+			unsigned long right = left + 1;
+			if (left < size && before(h[left], h[smallest])) {
+				smallest = left;
+			}
+			if (right < size && before(h[right], h[smallest])) {
+				smallest = right;
+			}
+			if (smallest == i) {
+				return;
+			}
+			std::swap(h[i], h[smallest]);
+			i = smallest;
+		}
+	};
+	for (unsigned long i = heap.size(); i-- > 0;) {
+		sift_down(i);
+	}
+
+	vector<T> out;
+	out.reserve(total);
+	while (!heap.empty()) {
+		unsigned long r = heap.data()[0];
+		out.push_back(run[r][at[r]++]);
+		if (at[r] == run[r].size()) {
+			heap.data()[0] = heap.data()[heap.size() - 1];
+			heap.pop_back();
+		}
+		if (!heap.empty()) {
+			sift_down(0);
+		}
+	}
+	return out;
+}
+
+
+}
+#endif
@@ -0,0 +1,334 @@
+// arena header file
+//
+// Monotonic arena for short-lived scratch memory, such as everything one
+// query allocates. Allocation bumps a pointer through the current block;
+// nothing is freed one at a time. reset() rewinds to the first block in
+// O(1), keeping every block for the next request, and destroying the arena
+// hands its blocks to this thread's arena_pool, so an arena made per
+// request reuses the previous request's memory without the allocator:
+//
+//   SL::arena arena;
+//   std::vector<float, SL::arena_allocator<float>> scores(n, 0.0f, arena);
+//
+// Blocks are powers of two from arena::options().block_size up. Each new
+// block doubles the last, and an allocation too big for that gets a block
+// of its own, so an arena holds few blocks whatever it serves. Blocks at
+// or above the large_buffer threshold are mapped with large_buffer, which
+// keeps the scratch of big requests on huge pages.
+// Each thread caches up to options().pool_bytes of free blocks; the rest
+// go back to the system.
+//
+// An arena is used by one thread at a time, and memory from it must not be
+// used after it is reset or destroyed.
+
+#ifndef SL_ARENA_H
+#define SL_ARENA_H
+
+#include "memory.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+
+namespace SL {
+
+struct arena_options {
+	unsigned long block_size = 1UL << 16;  // smallest block, a power of two
+	unsigned long pool_bytes = 1UL << 26;  // free blocks cached per thread
+};
+
+struct arena_stats {
+	unsigned long system_blocks;    // blocks taken from malloc or mmap
+	unsigned long recycled_blocks;  // blocks taken from a thread's pool
+};
+
+
+// Pool
+
+// Free blocks of one thread, a list per power of two size
+class arena_pool {
+public:
+	struct block {
+		block* next;
+		unsigned long size;  // bytes, including this header
+
+		char* begin() {
+			return (char*) (this + 1);
+		}
+
+		char* end() {
+			return (char*) this + size;
+		}
+	};
+
+	arena_pool() : cached_(0) {
+		for (block* &list : free_) {
+			list = nullptr;
+		}
+	}
+
+	arena_pool(const arena_pool &) = delete;
+	arena_pool& operator=(const arena_pool &) = delete;
+
+	~arena_pool() {
+		for (block* &list : free_) {
+			while (list != nullptr) {
+				block* b = list;
+				list = b->next;
+				free_block(b);
+			}
+		}
+	}
+
+	static arena_pool& local() {
+		static thread_local arena_pool pool;
+		return pool;
+	}
+
+	// A block of at least bytes, including its header
+	block* acquire(unsigned long bytes) {
+		unsigned long size = block_size(bytes);
+		unsigned long cls = size_class(size);
+		block* b = free_[cls];
+		if (b != nullptr) {
+			free_[cls] = b->next;
+			cached_ -= size;
+			counters().recycled.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			b = allocate_block(size);
+			counters().system.fetch_add(1, std::memory_order_relaxed);
+		}
+		b->next = nullptr;
+		return b;
+	}
+
+	void release(block* b) {
+		if (cached_ + b->size > options().pool_bytes) {
+			free_block(b);
+			return;
+		}
+		unsigned long cls = size_class(b->size);
+		b->next = free_[cls];
+		free_[cls] = b;
+		cached_ += b->size;
+	}
+
+	// Bytes of free blocks held for this thread
+	unsigned long cached() const {
+		return cached_;
+	}
+
+	static arena_options& options() {
+		static arena_options options;
+		return options;
+	}
+
+	// Process wide, over every thread
+	static arena_stats stats() {
+		return { counters().system.load(std::memory_order_relaxed),
+				counters().recycled.load(std::memory_order_relaxed) };
+	}
+
+private:
+	static constexpr unsigned long CLASSES = 64;
+
+	struct block_counters {
+		std::atomic<unsigned long> system{0};
+		std::atomic<unsigned long> recycled{0};
+	};
+
+	block* free_[CLASSES];
+	unsigned long cached_;
+
+
+	static block_counters& counters() {
+		static block_counters counters;
+		return counters;
+	}
+
+	static unsigned long block_size(unsigned long bytes) {
+		unsigned long size = options().block_size;
+		while (size < bytes) {
+			if (size > ~0UL / 2) {
+				throw "Arena allocation too large!";
+			}
+			size *= 2;
+		}
+		return size;
+	}
+
+	static unsigned long size_class(unsigned long size) {
+		return 63 - __builtin_clzl(size);
+	}
+
+	static block* allocate_block(unsigned long size) {
+		void* data;
+		if (large_buffer::is_large(size)) {
+			data = large_buffer::allocate(size);
+		} else {
+			data = std::malloc(size);
+			if (data == nullptr) {
+				throw "Arena allocation failed!";
+			}
+		}
+		block* b = (block*) data;
+		b->size = size;
+		return b;
+	}
+
+	static void free_block(block* b) {
+		if (large_buffer::is_large(b->size)) {
+			large_buffer::deallocate(b, b->size);
+		} else {
+			std::free(b);
+		}
+	}
+};
+
+
+// Arena
+
+class arena {
+public:
+	arena() : first_(nullptr), current_(nullptr), at_(0), end_(0), grow_(0) {}
+
+	arena(const arena &) = delete;
+	arena& operator=(const arena &) = delete;
+
+	~arena() {
+		arena_pool &pool = arena_pool::local();
+		while (first_ != nullptr) {
+			arena_pool::block* b = first_;
+			first_ = b->next;
+			pool.release(b);
+		}
+	}
+
+	// bytes aligned to align, a power of two
+	void* allocate(unsigned long bytes, unsigned long align = alignof(std::max_align_t)) {
+		uintptr_t p = (at_ + align - 1) & ~(uintptr_t) (align - 1);
+		if (p > end_ || bytes > end_ - p) {
+			p = next_block(bytes, align);
+		}
+		at_ = p + bytes;
+		return (void*) p;
+	}
+
+	// Frees everything allocated so far; the blocks stay for reuse
+	void reset() {
+		current_ = first_;
+		at_ = first_ ? (uintptr_t) first_->begin() : 0;
+		end_ = first_ ? (uintptr_t) first_->end() : 0;
+	}
+
+	// Bytes of the blocks held, used or not
+	unsigned long capacity() const {
+		unsigned long bytes = 0;
+		for (arena_pool::block* b = first_; b != nullptr; b = b->next) {
+			bytes += b->size;
+		}
+		return bytes;
+	}
+
+	unsigned long blocks() const {
+		unsigned long count = 0;
+		for (arena_pool::block* b = first_; b != nullptr; b = b->next) {
+			count++;
+		}
+		return count;
+	}
+
+	static arena_options& options() {
+		return arena_pool::options();
+	}
+
+	static arena_stats stats() {
+		return arena_pool::stats();
+	}
+
+private:
+	arena_pool::block* first_;
+	arena_pool::block* current_;
+	uintptr_t at_;
+	uintptr_t end_;
+	unsigned long grow_;  // size of the next regular block, doubling
+
+
+	// Moves to the block after the current one if the allocation fits,
+	// otherwise links in a new block there: twice the last regular block,
+	// or one just for this allocation if it is bigger than that
+	uintptr_t next_block(unsigned long bytes, unsigned long align) {
+		unsigned long needed = sizeof(arena_pool::block) + align + bytes;
+		if (needed < bytes) {
+			throw "Arena allocation too large!";
+		}
+		arena_pool::block* next = current_ ? current_->next : first_;
+		if (next == nullptr || next->size < needed) {
+			unsigned long size = needed;
+			if (needed <= grow_) {
+				size = grow_;
+				grow_ *= 2;
+			} else if (grow_ == 0) {
+				grow_ = options().block_size * 2;
+			}
+			arena_pool::block* b = arena_pool::local().acquire(size);
+			b->next = next;
+			if (current_) {
+				current_->next = b;
+			} else {
+				first_ = b;
+			}
+			next = b;
+		}
+		current_ = next;
+		at_ = (uintptr_t) next->begin();
+		end_ = (uintptr_t) next->end();
+		return (at_ + align - 1) & ~(uintptr_t) (align - 1);
+	}
+};
+
+
+// Standard allocator over an arena, for std containers on the query path;
+// deallocate is a no-op, the memory returns when the arena is reset
+template<class T>
+class arena_allocator {
+public:
+	typedef T value_type;
+
+	arena_allocator(arena &a) noexcept : arena_(&a) {}
+
+	template<class U>
+	arena_allocator(const arena_allocator<U> &other) noexcept : arena_(other.arena_) {}
+
+	T* allocate(std::size_t n) {
+		if (n > ~0UL / sizeof(T)) {
+			throw "Arena allocation too large!";
+		}
+		return (T*) arena_->allocate(n * sizeof(T), alignof(T));
+	}
+
+	void deallocate(T*, std::size_t) noexcept {}
+
+	arena& get_arena() const noexcept {
+		return *arena_;
+	}
+
+	template<class U>
+	bool operator==(const arena_allocator<U> &other) const noexcept {
+		return arena_ == other.arena_;
+	}
+
+	template<class U>
+	bool operator!=(const arena_allocator<U> &other) const noexcept {
+		return arena_ != other.arena_;
+	}
+
+private:
+	template<class U> friend class arena_allocator;
+
+	arena* arena_;
+};
+
+
+}
+#endif
@@ -0,0 +1,88 @@
+// Bitvector Benchmark
+//
+// Usage: bench_bitvector [documents] [passes]
+//
+// Compares a byte-per-document filter, SL::bitvector and SL::roaring_bitmap
+// on memory and on intersecting a dense filter with a sparse one, the shape
+// of "live documents AND documents matching a facet".
+
+#include "bitvector.h"
+#include "roaring.h"
+#include "vector.h"
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+using namespace SL;
+
+template<class Body>
+double time_passes(unsigned long passes, Body body);
+
+
+int main(int argc, char** argv) {
+	unsigned long docs = argc > 1 ? std::stoul(argv[1]) : 10000000;
+	unsigned long passes = argc > 2 ? std::stoul(argv[2]) : 10;
+
+	// 90% of documents live, 1% matching the facet
+	std::mt19937_64 rng(1);
+	vector<unsigned char> live_bytes(docs, 0), facet_bytes(docs, 0);
+	bitvector live_bits(docs), facet_bits(docs);
+	roaring_bitmap live_roaring, facet_roaring;
+	for (unsigned long d = 0; d < docs; d++) {
+		unsigned long r = rng() % 100;
+		if (r < 90) {
+			live_bytes[d] = 1;
+			live_bits.set(d);
+			live_roaring.add(d);
+		}
+		if (r % 50 == 7) {
+			facet_bytes[d] = 1;
+			facet_bits.set(d);
+			facet_roaring.add(d);
+		}
+	}
+
+	printf("Intersecting %lu documents (%lu live, %lu in facet)\n", docs, live_bits.count(), facet_bits.count());
+	printf("%-10s %14s %14s\n", "filter", "bytes", "ns/doc");
+
+	unsigned long matched = 0;
+	double byte_ns = time_passes(passes, [&] {
+		const unsigned char* a = live_bytes.data();
+		const unsigned char* b = facet_bytes.data();
+		for (unsigned long d = 0; d < docs; d++) {
+			matched += a[d] & b[d];
+		}
+	});
+	printf("%-10s %14lu %14.3f\n", "bytes", live_bytes.capacity() + facet_bytes.capacity(), byte_ns / docs);
+
+	double bit_ns = time_passes(passes, [&] {
+		matched += (live_bits & facet_bits).count();
+	});
+	printf("%-10s %14lu %14.3f\n", "bitvector", live_bits.memory_bytes() + facet_bits.memory_bytes(), bit_ns / docs);
+
+	double roaring_ns = time_passes(passes, [&] {
+		matched += (live_roaring & facet_roaring).cardinality();
+	});
+	printf("%-10s %14lu %14.3f\n", "roaring", live_roaring.memory_bytes() + facet_roaring.memory_bytes(),
+			roaring_ns / docs);
+
+	// Keep the results live
+	if (matched == 0) {
+		printf("\n");
+	}
+	return 0;
+}
+
+// Helper Functions
+
+// Nanoseconds per pass
+template<class Body>
+double time_passes(unsigned long passes, Body body) {
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long p = 0; p < passes; p++) {
+		body();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / passes;
+}
@@ -0,0 +1,81 @@
+// Concurrent Vector Benchmark
+//
+// Usage: bench_concurrent_vector [appends] [max threads]
+//
+// Appends a fixed number of postings split across 1, 2, 4, ... threads into
+// a mutex-guarded SL::vector and into an SL::concurrent_vector, and reports
+// throughput for each. Scaling is bounded by the cores of the machine.
+
+#include "concurrent_vector.h"
+#include "vector.h"
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace SL;
+
+struct Posting {
+	unsigned int doc;
+	unsigned int freq;
+};
+
+template<class Append>
+double run(unsigned long appends, unsigned long threads, Append append);
+
+
+int main(int argc, char** argv) {
+	unsigned long appends = argc > 1 ? std::stoul(argv[1]) : 20000000;
+	unsigned long max_threads = argc > 2 ? std::stoul(argv[2]) : 32;
+
+	printf("Appending %lu postings on %u cores\n", appends, std::thread::hardware_concurrency());
+	printf("%8s %18s %18s %8s\n", "threads", "mutex M/s", "concurrent M/s", "speedup");
+
+	for (unsigned long threads = 1; threads <= max_threads; threads *= 2) {
+		double locked;
+		{
+			vector<Posting> vec;
+			std::mutex lock;
+			locked = run(appends, threads, [&](unsigned long i) {
+				std::lock_guard<std::mutex> guard(lock);
+				vec.push_back({ (unsigned int) i, 1 });
+			});
+		}
+
+		double lock_free;
+		{
+			concurrent_vector<Posting> vec;
+			lock_free = run(appends, threads, [&](unsigned long i) {
+				vec.push_back({ (unsigned int) i, 1 });
+			});
+		}
+
+		printf("%8lu %18.1f %18.1f %7.1fx\n", threads, appends / locked / 1e6,
+				appends / lock_free / 1e6, locked / lock_free);
+	}
+
+	return 0;
+}
+
+// Helper Functions
+
+template<class Append>
+double run(unsigned long appends, unsigned long threads, Append append) {
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread workers[64];
+	for (unsigned long t = 0; t < threads; t++) {
+		workers[t] = std::thread([&, t] {
+			for (unsigned long i = t; i < appends; i += threads) {
+				append(i);
+			}
+		});
+	}
+	for (unsigned long t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
@@ -0,0 +1,92 @@
+// Growth Benchmark
+//
+// Usage: bench_growth [megabytes]
+//
+// Fills an SL::vector with push_back until it holds the given amount of data,
+// once with a trivially relocatable element (grown by realloc/mremap) and
+// once with an equivalent element that must be copied on growth. Each fill
+// runs in its own child process so its peak RSS can be reported on its own.
+
+#include "vector.h"
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <string>
+
+using namespace SL;
+
+// Same layout as int, but growth has to copy it element by element
+struct Copied {
+	int val;
+
+	Copied() : val(0) {}
+	Copied(int v) : val(v) {}
+	Copied(const Copied &other) : val(other.val) {}
+	Copied& operator=(const Copied &other) {
+		val = other.val;
+		return *this;
+	}
+};
+
+int value(int val);
+int value(const Copied &val);
+template<class T>
+void fill(unsigned long count);
+template<class T>
+void run(const char* name, unsigned long megabytes);
+
+
+int main(int argc, char** argv) {
+	unsigned long megabytes = argc > 1 ? std::stoul(argv[1]) : 1024;
+
+	printf("Filling %lu MB with push_back\n", megabytes);
+	printf("%-14s %10s %14s %10s\n", "element", "seconds", "peak RSS MB", "peak/data");
+
+	run<int>("relocatable", megabytes);
+	run<Copied>("copied", megabytes);
+
+	return 0;
+}
+
+// Helper Functions
+
+int value(int val) {
+	return val;
+}
+
+int value(const Copied &val) {
+	return val.val;
+}
+
+template<class T>
+void fill(unsigned long count) {
+	vector<T> vec;
+	for (unsigned long i = 0; i < count; i++) {
+		vec.push_back((int) i);
+	}
+	if (value(vec[count - 1]) != (int) (count - 1)) {
+		printf("Wrong value\n");
+	}
+}
+
+template<class T>
+void run(const char* name, unsigned long megabytes) {
+	unsigned long count = megabytes * (1UL << 20) / sizeof(T);
+
+	auto start = std::chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (pid == 0) {
+		fill<T>(count);
+		_exit(0);
+	}
+
+	int status;
+	rusage usage;
+	wait4(pid, &status, 0, &usage);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double peak = usage.ru_maxrss / 1024.0;
+	printf("%-14s %10.2f %14.0f %10.2f%s\n", name, elapsed.count(), peak, peak / megabytes,
+			WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "" : "  (failed)");
+}
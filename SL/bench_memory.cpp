@@ -0,0 +1,121 @@
+// Memory Benchmark
+//
+// Usage: bench_memory [megabytes] [lookups]
+//
+// Scores randomly chosen document vectors out of one large SL::vector<float>,
+// once with storage from new[] (4 KB pages) and once from large_buffer
+// (transparent huge pages), and reports time and data-TLB misses per lookup.
+// TLB misses are read with perf_event_open and show as n/a where the kernel
+// or hypervisor does not expose the counter.
+
+#include "vector.h"
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace SL;
+
+const unsigned long DIM = 16;
+
+int open_tlb_counter();
+long read_counter(int fd);
+unsigned long anon_huge_kb();
+void run(const char* name, unsigned long floats, unsigned long lookups);
+
+
+int main(int argc, char** argv) {
+	unsigned long megabytes = argc > 1 ? std::stoul(argv[1]) : 1024;
+	unsigned long lookups = argc > 2 ? std::stoul(argv[2]) : 10000000;
+	unsigned long floats = megabytes * (1UL << 20) / sizeof(float);
+
+	printf("Scoring %lu random %lu-dim vectors out of %lu MB\n", lookups, DIM, megabytes);
+	printf("%-14s %10s %14s %14s\n", "storage", "ns/lookup", "dTLB miss/op", "huge pages MB");
+
+	large_buffer::options().threshold = ~0UL;
+	run("new[]", floats, lookups);
+
+	large_buffer::options().threshold = 1UL << 21;
+	run("large_buffer", floats, lookups);
+
+	return 0;
+}
+
+// Helper Functions
+
+void run(const char* name, unsigned long floats, unsigned long lookups) {
+	vector<float> docs;
+	docs.resize(floats, 0.5f);
+	float query[DIM];
+	for (unsigned long d = 0; d < DIM; d++) {
+		query[d] = d * 0.25f;
+	}
+
+	unsigned long huge_mb = anon_huge_kb() / 1024;
+	unsigned long rows = floats / DIM;
+	const float* data = docs.data();
+	int fd = open_tlb_counter();
+
+	auto start = std::chrono::steady_clock::now();
+	long misses_start = read_counter(fd);
+	uint64_t state = 88172645463325252ULL;
+	float total = 0;
+	for (unsigned long i = 0; i < lookups; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		const float* row = data + (state % rows) * DIM;
+		float score = 0;
+		for (unsigned long d = 0; d < DIM; d++) {
+			score += row[d] * query[d];
+		}
+		total += score;
+	}
+	long misses = read_counter(fd) - misses_start;
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	char tlb[32] = "n/a";
+	if (fd >= 0) {
+		snprintf(tlb, sizeof(tlb), "%.3f", (double) misses / lookups);
+		close(fd);
+	}
+	printf("%-14s %10.2f %14s %14lu %s\n", name, elapsed.count() / lookups, tlb, huge_mb,
+			total < 0 ? "!" : "");
+}
+
+int open_tlb_counter() {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+long read_counter(int fd) {
+	long val = 0;
+	if (fd >= 0 && read(fd, &val, sizeof(val)) != sizeof(val)) {
+		val = 0;
+	}
+	return val;
+}
+
+// Anonymous memory of this process currently backed by huge pages
+unsigned long anon_huge_kb() {
+	std::ifstream smaps("/proc/self/smaps_rollup");
+	std::string key;
+	unsigned long kb;
+	std::getline(smaps, key);
+	while (smaps >> key >> kb) {
+		if (key == "AnonHugePages:") {
+			return kb;
+		}
+		smaps.ignore(256, '\n');
+	}
+	return 0;
+}
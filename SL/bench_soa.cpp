@@ -0,0 +1,100 @@
+// SoA Vector Benchmark
+//
+// Usage: bench_soa [records] [passes]
+//
+// Runs the same two scoring kernels over (docID, score, norm, url offset)
+// records stored as an SL::vector of structs and as an SL::soa_vector:
+// a filter that reads docID and score, and a sum over score alone.
+
+#include "soa_vector.h"
+#include "vector.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+using namespace SL;
+
+struct Record {
+	unsigned int doc;
+	float score;
+	float norm;
+	unsigned long url_offset;
+};
+
+typedef soa_vector<unsigned int, float, float, unsigned long> Records;
+
+template<class Body>
+double time_passes(unsigned long passes, Body body);
+
+
+int main(int argc, char** argv) {
+	unsigned long count = argc > 1 ? std::stoul(argv[1]) : 10000000;
+	unsigned long passes = argc > 2 ? std::stoul(argv[2]) : 10;
+
+	vector<Record> aos;
+	Records soa;
+	aos.reserve(count);
+	soa.reserve(count);
+	for (unsigned long i = 0; i < count; i++) {
+		float score = (i * 2654435761UL % 1000) / 1000.0f;
+		aos.push_back({ (unsigned int) i, score, 1.0f, i * 40 });
+		soa.push_back((unsigned int) i, score, 1.0f, i * 40);
+	}
+
+	printf("Scoring %lu records (%lu bytes as struct, %lu bytes of docID + score)\n",
+			count, sizeof(Record), sizeof(unsigned int) + sizeof(float));
+	printf("%-10s %14s %14s %8s\n", "kernel", "struct ns/rec", "soa ns/rec", "speedup");
+
+	unsigned long matched = 0;
+	const Record* records = aos.data();
+	double aos_filter = time_passes(passes, [&] {
+		for (unsigned long i = 0; i < count; i++) {
+			if (records[i].score > 0.9f) {
+				matched += records[i].doc;
+			}
+		}
+	});
+	const unsigned int* docs = soa.data<0>();
+	const float* scores = soa.data<1>();
+	double soa_filter = time_passes(passes, [&] {
+		for (unsigned long i = 0; i < count; i++) {
+			if (scores[i] > 0.9f) {
+				matched += docs[i];
+			}
+		}
+	});
+	printf("%-10s %14.3f %14.3f %7.1fx\n", "filter", aos_filter / count, soa_filter / count, aos_filter / soa_filter);
+
+	float total = 0;
+	double aos_sum = time_passes(passes, [&] {
+		for (unsigned long i = 0; i < count; i++) {
+			total += records[i].score;
+		}
+	});
+	span<const float> column = ((const Records &) soa).column<1>();
+	double soa_sum = time_passes(passes, [&] {
+		for (float score : column) {
+			total += score;
+		}
+	});
+	printf("%-10s %14.3f %14.3f %7.1fx\n", "sum", aos_sum / count, soa_sum / count, aos_sum / soa_sum);
+
+	// Keep the results live
+	if (matched == 0 && total == 0) {
+		printf("\n");
+	}
+	return 0;
+}
+
+// Helper Functions
+
+// Nanoseconds per pass
+template<class Body>
+double time_passes(unsigned long passes, Body body) {
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned long p = 0; p < passes; p++) {
+		body();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / passes;
+}
@@ -0,0 +1,104 @@
+// Sort Benchmark
+//
+// Usage: bench_sort [pairs] [threads]
+//
+// Sorts (termID, docID) pairs packed into 64-bit keys, the shape of
+// postings construction, with std::sort, std::sort(std::execution::par),
+// SL::radix_sort and SL::parallel_sort, then merges 64 sorted runs with
+// SL::merge_runs. Each sort starts from the same shuffled copy.
+
+#include "algorithm.h"
+#include "thread_pool.h"
+#include "vector.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#if __has_include(<execution>)
+#include <execution>
+#endif
+
+using namespace SL;
+
+template<class Body>
+double time_once(Body body);
+void report(const char* name, double ns, unsigned long count, double baseline);
+
+
+int main(int argc, char** argv) {
+	unsigned long count = argc > 1 ? std::stoul(argv[1]) : 20000000;
+	unsigned long threads = argc > 2 ? std::stoul(argv[2]) : std::max(std::thread::hardware_concurrency(), 1U);
+
+	// 2^20 terms with Zipf-ish frequencies, docIDs below 2^26
+	std::mt19937_64 rng(1);
+	vector<uint64_t> input;
+	input.reserve(count);
+	for (unsigned long i = 0; i < count; i++) {
+		uint64_t term = (rng() % (1UL << 20)) * (rng() % (1UL << 20)) >> 20;
+		uint64_t doc = rng() % (1UL << 26);
+		input.push_back(term << 32 | doc);
+	}
+
+	printf("Sorting %lu (termID, docID) pairs with %lu threads\n", count, threads);
+	printf("%-22s %10s %10s %8s\n", "algorithm", "ms", "ns/pair", "speedup");
+
+	vector<uint64_t> keys(input);
+	double std_ns = time_once([&] { std::sort(keys.data(), keys.data() + count); });
+	report("std::sort", std_ns, count, std_ns);
+	vector<uint64_t> expected(keys);
+
+#if defined(__cpp_lib_parallel_algorithm)
+	keys = input;
+	double par_ns = time_once([&] { std::sort(std::execution::par, keys.data(), keys.data() + count); });
+	report("std::sort(par)", par_ns, count, std_ns);
+#endif
+
+	keys = input;
+	double radix_ns = time_once([&] { radix_sort(keys); });
+	report("SL::radix_sort", radix_ns, count, std_ns);
+	if (!std::equal(keys.data(), keys.data() + count, expected.data())) {
+		printf("radix_sort mismatch!\n");
+		return 1;
+	}
+
+	thread_pool pool(threads - 1);
+	keys = input;
+	double sample_ns = time_once([&] { parallel_sort(keys, pool); });
+	report("SL::parallel_sort", sample_ns, count, std_ns);
+	if (!std::equal(keys.data(), keys.data() + count, expected.data())) {
+		printf("parallel_sort mismatch!\n");
+		return 1;
+	}
+
+	// Merge 64 sorted runs, as after spilling sorted blocks
+	const unsigned long RUNS = 64;
+	keys = input;
+	vector<span<const uint64_t>> runs;
+	unsigned long run_size = (count + RUNS - 1) / RUNS;
+	for (unsigned long begin = 0; begin < count; begin += run_size) {
+		unsigned long size = std::min(run_size, count - begin);
+		std::sort(keys.data() + begin, keys.data() + begin + size);
+		runs.push_back(span<const uint64_t>(keys.data() + begin, size));
+	}
+	vector<uint64_t> merged;
+	double merge_ns = time_once([&] { merged = merge_runs(runs); });
+	report("SL::merge_runs (64)", merge_ns, count, std_ns);
+
+	return 0;
+}
+
+// Helper Functions
+
+template<class Body>
+double time_once(Body body) {
+	auto start = std::chrono::steady_clock::now();
+	body();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void report(const char* name, double ns, unsigned long count, double baseline) {
+	printf("%-22s %10.1f %10.2f %7.2fx\n", name, ns / 1e6, ns / count, baseline / ns);
+}
@@ -0,0 +1,94 @@
+// Vector Benchmark
+//
+// Usage: bench_vector [elements]
+//
+// Times the common growth and traversal patterns of SL::vector and reports
+// the allocations and element copies each one costs, so a regression shows
+// up both as time and as work.
+
+#include "vector.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+using namespace SL;
+using SL::test::AllocScope;
+using SL::test::Tracked;
+
+template<class Body>
+void run(const char* name, unsigned long count, Body body);
+
+
+int main(int argc, char** argv) {
+	unsigned long count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	printf("Running vector benchmarks with %lu elements\n", count);
+	printf("%-20s %10s %12s %10s %12s\n", "operation", "ns/elem", "allocations", "MB", "copies/elem");
+
+	run("push_back", count, [count] {
+		vector<Tracked> vec;
+		for (unsigned long i = 0; i < count; i++) {
+			vec.push_back((int) i);
+		}
+	});
+
+	run("reserve+push_back", count, [count] {
+		vector<Tracked> vec;
+		vec.reserve(count);
+		for (unsigned long i = 0; i < count; i++) {
+			vec.push_back((int) i);
+		}
+	});
+
+	vector<Tracked> original(count, Tracked(1));
+
+	run("copy", count, [&original] {
+		vector<Tracked> copy(original);
+	});
+
+	run("iterate", count, [&original] {
+		long sum = 0;
+		for (auto itr = original.begin(); itr != original.end(); itr++) {
+			sum += (*itr).val();
+		}
+		if (sum < 0) {
+			printf("unreachable\n");
+		}
+	});
+
+	run("index", count, [&original, count] {
+		long sum = 0;
+		for (unsigned long i = 0; i < count; i++) {
+			sum += original[i].val();
+		}
+		if (sum < 0) {
+			printf("unreachable\n");
+		}
+	});
+
+	run("pop_back", count, [count] {
+		vector<Tracked> vec;
+		vec.reserve(count);
+		vec.resize(count);
+		while (!vec.empty()) {
+			vec.pop_back();
+		}
+	});
+
+	return 0;
+}
+
+// Helper Functions
+
+template<class Body>
+void run(const char* name, unsigned long count, Body body) {
+	Tracked::reset();
+	AllocScope scope;
+
+	auto start = std::chrono::steady_clock::now();
+	body();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	printf("%-20s %10.2f %12lu %10.1f %12.2f\n", name, elapsed.count() / count,
+			scope.allocations(), scope.bytes() / 1048576.0, (double) Tracked::copies() / count);
+}
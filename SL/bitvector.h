@@ -0,0 +1,384 @@
+// bitvector header file
+//
+// Bit-packed set over [0, size()), one bit per element, for document
+// filters and deletion marks. Whole-vector AND/OR/ANDNOT and popcount run
+// a word (or with AVX2, 256 bits) at a time. rank_select adds constant-time
+// rank and near-constant-time select on top of a finished bitvector.
+//
+// bitvector and roaring_bitmap (roaring.h) share the filter interface used
+// by postings traversals:
+//
+//   contains(doc)  - is doc in the set
+//   next(doc)      - smallest member >= doc, or NPOS
+
+#ifndef SL_BITVECTOR_H
+#define SL_BITVECTOR_H
+
+#include "vector.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace SL {
+
+class bitvector {
+public:
+	static constexpr unsigned long NPOS = ~0UL;
+	static constexpr unsigned long WORD_BITS = 64;
+
+	// Constructors
+	bitvector() : size_(0) {}
+
+	explicit bitvector(unsigned long size, bool val = false) : size_(0) {
+		resize(size, val);
+	}
+
+
+	// Capacity
+	unsigned long size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	unsigned long word_count() const {
+		return words_.size();
+	}
+
+	unsigned long memory_bytes() const {
+		return words_.capacity() * sizeof(uint64_t);
+	}
+
+	void resize(unsigned long size, bool val = false) {
+		if (size > size_ && val && size_ % WORD_BITS != 0) {
+			// Fill the rest of the current last word before adding new ones
+			words_.data()[size_ / WORD_BITS] |= ~0ULL << (size_ % WORD_BITS);
+		}
+		words_.resize((size + WORD_BITS - 1) / WORD_BITS, val ? ~0ULL : 0ULL);
+		size_ = size;
+		clear_tail();
+	}
+
+
+	// Accessors
+	bool test(unsigned long index) const {
+		if (index >= size_) {
+			throw "Out of range exception!";
+		}
+		return (words_.data()[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+	}
+
+	bool operator[](unsigned long index) const {
+		return test(index);
+	}
+
+	bool contains(unsigned long index) const {
+		return index < size_ && ((words_.data()[index / WORD_BITS] >> (index % WORD_BITS)) & 1);
+	}
+
+	// Smallest set bit >= index, or NPOS
+	unsigned long next(unsigned long index) const {
+		if (index >= size_) {
+			return NPOS;
+		}
+		const uint64_t* words = words_.data();
+		unsigned long w = index / WORD_BITS;
+		uint64_t word = words[w] & (~0ULL << (index % WORD_BITS));
+		while (word == 0) {
+			if (++w == words_.size()) {
+				return NPOS;
+			}
+			word = words[w];
+		}
+		return w * WORD_BITS + __builtin_ctzll(word);
+	}
+
+	const uint64_t* data() const noexcept {
+		return words_.data();
+	}
+
+	uint64_t* data() noexcept {
+		return words_.data();
+	}
+
+	// Number of set bits
+	unsigned long count() const {
+		return popcount(words_.data(), words_.size());
+	}
+
+
+	// Modifiers
+	void set(unsigned long index) {
+		check(index);
+		words_.data()[index / WORD_BITS] |= 1ULL << (index % WORD_BITS);
+	}
+
+	void reset(unsigned long index) {
+		check(index);
+		words_.data()[index / WORD_BITS] &= ~(1ULL << (index % WORD_BITS));
+	}
+
+	void assign(unsigned long index, bool val) {
+		if (val) {
+			set(index);
+		} else {
+			reset(index);
+		}
+	}
+
+	void set_all() {
+		uint64_t* words = words_.data();
+		for (unsigned long w = 0; w < words_.size(); w++) {
+			words[w] = ~0ULL;
+		}
+		clear_tail();
+	}
+
+	void reset_all() {
+		uint64_t* words = words_.data();
+		for (unsigned long w = 0; w < words_.size(); w++) {
+			words[w] = 0;
+		}
+	}
+
+	// Set operations; both operands must have the same size
+	bitvector& operator&=(const bitvector &other) {
+		combine(other, AND);
+		return *this;
+	}
+
+	bitvector& operator|=(const bitvector &other) {
+		combine(other, OR);
+		return *this;
+	}
+
+	// Removes the members of other
+	bitvector& and_not(const bitvector &other) {
+		combine(other, AND_NOT);
+		return *this;
+	}
+
+	friend bitvector operator&(bitvector lhs, const bitvector &rhs) {
+		return lhs &= rhs;
+	}
+
+	friend bitvector operator|(bitvector lhs, const bitvector &rhs) {
+		return lhs |= rhs;
+	}
+
+	bool operator==(const bitvector &other) const {
+		if (size_ != other.size_) {
+			return false;
+		}
+		for (unsigned long w = 0; w < words_.size(); w++) {
+			if (words_.data()[w] != other.words_.data()[w]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool operator!=(const bitvector &other) const {
+		return !(*this == other);
+	}
+
+
+	static unsigned long popcount(const uint64_t* words, unsigned long n) {
+		unsigned long total = 0;
+		unsigned long w = 0;
+#ifdef __AVX2__
+		// Nibble lookup popcount, summed per 64-bit lane with SAD
+		const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+				0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low_mask = _mm256_set1_epi8(0x0f);
+		__m256i acc = _mm256_setzero_si256();
+		uint64_t last[4] = { 0, 0, 0, 0 };
+		for (; w < n; w += 4) {
+			// The last partial block is counted from a zero padded copy, so
+			// there is no scalar tail loop. GCC 12 at -O3 with AVX-512
+			// VPOPCNTDQ vectorizes that loop and miscounts short vectors.
+			const uint64_t* block = words + w;
+			if (n - w < 4) {
+				std::memcpy(last, block, (n - w) * sizeof(uint64_t));
+				block = last;
+			}
+			__m256i v = _mm256_loadu_si256((const __m256i*) block);
+			__m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask));
+			__m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+		}
+		uint64_t lanes[4];
+		_mm256_storeu_si256((__m256i*) lanes, acc);
+		total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+		for (; w < n; w++) {
+			total += __builtin_popcountll(words[w]);
+		}
+#endif
+		return total;
+	}
+
+private:
+	enum Op { AND, OR, AND_NOT };
+
+	vector<uint64_t> words_;
+	unsigned long size_;
+
+
+	void check(unsigned long index) const {
+		if (index >= size_) {
+			throw "Out of range exception!";
+		}
+	}
+
+	// Bits past size_ in the last word stay zero so count() and next() can
+	// work on whole words
+	void clear_tail() {
+		if (size_ % WORD_BITS != 0) {
+			words_.data()[size_ / WORD_BITS] &= (1ULL << (size_ % WORD_BITS)) - 1;
+		}
+	}
+
+	void combine(const bitvector &other, Op op) {
+		if (size_ != other.size_) {
+			throw "Bitvector sizes differ!";
+		}
+
+		uint64_t* dst = words_.data();
+		const uint64_t* src = other.words_.data();
+		unsigned long n = words_.size();
+		unsigned long w = 0;
+#ifdef __AVX2__
+		// Bounded by the whole blocks rather than w + 4 <= n, which GCC
+		// cannot prove free of wraparound and warns about in the tail loop
+		for (unsigned long blocks = n / 4 * 4; w < blocks; w += 4) {
+			__m256i a = _mm256_loadu_si256((const __m256i*) (dst + w));
+			__m256i b = _mm256_loadu_si256((const __m256i*) (src + w));
+			__m256i r = op == AND ? _mm256_and_si256(a, b)
+					: op == OR ? _mm256_or_si256(a, b)
+					: _mm256_andnot_si256(b, a);
+			_mm256_storeu_si256((__m256i*) (dst + w), r);
+		}
+#endif
+		for (; w < n; w++) {
+			dst[w] = op == AND ? dst[w] & src[w]
+					: op == OR ? dst[w] | src[w]
+					: dst[w] & ~src[w];
+		}
+	}
+};
+
+
+// Rank and select over a bitvector that no longer changes. Rank uses a
+// 64-bit count per 512-bit superblock plus a 16-bit count per word (37.5%
+// over the bits); select keeps the superblock of every 512th set bit.
+class rank_select {
+public:
+	static constexpr unsigned long NPOS = bitvector::NPOS;
+
+	// Constructors
+	rank_select() : bits_(nullptr), ones_(0) {}
+
+	explicit rank_select(const bitvector &bits) : bits_(&bits), ones_(0) {
+		const uint64_t* words = bits.data();
+		unsigned long n = bits.word_count();
+
+		superblocks_.reserve(n / WORDS_PER_SUPERBLOCK + 1);
+		blocks_.reserve(n);
+		unsigned long relative = 0;
+		for (unsigned long w = 0; w < n; w++) {
+			if (w % WORDS_PER_SUPERBLOCK == 0) {
+				superblocks_.push_back(ones_);
+				relative = 0;
+			}
+			blocks_.push_back((uint16_t) relative);
+
+			unsigned long ones = __builtin_popcountll(words[w]);
+			while (select_samples_.size() * SELECT_SAMPLE < ones_ + ones) {
+				select_samples_.push_back(w / WORDS_PER_SUPERBLOCK);
+			}
+			ones_ += ones;
+			relative += ones;
+		}
+		superblocks_.push_back(ones_);
+	}
+
+
+	// Set bits in [0, index)
+	unsigned long rank1(unsigned long index) const {
+		if (index == bits_->size()) {
+			return ones_;
+		}
+		if (index > bits_->size()) {
+			throw "Out of range exception!";
+		}
+		unsigned long w = index / bitvector::WORD_BITS;
+		uint64_t mask = (1ULL << (index % bitvector::WORD_BITS)) - 1;
+		return superblocks_.data()[w / WORDS_PER_SUPERBLOCK] + blocks_.data()[w]
+				+ __builtin_popcountll(bits_->data()[w] & mask);
+	}
+
+	// Clear bits in [0, index)
+	unsigned long rank0(unsigned long index) const {
+		return index - rank1(index);
+	}
+
+	// Position of the set bit with the given rank (0-based), or NPOS
+	unsigned long select1(unsigned long rank) const {
+		if (rank >= ones_) {
+			return NPOS;
+		}
+
+		// The sample bounds the superblock; scan superblocks, then words
+		unsigned long sb = select_samples_.data()[rank / SELECT_SAMPLE];
+		const unsigned long* supers = superblocks_.data();
+		while (supers[sb + 1] <= rank) {
+			sb++;
+		}
+
+		const uint64_t* words = bits_->data();
+		unsigned long w = sb * WORDS_PER_SUPERBLOCK;
+		unsigned long remaining = rank - supers[sb];
+		unsigned long ones = __builtin_popcountll(words[w]);
+		while (ones <= remaining) {
+			remaining -= ones;
+			ones = __builtin_popcountll(words[++w]);
+		}
+		return w * bitvector::WORD_BITS + select_in_word(words[w], remaining);
+	}
+
+	unsigned long ones() const {
+		return ones_;
+	}
+
+	unsigned long memory_bytes() const {
+		return superblocks_.capacity() * sizeof(unsigned long) + blocks_.capacity() * sizeof(uint16_t)
+				+ select_samples_.capacity() * sizeof(unsigned long);
+	}
+
+private:
+	static constexpr unsigned long WORDS_PER_SUPERBLOCK = 8;
+	static constexpr unsigned long SELECT_SAMPLE = 512;
+
+	const bitvector* bits_;
+	unsigned long ones_;
+	vector<unsigned long> superblocks_;   // set bits before each superblock
+	vector<uint16_t> blocks_;             // set bits before each word, within its superblock
+	vector<unsigned long> select_samples_; // superblock of every SELECT_SAMPLE-th set bit
+
+	static unsigned long select_in_word(uint64_t word, unsigned long rank) {
+		for (unsigned long i = 0; i < rank; i++) {
+			word &= word - 1;
+		}
+		return __builtin_ctzll(word);
+	}
+};
+
+
+}
+#endif
@@ -0,0 +1,237 @@
+// concurrent_vector header file
+//
+// Append-only vector that many threads can grow at once. Appends reserve
+// their slots with a single atomic fetch_add and construct the elements in
+// place, without locks. Storage is a list of segments that double in size
+// and never move, so references and pointers to elements stay valid for
+// the life of the container.
+//
+// An element may be read once the write that appended it happens-before
+// the read (for example after joining the appending thread, or through
+// another synchronizing handoff). size() counts reserved slots, which can
+// include elements whose construction is still in progress on another
+// thread.
+
+#ifndef SL_CONCURRENT_VECTOR_H
+#define SL_CONCURRENT_VECTOR_H
+
+#include "memory.h"
+#include <atomic>
+#include <new>
+#include <utility>
+
+namespace SL {
+
+template<class T>
+class concurrent_vector {
+public:
+	// Constructors
+	concurrent_vector() : size_(0) {
+		for (unsigned long i = 0; i < SEGMENT_COUNT; i++) {
+			segments_[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	concurrent_vector(unsigned long length, const T& val) : concurrent_vector() {
+		grow_by(length, val);
+	}
+
+	concurrent_vector(const concurrent_vector &) = delete;
+	concurrent_vector& operator=(const concurrent_vector &) = delete;
+
+
+	// Destructor
+	~concurrent_vector() {
+		unsigned long size = size_.load(std::memory_order_relaxed);
+		for (unsigned long i = 0; i < size; i++) {
+			element(i).~T();
+		}
+
+		for (unsigned long seg = 0; seg < SEGMENT_COUNT; seg++) {
+			T* segment = segments_[seg].load(std::memory_order_relaxed);
+			if (segment != nullptr) {
+				free_segment(segment, seg);
+			}
+		}
+	}
+
+
+	// Capacity
+	unsigned long size() const {
+		return size_.load(std::memory_order_acquire);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	// Slots in allocated segments
+	unsigned long capacity() const {
+		unsigned long capacity = 0;
+		for (unsigned long seg = 0; seg < SEGMENT_COUNT; seg++) {
+			if (segments_[seg].load(std::memory_order_acquire) != nullptr) {
+				capacity += segment_size(seg);
+			}
+		}
+		return capacity;
+	}
+
+	// Allocates the segments needed to hold n elements ahead of time
+	void reserve(unsigned long n) {
+		if (n == 0) {
+			return;
+		}
+		for (unsigned long seg = 0; seg <= segment_of(n - 1); seg++) {
+			segment(seg);
+		}
+	}
+
+
+	// Accessors
+	T& operator[](unsigned long index) {
+		return element(index);
+	}
+
+	const T& operator[](unsigned long index) const {
+		return element(index);
+	}
+
+	T& at(unsigned long index) {
+		if (index >= size()) {
+			throw "Out of range exception!";
+		}
+		return element(index);
+	}
+
+	const T& at(unsigned long index) const {
+		if (index >= size()) {
+			throw "Out of range exception!";
+		}
+		return element(index);
+	}
+
+
+	// Modifiers
+
+	// Appends val and returns its index
+	unsigned long push_back(const T& val) {
+		unsigned long index = size_.fetch_add(1, std::memory_order_acq_rel);
+		new (slot(index)) T(val);
+		return index;
+	}
+
+	unsigned long push_back(T&& val) {
+		unsigned long index = size_.fetch_add(1, std::memory_order_acq_rel);
+		new (slot(index)) T(std::move(val));
+		return index;
+	}
+
+	template<class... Args>
+	unsigned long emplace_back(Args&&... args) {
+		unsigned long index = size_.fetch_add(1, std::memory_order_acq_rel);
+		new (slot(index)) T(std::forward<Args>(args)...);
+		return index;
+	}
+
+	// Appends n default constructed elements and returns the index of the
+	// first; the range is contiguous in index space but may span segments
+	unsigned long grow_by(unsigned long n) {
+		unsigned long start = size_.fetch_add(n, std::memory_order_acq_rel);
+		for (unsigned long i = start; i < start + n; i++) {
+			new (slot(i)) T();
+		}
+		return start;
+	}
+
+	unsigned long grow_by(unsigned long n, const T& val) {
+		unsigned long start = size_.fetch_add(n, std::memory_order_acq_rel);
+		for (unsigned long i = start; i < start + n; i++) {
+			new (slot(i)) T(val);
+		}
+		return start;
+	}
+
+
+	// Segment layout, exposed for bulk processing: indices
+	// [segment_start(seg), segment_start(seg) + segment_size(seg)) are
+	// contiguous in memory
+	static unsigned long segment_of(unsigned long index) {
+		unsigned long high = index >> FIRST_SEGMENT_BITS;
+		return high == 0 ? 0 : 64 - __builtin_clzl(high);
+	}
+
+	static unsigned long segment_start(unsigned long seg) {
+		return seg == 0 ? 0 : FIRST_SEGMENT_SIZE << (seg - 1);
+	}
+
+	static unsigned long segment_size(unsigned long seg) {
+		return seg == 0 ? FIRST_SEGMENT_SIZE : FIRST_SEGMENT_SIZE << (seg - 1);
+	}
+
+
+private:
+	static constexpr unsigned long FIRST_SEGMENT_BITS = 6;
+	static constexpr unsigned long FIRST_SEGMENT_SIZE = 1UL << FIRST_SEGMENT_BITS;
+	static constexpr unsigned long SEGMENT_COUNT = 64 - FIRST_SEGMENT_BITS + 1;
+
+	// Kept apart from the segment table so appends do not invalidate the
+	// line readers use to find segments
+	alignas(64) std::atomic<unsigned long> size_;
+	alignas(64) std::atomic<T*> segments_[SEGMENT_COUNT];
+
+
+	T& element(unsigned long index) const {
+		unsigned long seg = segment_of(index);
+		return segments_[seg].load(std::memory_order_acquire)[index - segment_start(seg)];
+	}
+
+	// Storage for a reserved index, allocating its segment if needed
+	void* slot(unsigned long index) {
+		unsigned long seg = segment_of(index);
+		return segment(seg) + (index - segment_start(seg));
+	}
+
+	// Racing threads may each allocate the segment; one installs it and the
+	// others free theirs
+	T* segment(unsigned long seg) {
+		T* segment = segments_[seg].load(std::memory_order_acquire);
+		if (segment != nullptr) {
+			return segment;
+		}
+
+		T* fresh = allocate_segment(seg);
+		if (segments_[seg].compare_exchange_strong(segment, fresh, std::memory_order_acq_rel)) {
+			return fresh;
+		}
+		free_segment(fresh, seg);
+		return segment;
+	}
+
+	// Segments of a huge page or more are mapped by large_buffer. This is
+	// decided by size alone, not the process-wide threshold, so freeing
+	// always agrees with allocation.
+	static bool is_large_segment(unsigned long bytes) {
+		return bytes >= large_buffer::HUGE_PAGE_SIZE;
+	}
+
+	static T* allocate_segment(unsigned long seg) {
+		unsigned long bytes = segment_size(seg) * sizeof(T);
+		if (is_large_segment(bytes)) {
+			return (T*) large_buffer::allocate(bytes);
+		}
+		return (T*) ::operator new(bytes);
+	}
+
+	static void free_segment(T* segment, unsigned long seg) {
+		unsigned long bytes = segment_size(seg) * sizeof(T);
+		if (is_large_segment(bytes)) {
+			large_buffer::deallocate(segment, bytes);
+		} else {
+			::operator delete(segment);
+		}
+	}
+};
+
+
+}
+#endif
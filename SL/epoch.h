@@ -0,0 +1,288 @@
+// epoch header file
+//
+// Epoch-based reclamation. Readers pin the current epoch while they hold
+// pointers into shared structures; writers unlink objects and retire them,
+// and a retired object is freed once every reader that could still see it
+// has unpinned. Pinning is a load and a store to the thread's own slot plus
+// a compiler fence; the matching hardware fence is issued by reclaiming
+// writers through membarrier(2), or by readers themselves on kernels
+// without it. Readers never perform an atomic read-modify-write.
+//
+//   epoch_guard   - RAII pin, may nest
+//   epoch         - retire(), reclaim() and synchronize() for writers
+//   snapshot<T>   - atomically swappable pointer whose replaced values are
+//                   retired, e.g. the live index while a rebuilt one is
+//                   installed
+
+#ifndef SL_EPOCH_H
+#define SL_EPOCH_H
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SL {
+
+class epoch {
+public:
+	// Retired objects a writer lets pile up before reclaiming on its own
+	static constexpr unsigned long RECLAIM_BATCH = 64;
+
+	static void pin() {
+		ThreadRecord &record = local();
+		if (record.depth++ > 0) {
+			return;
+		}
+
+		Registry &registry = Registry::get();
+		record.epoch.store(registry.global.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		// Order the store before the reads that follow. Against a writer's
+		// membarrier a compiler fence suffices.
+		if (registry.asymmetric) {
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		} else {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	static void unpin() {
+		ThreadRecord &record = local();
+		if (--record.depth == 0) {
+			record.epoch.store(QUIESCENT, std::memory_order_release);
+		}
+	}
+
+	static bool pinned() {
+		return local().depth > 0;
+	}
+
+	// Frees ptr with delete once no reader can hold it. The caller must
+	// already have made ptr unreachable for new readers.
+	template<class T>
+	static void retire(T* ptr) {
+		retire(ptr, [](void* p) { delete (T*) p; });
+	}
+
+	static void retire(void* ptr, void (*deleter)(void*)) {
+		Registry &registry = Registry::get();
+		unsigned long pending;
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.retired.push_back({ registry.global.load(), ptr, deleter });
+			pending = registry.retired.size();
+		}
+		if (pending >= RECLAIM_BATCH) {
+			reclaim();
+		}
+	}
+
+	// Frees every retired object no pinned reader can hold; returns how many
+	static unsigned long reclaim() {
+		Registry &registry = Registry::get();
+		std::vector<Retired> ready;
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			uint64_t oldest = registry.global.fetch_add(1) + 1;
+			registry.barrier();
+			for (ThreadRecord* record : registry.threads) {
+				uint64_t pinned = record->epoch.load(std::memory_order_acquire);
+				if (pinned != QUIESCENT) {
+					oldest = std::min(oldest, pinned);
+				}
+			}
+
+			// Readers pinned at an epoch no later than an object's
+			// retirement may hold it
+			auto keep = std::partition(registry.retired.begin(), registry.retired.end(),
+					[oldest](const Retired &r) { return r.epoch >= oldest; });
+			ready.assign(keep, registry.retired.end());
+			registry.retired.erase(keep, registry.retired.end());
+		}
+
+		for (Retired &r : ready) {
+			r.deleter(r.ptr);
+		}
+		return ready.size();
+	}
+
+	// Waits until everything retired so far has been freed. Must not be
+	// called while pinned.
+	static void synchronize() {
+		if (pinned()) {
+			throw "Cannot synchronize while pinned!";
+		}
+		while (reclaim(), pending() > 0) {
+			std::this_thread::yield();
+		}
+	}
+
+	static unsigned long pending() {
+		Registry &registry = Registry::get();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		return registry.retired.size();
+	}
+
+private:
+	static constexpr uint64_t QUIESCENT = 0;
+
+	struct Retired {
+		uint64_t epoch;
+		void* ptr;
+		void (*deleter)(void*);
+	};
+
+	struct alignas(64) ThreadRecord {
+		std::atomic<uint64_t> epoch{QUIESCENT};
+		unsigned long depth = 0; // only touched by the owning thread
+	};
+
+	struct Registry {
+		std::atomic<uint64_t> global{1};
+		bool asymmetric;
+		std::mutex mutex;
+		std::vector<ThreadRecord*> threads;
+		std::vector<Retired> retired;
+
+		static Registry& get() {
+			static Registry registry;
+			return registry;
+		}
+
+		Registry() {
+			long commands = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+			asymmetric = commands > 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+					&& syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+		}
+
+		~Registry() {
+			for (Retired &r : retired) {
+				r.deleter(r.ptr);
+			}
+		}
+
+		// Makes every reader's pinned epoch visible before the slots are read
+		void barrier() {
+			if (asymmetric) {
+				syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+			} else {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+	};
+
+	class ThreadHandle {
+	public:
+		ThreadHandle() {
+			Registry &registry = Registry::get();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.threads.push_back(&record_);
+		}
+
+		~ThreadHandle() {
+			Registry &registry = Registry::get();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &record_));
+		}
+
+		ThreadRecord record_;
+	};
+
+	static ThreadRecord& local() {
+		thread_local ThreadHandle handle;
+		return handle.record_;
+	}
+};
+
+
+class epoch_guard {
+public:
+	epoch_guard() {
+		epoch::pin();
+	}
+
+	~epoch_guard() {
+		epoch::unpin();
+	}
+
+	epoch_guard(const epoch_guard &) = delete;
+	epoch_guard& operator=(const epoch_guard &) = delete;
+};
+
+
+template<class T>
+class snapshot {
+public:
+	class reader;
+
+	// Constructors
+	explicit snapshot(T* initial = nullptr) : current_(initial) {}
+
+	snapshot(const snapshot &) = delete;
+	snapshot& operator=(const snapshot &) = delete;
+
+
+	// Destructor
+	// No reader may still be using this snapshot
+	~snapshot() {
+		delete current_.load(std::memory_order_relaxed);
+	}
+
+
+	// Pins the epoch and returns the current value; it stays valid until the
+	// reader is destroyed, even if another value is installed meanwhile
+	reader read() const {
+		return reader(current_);
+	}
+
+	// Publishes next, taking ownership of it, and retires the value it
+	// replaces
+	void install(T* next) {
+		T* previous = current_.exchange(next, std::memory_order_acq_rel);
+		if (previous != nullptr) {
+			epoch::retire(previous);
+		}
+		epoch::reclaim();
+	}
+
+
+	class reader {
+	public:
+		const T* get() const {
+			return ptr_;
+		}
+
+		const T& operator*() const {
+			return *ptr_;
+		}
+
+		const T* operator->() const {
+			return ptr_;
+		}
+
+		explicit operator bool() const {
+			return ptr_ != nullptr;
+		}
+
+	private:
+		epoch_guard guard_;
+		const T* ptr_;
+
+		explicit reader(const std::atomic<T*> &current) :
+				ptr_(current.load(std::memory_order_acquire)) {}
+
+		friend class snapshot;
+	};
+
+private:
+	std::atomic<T*> current_;
+};
+
+
+}
+#endif
@@ -0,0 +1,197 @@
+// Bitvector Fuzz Target
+//
+// Usage: fuzz_bitvector [-runs=N] [-seed=S] [-max_len=N] [input files]
+//
+// Differential fuzzing of SL::bitvector and rank_select against
+// std::vector<bool>. Each input byte is one operation (resize, set,
+// reset, fill, AND/OR/ANDNOT with a second random vector, next, rank or
+// select) applied to both in lockstep; after each, the size, the bit it
+// wrote, the last bit and the zeroed tail of the last word are checked,
+// and periodically every bit and count().
+
+#include "bitvector.h"
+#include "fuzz_util.h"
+#include <vector>
+
+using namespace SL;
+using SL::fuzz::FuzzInput;
+using SL::fuzz::NO_ELEMENT;
+
+void compare(const bitvector &sl, const std::vector<bool> &ref);
+void compare_at(const bitvector &sl, const std::vector<bool> &ref, unsigned long i);
+void random_pair(FuzzInput &in, unsigned long size, bitvector &sl, std::vector<bool> &ref);
+
+const unsigned long MAX_BITS = 5000;
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput in(data, size);
+	bitvector sl;
+	std::vector<bool> ref;
+
+	for (unsigned long ops = 1; !in.empty(); ops++) {
+		unsigned long touched = NO_ELEMENT;
+		switch (in.byte() % 10) {
+			case 0: {
+				unsigned long n = in.below(MAX_BITS);
+				bool val = in.byte() & 1;
+				sl.resize(n, val);
+				ref.resize(n, val);
+				break;
+			}
+			case 1:
+			case 2: {
+				unsigned long i = in.below(ref.size() + 2);
+				bool val = in.byte() & 1;
+				if (i >= ref.size()) {
+					SL_FUZZ_CHECK_THROWS(sl.assign(i, val));
+					SL_FUZZ_CHECK_THROWS(sl.test(i));
+					SL_FUZZ_CHECK(!sl.contains(i));
+				} else {
+					sl.assign(i, val);
+					ref[i] = val;
+					touched = i;
+				}
+				break;
+			}
+			case 3:
+				if (in.byte() & 1) {
+					sl.set_all();
+					ref.assign(ref.size(), true);
+				} else {
+					sl.reset_all();
+					ref.assign(ref.size(), false);
+				}
+				break;
+			case 4:
+			case 5: {
+				bitvector other;
+				std::vector<bool> other_ref;
+				random_pair(in, ref.size(), other, other_ref);
+				uint8_t op = in.byte() % 5;
+				for (unsigned long i = 0; i < ref.size(); i++) {
+					ref[i] = op == 0 || op == 3 ? ref[i] && other_ref[i]
+							: op == 1 || op == 4 ? ref[i] || other_ref[i]
+							: ref[i] && !other_ref[i];
+				}
+				if (op == 0) {
+					sl &= other;
+				} else if (op == 1) {
+					sl |= other;
+				} else if (op == 2) {
+					sl.and_not(other);
+				} else if (op == 3) {
+					sl = sl & other;
+				} else {
+					sl = sl | other;
+				}
+				break;
+			}
+			case 6: {
+				unsigned long i = in.below(ref.size() + 2);
+				unsigned long expected = bitvector::NPOS;
+				for (unsigned long j = i; j < ref.size(); j++) {
+					if (ref[j]) {
+						expected = j;
+						break;
+					}
+				}
+				SL_FUZZ_CHECK(sl.next(i) == expected);
+				break;
+			}
+			case 7: {
+				rank_select ranks(sl);
+				unsigned long ones = 0;
+				for (unsigned long i = 0; i <= ref.size(); i++) {
+					SL_FUZZ_CHECK(ranks.rank1(i) == ones);
+					SL_FUZZ_CHECK(ranks.rank0(i) == i - ones);
+					if (i < ref.size() && ref[i]) {
+						SL_FUZZ_CHECK(ranks.select1(ones) == i);
+						ones++;
+					}
+				}
+				SL_FUZZ_CHECK(ranks.ones() == ones);
+				SL_FUZZ_CHECK(ranks.select1(ones) == rank_select::NPOS);
+				SL_FUZZ_CHECK_THROWS(ranks.rank1(ref.size() + 1));
+				break;
+			}
+			case 8: {
+				bitvector copy(sl);
+				SL_FUZZ_CHECK(copy == sl);
+				if (!ref.empty()) {
+					unsigned long i = in.below(ref.size());
+					copy.assign(i, !ref[i]);
+					SL_FUZZ_CHECK(copy != sl);
+				}
+				break;
+			}
+			default: {
+				bool val = in.byte() & 1;
+				unsigned long n = in.below(MAX_BITS);
+				sl = bitvector(n, val);
+				ref.assign(n, val);
+			}
+		}
+		if (ops % SL::fuzz::FULL_COMPARE_OPS == 0) {
+			compare(sl, ref);
+		} else {
+			compare_at(sl, ref, touched);
+		}
+	}
+	compare(sl, ref);
+	return 0;
+}
+
+#ifndef SL_LIBFUZZER
+int main(int argc, char** argv) {
+	return SL::fuzz::driver(argc, argv, LLVMFuzzerTestOneInput);
+}
+#endif
+
+// Helper Functions
+
+void compare(const bitvector &sl, const std::vector<bool> &ref) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.word_count() == (ref.size() + 63) / 64);
+	unsigned long ones = 0;
+	for (unsigned long i = 0; i < ref.size(); i++) {
+		SL_FUZZ_CHECK(sl.test(i) == ref[i]);
+		ones += ref[i];
+	}
+	SL_FUZZ_CHECK(sl.count() == ones);
+	if (ref.size() % 64 != 0) {
+		SL_FUZZ_CHECK(sl.data()[ref.size() / 64] >> (ref.size() % 64) == 0);
+	}
+}
+
+// Size, the last bit, bit i, if there is one, and the zeroed tail
+void compare_at(const bitvector &sl, const std::vector<bool> &ref, unsigned long i) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.word_count() == (ref.size() + 63) / 64);
+	if (!ref.empty()) {
+		SL_FUZZ_CHECK(sl.test(ref.size() - 1) == ref.back());
+	}
+	if (i < ref.size()) {
+		SL_FUZZ_CHECK(sl.test(i) == ref[i]);
+	}
+	if (ref.size() % 64 != 0) {
+		SL_FUZZ_CHECK(sl.data()[ref.size() / 64] >> (ref.size() % 64) == 0);
+	}
+}
+
+// Random bits with a random density
+void random_pair(FuzzInput &in, unsigned long size, bitvector &sl, std::vector<bool> &ref) {
+	uint8_t density = in.byte();
+	uint32_t state = in.u32() | 1;
+	sl.resize(size);
+	ref.assign(size, false);
+	for (unsigned long i = 0; i < size; i++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		if ((state & 0xff) < density) {
+			sl.set(i);
+			ref[i] = true;
+		}
+	}
+}
@@ -0,0 +1,140 @@
+// Concurrent_vector Fuzz Target
+//
+// Usage: fuzz_concurrent_vector [-runs=N] [-seed=S] [-max_len=N] [input files]
+//
+// Differential fuzzing of SL::concurrent_vector<std::string> against
+// std::vector, one thread at a time: the operations that decide where
+// elements land (push_back, emplace_back, grow_by across segment
+// boundaries, reserve) are applied to both in lockstep, and after each the
+// returned indices, the back and the element it wrote must agree, and
+// periodically every element and the segment layout.
+// Threaded appends are covered by test_concurrent_vector.
+
+#include "concurrent_vector.h"
+#include "fuzz_util.h"
+#include <string>
+#include <vector>
+
+using namespace SL;
+using SL::fuzz::FuzzInput;
+using SL::fuzz::NO_ELEMENT;
+
+void compare(concurrent_vector<std::string> &sl, const std::vector<std::string> &ref);
+void compare_at(concurrent_vector<std::string> &sl, const std::vector<std::string> &ref, unsigned long i);
+std::string make(uint32_t val);
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput in(data, size);
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = in.byte() & 1 ? 4096 : saved.threshold;
+
+	{
+		std::string first = make(in.u32());
+		unsigned long length = in.below(100);
+		concurrent_vector<std::string> sl(length, first);
+		std::vector<std::string> ref(length, first);
+		for (unsigned long ops = 1; !in.empty(); ops++) {
+			unsigned long touched = NO_ELEMENT;
+			switch (in.byte() % 7) {
+				case 0: {
+					std::string val = make(in.u32());
+					SL_FUZZ_CHECK(sl.push_back(val) == ref.size());
+					ref.push_back(val);
+					break;
+				}
+				case 1: {
+					std::string val = make(in.u32());
+					ref.push_back(val);
+					SL_FUZZ_CHECK(sl.push_back(std::move(val)) == ref.size() - 1);
+					break;
+				}
+				case 2: {
+					unsigned long n = in.below(64);
+					char c = 'a' + in.byte() % 26;
+					SL_FUZZ_CHECK(sl.emplace_back(n, c) == ref.size());
+					ref.emplace_back(n, c);
+					break;
+				}
+				case 3: {
+					unsigned long n = in.below(3000);
+					SL_FUZZ_CHECK(sl.grow_by(n) == ref.size());
+					ref.resize(ref.size() + n);
+					break;
+				}
+				case 4: {
+					unsigned long n = in.below(300);
+					std::string val = make(in.u32());
+					SL_FUZZ_CHECK(sl.grow_by(n, val) == ref.size());
+					ref.resize(ref.size() + n, val);
+					break;
+				}
+				case 5: {
+					unsigned long n = in.below(ref.size() + 5000);
+					sl.reserve(n);
+					SL_FUZZ_CHECK(sl.capacity() >= n);
+					break;
+				}
+				default: {
+					unsigned long i = in.below(ref.size() + 2);
+					std::string val = make(in.u32());
+					if (i >= ref.size()) {
+						SL_FUZZ_CHECK_THROWS(sl.at(i) = val);
+					} else {
+						sl.at(i) = val;
+						ref[i] = val;
+						touched = i;
+					}
+				}
+			}
+			if (ops % SL::fuzz::FULL_COMPARE_OPS == 0) {
+				compare(sl, ref);
+			} else {
+				compare_at(sl, ref, touched);
+			}
+		}
+		compare(sl, ref);
+	}
+
+	large_buffer::options() = saved;
+	return 0;
+}
+
+#ifndef SL_LIBFUZZER
+int main(int argc, char** argv) {
+	return SL::fuzz::driver(argc, argv, LLVMFuzzerTestOneInput);
+}
+#endif
+
+// Helper Functions
+
+void compare(concurrent_vector<std::string> &sl, const std::vector<std::string> &ref) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	for (unsigned long i = 0; i < ref.size(); i++) {
+		SL_FUZZ_CHECK(sl[i] == ref[i]);
+		// Elements of one segment are contiguous
+		unsigned long seg = concurrent_vector<std::string>::segment_of(i);
+		unsigned long start = concurrent_vector<std::string>::segment_start(seg);
+		SL_FUZZ_CHECK(i >= start && i < start + concurrent_vector<std::string>::segment_size(seg));
+		SL_FUZZ_CHECK(&sl[i] == &sl[start] + (i - start));
+	}
+}
+
+// Sizes, the back and element i, if there is one
+void compare_at(concurrent_vector<std::string> &sl, const std::vector<std::string> &ref, unsigned long i) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	if (!ref.empty()) {
+		SL_FUZZ_CHECK(sl[ref.size() - 1] == ref.back());
+	}
+	if (i < ref.size()) {
+		SL_FUZZ_CHECK(sl[i] == ref[i]);
+	}
+}
+
+std::string make(uint32_t val) {
+	return std::string(val % 40, (char) ('a' + val % 26));
+}
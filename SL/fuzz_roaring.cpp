@@ -0,0 +1,198 @@
+// Roaring Fuzz Target
+//
+// Usage: fuzz_roaring [-runs=N] [-seed=S] [-max_len=N] [input files]
+//
+// Differential fuzzing of SL::roaring_bitmap against std::set<uint32_t>.
+// Values are drawn from a few 65536-value chunks, and runs of adds and
+// removes push chunks back and forth across ARRAY_MAX, so both container
+// kinds and the conversions between them are exercised. Each input byte
+// is one operation applied to both in lockstep; after each, cardinality
+// and the value it added or removed are checked, and periodically the
+// members in order. Operation 7 checks contains() and next().
+
+#include "roaring.h"
+#include "fuzz_util.h"
+#include <set>
+
+using namespace SL;
+using SL::fuzz::FuzzInput;
+
+void compare(const roaring_bitmap &sl, const std::set<uint32_t> &ref);
+void compare_at(const roaring_bitmap &sl, const std::set<uint32_t> &ref, unsigned long val);
+uint32_t random_value(FuzzInput &in);
+void random_pair(FuzzInput &in, roaring_bitmap &sl, std::set<uint32_t> &ref);
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput in(data, size);
+	roaring_bitmap sl;
+	std::set<uint32_t> ref;
+
+	for (unsigned long ops = 1; !in.empty(); ops++) {
+		unsigned long touched = roaring_bitmap::NPOS;
+		switch (in.byte() % 9) {
+			case 0: {
+				uint32_t val = random_value(in);
+				sl.add(val);
+				ref.insert(val);
+				touched = val;
+				break;
+			}
+			case 1: {
+				uint32_t val = random_value(in);
+				sl.remove(val);
+				ref.erase(val);
+				touched = val;
+				break;
+			}
+			case 2: {
+				// A run of up to 8K values, enough to flip a chunk's kind
+				uint32_t start = random_value(in);
+				unsigned long length = in.below(8192);
+				bool add = in.byte() & 1;
+				touched = start;
+				for (unsigned long val = start; val < start + length && val <= UINT32_MAX; val++) {
+					if (add) {
+						sl.add(val);
+						ref.insert(val);
+					} else {
+						sl.remove(val);
+						ref.erase(val);
+					}
+				}
+				break;
+			}
+			case 3:
+			case 4: {
+				roaring_bitmap other;
+				std::set<uint32_t> other_ref;
+				random_pair(in, other, other_ref);
+				uint8_t op = in.byte() % 5;
+				std::set<uint32_t> result;
+				for (uint32_t val : ref) {
+					bool in_other = other_ref.count(val);
+					if ((op == 0 || op == 3) ? in_other : (op == 2 ? !in_other : true)) {
+						result.insert(val);
+					}
+				}
+				if (op == 1 || op == 4) {
+					result.insert(other_ref.begin(), other_ref.end());
+				}
+				ref = result;
+				if (op == 0) {
+					sl &= other;
+				} else if (op == 1) {
+					sl |= other;
+				} else if (op == 2) {
+					sl.and_not(other);
+				} else if (op == 3) {
+					sl = sl & other;
+				} else {
+					sl = sl | other;
+				}
+				break;
+			}
+			case 5: {
+				roaring_bitmap copy(sl);
+				SL_FUZZ_CHECK(copy == sl);
+				roaring_bitmap moved(std::move(copy));
+				SL_FUZZ_CHECK(moved == sl);
+				roaring_bitmap &self = moved;
+				moved = self;
+				sl = moved;
+				break;
+			}
+			case 6: {
+				unsigned long size = in.below(300000);
+				bitvector bits = sl.to_bitvector(size);
+				unsigned long expected = 0;
+				for (uint32_t val : ref) {
+					if (val < size) {
+						SL_FUZZ_CHECK(bits.test(val));
+						expected++;
+					}
+				}
+				SL_FUZZ_CHECK(bits.count() == expected);
+				roaring_bitmap back(bits);
+				for (unsigned long val = back.next(0); val != roaring_bitmap::NPOS; val = back.next(val + 1)) {
+					SL_FUZZ_CHECK(val < size && ref.count(val));
+				}
+				break;
+			}
+			case 7: {
+				uint32_t val = random_value(in);
+				auto itr = ref.lower_bound(val);
+				SL_FUZZ_CHECK(sl.next(val) == (itr == ref.end() ? roaring_bitmap::NPOS : *itr));
+				SL_FUZZ_CHECK(sl.contains(val) == (ref.count(val) == 1));
+				break;
+			}
+			default:
+				if (in.byte() % 4 == 0) {
+					sl.clear();
+					ref.clear();
+				}
+				SL_FUZZ_CHECK_THROWS(sl.add(1UL << 32));
+				SL_FUZZ_CHECK(!sl.contains(1UL << 32));
+				SL_FUZZ_CHECK(sl.next(1UL << 32) == roaring_bitmap::NPOS);
+		}
+		if (ops % SL::fuzz::FULL_COMPARE_OPS == 0) {
+			compare(sl, ref);
+		} else {
+			compare_at(sl, ref, touched);
+		}
+	}
+	compare(sl, ref);
+	return 0;
+}
+
+#ifndef SL_LIBFUZZER
+int main(int argc, char** argv) {
+	return SL::fuzz::driver(argc, argv, LLVMFuzzerTestOneInput);
+}
+#endif
+
+// Helper Functions
+
+void compare(const roaring_bitmap &sl, const std::set<uint32_t> &ref) {
+	SL_FUZZ_CHECK(sl.cardinality() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	auto itr = ref.begin();
+	sl.for_each([&](unsigned long val) {
+		SL_FUZZ_CHECK(itr != ref.end() && val == *itr);
+		++itr;
+	});
+	SL_FUZZ_CHECK(itr == ref.end());
+}
+
+// Cardinality and whether val, unless NPOS, is a member
+void compare_at(const roaring_bitmap &sl, const std::set<uint32_t> &ref, unsigned long val) {
+	SL_FUZZ_CHECK(sl.cardinality() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	if (val != roaring_bitmap::NPOS) {
+		SL_FUZZ_CHECK(sl.contains(val) == (ref.count(val) == 1));
+	}
+}
+
+// One of four chunks: the first two, one in the middle and the last
+uint32_t random_value(FuzzInput &in) {
+	static const uint32_t chunks[] = { 0, 1, 0x8000, 0xffff };
+	return (chunks[in.byte() % 4] << 16) | in.u16();
+}
+
+// Up to 200 members over the same chunks, or sometimes up to 6000 in one
+// chunk, which then becomes a bitmap
+void random_pair(FuzzInput &in, roaring_bitmap &sl, std::set<uint32_t> &ref) {
+	static const uint32_t chunks[] = { 0, 1, 0x8000, 0xffff };
+	bool dense = in.byte() % 4 == 0;
+	unsigned long count = dense ? in.below(6000) : in.below(200);
+	uint32_t chunk = in.byte() % 4;
+	uint32_t state = in.u32() | 1;
+	for (unsigned long i = 0; i < count; i++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		uint32_t val = (chunks[dense ? chunk : state >> 30] << 16) | (state & 0xffff);
+		sl.add(val);
+		ref.insert(val);
+	}
+}
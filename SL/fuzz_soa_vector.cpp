@@ -0,0 +1,183 @@
+// Soa_vector Fuzz Target
+//
+// Usage: fuzz_soa_vector [-runs=N] [-seed=S] [-max_len=N] [input files]
+//
+// Differential fuzzing of SL::soa_vector<int, std::string, double>
+// against std::vector of tuples. Each input byte is one operation applied
+// to both in lockstep, through rows, row proxies, single fields and
+// column spans; after each, the back row and the rows it wrote must agree
+// and all three columns must have the size and capacity of the first, and
+// periodically every row must agree.
+
+#include "soa_vector.h"
+#include "fuzz_util.h"
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace SL;
+using SL::fuzz::FuzzInput;
+using SL::fuzz::NO_ELEMENT;
+
+typedef soa_vector<int, std::string, double> Rows;
+typedef std::tuple<int, std::string, double> Row;
+
+void compare(Rows &sl, const std::vector<Row> &ref);
+void compare_at(Rows &sl, const std::vector<Row> &ref, unsigned long i);
+Row make_row(uint32_t val);
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput in(data, size);
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = in.byte() & 1 ? 4096 : saved.threshold;
+
+	{
+		Rows sl;
+		std::vector<Row> ref;
+		for (unsigned long ops = 1; !in.empty(); ops++) {
+			unsigned long touched = NO_ELEMENT;
+			switch (in.byte() % 12) {
+				case 0: {
+					Row row = make_row(in.u32());
+					sl.push_back(std::get<0>(row), std::get<1>(row), std::get<2>(row));
+					ref.push_back(row);
+					break;
+				}
+				case 1: {
+					Row row = make_row(in.u32());
+					sl.push_back(row);
+					ref.push_back(row);
+					break;
+				}
+				case 2:
+					if (ref.empty()) {
+						SL_FUZZ_CHECK_THROWS(sl.pop_back());
+					} else {
+						sl.pop_back();
+						ref.pop_back();
+					}
+					break;
+				case 3: {
+					unsigned long n = in.below(2 * ref.size() + 16);
+					sl.resize(n);
+					ref.resize(n);
+					break;
+				}
+				case 4: {
+					unsigned long n = in.below(2048);
+					Row row = make_row(in.u32());
+					sl.resize(n, std::get<0>(row), std::get<1>(row), std::get<2>(row));
+					ref.resize(n, row);
+					break;
+				}
+				case 5: {
+					unsigned long n = in.below(2048);
+					sl.reserve(n);
+					SL_FUZZ_CHECK(sl.capacity() >= n);
+					break;
+				}
+				case 6:
+					sl.shrink_to_fit();
+					break;
+				case 7: {
+					unsigned long i = in.below(ref.size() + 2);
+					Row row = make_row(in.u32());
+					if (i >= ref.size()) {
+						SL_FUZZ_CHECK_THROWS(sl.at(i) = row);
+					} else {
+						sl.at(i) = row;
+						ref[i] = row;
+						touched = i;
+					}
+					break;
+				}
+				case 8:
+					if (ref.empty()) {
+						SL_FUZZ_CHECK_THROWS(sl.front());
+						SL_FUZZ_CHECK_THROWS(sl.back());
+					} else {
+						// Row proxies copy between rows
+						sl.front() = sl.back();
+						ref.front() = ref.back();
+						SL_FUZZ_CHECK((Row) sl.back() == ref.back());
+						touched = 0;
+					}
+					break;
+				case 9:
+					if (!ref.empty()) {
+						unsigned long i = in.below(ref.size());
+						Row row = make_row(in.u32());
+						sl.get<0>(i) = std::get<0>(row);
+						sl[i].get<1>() = std::get<1>(row);
+						sl.column<2>()[i] = std::get<2>(row);
+						ref[i] = row;
+						touched = i;
+					}
+					break;
+				case 10: {
+					Rows copy(sl);
+					compare(copy, ref);
+					sl = Rows();
+					sl = copy;
+					break;
+				}
+				default: {
+					unsigned long n = in.below(64);
+					Row row = make_row(in.u32());
+					sl = Rows(n, std::get<0>(row), std::get<1>(row), std::get<2>(row));
+					ref.assign(n, row);
+				}
+			}
+			if (ops % SL::fuzz::FULL_COMPARE_OPS == 0) {
+				compare(sl, ref);
+			} else {
+				compare_at(sl, ref, touched);
+			}
+		}
+		compare(sl, ref);
+	}
+
+	large_buffer::options() = saved;
+	return 0;
+}
+
+#ifndef SL_LIBFUZZER
+int main(int argc, char** argv) {
+	return SL::fuzz::driver(argc, argv, LLVMFuzzerTestOneInput);
+}
+#endif
+
+// Helper Functions
+
+void compare(Rows &sl, const std::vector<Row> &ref) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	SL_FUZZ_CHECK(sl.column<0>().size() == ref.size());
+	SL_FUZZ_CHECK(sl.column<1>().size() == ref.size());
+	for (unsigned long i = 0; i < ref.size(); i++) {
+		SL_FUZZ_CHECK(sl.row(i) == ref[i]);
+		SL_FUZZ_CHECK(sl.data<1>()[i] == std::get<1>(ref[i]));
+	}
+}
+
+// Sizes, the back row and row i, if there is one
+void compare_at(Rows &sl, const std::vector<Row> &ref, unsigned long i) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	SL_FUZZ_CHECK(sl.column<0>().size() == ref.size());
+	SL_FUZZ_CHECK(sl.column<1>().size() == ref.size());
+	if (!ref.empty()) {
+		SL_FUZZ_CHECK(sl.row(ref.size() - 1) == ref.back());
+	}
+	if (i < ref.size()) {
+		SL_FUZZ_CHECK(sl.row(i) == ref[i]);
+		SL_FUZZ_CHECK(sl.data<1>()[i] == std::get<1>(ref[i]));
+	}
+}
+
+Row make_row(uint32_t val) {
+	return Row((int) val, std::string(val % 40, (char) ('a' + val % 26)), val / 7.0);
+}
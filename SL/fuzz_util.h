@@ -0,0 +1,166 @@
+// fuzz utility header file
+//
+// Support for the differential fuzz targets (fuzz_*.cpp). Each target
+// defines LLVMFuzzerTestOneInput, decodes its input bytes into a sequence
+// of container operations, applies every operation to an SL container and
+// to the standard library container it mimics, and aborts at the first
+// difference. Built with sanitizers, memory errors abort as well. The
+// containers are compared in full every FULL_COMPARE_OPS operations and at
+// the end of the input; after the other operations only their sizes and
+// the element the operation touched, so an input runs in time linear in
+// its length rather than quadratic.
+//
+//   FuzzInput - reads operations and arguments from the input; past its
+//               end every read returns zero, so any input is valid
+//   check     - prints the failed comparison and aborts
+//   driver    - main() for builds without libFuzzer: runs the inputs
+//               named on the command line (AFL's @@, crash reproduction)
+//               or, with none, -runs=N random inputs from -seed=S,
+//               stopping early after -max_total_time=S seconds
+//
+// Building with -fsanitize=fuzzer -DSL_LIBFUZZER leaves main to libFuzzer.
+
+#ifndef SL_FUZZ_UTIL_H
+#define SL_FUZZ_UTIL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace SL {
+namespace fuzz {
+
+typedef int (*Target)(const uint8_t*, size_t);
+
+const unsigned long FULL_COMPARE_OPS = 64;
+
+// No element touched, for the per-operation comparisons
+const unsigned long NO_ELEMENT = ~0UL;
+
+class FuzzInput {
+public:
+	FuzzInput(const uint8_t* data, size_t size) : data_(data), size_(size), at_(0) {}
+
+	bool empty() const {
+		return at_ >= size_;
+	}
+
+	uint8_t byte() {
+		return at_ < size_ ? data_[at_++] : 0;
+	}
+
+	uint16_t u16() {
+		return (uint16_t) (byte() | (byte() << 8));
+	}
+
+	uint32_t u32() {
+		return (uint32_t) u16() | ((uint32_t) u16() << 16);
+	}
+
+	// Value in [0, n), 0 when n is 0
+	unsigned long below(unsigned long n) {
+		if (n == 0) {
+			return 0;
+		}
+		return (n <= 256 ? byte() : n <= 65536 ? u16() : u32()) % n;
+	}
+
+private:
+	const uint8_t* data_;
+	size_t size_;
+	size_t at_;
+};
+
+inline void check(bool ok, const char* what, const char* file, int line) {
+	if (!ok) {
+		fprintf(stderr, "%s:%d: SL and std disagree: %s\n", file, line, what);
+		std::abort();
+	}
+}
+
+#define SL_FUZZ_CHECK(cond) SL::fuzz::check((cond), #cond, __FILE__, __LINE__)
+
+// Runs body, which must throw a const char* error
+#define SL_FUZZ_CHECK_THROWS(body) do { \
+	bool thrown = false; \
+	try { \
+		body; \
+	} catch (const char*) { \
+		thrown = true; \
+	} \
+	SL::fuzz::check(thrown, #body " throws", __FILE__, __LINE__); \
+} while (0)
+
+inline bool read_input(const char* path, std::vector<uint8_t> &out) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return true;
+}
+
+inline int driver(int argc, char** argv, Target target) {
+	unsigned long runs = 10000;
+	unsigned long seed = 1;
+	unsigned long max_len = 1024;
+	unsigned long max_time = 0;
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++) {
+		if (std::strncmp(argv[i], "-runs=", 6) == 0) {
+			runs = std::strtoul(argv[i] + 6, nullptr, 10);
+		} else if (std::strncmp(argv[i], "-seed=", 6) == 0) {
+			seed = std::strtoul(argv[i] + 6, nullptr, 10);
+		} else if (std::strncmp(argv[i], "-max_len=", 9) == 0) {
+			max_len = std::strtoul(argv[i] + 9, nullptr, 10);
+		} else if (std::strncmp(argv[i], "-max_total_time=", 16) == 0) {
+			max_time = std::strtoul(argv[i] + 16, nullptr, 10);
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+
+	std::vector<uint8_t> input;
+	if (!files.empty()) {
+		for (const char* file : files) {
+			if (!read_input(file, input)) {
+				fprintf(stderr, "Cannot read %s\n", file);
+				return 1;
+			}
+			target(input.data(), input.size());
+		}
+		printf("Ran %lu inputs\n", (unsigned long) files.size());
+		return 0;
+	}
+
+	// Random inputs; a failing one is saved so it can be replayed
+	std::mt19937_64 rng(seed);
+	auto start = std::chrono::steady_clock::now();
+	unsigned long run = 0;
+	for (; run < runs; run++) {
+		if (max_time && std::chrono::steady_clock::now() - start >= std::chrono::seconds(max_time)) {
+			break;
+		}
+		input.resize(max_len ? rng() % (max_len + 1) : 0);
+		for (uint8_t &b : input) {
+			b = (uint8_t) rng();
+		}
+		std::ofstream("fuzz-last-input", std::ios::binary).write((const char*) input.data(), input.size());
+		target(input.data(), input.size());
+	}
+	std::remove("fuzz-last-input");
+	printf("Ran %lu random inputs from seed %lu\n", run, seed);
+	return 0;
+}
+
+
+}
+}
+#endif
@@ -0,0 +1,264 @@
+// Vector Fuzz Target
+//
+// Usage: fuzz_vector [-runs=N] [-seed=S] [-max_len=N] [input files]
+//
+// Differential fuzzing of SL::vector against std::vector. The first input
+// byte picks the element type and the large buffer threshold:
+//
+//   int          trivially relocatable, so grown with realloc and mremap
+//   Tracked      copied element by element; its live count must return
+//                to zero once both vectors are gone
+//   std::string  owns heap memory, so a shallow copy is a double free
+//
+// with either the default threshold or 4 KB, which moves even small
+// vectors onto mmap-backed storage. Every later byte is one operation,
+// applied to an SL::vector and a std::vector in lockstep; after each the
+// sizes, the back and the element it wrote must agree and the capacity
+// must cover the size, and periodically every element must agree.
+
+#include "vector.h"
+#include "fuzz_util.h"
+#include "test_util.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace SL;
+using SL::fuzz::FuzzInput;
+using SL::fuzz::NO_ELEMENT;
+using SL::test::Tracked;
+
+template<class T>
+void run(FuzzInput &in);
+template<class T>
+void compare(vector<T> &sl, const std::vector<T> &ref);
+template<class T>
+void compare_at(vector<T> &sl, const std::vector<T> &ref, unsigned long i);
+template<class T>
+T make(uint32_t val);
+bool before(int a, int b);
+bool before(const Tracked &a, const Tracked &b);
+bool before(const std::string &a, const std::string &b);
+
+// Largest size operations ask for; past 4 KB of ints or strings
+const unsigned long MAX_ELEMENTS = 1UL << 11;
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput in(data, size);
+	uint8_t config = in.byte();
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = config & 4 ? 4096 : saved.threshold;
+	switch (config % 3) {
+		case 0:
+			run<int>(in);
+			break;
+		case 1:
+			run<Tracked>(in);
+			SL_FUZZ_CHECK(Tracked::live() == 0);
+			break;
+		default:
+			run<std::string>(in);
+	}
+	large_buffer::options() = saved;
+	return 0;
+}
+
+#ifndef SL_LIBFUZZER
+int main(int argc, char** argv) {
+	return SL::fuzz::driver(argc, argv, LLVMFuzzerTestOneInput);
+}
+#endif
+
+// Helper Functions
+
+template<class T>
+void run(FuzzInput &in) {
+	vector<T> sl;
+	std::vector<T> ref;
+
+	for (unsigned long ops = 1; !in.empty(); ops++) {
+		unsigned long touched = NO_ELEMENT;
+		switch (in.byte() % 16) {
+			case 0: {
+				T val = make<T>(in.u32());
+				sl.push_back(val);
+				ref.push_back(val);
+				break;
+			}
+			case 1:
+				if (ref.empty()) {
+					SL_FUZZ_CHECK_THROWS(sl.pop_back());
+				} else {
+					sl.pop_back();
+					ref.pop_back();
+				}
+				break;
+			case 2: {
+				unsigned long n = in.below(2 * ref.size() + 16);
+				sl.resize(n);
+				ref.resize(n);
+				break;
+			}
+			case 3: {
+				unsigned long n = in.below(2 * ref.size() + 16);
+				T val = make<T>(in.u32());
+				sl.resize(n, val);
+				ref.resize(n, val);
+				break;
+			}
+			case 4: {
+				unsigned long n = in.below(MAX_ELEMENTS);
+				sl.resize(n);
+				ref.resize(n);
+				break;
+			}
+			case 5: {
+				unsigned long n = in.below(MAX_ELEMENTS);
+				sl.reserve(n);
+				SL_FUZZ_CHECK(sl.capacity() >= n);
+				break;
+			}
+			case 6:
+				sl.shrink_to_fit();
+				break;
+			case 7: {
+				unsigned long i = in.below(ref.size() + 2);
+				T val = make<T>(in.u32());
+				if (i >= ref.size()) {
+					SL_FUZZ_CHECK_THROWS(sl.at(i) = val);
+				} else {
+					sl.at(i) = val;
+					ref[i] = val;
+					touched = i;
+				}
+				break;
+			}
+			case 8: {
+				unsigned long i = in.below(ref.size() + 2);
+				if (i >= ref.size()) {
+					SL_FUZZ_CHECK_THROWS(sl[i]);
+				} else {
+					SL_FUZZ_CHECK(sl[i] == ref[i]);
+				}
+				break;
+			}
+			case 9:
+				if (ref.empty()) {
+					SL_FUZZ_CHECK_THROWS(sl.front());
+					SL_FUZZ_CHECK_THROWS(sl.back());
+				} else {
+					SL_FUZZ_CHECK(sl.front() == ref.front());
+					SL_FUZZ_CHECK(sl.back() == ref.back());
+				}
+				break;
+			case 10: {
+				vector<T> copy(sl);
+				compare(copy, ref);
+				vector<T> assigned;
+				assigned.push_back(make<T>(in.u32()));
+				assigned = copy;
+				compare(assigned, ref);
+				sl = assigned;
+				break;
+			}
+			case 11: {
+				vector<T> moved(sl);
+				sl = std::move(moved);
+				SL_FUZZ_CHECK(moved.size() == 0);
+				break;
+			}
+			case 12: {
+				vector<T> &self = sl;
+				sl = self;
+				break;
+			}
+			case 13: {
+				unsigned long n = in.below(64);
+				T val = make<T>(in.u32());
+				sl = vector<T>(n, val);
+				ref.assign(n, val);
+				break;
+			}
+			case 14: {
+				unsigned long i = 0;
+				for (auto itr = sl.begin(); itr != sl.end(); ++itr) {
+					SL_FUZZ_CHECK(i < ref.size() && *itr == ref[i]);
+					i++;
+				}
+				SL_FUZZ_CHECK(i == ref.size());
+				SL_FUZZ_CHECK(sl.end() - sl.begin() == (long) ref.size());
+				for (auto itr = sl.rbegin(); itr != sl.rend(); ++itr) {
+					SL_FUZZ_CHECK(i > 0 && *itr == ref[i - 1]);
+					i--;
+				}
+				SL_FUZZ_CHECK(i == 0);
+				break;
+			}
+			default:
+				std::sort(sl.begin(), sl.end(), [](const T &a, const T &b) { return before(a, b); });
+				std::sort(ref.begin(), ref.end(), [](const T &a, const T &b) { return before(a, b); });
+		}
+		if (ops % SL::fuzz::FULL_COMPARE_OPS == 0) {
+			compare(sl, ref);
+		} else {
+			compare_at(sl, ref, touched);
+		}
+	}
+	compare(sl, ref);
+}
+
+template<class T>
+void compare(vector<T> &sl, const std::vector<T> &ref) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	const T* data = sl.data();
+	for (unsigned long i = 0; i < ref.size(); i++) {
+		SL_FUZZ_CHECK(data[i] == ref[i]);
+	}
+}
+
+// Sizes, the back and element i, if there is one
+template<class T>
+void compare_at(vector<T> &sl, const std::vector<T> &ref, unsigned long i) {
+	SL_FUZZ_CHECK(sl.size() == ref.size());
+	SL_FUZZ_CHECK(sl.empty() == ref.empty());
+	SL_FUZZ_CHECK(sl.capacity() >= sl.size());
+	if (!ref.empty()) {
+		SL_FUZZ_CHECK(sl.data()[ref.size() - 1] == ref.back());
+	}
+	if (i < ref.size()) {
+		SL_FUZZ_CHECK(sl.data()[i] == ref[i]);
+	}
+}
+
+template<>
+int make<int>(uint32_t val) {
+	return (int) val;
+}
+
+template<>
+Tracked make<Tracked>(uint32_t val) {
+	return Tracked((int) val);
+}
+
+// Short strings live inside std::string, longer ones on the heap
+template<>
+std::string make<std::string>(uint32_t val) {
+	return std::string(val % 40, (char) ('a' + val % 26));
+}
+
+bool before(int a, int b) {
+	return a < b;
+}
+
+bool before(const Tracked &a, const Tracked &b) {
+	return a.val() < b.val();
+}
+
+bool before(const std::string &a, const std::string &b) {
+	return a < b;
+}
@@ -0,0 +1,180 @@
+// memory header file
+//
+// Large-buffer allocation for SL containers. Buffers at or above
+// large_buffer::options().threshold bytes are mapped directly with mmap
+// instead of going through new[]:
+//
+//   - backed by huge pages, either transparent (MADV_HUGEPAGE) or reserved
+//     (MAP_HUGETLB, falling back to transparent when none are reserved), so
+//     random access over multi-GB arrays stays within the TLB
+//   - optionally bound to, or interleaved across, NUMA nodes with mbind
+//   - grown with mremap, which moves page table entries instead of bytes
+//     (see is_trivially_relocatable)
+//
+// Options are process wide and apply to buffers allocated after they are set.
+// Elsewhere than Linux large buffers come from malloc and realloc, and the
+// huge page and NUMA options have no effect.
+
+#ifndef SL_MEMORY_H
+#define SL_MEMORY_H
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+namespace SL {
+
+// Types whose objects can be moved to a new address by copying their bytes
+// and forgetting the old ones, without running a copy and destructor. SL
+// containers grow buffers of such types with realloc and mremap instead of
+// element-wise copies. Trivially copyable types qualify automatically; other
+// types opt in with
+//
+//   template<> struct SL::is_trivially_relocatable<MyType> : std::true_type {};
+//
+// which is correct for most types that do not point into themselves.
+template<class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+enum class huge_page_mode { none, transparent, reserved };
+enum class numa_policy { local, bind, interleave };
+
+struct large_buffer_options {
+	unsigned long threshold = 1UL << 21;
+	huge_page_mode huge_pages = huge_page_mode::transparent;
+	numa_policy numa = numa_policy::local;
+	unsigned long node_mask = 0; // nodes to bind or interleave over, bit per node
+};
+
+class large_buffer {
+public:
+	static constexpr unsigned long HUGE_PAGE_SIZE = 1UL << 21;
+
+	static large_buffer_options& options() {
+		static large_buffer_options options;
+		return options;
+	}
+
+	static bool is_large(unsigned long bytes) {
+		return bytes > 0 && bytes >= options().threshold;
+	}
+
+	// Size of the mapping that backs a buffer of the given size
+	static unsigned long mapped_size(unsigned long bytes) {
+		return round_up(bytes, HUGE_PAGE_SIZE);
+	}
+
+	static void* allocate(unsigned long bytes) {
+#ifdef __linux__
+		const large_buffer_options &opts = options();
+		unsigned long length = mapped_size(bytes);
+		void* ptr = MAP_FAILED;
+
+		if (opts.huge_pages == huge_page_mode::reserved) {
+			ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+		if (ptr == MAP_FAILED) {
+			ptr = map_aligned(length);
+			if (opts.huge_pages != huge_page_mode::none) {
+				madvise(ptr, length, MADV_HUGEPAGE);
+			}
+		}
+
+		apply_numa_policy(ptr, length);
+		return ptr;
+#else
+		void* ptr = std::malloc(mapped_size(bytes));
+		if (ptr == nullptr) {
+			throw "Large buffer allocation failed!";
+		}
+		return ptr;
+#endif
+	}
+
+	// Resizes a buffer, keeping its contents up to the smaller size. The
+	// buffer may move, so only use this for trivially copyable contents.
+	static void* reallocate(void* ptr, unsigned long old_bytes, unsigned long new_bytes) {
+		unsigned long old_length = mapped_size(old_bytes);
+		unsigned long new_length = mapped_size(new_bytes);
+		if (old_length == new_length) {
+			return ptr;
+		}
+
+#ifdef __linux__
+		void* result = mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+		if (result == MAP_FAILED) {
+			throw "Large buffer remap failed!";
+		}
+		if (new_length > old_length && options().huge_pages != huge_page_mode::none) {
+			madvise(result, new_length, MADV_HUGEPAGE);
+		}
+#else
+		void* result = std::realloc(ptr, new_length);
+		if (result == nullptr) {
+			throw "Large buffer remap failed!";
+		}
+#endif
+		return result;
+	}
+
+	static void deallocate(void* ptr, unsigned long bytes) {
+		if (ptr != nullptr) {
+#ifdef __linux__
+			munmap(ptr, mapped_size(bytes));
+#else
+			std::free(ptr);
+#endif
+		}
+	}
+
+private:
+	static unsigned long round_up(unsigned long val, unsigned long align) {
+		return (val + align - 1) / align * align;
+	}
+
+#ifdef __linux__
+	// Maps length bytes at a huge page boundary so transparent huge pages
+	// can back the buffer from its first byte
+	static void* map_aligned(unsigned long length) {
+		unsigned long padded = length + HUGE_PAGE_SIZE;
+		char* base = (char*) mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (base == MAP_FAILED) {
+			throw "Large buffer allocation failed!";
+		}
+
+		char* aligned = (char*) round_up((uintptr_t) base, HUGE_PAGE_SIZE);
+		if (aligned > base) {
+			munmap(base, aligned - base);
+		}
+		char* end = aligned + length;
+		if (base + padded > end) {
+			munmap(end, base + padded - end);
+		}
+		return aligned;
+	}
+
+	static void apply_numa_policy(void* ptr, unsigned long length) {
+		const large_buffer_options &opts = options();
+		if (opts.numa == numa_policy::local || opts.node_mask == 0) {
+			return;
+		}
+
+		int mode = opts.numa == numa_policy::bind ? MPOL_BIND : MPOL_INTERLEAVE;
+		unsigned long mask = opts.node_mask;
+		// Best effort: a node missing from this machine leaves the default policy
+		syscall(SYS_mbind, ptr, length, mode, &mask, sizeof(mask) * 8, 0);
+	}
+#endif
+};
+
+
+}
+#endif
@@ -0,0 +1,113 @@
+#!/bin/sh
+# Benchmark Report
+#
+# Usage: perf_report.sh run <report> <bench>...
+#        perf_report.sh compare <old report> <new report>
+#
+# run executes each benchmark under perf stat and writes one line per
+# benchmark to <report>: wall seconds, cycles, instructions, IPC, cache
+# misses per cache reference and branch misses per branch. The header
+# records the build configuration, compiler, CPU and commit, so reports
+# from different builds of the same tree can be compared line by line.
+# Benchmark output goes to <report>.log. Without perf, or when the kernel
+# refuses counters, only wall time is reported.
+#
+# compare prints, for benchmarks in both reports, the old and new wall
+# time and cycles with the new/old ratios, and the IPC of each.
+
+EVENTS=cycles,instructions,cache-references,cache-misses,branches,branch-misses
+
+run() {
+	report=$1
+	shift
+	mkdir -p "$(dirname "$report")"
+	log=$report.log
+	: > "$log"
+
+	have_perf=no
+	if command -v perf > /dev/null 2>&1; then
+		have_perf=yes
+	else
+		echo "perf_report.sh: perf not found, reporting wall time only" >&2
+	fi
+
+	{
+		echo "# config:   ${PERF_CONFIG:-unknown}"
+		echo "# compiler: $(${CXX:-g++} --version | head -n 1)"
+		echo "# cpu:      $(grep -m 1 'model name' /proc/cpuinfo 2>/dev/null | sed 's/.*: //')"
+		echo "# commit:   $(git rev-parse --short HEAD 2>/dev/null)$(git diff --quiet HEAD 2>/dev/null || echo ' (modified)')"
+		echo "# date:     $(date '+%Y-%m-%d %H:%M:%S')"
+		printf "%-28s %10s %14s %14s %6s %8s %8s\n" bench seconds cycles instructions IPC cache% branch%
+	} > "$report"
+
+	stats=$(mktemp)
+	for bench in "$@"; do
+		echo "== $bench" >> "$log"
+		start=$(date +%s.%N)
+		if [ $have_perf = yes ]; then
+			perf stat -x, -e $EVENTS -o "$stats" -- "$bench" >> "$log" 2>&1
+		else
+			: > "$stats"
+			"$bench" >> "$log" 2>&1
+		fi
+		status=$?
+		end=$(date +%s.%N)
+		if [ $status -ne 0 ]; then
+			echo "perf_report.sh: $bench failed, see $log" >&2
+			rm -f "$stats"
+			exit 1
+		fi
+
+		# perf -x, lines are value,unit,event,...; unsupported counters
+		# have a non-numeric value
+		awk -F, -v name="$(basename "$bench")" -v start="$start" -v end="$end" '
+			$1 ~ /^[0-9.]+$/ { count[$3] = $1 }
+			function get(e) { return (e in count) ? count[e] : "-" }
+			function ratio(a, b, scale) {
+				if (!(a in count) || !(b in count) || count[b] == 0) {
+					return "-"
+				}
+				return sprintf("%.2f", scale * count[a] / count[b])
+			}
+			END {
+				printf "%-28s %10.3f %14s %14s %6s %8s %8s\n", name, end - start,
+						get("cycles"), get("instructions"), ratio("instructions", "cycles", 1),
+						ratio("cache-misses", "cache-references", 100),
+						ratio("branch-misses", "branches", 100)
+			}' "$stats" >> "$report"
+	done
+	rm -f "$stats"
+	cat "$report"
+}
+
+compare() {
+	awk '
+		/^#/ || $1 == "bench" { next }
+		FNR == NR { seconds[$1] = $2; cycles[$1] = $3; ipc[$1] = $5; next }
+		!($1 in seconds) { next }
+		function ratio(a, b) { return a ~ /^[0-9.]+$/ && b ~ /^[0-9.]+$/ && a > 0 ? sprintf("%.3f", b / a) : "-" }
+		BEGIN {
+			printf "%-28s %10s %10s %7s %14s %14s %7s %6s %6s\n", "bench", "old s", "new s", "ratio",
+					"old cycles", "new cycles", "ratio", "IPC", "IPC"
+		}
+		{
+			printf "%-28s %10s %10s %7s %14s %14s %7s %6s %6s\n", $1, seconds[$1], $2, ratio(seconds[$1], $2),
+					cycles[$1], $3, ratio(cycles[$1], $3), ipc[$1], $5
+		}' "$1" "$2"
+}
+
+case "$1" in
+	run)
+		[ $# -ge 3 ] || { echo "Usage: perf_report.sh run <report> <bench>..." >&2; exit 2; }
+		shift
+		run "$@"
+		;;
+	compare)
+		[ $# -eq 3 ] || { echo "Usage: perf_report.sh compare <old report> <new report>" >&2; exit 2; }
+		compare "$2" "$3"
+		;;
+	*)
+		echo "Usage: perf_report.sh run <report> <bench>... | compare <old report> <new report>" >&2
+		exit 2
+		;;
+esac
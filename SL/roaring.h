@@ -0,0 +1,515 @@
+// roaring header file
+//
+// Compressed set of 32-bit values in the style of Roaring bitmaps. Values
+// are split by their high 16 bits into chunks of 65536, and each non-empty
+// chunk is held in whichever container is smaller:
+//
+//   array  - sorted uint16_t low halves, up to ARRAY_MAX values (2 bytes each)
+//   bitmap - 1024 words, one bit per low half (8 KB)
+//
+// Sparse filters cost a few bytes per member instead of a bit per document,
+// and dense chunks fall back to bitmap speed. Shares the contains()/next()
+// filter interface with bitvector.
+
+#ifndef SL_ROARING_H
+#define SL_ROARING_H
+
+#include "bitvector.h"
+#include "vector.h"
+#include <cstdint>
+#include <utility>
+
+namespace SL {
+
+class roaring_bitmap {
+public:
+	static constexpr unsigned long NPOS = ~0UL;
+	static constexpr unsigned long ARRAY_MAX = 4096;
+	static constexpr unsigned long CHUNK_WORDS = 1024;
+
+	// Constructors
+	roaring_bitmap() {}
+
+	explicit roaring_bitmap(const bitvector &bits) {
+		for (unsigned long val = bits.next(0); val != bitvector::NPOS; val = bits.next(val + 1)) {
+			add(val);
+		}
+	}
+
+	roaring_bitmap(const roaring_bitmap &other) {
+		*this = other;
+	}
+
+	roaring_bitmap& operator=(const roaring_bitmap &other) {
+		if (this == &other) {
+			return *this;
+		}
+		clear();
+		for (unsigned long i = 0; i < other.chunks_.size(); i++) {
+			keys_.push_back(other.keys_.data()[i]);
+			chunks_.push_back(new Chunk(*other.chunks_.data()[i]));
+		}
+		return *this;
+	}
+
+	roaring_bitmap(roaring_bitmap &&other) noexcept {
+		*this = std::move(other);
+	}
+
+	roaring_bitmap& operator=(roaring_bitmap &&other) noexcept {
+		if (this == &other) {
+			return *this;
+		}
+		clear();
+		keys_ = std::move(other.keys_);
+		chunks_ = std::move(other.chunks_);
+		return *this;
+	}
+
+
+	// Destructor
+	~roaring_bitmap() {
+		clear();
+	}
+
+
+	// Capacity
+	unsigned long cardinality() const {
+		unsigned long total = 0;
+		for (unsigned long i = 0; i < chunks_.size(); i++) {
+			total += chunks_.data()[i]->cardinality;
+		}
+		return total;
+	}
+
+	bool empty() const {
+		return chunks_.size() == 0;
+	}
+
+	unsigned long chunk_count() const {
+		return chunks_.size();
+	}
+
+	unsigned long memory_bytes() const {
+		unsigned long bytes = keys_.capacity() * sizeof(uint16_t) + chunks_.capacity() * sizeof(Chunk*);
+		for (unsigned long i = 0; i < chunks_.size(); i++) {
+			const Chunk* chunk = chunks_.data()[i];
+			bytes += sizeof(Chunk) + chunk->array.capacity() * sizeof(uint16_t)
+					+ chunk->bits.capacity() * sizeof(uint64_t);
+		}
+		return bytes;
+	}
+
+
+	// Accessors
+	bool contains(unsigned long val) const {
+		if (val > UINT32_MAX) {
+			return false;
+		}
+		unsigned long i = find_key(val >> 16);
+		return i < chunks_.size() && keys_.data()[i] == (val >> 16) && chunks_.data()[i]->contains(val & 0xffff);
+	}
+
+	// Smallest member >= val, or NPOS
+	unsigned long next(unsigned long val) const {
+		if (val > UINT32_MAX) {
+			return NPOS;
+		}
+		for (unsigned long i = find_key(val >> 16); i < chunks_.size(); i++) {
+			unsigned long base = (unsigned long) keys_.data()[i] << 16;
+			unsigned long low = base > val ? 0 : val & 0xffff;
+			unsigned long found = chunks_.data()[i]->next(low);
+			if (found != NPOS) {
+				return base | found;
+			}
+		}
+		return NPOS;
+	}
+
+	// Calls f(val) for every member in increasing order
+	template<class F>
+	void for_each(F f) const {
+		for (unsigned long i = 0; i < chunks_.size(); i++) {
+			unsigned long base = (unsigned long) keys_.data()[i] << 16;
+			const Chunk* chunk = chunks_.data()[i];
+			if (chunk->is_bitmap()) {
+				for (unsigned long w = 0; w < CHUNK_WORDS; w++) {
+					for (uint64_t word = chunk->bits.data()[w]; word != 0; word &= word - 1) {
+						f(base | (w * 64 + __builtin_ctzll(word)));
+					}
+				}
+			} else {
+				for (unsigned long j = 0; j < chunk->array.size(); j++) {
+					f(base | chunk->array.data()[j]);
+				}
+			}
+		}
+	}
+
+	bitvector to_bitvector(unsigned long size) const {
+		bitvector bits(size);
+		for_each([&bits, size](unsigned long val) {
+			if (val < size) {
+				bits.set(val);
+			}
+		});
+		return bits;
+	}
+
+
+	// Modifiers
+	void add(unsigned long val) {
+		if (val > UINT32_MAX) {
+			throw "Roaring bitmap values are 32-bit!";
+		}
+		unsigned long key = val >> 16;
+		unsigned long i = find_key(key);
+		if (i == chunks_.size() || keys_.data()[i] != key) {
+			insert_chunk(i, key, new Chunk());
+		}
+		chunks_.data()[i]->add(val & 0xffff);
+	}
+
+	void remove(unsigned long val) {
+		if (val > UINT32_MAX) {
+			return;
+		}
+		unsigned long i = find_key(val >> 16);
+		if (i < chunks_.size() && keys_.data()[i] == (val >> 16)) {
+			Chunk* chunk = chunks_.data()[i];
+			chunk->remove(val & 0xffff);
+			if (chunk->cardinality == 0) {
+				erase_chunk(i);
+			}
+		}
+	}
+
+	void clear() {
+		for (unsigned long i = 0; i < chunks_.size(); i++) {
+			delete chunks_.data()[i];
+		}
+		chunks_.resize(0);
+		keys_.resize(0);
+	}
+
+	// Set operations, merging chunk by chunk on their keys
+	roaring_bitmap& operator&=(const roaring_bitmap &other) {
+		return *this = combine(*this, other, AND);
+	}
+
+	roaring_bitmap& operator|=(const roaring_bitmap &other) {
+		return *this = combine(*this, other, OR);
+	}
+
+	// Removes the members of other
+	roaring_bitmap& and_not(const roaring_bitmap &other) {
+		return *this = combine(*this, other, AND_NOT);
+	}
+
+	friend roaring_bitmap operator&(const roaring_bitmap &lhs, const roaring_bitmap &rhs) {
+		return combine(lhs, rhs, AND);
+	}
+
+	friend roaring_bitmap operator|(const roaring_bitmap &lhs, const roaring_bitmap &rhs) {
+		return combine(lhs, rhs, OR);
+	}
+
+	bool operator==(const roaring_bitmap &other) const {
+		if (chunks_.size() != other.chunks_.size()) {
+			return false;
+		}
+		for (unsigned long i = 0; i < chunks_.size(); i++) {
+			if (keys_.data()[i] != other.keys_.data()[i] || !chunks_.data()[i]->equals(*other.chunks_.data()[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	enum Op { AND, OR, AND_NOT };
+
+	// One 65536-value chunk; bits is empty while the chunk is an array
+	struct Chunk {
+		unsigned long cardinality = 0;
+		vector<uint16_t> array;
+		vector<uint64_t> bits;
+
+		bool is_bitmap() const {
+			return bits.size() != 0;
+		}
+
+		bool contains(unsigned long low) const {
+			if (is_bitmap()) {
+				return (bits.data()[low / 64] >> (low % 64)) & 1;
+			}
+			unsigned long i = lower_bound(low);
+			return i < array.size() && array.data()[i] == low;
+		}
+
+		unsigned long next(unsigned long low) const {
+			if (is_bitmap()) {
+				unsigned long w = low / 64;
+				uint64_t word = bits.data()[w] & (~0ULL << (low % 64));
+				while (word == 0) {
+					if (++w == CHUNK_WORDS) {
+						return NPOS;
+					}
+					word = bits.data()[w];
+				}
+				return w * 64 + __builtin_ctzll(word);
+			}
+			unsigned long i = lower_bound(low);
+			return i < array.size() ? array.data()[i] : NPOS;
+		}
+
+		void add(unsigned long low) {
+			if (is_bitmap()) {
+				uint64_t &word = bits.data()[low / 64];
+				cardinality += !((word >> (low % 64)) & 1);
+				word |= 1ULL << (low % 64);
+				return;
+			}
+
+			unsigned long i = lower_bound(low);
+			if (i < array.size() && array.data()[i] == low) {
+				return;
+			}
+			array.push_back(0);
+			uint16_t* data = array.data();
+			for (unsigned long j = array.size() - 1; j > i; j--) {
+				data[j] = data[j - 1];
+			}
+			data[i] = (uint16_t) low;
+			cardinality++;
+
+			if (cardinality > ARRAY_MAX) {
+				to_bitmap();
+			}
+		}
+
+		void remove(unsigned long low) {
+			if (is_bitmap()) {
+				uint64_t &word = bits.data()[low / 64];
+				cardinality -= (word >> (low % 64)) & 1;
+				word &= ~(1ULL << (low % 64));
+				if (cardinality <= ARRAY_MAX) {
+					to_array();
+				}
+				return;
+			}
+
+			unsigned long i = lower_bound(low);
+			if (i == array.size() || array.data()[i] != low) {
+				return;
+			}
+			uint16_t* data = array.data();
+			for (unsigned long j = i; j + 1 < array.size(); j++) {
+				data[j] = data[j + 1];
+			}
+			array.pop_back();
+			cardinality--;
+		}
+
+		unsigned long lower_bound(unsigned long low) const {
+			const uint16_t* data = array.data();
+			unsigned long lo = 0, hi = array.size();
+			while (lo < hi) {
+				unsigned long mid = (lo + hi) / 2;
+				if (data[mid] < low) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			return lo;
+		}
+
+		void to_bitmap() {
+			bits.resize(CHUNK_WORDS, 0);
+			for (unsigned long i = 0; i < array.size(); i++) {
+				unsigned long low = array.data()[i];
+				bits.data()[low / 64] |= 1ULL << (low % 64);
+			}
+			array = vector<uint16_t>();
+		}
+
+		void to_array() {
+			vector<uint16_t> values;
+			values.reserve(cardinality);
+			for (unsigned long w = 0; w < CHUNK_WORDS; w++) {
+				for (uint64_t word = bits.data()[w]; word != 0; word &= word - 1) {
+					values.push_back((uint16_t) (w * 64 + __builtin_ctzll(word)));
+				}
+			}
+			array = values;
+			bits = vector<uint64_t>();
+		}
+
+		// Chooses the smaller container after a bulk change to bits
+		void normalize() {
+			cardinality = bitvector::popcount(bits.data(), CHUNK_WORDS);
+			if (cardinality <= ARRAY_MAX) {
+				to_array();
+			}
+		}
+
+		bool equals(const Chunk &other) const {
+			if (cardinality != other.cardinality || is_bitmap() != other.is_bitmap()) {
+				return false;
+			}
+			const vector<uint64_t> &a = bits, &b = other.bits;
+			if (is_bitmap()) {
+				for (unsigned long w = 0; w < CHUNK_WORDS; w++) {
+					if (a.data()[w] != b.data()[w]) {
+						return false;
+					}
+				}
+				return true;
+			}
+			for (unsigned long i = 0; i < array.size(); i++) {
+				if (array.data()[i] != other.array.data()[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Bitmap words of this chunk, converting a copy of an array chunk
+		vector<uint64_t> words() const {
+			if (is_bitmap()) {
+				return bits;
+			}
+			vector<uint64_t> words(CHUNK_WORDS, 0);
+			for (unsigned long i = 0; i < array.size(); i++) {
+				unsigned long low = array.data()[i];
+				words.data()[low / 64] |= 1ULL << (low % 64);
+			}
+			return words;
+		}
+	};
+
+	vector<uint16_t> keys_;  // high 16 bits of each chunk, sorted
+	vector<Chunk*> chunks_;
+
+
+	unsigned long find_key(unsigned long key) const {
+		const uint16_t* keys = keys_.data();
+		unsigned long lo = 0, hi = keys_.size();
+		while (lo < hi) {
+			unsigned long mid = (lo + hi) / 2;
+			if (keys[mid] < key) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	void insert_chunk(unsigned long i, unsigned long key, Chunk* chunk) {
+		keys_.push_back(0);
+		chunks_.push_back(nullptr);
+		for (unsigned long j = chunks_.size() - 1; j > i; j--) {
+			keys_.data()[j] = keys_.data()[j - 1];
+			chunks_.data()[j] = chunks_.data()[j - 1];
+		}
+		keys_.data()[i] = (uint16_t) key;
+		chunks_.data()[i] = chunk;
+	}
+
+	void erase_chunk(unsigned long i) {
+		delete chunks_.data()[i];
+		for (unsigned long j = i; j + 1 < chunks_.size(); j++) {
+			keys_.data()[j] = keys_.data()[j + 1];
+			chunks_.data()[j] = chunks_.data()[j + 1];
+		}
+		keys_.pop_back();
+		chunks_.pop_back();
+	}
+
+	void append_chunk(unsigned long key, Chunk* chunk) {
+		if (chunk->cardinality == 0) {
+			delete chunk;
+			return;
+		}
+		keys_.push_back((uint16_t) key);
+		chunks_.push_back(chunk);
+	}
+
+	static Chunk* combine_chunks(const Chunk &a, const Chunk &b, Op op) {
+		Chunk* result = new Chunk();
+		if (!a.is_bitmap() && !b.is_bitmap()) {
+			// Sorted merge of two arrays
+			const uint16_t* x = a.array.data();
+			const uint16_t* y = b.array.data();
+			unsigned long i = 0, j = 0, n = a.array.size(), m = b.array.size();
+			while (i < n || j < m) {
+				if (j == m || (i < n && x[i] < y[j])) {
+					if (op != AND) {
+						result->array.push_back(x[i]);
+					}
+					i++;
+				} else if (i == n || y[j] < x[i]) {
+					if (op == OR) {
+						result->array.push_back(y[j]);
+					}
+					j++;
+				} else {
+					if (op != AND_NOT) {
+						result->array.push_back(x[i]);
+					}
+					i++;
+					j++;
+				}
+			}
+			result->cardinality = result->array.size();
+			if (result->cardinality > ARRAY_MAX) {
+				result->to_bitmap();
+			}
+			return result;
+		}
+
+		vector<uint64_t> x = a.words();
+		vector<uint64_t> y = b.words();
+		uint64_t* dst = x.data();
+		const uint64_t* src = y.data();
+		for (unsigned long w = 0; w < CHUNK_WORDS; w++) {
+			dst[w] = op == AND ? dst[w] & src[w]
+					: op == OR ? dst[w] | src[w]
+					: dst[w] & ~src[w];
+		}
+		result->bits = x;
+		result->normalize();
+		return result;
+	}
+
+	static roaring_bitmap combine(const roaring_bitmap &a, const roaring_bitmap &b, Op op) {
+		roaring_bitmap result;
+		unsigned long i = 0, j = 0, n = a.chunks_.size(), m = b.chunks_.size();
+		while (i < n || j < m) {
+			unsigned long ka = i < n ? a.keys_.data()[i] : NPOS;
+			unsigned long kb = j < m ? b.keys_.data()[j] : NPOS;
+			if (ka < kb) {
+				if (op != AND) {
+					result.append_chunk(ka, new Chunk(*a.chunks_.data()[i]));
+				}
+				i++;
+			} else if (kb < ka) {
+				if (op == OR) {
+					result.append_chunk(kb, new Chunk(*b.chunks_.data()[j]));
+				}
+				j++;
+			} else {
+				result.append_chunk(ka, combine_chunks(*a.chunks_.data()[i], *b.chunks_.data()[j], op));
+				i++;
+				j++;
+			}
+		}
+		return result;
+	}
+};
+
+
+}
+#endif
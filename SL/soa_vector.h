@@ -0,0 +1,201 @@
+// soa_vector header file
+//
+// Structure-of-arrays vector: soa_vector<unsigned int, float, float> keeps
+// each field in its own contiguous column, so a loop over one field streams
+// only that field through the cache. Growth, shrinking and the capacity of
+// every column follow SL::vector exactly. Rows are reached through a proxy
+// reference and whole columns through span.
+
+#ifndef SL_SOA_VECTOR_H
+#define SL_SOA_VECTOR_H
+
+#include "span.h"
+#include "vector.h"
+#include <tuple>
+#include <utility>
+
+namespace SL {
+
+template<class... Fields>
+class soa_vector {
+	static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+
+public:
+	typedef std::tuple<Fields...> value_type;
+
+	template<unsigned long I>
+	using field_type = typename std::tuple_element<I, value_type>::type;
+
+	class reference;
+
+
+	// Constructors
+	soa_vector() {}
+
+	soa_vector(unsigned long length, const Fields&... vals) :
+			columns_(vector<Fields>(length, vals)...) {}
+
+
+	// Capacity
+	unsigned long size() const {
+		return std::get<0>(columns_).size();
+	}
+
+	unsigned long capacity() const {
+		return std::get<0>(columns_).capacity();
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	void resize(unsigned long n) {
+		std::apply([n](vector<Fields>&... columns) { (columns.resize(n), ...); }, columns_);
+	}
+
+	void resize(unsigned long n, const Fields&... vals) {
+		resize_each(n, std::index_sequence_for<Fields...>{}, vals...);
+	}
+
+	void reserve(unsigned long n) {
+		std::apply([n](vector<Fields>&... columns) { (columns.reserve(n), ...); }, columns_);
+	}
+
+	void shrink_to_fit() {
+		std::apply([](vector<Fields>&... columns) { (columns.shrink_to_fit(), ...); }, columns_);
+	}
+
+
+	// Accessors
+	reference operator[](unsigned long index) {
+		return reference(this, index);
+	}
+
+	reference at(unsigned long index) {
+		if (index >= size()) {
+			throw "Out of range exception!";
+		}
+		return reference(this, index);
+	}
+
+	reference front() {
+		return at(0);
+	}
+
+	reference back() {
+		return at(size() - 1);
+	}
+
+	// One field of one row
+	template<unsigned long I>
+	field_type<I>& get(unsigned long index) {
+		return data<I>()[index];
+	}
+
+	template<unsigned long I>
+	const field_type<I>& get(unsigned long index) const {
+		return data<I>()[index];
+	}
+
+	// Copy of a whole row
+	value_type row(unsigned long index) const {
+		return row_at(index, std::index_sequence_for<Fields...>{});
+	}
+
+	// Start of a column; valid until the next change in capacity
+	template<unsigned long I>
+	field_type<I>* data() noexcept {
+		return std::get<I>(columns_).data();
+	}
+
+	template<unsigned long I>
+	const field_type<I>* data() const noexcept {
+		return std::get<I>(columns_).data();
+	}
+
+	template<unsigned long I>
+	span<field_type<I>> column() {
+		return span<field_type<I>>(data<I>(), size());
+	}
+
+	template<unsigned long I>
+	span<const field_type<I>> column() const {
+		return span<const field_type<I>>(data<I>(), size());
+	}
+
+
+	// Modifiers
+	void push_back(const Fields&... vals) {
+		push_back_each(std::index_sequence_for<Fields...>{}, vals...);
+	}
+
+	void push_back(const value_type& vals) {
+		std::apply([this](const Fields&... v) { push_back(v...); }, vals);
+	}
+
+	void pop_back() {
+		if (empty()) {
+			throw "Cannot pop_back on empty vector!";
+		}
+		std::apply([](vector<Fields>&... columns) { (columns.pop_back(), ...); }, columns_);
+	}
+
+
+	// Proxy for one row; reads and writes go straight to the columns
+	class reference {
+	public:
+		template<unsigned long I>
+		field_type<I>& get() const {
+			return owner_->template data<I>()[index_];
+		}
+
+		operator value_type() const {
+			return owner_->row(index_);
+		}
+
+		reference& operator=(const value_type& vals) {
+			assign(vals, std::index_sequence_for<Fields...>{});
+			return *this;
+		}
+
+		reference& operator=(const reference& other) {
+			return *this = (value_type) other;
+		}
+
+	private:
+		soa_vector* owner_;
+		unsigned long index_;
+
+		reference(soa_vector* owner, unsigned long index) : owner_(owner), index_(index) {}
+
+		template<unsigned long... I>
+		void assign(const value_type& vals, std::index_sequence<I...>) {
+			((get<I>() = std::get<I>(vals)), ...);
+		}
+
+		friend class soa_vector;
+	};
+
+private:
+	std::tuple<vector<Fields>...> columns_;
+
+
+	template<unsigned long... I>
+	void push_back_each(std::index_sequence<I...>, const Fields&... vals) {
+		(std::get<I>(columns_).push_back(vals), ...);
+	}
+
+	template<unsigned long... I>
+	void resize_each(unsigned long n, std::index_sequence<I...>, const Fields&... vals) {
+		(std::get<I>(columns_).resize(n, vals), ...);
+	}
+
+	template<unsigned long... I>
+	value_type row_at(unsigned long index, std::index_sequence<I...>) const {
+		return value_type(data<I>()[index]...);
+	}
+};
+
+
+}
+#endif
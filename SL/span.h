@@ -0,0 +1,63 @@
+// span header file
+//
+// Non-owning view of a contiguous run of elements, used to hand container
+// storage to kernels that only need a pointer and a length.
+
+#ifndef SL_SPAN_H
+#define SL_SPAN_H
+
+namespace SL {
+
+template<class T>
+class span {
+public:
+	// Constructors
+	span() : data_(nullptr), size_(0) {}
+
+	span(T* data, unsigned long size) : data_(data), size_(size) {}
+
+
+	// Iterators
+	T* begin() const {
+		return data_;
+	}
+
+	T* end() const {
+		return data_ + size_;
+	}
+
+
+	// Capacity
+	unsigned long size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+
+	// Accessors
+	T& operator[](unsigned long index) const {
+		return data_[index];
+	}
+
+	T* data() const {
+		return data_;
+	}
+
+	span subspan(unsigned long offset, unsigned long count) const {
+		if (offset > size_ || count > size_ - offset) {
+			throw "Out of range exception!";
+		}
+		return span(data_ + offset, count);
+	}
+
+private:
+	T* data_;
+	unsigned long size_;
+};
+
+
+}
+#endif
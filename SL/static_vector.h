@@ -0,0 +1,170 @@
+// static_vector header file
+//
+// Vector with a fixed inline capacity of N elements and no heap use. Every
+// operation is constexpr, so tables that are fixed once the program is
+// written (character classes, word lists) can be computed by a constexpr
+// function and baked into the binary instead of being built at startup:
+//
+//   constexpr SL::static_vector<uint8_t, 256> TABLE = make_table();
+//
+// As with SL::vector, all N slots are constructed up front, so T must be
+// default constructible; pop_back and shrinking resize leave the old
+// elements in place until they are overwritten or the vector is destroyed.
+// Growing past N throws instead of reallocating.
+
+#ifndef SL_STATIC_VECTOR_H
+#define SL_STATIC_VECTOR_H
+
+#include <initializer_list>
+
+namespace SL {
+
+template<class T, unsigned long N>
+class static_vector {
+public:
+	// Constructors
+	constexpr static_vector() : data_{}, size_(0) {}
+
+	constexpr static_vector(unsigned long length, const T &val) : data_{}, size_(0) {
+		resize(length, val);
+	}
+
+	constexpr static_vector(std::initializer_list<T> vals) : data_{}, size_(0) {
+		if (vals.size() > N) {
+			throw "Too many elements for static_vector!";
+		}
+		for (const T &val : vals) {
+			data_[size_++] = val;
+		}
+	}
+
+
+	// Iterators
+	constexpr T* begin() {
+		return data_;
+	}
+
+	constexpr T* end() {
+		return data_ + size_;
+	}
+
+	constexpr const T* begin() const {
+		return data_;
+	}
+
+	constexpr const T* end() const {
+		return data_ + size_;
+	}
+
+
+	// Capacity
+	constexpr unsigned long size() const {
+		return size_;
+	}
+
+	static constexpr unsigned long capacity() {
+		return N;
+	}
+
+	constexpr bool empty() const {
+		return size_ == 0;
+	}
+
+	constexpr bool full() const {
+		return size_ == N;
+	}
+
+	constexpr void resize(unsigned long n) {
+		resize(n, T{});
+	}
+
+	constexpr void resize(unsigned long n, const T &val) {
+		reserve(n);
+		for (unsigned long i = size_; i < n; i++) {
+			data_[i] = val;
+		}
+		size_ = n;
+	}
+
+	constexpr void reserve(unsigned long n) const {
+		if (n > N) {
+			throw "Capacity exceeded for static_vector!";
+		}
+	}
+
+	constexpr void clear() {
+		size_ = 0;
+	}
+
+
+	// Accessors
+	constexpr T& operator[](unsigned long index) {
+		return at(index);
+	}
+
+	constexpr const T& operator[](unsigned long index) const {
+		return at(index);
+	}
+
+	constexpr T& at(unsigned long index) {
+		if (index >= size_) {
+			throw "Out of range exception!";
+		}
+		return data_[index];
+	}
+
+	constexpr const T& at(unsigned long index) const {
+		if (index >= size_) {
+			throw "Out of range exception!";
+		}
+		return data_[index];
+	}
+
+	constexpr T& front() {
+		return at(0);
+	}
+
+	constexpr T& back() {
+		return at(size_ - 1);
+	}
+
+	constexpr const T& front() const {
+		return at(0);
+	}
+
+	constexpr const T& back() const {
+		return at(size_ - 1);
+	}
+
+	constexpr T* data() noexcept {
+		return data_;
+	}
+
+	constexpr const T* data() const noexcept {
+		return data_;
+	}
+
+
+	// Modifiers
+	constexpr void push_back(const T &val) {
+		if (size_ == N) {
+			throw "Cannot push_back on full static_vector!";
+		}
+		data_[size_++] = val;
+	}
+
+	constexpr void pop_back() {
+		if (empty()) {
+			throw "Cannot pop_back on empty static_vector!";
+		}
+		size_--;
+	}
+
+private:
+	T data_[N];
+	unsigned long size_;
+};
+
+
+}
+#endif
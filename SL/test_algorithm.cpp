@@ -0,0 +1,409 @@
+// Algorithm Test File
+
+#include "algorithm.h"
+#include "thread_pool.h"
+#include "vector.h"
+#include <stdio.h>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace SL;
+
+struct Posting {
+	uint32_t term;
+	uint32_t doc;
+	uint32_t seq;  // insertion order, for checking stability
+};
+
+void test_thread_pool_run();
+void test_thread_pool_exception();
+void test_thread_pool_no_workers();
+
+void test_radix_sort();
+void test_radix_sort_small_keys();
+void test_radix_sort_values();
+void test_radix_sort_by_key();
+void test_radix_sort_edges();
+
+void test_parallel_sort();
+void test_parallel_sort_compare();
+void test_parallel_sort_duplicates();
+
+void test_merge_runs();
+void test_merge_runs_stable();
+void test_merge_runs_empty();
+
+vector<uint64_t> random_keys(unsigned long count, uint64_t mask, unsigned long seed);
+template<class T, class Compare = std::less<T>>
+bool is_sorted(vector<T> &vec, Compare comp = Compare());
+template<class T>
+std::vector<T> sorted_copy(vector<T> &vec);
+
+
+int main() {
+	printf("Running algorithm test cases\n");
+
+	// Test thread_pool
+	test_thread_pool_run();
+	test_thread_pool_exception();
+	test_thread_pool_no_workers();
+
+	// Test Radix Sort
+	test_radix_sort();
+	test_radix_sort_small_keys();
+	test_radix_sort_values();
+	test_radix_sort_by_key();
+	test_radix_sort_edges();
+
+	// Test Parallel Sort
+	test_parallel_sort();
+	test_parallel_sort_compare();
+	test_parallel_sort_duplicates();
+
+	// Test Merge
+	test_merge_runs();
+	test_merge_runs_stable();
+	test_merge_runs_empty();
+
+	printf("All algorithm test cases passed!\n");
+	return 0;
+}
+
+// Testing thread_pool
+
+void test_thread_pool_run() {
+	printf("Testing thread_pool::run()\n");
+
+	thread_pool pool(3);
+	assert(pool.size() == 4);
+
+	for (int round = 0; round < 50; round++) {
+		std::vector<std::atomic<int>> hits(100);
+		pool.run(100, [&hits](unsigned long i) { hits[i]++; });
+		for (unsigned long i = 0; i < 100; i++) {
+			assert(hits[i] == 1);
+		}
+	}
+
+	// Single-task runs back to back mostly finish before the workers wake;
+	// a late worker must not pick up a finished run's job or task count
+	for (int round = 0; round < 2000; round++) {
+		int hit = 0;
+		pool.run(1, [&hit](unsigned long) { hit++; });
+		assert(hit == 1);
+	}
+
+	// Zero tasks returns straight away
+	pool.run(0, [](unsigned long) { assert(false); });
+
+	printf("Passed!\n");
+}
+
+void test_thread_pool_exception() {
+	printf("Testing thread_pool exceptions\n");
+
+	thread_pool pool(2);
+	std::atomic<int> ran{0};
+	try {
+		pool.run(20, [&ran](unsigned long i) {
+			ran++;
+			if (i == 7) {
+				throw "Task failed!";
+			}
+		});
+		assert(false);
+	} catch (const char* e) {
+	}
+	assert(ran == 20);
+
+	// The pool is still usable afterwards
+	ran = 0;
+	pool.run(5, [&ran](unsigned long) { ran++; });
+	assert(ran == 5);
+
+	printf("Passed!\n");
+}
+
+void test_thread_pool_no_workers() {
+	printf("Testing thread_pool without workers\n");
+
+	thread_pool pool(0);
+	assert(pool.size() == 1);
+	unsigned long sum = 0;
+	pool.run(10, [&sum](unsigned long i) { sum += i; });
+	assert(sum == 45);
+
+	printf("Passed!\n");
+}
+
+// Testing Radix Sort
+
+void test_radix_sort() {
+	printf("Testing radix_sort()\n");
+
+	vector<uint64_t> keys = random_keys(100000, ~0ULL, 1);
+	std::vector<uint64_t> expected = sorted_copy(keys);
+	radix_sort(keys);
+	assert(keys.size() == expected.size());
+	for (unsigned long i = 0; i < keys.size(); i++) {
+		assert(keys[i] == expected[i]);
+	}
+
+	vector<uint32_t> small;
+	for (uint32_t i = 0; i < 1000; i++) {
+		small.push_back(i * 2654435761U);
+	}
+	radix_sort(small);
+	assert(is_sorted(small));
+
+	printf("Passed!\n");
+}
+
+void test_radix_sort_small_keys() {
+	printf("Testing radix_sort() on keys using few bytes\n");
+
+	// Upper bytes are constant, so their passes are skipped; an odd number
+	// of passes leaves the result in the scratch buffer
+	for (uint64_t mask : { 0xffULL, 0xffffULL, 0xffffffULL, 0xff00ff0000ULL }) {
+		vector<uint64_t> keys = random_keys(10000, mask, mask);
+		std::vector<uint64_t> expected = sorted_copy(keys);
+		radix_sort(keys);
+		for (unsigned long i = 0; i < keys.size(); i++) {
+			assert(keys[i] == expected[i]);
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_radix_sort_values() {
+	printf("Testing radix_sort() with values\n");
+
+	vector<uint32_t> keys;
+	vector<uint32_t> values;
+	std::mt19937 rng(2);
+	for (uint32_t i = 0; i < 50000; i++) {
+		keys.push_back(rng() % 1000);
+		values.push_back(i);
+	}
+	vector<uint32_t> original(keys);
+
+	radix_sort(keys, values);
+	assert(is_sorted(keys));
+	for (unsigned long i = 0; i < keys.size(); i++) {
+		// Values follow their keys, and equal keys keep their order
+		assert(original[values[i]] == keys[i]);
+		if (i > 0 && keys[i] == keys[i - 1]) {
+			assert(values[i] > values[i - 1]);
+		}
+	}
+
+	vector<uint32_t> short_values(10, 0);
+	try {
+		radix_sort(keys, short_values);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_radix_sort_by_key() {
+	printf("Testing radix_sort_by_key()\n");
+
+	vector<Posting> postings;
+	std::mt19937 rng(3);
+	for (uint32_t i = 0; i < 50000; i++) {
+		postings.push_back({ (uint32_t) (rng() % 500), (uint32_t) (rng() % 100), i });
+	}
+
+	radix_sort_by_key(postings, [](const Posting &p) {
+		return ((uint64_t) p.term << 32) | p.doc;
+	});
+	for (unsigned long i = 1; i < postings.size(); i++) {
+		const Posting &a = postings[i - 1];
+		const Posting &b = postings[i];
+		assert(a.term < b.term || (a.term == b.term && a.doc < b.doc)
+				|| (a.term == b.term && a.doc == b.doc && a.seq < b.seq));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_radix_sort_edges() {
+	printf("Testing radix_sort() edge cases\n");
+
+	vector<uint64_t> empty;
+	radix_sort(empty);
+	assert(empty.size() == 0);
+
+	vector<uint64_t> one(1, 42);
+	radix_sort(one);
+	assert(one[0] == 42);
+
+	vector<uint16_t> same(100, 7);
+	radix_sort(same);
+	assert(same.size() == 100 && same[99] == 7);
+
+	vector<uint8_t> bytes;
+	for (int i = 255; i >= 0; i--) {
+		bytes.push_back(i);
+	}
+	radix_sort(bytes);
+	for (int i = 0; i < 256; i++) {
+		assert(bytes[i] == i);
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Parallel Sort
+
+void test_parallel_sort() {
+	printf("Testing parallel_sort()\n");
+
+	thread_pool pool(3);
+	for (unsigned long n : { 0UL, 1UL, 1000UL, 70000UL, 300000UL }) {
+		vector<uint64_t> keys = random_keys(n, ~0ULL, n);
+		std::vector<uint64_t> expected = sorted_copy(keys);
+		parallel_sort(keys, pool);
+		assert(keys.size() == n);
+		for (unsigned long i = 0; i < n; i++) {
+			assert(keys[i] == expected[i]);
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_parallel_sort_compare() {
+	printf("Testing parallel_sort() with a comparator\n");
+
+	thread_pool pool(2);
+	vector<uint64_t> keys = random_keys(200000, 0xffffff, 4);
+	parallel_sort(keys, pool, std::greater<uint64_t>());
+	assert(is_sorted(keys, std::greater<uint64_t>()));
+
+	printf("Passed!\n");
+}
+
+void test_parallel_sort_duplicates() {
+	printf("Testing parallel_sort() with duplicates\n");
+
+	thread_pool pool(3);
+	vector<uint64_t> keys = random_keys(200000, 3, 5);
+	std::vector<uint64_t> expected = sorted_copy(keys);
+	parallel_sort(keys, pool);
+	for (unsigned long i = 0; i < keys.size(); i++) {
+		assert(keys[i] == expected[i]);
+	}
+
+	vector<uint64_t> same(100000, 9);
+	parallel_sort(same, pool);
+	assert(same.size() == 100000 && same[0] == 9 && same[99999] == 9);
+
+	printf("Passed!\n");
+}
+
+// Testing Merge
+
+void test_merge_runs() {
+	printf("Testing merge_runs()\n");
+
+	std::vector<vector<uint64_t>> runs;
+	vector<span<const uint64_t>> views;
+	vector<uint64_t> all;
+	for (unsigned long r = 0; r < 13; r++) {
+		runs.push_back(random_keys(1000 + r * 37, 0xfffff, r + 10));
+		radix_sort(runs.back());
+		for (unsigned long i = 0; i < runs.back().size(); i++) {
+			all.push_back(runs.back()[i]);
+		}
+	}
+	for (vector<uint64_t> &run : runs) {
+		views.push_back(span<const uint64_t>(run.data(), run.size()));
+	}
+
+	vector<uint64_t> merged = merge_runs(views);
+	std::vector<uint64_t> expected = sorted_copy(all);
+	assert(merged.size() == expected.size());
+	for (unsigned long i = 0; i < merged.size(); i++) {
+		assert(merged[i] == expected[i]);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_merge_runs_stable() {
+	printf("Testing merge_runs() stability\n");
+
+	// Runs sorted by term only; equal terms must come out in run order
+	vector<Posting> a, b, c;
+	for (uint32_t i = 0; i < 100; i++) {
+		a.push_back({ i / 10, 0, i });
+		b.push_back({ i / 20, 1, i });
+		c.push_back({ i / 5, 2, i });
+	}
+	vector<span<const Posting>> views;
+	views.push_back(span<const Posting>(a.data(), a.size()));
+	views.push_back(span<const Posting>(b.data(), b.size()));
+	views.push_back(span<const Posting>(c.data(), c.size()));
+
+	vector<Posting> merged = merge_runs(views, [](const Posting &x, const Posting &y) {
+		return x.term < y.term;
+	});
+	assert(merged.size() == 300);
+	for (unsigned long i = 1; i < merged.size(); i++) {
+		const Posting &x = merged[i - 1];
+		const Posting &y = merged[i];
+		assert(x.term < y.term || (x.term == y.term && (x.doc < y.doc || (x.doc == y.doc && x.seq < y.seq))));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_merge_runs_empty() {
+	printf("Testing merge_runs() with empty runs\n");
+
+	vector<span<const uint64_t>> none;
+	assert(merge_runs(none).size() == 0);
+
+	vector<uint64_t> run;
+	run.push_back(1);
+	run.push_back(5);
+	vector<span<const uint64_t>> views;
+	views.push_back(span<const uint64_t>());
+	views.push_back(span<const uint64_t>(run.data(), run.size()));
+	views.push_back(span<const uint64_t>());
+	vector<uint64_t> merged = merge_runs(views);
+	assert(merged.size() == 2 && merged[0] == 1 && merged[1] == 5);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+vector<uint64_t> random_keys(unsigned long count, uint64_t mask, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	vector<uint64_t> keys;
+	keys.reserve(count);
+	for (unsigned long i = 0; i < count; i++) {
+		keys.push_back(rng() & mask);
+	}
+	return keys;
+}
+
+template<class T, class Compare>
+bool is_sorted(vector<T> &vec, Compare comp) {
+	return std::is_sorted(vec.begin(), vec.end(), comp);
+}
+
+template<class T>
+std::vector<T> sorted_copy(vector<T> &vec) {
+	std::vector<T> copy(vec.begin(), vec.end());
+	std::sort(copy.begin(), copy.end());
+	return copy;
+}
@@ -0,0 +1,292 @@
+// Arena Test File
+
+#include "arena.h"
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SL;
+
+void test_allocate();
+void test_alignment();
+void test_block_growth();
+void test_large_allocation();
+
+void test_reset();
+void test_recycle();
+void test_pool_limit();
+void test_thread_pools();
+
+void test_allocator();
+void test_allocator_containers();
+
+
+int main() {
+	printf("Running arena test cases\n");
+
+	// Test Allocation
+	test_allocate();
+	test_alignment();
+	test_block_growth();
+	test_large_allocation();
+
+	// Test Reuse
+	test_reset();
+	test_recycle();
+	test_pool_limit();
+	test_thread_pools();
+
+	// Test Allocator
+	test_allocator();
+	test_allocator_containers();
+
+	printf("All arena test cases passed!\n");
+	return 0;
+}
+
+// Testing Allocation
+
+void test_allocate() {
+	printf("Testing allocate()\n");
+
+	arena a;
+	assert(a.blocks() == 0);
+	assert(a.capacity() == 0);
+
+	// Consecutive allocations are disjoint and writable
+	std::vector<char*> chunks;
+	for (int i = 0; i < 100; i++) {
+		char* p = (char*) a.allocate(100);
+		std::memset(p, i, 100);
+		chunks.push_back(p);
+	}
+	for (int i = 0; i < 100; i++) {
+		for (int j = 0; j < 100; j++) {
+			assert(chunks[i][j] == (char) i);
+		}
+	}
+	assert(a.blocks() == 1);
+	assert(a.capacity() == arena::options().block_size);
+
+	printf("Passed!\n");
+}
+
+void test_alignment() {
+	printf("Testing alignment\n");
+
+	arena a;
+	for (unsigned long align = 1; align <= 4096; align *= 2) {
+		a.allocate(1, 1);
+		void* p = a.allocate(24, align);
+		assert((uintptr_t) p % align == 0);
+	}
+	assert((uintptr_t) a.allocate(3) % alignof(std::max_align_t) == 0);
+
+	printf("Passed!\n");
+}
+
+void test_block_growth() {
+	printf("Testing block growth\n");
+
+	// 4 MB in 1 KB pieces takes a handful of doubling blocks
+	arena a;
+	for (int i = 0; i < 4096; i++) {
+		a.allocate(1024);
+	}
+	assert(a.capacity() >= (4UL << 20));
+	assert(a.blocks() <= 8);
+	assert(a.capacity() < (16UL << 20));
+
+	printf("Passed!\n");
+}
+
+void test_large_allocation() {
+	printf("Testing allocations bigger than a block\n");
+
+	arena a;
+	a.allocate(10);
+	unsigned long big = 8 * arena::options().block_size;
+	char* p = (char*) a.allocate(big);
+	std::memset(p, 1, big);
+	assert(a.blocks() == 2);
+
+	// Beyond the large_buffer threshold the block is mapped
+	char* q = (char*) a.allocate(large_buffer::options().threshold);
+	q[0] = q[large_buffer::options().threshold - 1] = 1;
+	assert(a.blocks() == 3);
+
+	// Small allocations continue in blocks of the regular sizes
+	a.allocate(10);
+	assert(a.capacity() < 3 * large_buffer::options().threshold);
+
+	printf("Passed!\n");
+}
+
+// Testing Reuse
+
+void test_reset() {
+	printf("Testing reset()\n");
+
+	arena a;
+	std::vector<void*> first;
+	for (int i = 0; i < 1000; i++) {
+		first.push_back(a.allocate(512));
+	}
+	unsigned long capacity = a.capacity();
+	unsigned long blocks = a.blocks();
+
+	// The same allocations again land in the same memory, with no new blocks
+	arena_stats before = arena::stats();
+	for (int round = 0; round < 3; round++) {
+		a.reset();
+		for (int i = 0; i < 1000; i++) {
+			assert(a.allocate(512) == first[i]);
+		}
+	}
+	arena_stats after = arena::stats();
+	assert(after.system_blocks == before.system_blocks);
+	assert(after.recycled_blocks == before.recycled_blocks);
+	assert(a.capacity() == capacity);
+	assert(a.blocks() == blocks);
+
+	// An empty arena resets to empty
+	arena empty;
+	empty.reset();
+	assert(empty.allocate(8) != nullptr);
+
+	printf("Passed!\n");
+}
+
+void test_recycle() {
+	printf("Testing block recycling\n");
+
+	// The first arena takes its blocks from the system
+	{
+		arena a;
+		for (int i = 0; i < 1000; i++) {
+			a.allocate(512);
+		}
+		a.allocate(1UL << 20);
+	}
+	assert(arena_pool::local().cached() > 0);
+
+	// Later arenas of the same shape take them from this thread's pool
+	arena_stats before = arena::stats();
+	for (int round = 0; round < 10; round++) {
+		arena a;
+		for (int i = 0; i < 1000; i++) {
+			a.allocate(512);
+		}
+		a.allocate(1UL << 20);
+	}
+	arena_stats after = arena::stats();
+	assert(after.system_blocks == before.system_blocks);
+	assert(after.recycled_blocks > before.recycled_blocks);
+
+	printf("Passed!\n");
+}
+
+void test_pool_limit() {
+	printf("Testing pool size limit\n");
+
+	arena_options saved = arena::options();
+	arena::options().pool_bytes = 4 * arena::options().block_size;
+	{
+		arena a;
+		for (int i = 0; i < 64; i++) {
+			a.allocate(arena::options().block_size);
+		}
+	}
+	assert(arena_pool::local().cached() <= arena::options().pool_bytes);
+	arena::options() = saved;
+
+	printf("Passed!\n");
+}
+
+void test_thread_pools() {
+	printf("Testing per-thread pools\n");
+
+	// Each thread recycles through its own pool; no locks are taken
+	std::vector<std::thread> threads;
+	std::vector<unsigned long> sums(4, 0);
+	for (unsigned long t = 0; t < 4; t++) {
+		threads.emplace_back([&sums, t]() {
+			for (int round = 0; round < 100; round++) {
+				arena a;
+				unsigned long* vals = (unsigned long*) a.allocate(1000 * sizeof(unsigned long));
+				for (unsigned long i = 0; i < 1000; i++) {
+					vals[i] = i * t;
+				}
+				for (unsigned long i = 0; i < 1000; i++) {
+					sums[t] += vals[i];
+				}
+			}
+			assert(arena_pool::local().cached() > 0);
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	for (unsigned long t = 0; t < 4; t++) {
+		assert(sums[t] == 100 * t * (999 * 1000 / 2));
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Allocator
+
+void test_allocator() {
+	printf("Testing arena_allocator\n");
+
+	arena a;
+	arena b;
+	arena_allocator<int> ints(a);
+	arena_allocator<double> doubles(ints);
+	assert(ints == doubles);
+	assert(ints != arena_allocator<int>(b));
+	assert(&doubles.get_arena() == &a);
+
+	double* p = doubles.allocate(10);
+	assert((uintptr_t) p % alignof(double) == 0);
+	doubles.deallocate(p, 10);
+
+	try {
+		ints.allocate(~0UL / 2);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_allocator_containers() {
+	printf("Testing std containers in an arena\n");
+
+	arena a;
+	for (int round = 0; round < 3; round++) {
+		std::vector<int, arena_allocator<int>> vals(a);
+		for (int i = 0; i < 10000; i++) {
+			vals.push_back(10000 - i);
+		}
+		std::sort(vals.begin(), vals.end());
+		for (int i = 0; i < 10000; i++) {
+			assert(vals[i] == i + 1);
+		}
+
+		typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+		std::vector<arena_string, arena_allocator<arena_string>> words(a);
+		for (int i = 0; i < 100; i++) {
+			words.emplace_back(std::string(i, 'x').c_str(), a);
+		}
+		assert(words[99].size() == 99);
+		a.reset();
+	}
+
+	printf("Passed!\n");
+}
@@ -0,0 +1,358 @@
+// Bitvector Test File
+
+#include "bitvector.h"
+#include <stdio.h>
+#include <cassert>
+#include <random>
+#include <vector>
+
+using namespace SL;
+
+void test_basic_constr();
+void test_fill_constr();
+void test_resize();
+
+void test_set_reset();
+void test_out_of_range();
+void test_next();
+void test_count();
+void test_set_all();
+
+void test_and();
+void test_or();
+void test_and_not();
+void test_size_mismatch();
+
+void test_rank();
+void test_select();
+void test_rank_select_random();
+
+bitvector random_bits(unsigned long size, double density, unsigned long seed);
+
+
+int main() {
+	printf("Running bitvector test cases\n");
+
+	// Test Constructors
+	test_basic_constr();
+	test_fill_constr();
+	test_resize();
+
+	// Test Accessors and Modifiers
+	test_set_reset();
+	test_out_of_range();
+	test_next();
+	test_count();
+	test_set_all();
+
+	// Test Set Operations
+	test_and();
+	test_or();
+	test_and_not();
+	test_size_mismatch();
+
+	// Test rank_select
+	test_rank();
+	test_select();
+	test_rank_select_random();
+
+	printf("All bitvector test cases passed!\n");
+	return 0;
+}
+
+// Testing Constructors
+
+void test_basic_constr() {
+	printf("Testing basic constructor\n");
+
+	bitvector bits;
+	assert(bits.size() == 0);
+	assert(bits.empty());
+	assert(bits.count() == 0);
+	assert(bits.next(0) == bitvector::NPOS);
+
+	printf("Passed!\n");
+}
+
+void test_fill_constr() {
+	printf("Testing fill constructor\n");
+
+	bitvector zeros(100);
+	assert(zeros.size() == 100);
+	assert(zeros.count() == 0);
+	assert(zeros.word_count() == 2);
+
+	bitvector ones(100, true);
+	assert(ones.count() == 100);
+	for (unsigned long i = 0; i < 100; i++) {
+		assert(ones[i]);
+	}
+
+	// One bit per element
+	bitvector large(1000000);
+	assert(large.memory_bytes() == 1000000 / 8);
+
+	printf("Passed!\n");
+}
+
+void test_resize() {
+	printf("Testing resize()\n");
+
+	bitvector bits(10, true);
+	bits.resize(100, true);
+	assert(bits.count() == 100);
+
+	bits.resize(70);
+	assert(bits.count() == 70);
+
+	// Growing with zeros leaves no stale bits past the old size
+	bits.resize(200);
+	assert(bits.count() == 70);
+	assert(!bits.test(70) && !bits.test(127));
+
+	bits.resize(5);
+	bits.resize(64, true);
+	assert(bits.count() == 64);
+
+	printf("Passed!\n");
+}
+
+// Testing Accessors and Modifiers
+
+void test_set_reset() {
+	printf("Testing set()/reset()/assign()\n");
+
+	bitvector bits(130);
+	bits.set(0);
+	bits.set(63);
+	bits.set(64);
+	bits.set(129);
+	assert(bits.test(0) && bits.test(63) && bits.test(64) && bits.test(129));
+	assert(!bits.test(1) && !bits.test(128));
+	assert(bits.count() == 4);
+
+	bits.reset(63);
+	assert(!bits.test(63));
+	bits.assign(5, true);
+	bits.assign(0, false);
+	assert(bits.test(5) && !bits.test(0));
+	assert(bits.count() == 3);
+
+	assert(bits.contains(5));
+	assert(!bits.contains(6));
+	assert(!bits.contains(1000));
+
+	printf("Passed!\n");
+}
+
+void test_out_of_range() {
+	printf("Testing out of range\n");
+
+	bitvector bits(10);
+	try {
+		bits.set(10);
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		bits.test(10);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_next() {
+	printf("Testing next()\n");
+
+	bitvector bits(1000);
+	bits.set(3);
+	bits.set(64);
+	bits.set(700);
+	bits.set(999);
+
+	assert(bits.next(0) == 3);
+	assert(bits.next(3) == 3);
+	assert(bits.next(4) == 64);
+	assert(bits.next(65) == 700);
+	assert(bits.next(701) == 999);
+	assert(bits.next(1000) == bitvector::NPOS);
+
+	std::vector<unsigned long> members;
+	for (unsigned long i = bits.next(0); i != bitvector::NPOS; i = bits.next(i + 1)) {
+		members.push_back(i);
+	}
+	assert(members == std::vector<unsigned long>({ 3, 64, 700, 999 }));
+
+	printf("Passed!\n");
+}
+
+void test_count() {
+	printf("Testing count()\n");
+
+	for (unsigned long size : { 1UL, 63UL, 64UL, 65UL, 255UL, 256UL, 1000UL, 100003UL }) {
+		bitvector bits = random_bits(size, 0.3, size);
+		unsigned long expected = 0;
+		for (unsigned long i = 0; i < size; i++) {
+			expected += bits.test(i);
+		}
+		assert(bits.count() == expected);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_set_all() {
+	printf("Testing set_all()/reset_all()\n");
+
+	bitvector bits(77);
+	bits.set_all();
+	assert(bits.count() == 77);
+	assert(bits.next(76) == 76);
+	bits.reset_all();
+	assert(bits.count() == 0);
+
+	printf("Passed!\n");
+}
+
+// Testing Set Operations
+
+void test_and() {
+	printf("Testing operator&=\n");
+
+	bitvector a = random_bits(1003, 0.5, 1);
+	bitvector b = random_bits(1003, 0.5, 2);
+	bitvector c = a & b;
+	for (unsigned long i = 0; i < 1003; i++) {
+		assert(c.test(i) == (a.test(i) && b.test(i)));
+	}
+
+	a &= b;
+	assert(a == c);
+
+	printf("Passed!\n");
+}
+
+void test_or() {
+	printf("Testing operator|=\n");
+
+	bitvector a = random_bits(1003, 0.2, 3);
+	bitvector b = random_bits(1003, 0.2, 4);
+	bitvector c = a | b;
+	for (unsigned long i = 0; i < 1003; i++) {
+		assert(c.test(i) == (a.test(i) || b.test(i)));
+	}
+	assert(c != a);
+
+	printf("Passed!\n");
+}
+
+void test_and_not() {
+	printf("Testing and_not()\n");
+
+	bitvector a = random_bits(1003, 0.5, 5);
+	bitvector b = random_bits(1003, 0.5, 6);
+	bitvector c = a;
+	c.and_not(b);
+	for (unsigned long i = 0; i < 1003; i++) {
+		assert(c.test(i) == (a.test(i) && !b.test(i)));
+	}
+
+	printf("Passed!\n");
+}
+
+void test_size_mismatch() {
+	printf("Testing set operations on different sizes\n");
+
+	bitvector a(10), b(11);
+	try {
+		a &= b;
+		assert(false);
+	} catch (const char* e) {
+	}
+	assert(a != b);
+
+	printf("Passed!\n");
+}
+
+// Testing rank_select
+
+void test_rank() {
+	printf("Testing rank1()/rank0()\n");
+
+	bitvector bits(1000);
+	bits.set(0);
+	bits.set(10);
+	bits.set(600);
+	rank_select rs(bits);
+
+	assert(rs.ones() == 3);
+	assert(rs.rank1(0) == 0);
+	assert(rs.rank1(1) == 1);
+	assert(rs.rank1(10) == 1);
+	assert(rs.rank1(11) == 2);
+	assert(rs.rank1(600) == 2);
+	assert(rs.rank1(601) == 3);
+	assert(rs.rank1(1000) == 3);
+	assert(rs.rank0(1000) == 997);
+
+	try {
+		rs.rank1(1001);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_select() {
+	printf("Testing select1()\n");
+
+	bitvector bits(5000);
+	bits.set(7);
+	bits.set(513);
+	bits.set(4999);
+	rank_select rs(bits);
+
+	assert(rs.select1(0) == 7);
+	assert(rs.select1(1) == 513);
+	assert(rs.select1(2) == 4999);
+	assert(rs.select1(3) == rank_select::NPOS);
+
+	printf("Passed!\n");
+}
+
+void test_rank_select_random() {
+	printf("Testing rank_select against a scan\n");
+
+	for (double density : { 0.001, 0.1, 0.5, 0.99 }) {
+		bitvector bits = random_bits(200000, density, (unsigned long) (density * 1000));
+		rank_select rs(bits);
+
+		unsigned long rank = 0;
+		for (unsigned long i = 0; i < bits.size(); i++) {
+			assert(rs.rank1(i) == rank);
+			if (bits.test(i)) {
+				assert(rs.select1(rank) == i);
+				rank++;
+			}
+		}
+		assert(rs.ones() == rank);
+		assert(rs.rank1(bits.size()) == rank);
+	}
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+bitvector random_bits(unsigned long size, double density, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	std::bernoulli_distribution coin(density);
+	bitvector bits(size);
+	for (unsigned long i = 0; i < size; i++) {
+		bits.assign(i, coin(rng));
+	}
+	return bits;
+}
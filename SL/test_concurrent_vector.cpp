@@ -0,0 +1,311 @@
+// Concurrent Vector Test File
+
+#include "concurrent_vector.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SL;
+using SL::test::Tracked;
+
+void test_basic_constr();
+void test_fill_constr();
+
+void test_segments();
+void test_push_back();
+void test_emplace_back();
+void test_grow_by();
+void test_reserve();
+void test_at();
+void test_stable_references();
+void test_destructor();
+
+void test_concurrent_push_back();
+void test_concurrent_grow_by();
+
+
+const unsigned long THREADS = 8;
+
+
+int main() {
+	printf("Running concurrent_vector test cases\n");
+
+	// Test Constructors
+	test_basic_constr();
+	test_fill_constr();
+
+	// Test Single Thread
+	test_segments();
+	test_push_back();
+	test_emplace_back();
+	test_grow_by();
+	test_reserve();
+	test_at();
+	test_stable_references();
+	test_destructor();
+
+	// Test Concurrent Appends
+	test_concurrent_push_back();
+	test_concurrent_grow_by();
+
+	printf("All concurrent_vector test cases passed!\n");
+	return 0;
+}
+
+// Testing Constructors
+
+void test_basic_constr() {
+	printf("Testing basic constructor\n");
+
+	concurrent_vector<int> vec;
+	assert(vec.size() == 0);
+	assert(vec.empty());
+	assert(vec.capacity() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_fill_constr() {
+	printf("Testing fill constructor\n");
+
+	concurrent_vector<int> vec(1000, 5);
+	assert(vec.size() == 1000);
+	assert(vec.capacity() >= 1000);
+	for (unsigned long i = 0; i < vec.size(); i++) {
+		assert(vec[i] == 5);
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Single Thread
+
+void test_segments() {
+	printf("Testing segment_of()/segment_start()/segment_size()\n");
+
+	typedef concurrent_vector<int> cv;
+
+	// Segments tile the index space with no gaps
+	unsigned long next = 0;
+	for (unsigned long seg = 0; seg < 20; seg++) {
+		assert(cv::segment_start(seg) == next);
+		assert(cv::segment_of(next) == seg);
+		assert(cv::segment_of(next + cv::segment_size(seg) - 1) == seg);
+		next += cv::segment_size(seg);
+	}
+
+	assert(cv::segment_of(0) == 0);
+	assert(cv::segment_of(~0UL) < 64);
+
+	printf("Passed!\n");
+}
+
+void test_push_back() {
+	printf("Testing push_back()\n");
+
+	concurrent_vector<std::string> vec;
+	for (int i = 0; i < 1000; i++) {
+		assert(vec.push_back(std::to_string(i)) == (unsigned long) i);
+	}
+
+	std::string moved = "moved";
+	assert(vec.push_back(std::move(moved)) == 1000);
+
+	assert(vec.size() == 1001);
+	for (int i = 0; i < 1000; i++) {
+		assert(vec[i] == std::to_string(i));
+	}
+	assert(vec[1000] == "moved");
+
+	printf("Passed!\n");
+}
+
+void test_emplace_back() {
+	printf("Testing emplace_back()\n");
+
+	concurrent_vector<std::string> vec;
+	assert(vec.emplace_back(3, 'x') == 0);
+	assert(vec.emplace_back("abc") == 1);
+	assert(vec[0] == "xxx" && vec[1] == "abc");
+
+	printf("Passed!\n");
+}
+
+void test_grow_by() {
+	printf("Testing grow_by()\n");
+
+	concurrent_vector<int> vec;
+	assert(vec.grow_by(10) == 0);
+	assert(vec.size() == 10);
+	for (int i = 0; i < 10; i++) {
+		assert(vec[i] == 0);
+	}
+
+	// Spans several segments
+	unsigned long start = vec.grow_by(1000, 7);
+	assert(start == 10);
+	assert(vec.size() == 1010);
+	for (unsigned long i = start; i < vec.size(); i++) {
+		assert(vec[i] == 7);
+	}
+
+	assert(vec.grow_by(0) == 1010);
+	assert(vec.size() == 1010);
+
+	printf("Passed!\n");
+}
+
+void test_reserve() {
+	printf("Testing reserve()\n");
+
+	concurrent_vector<int> vec;
+	vec.reserve(0);
+	assert(vec.capacity() == 0);
+
+	vec.reserve(1000);
+	unsigned long capacity = vec.capacity();
+	assert(capacity >= 1000);
+	assert(vec.size() == 0);
+
+	vec.grow_by(1000);
+	assert(vec.capacity() == capacity);
+
+	printf("Passed!\n");
+}
+
+void test_at() {
+	printf("Testing at()\n");
+
+	concurrent_vector<int> vec;
+	vec.push_back(1);
+	assert(vec.at(0) == 1);
+	vec.at(0) = 2;
+	assert(vec[0] == 2);
+
+	try {
+		vec.at(1);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_stable_references() {
+	printf("Testing stable references\n");
+
+	concurrent_vector<int> vec;
+	vec.push_back(42);
+	int* first = &vec[0];
+	int* hundredth = nullptr;
+
+	for (int i = 1; i < 100000; i++) {
+		vec.push_back(i);
+		if (i == 100) {
+			hundredth = &vec[100];
+		}
+	}
+
+	// Growth never moves existing elements
+	assert(&vec[0] == first && *first == 42);
+	assert(&vec[100] == hundredth && *hundredth == 100);
+
+	printf("Passed!\n");
+}
+
+void test_destructor() {
+	printf("Testing ~concurrent_vector()\n");
+
+	long live = Tracked::live();
+	{
+		concurrent_vector<Tracked> vec;
+		for (int i = 0; i < 500; i++) {
+			vec.push_back(Tracked(i));
+		}
+		vec.grow_by(100);
+
+		// Only appended elements are constructed, not the whole capacity
+		assert(Tracked::live() == live + 600);
+	}
+	assert(Tracked::live() == live);
+
+	printf("Passed!\n");
+}
+
+// Testing Concurrent Appends
+
+void test_concurrent_push_back() {
+	printf("Testing concurrent push_back()\n");
+
+	const unsigned long per_thread = 50000;
+	concurrent_vector<unsigned long> vec;
+	std::vector<std::vector<unsigned long>> indices(THREADS);
+
+	std::vector<std::thread> threads;
+	for (unsigned long t = 0; t < THREADS; t++) {
+		threads.emplace_back([&, t] {
+			for (unsigned long i = 0; i < per_thread; i++) {
+				indices[t].push_back(vec.push_back(t * per_thread + i));
+			}
+		});
+	}
+	for (std::thread &t : threads) {
+		t.join();
+	}
+
+	// Every value landed exactly once, at the index its push returned
+	assert(vec.size() == THREADS * per_thread);
+	std::vector<bool> seen(THREADS * per_thread, false);
+	for (unsigned long t = 0; t < THREADS; t++) {
+		for (unsigned long i = 0; i < per_thread; i++) {
+			unsigned long val = vec[indices[t][i]];
+			assert(val == t * per_thread + i);
+			assert(!seen[val]);
+			seen[val] = true;
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+void test_concurrent_grow_by() {
+	printf("Testing concurrent grow_by()\n");
+
+	const unsigned long batches = 2000;
+	const unsigned long batch = 37;
+	concurrent_vector<unsigned long> vec;
+
+	std::vector<std::thread> threads;
+	for (unsigned long t = 0; t < THREADS; t++) {
+		threads.emplace_back([&, t] {
+			for (unsigned long b = 0; b < batches; b++) {
+				unsigned long start = vec.grow_by(batch, t);
+				// A batch is a contiguous range owned by this thread
+				for (unsigned long i = start; i < start + batch; i++) {
+					vec[i] = t * batches + b;
+				}
+			}
+		});
+	}
+	for (std::thread &t : threads) {
+		t.join();
+	}
+
+	assert(vec.size() == THREADS * batches * batch);
+	std::vector<unsigned long> count(THREADS * batches, 0);
+	for (unsigned long i = 0; i < vec.size(); i += batch) {
+		unsigned long val = vec[i];
+		for (unsigned long j = i; j < i + batch; j++) {
+			assert(vec[j] == val);
+		}
+		count[val]++;
+	}
+	for (unsigned long c : count) {
+		assert(c == 1);
+	}
+
+	printf("Passed!\n");
+}
@@ -0,0 +1,285 @@
+// Epoch Test File
+
+#include "epoch.h"
+#include <stdio.h>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace SL;
+
+void test_guard_nesting();
+void test_retire_no_readers();
+void test_retire_pinned_reader();
+void test_retire_batch();
+void test_synchronize();
+
+void test_snapshot_read();
+void test_snapshot_install();
+void test_snapshot_stress();
+
+
+// Index stand-in that poisons itself when freed, so a reader touching a
+// reclaimed snapshot fails its checks (and ASan reports it)
+struct Index {
+	static std::atomic<long> live;
+
+	long version;
+	std::vector<long> postings;
+
+	Index(long v) : version(v), postings(64, v) {
+		live++;
+	}
+
+	~Index() {
+		version = -1;
+		for (unsigned long i = 0; i < postings.size(); i++) {
+			postings[i] = -1;
+		}
+		live--;
+	}
+};
+
+std::atomic<long> Index::live{0};
+
+
+int main() {
+	printf("Running epoch test cases\n");
+
+	// Test epoch
+	test_guard_nesting();
+	test_retire_no_readers();
+	test_retire_pinned_reader();
+	test_retire_batch();
+	test_synchronize();
+
+	// Test snapshot
+	test_snapshot_read();
+	test_snapshot_install();
+	test_snapshot_stress();
+
+	printf("All epoch test cases passed!\n");
+	return 0;
+}
+
+// Testing epoch
+
+void test_guard_nesting() {
+	printf("Testing epoch_guard nesting\n");
+
+	assert(!epoch::pinned());
+	{
+		epoch_guard outer;
+		assert(epoch::pinned());
+		{
+			epoch_guard inner;
+			assert(epoch::pinned());
+		}
+		assert(epoch::pinned());
+	}
+	assert(!epoch::pinned());
+
+	printf("Passed!\n");
+}
+
+void test_retire_no_readers() {
+	printf("Testing retire() with no readers\n");
+
+	long live = Index::live;
+	epoch::retire(new Index(1));
+	assert(Index::live == live + 1);
+	assert(epoch::pending() == 1);
+
+	assert(epoch::reclaim() == 1);
+	assert(Index::live == live);
+	assert(epoch::pending() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_retire_pinned_reader() {
+	printf("Testing retire() with a pinned reader\n");
+
+	long live = Index::live;
+	std::atomic<int> stage{0};
+
+	std::thread reader([&] {
+		epoch_guard guard;
+		stage = 1;
+		while (stage != 2) {
+			std::this_thread::yield();
+		}
+	});
+	while (stage != 1) {
+		std::this_thread::yield();
+	}
+
+	// The reader pinned before the retirement, so it may hold the object
+	epoch::retire(new Index(1));
+	assert(epoch::reclaim() == 0);
+	assert(epoch::reclaim() == 0);
+	assert(Index::live == live + 1);
+
+	stage = 2;
+	reader.join();
+	assert(epoch::reclaim() == 1);
+	assert(Index::live == live);
+
+	// A thread's own pin holds back what it retires
+	{
+		epoch_guard guard;
+		epoch::retire(new Index(2));
+		assert(epoch::reclaim() == 0);
+	}
+	assert(epoch::reclaim() == 1);
+	assert(Index::live == live);
+
+	printf("Passed!\n");
+}
+
+void test_retire_batch() {
+	printf("Testing retire() batching\n");
+
+	long live = Index::live;
+	epoch::synchronize();
+
+	// Crossing the batch size reclaims without being asked
+	for (unsigned long i = 0; i < epoch::RECLAIM_BATCH; i++) {
+		epoch::retire(new Index(i));
+	}
+	assert(epoch::pending() == 0);
+	assert(Index::live == live);
+
+	printf("Passed!\n");
+}
+
+void test_synchronize() {
+	printf("Testing synchronize()\n");
+
+	long live = Index::live;
+	std::atomic<bool> pinned{false};
+
+	std::thread reader([&] {
+		epoch_guard guard;
+		pinned = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	});
+	while (!pinned) {
+		std::this_thread::yield();
+	}
+
+	epoch::retire(new Index(1));
+	epoch::synchronize();
+	assert(Index::live == live);
+	reader.join();
+
+	{
+		epoch_guard guard;
+		try {
+			epoch::synchronize();
+			assert(false);
+		} catch (const char* e) {
+		}
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing snapshot
+
+void test_snapshot_read() {
+	printf("Testing snapshot read()\n");
+
+	{
+		snapshot<Index> empty;
+		auto reader = empty.read();
+		assert(!reader);
+		assert(reader.get() == nullptr);
+	}
+
+	snapshot<Index> index(new Index(3));
+	auto reader = index.read();
+	assert(reader);
+	assert(reader->version == 3);
+	assert((*reader).postings[63] == 3);
+	assert(epoch::pinned());
+
+	printf("Passed!\n");
+}
+
+void test_snapshot_install() {
+	printf("Testing snapshot install()\n");
+
+	long live = Index::live;
+	{
+		snapshot<Index> index(new Index(1));
+		{
+			auto reader = index.read();
+			index.install(new Index(2));
+
+			// The old value survives while it is being read
+			assert(reader->version == 1);
+			assert(Index::live == live + 2);
+			assert(index.read()->version == 2);
+		}
+
+		index.install(new Index(3));
+		assert(Index::live == live + 1);
+		assert(index.read()->version == 3);
+	}
+	assert(Index::live == live);
+
+	printf("Passed!\n");
+}
+
+void test_snapshot_stress() {
+	printf("Testing snapshot with concurrent swaps\n");
+
+	const unsigned long readers = 4;
+	const unsigned long writers = 2;
+	const long swaps = 2000;
+
+	long live = Index::live;
+	{
+		snapshot<Index> index(new Index(0));
+		std::atomic<long> next_version{1};
+		std::atomic<unsigned long> writers_done{0};
+		std::atomic<unsigned long> reads{0};
+
+		std::vector<std::thread> threads;
+		for (unsigned long r = 0; r < readers; r++) {
+			threads.emplace_back([&] {
+				unsigned long count = 0;
+				while (writers_done != writers) {
+					auto reader = index.read();
+					long version = reader->version;
+					assert(version >= 0);
+					for (unsigned long i = 0; i < reader->postings.size(); i++) {
+						assert(reader->postings[i] == version);
+					}
+					count++;
+				}
+				reads += count;
+			});
+		}
+		for (unsigned long w = 0; w < writers; w++) {
+			threads.emplace_back([&] {
+				for (long i = 0; i < swaps; i++) {
+					index.install(new Index(next_version++));
+				}
+				writers_done++;
+			});
+		}
+		for (std::thread &t : threads) {
+			t.join();
+		}
+
+		epoch::synchronize();
+		assert(Index::live == live + 1);
+		assert(reads > 0);
+	}
+	assert(Index::live == live);
+
+	printf("Passed!\n");
+}
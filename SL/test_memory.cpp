@@ -0,0 +1,395 @@
+// Memory Test File
+
+#include "memory.h"
+#include "vector.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+using namespace SL;
+using SL::test::AllocScope;
+using SL::test::Tracked;
+
+void test_is_large();
+void test_allocate();
+void test_allocate_no_huge_pages();
+void test_reallocate();
+void test_numa_policy();
+
+void test_vector_large();
+void test_vector_large_growth();
+void test_vector_large_tracked();
+void test_vector_large_copy();
+
+void test_relocatable_trait();
+void test_vector_relocate_small();
+void test_vector_relocate_opt_in();
+
+
+// Not trivially copyable, but safe to move as bytes
+struct Relocated {
+	Tracked val;
+
+	Relocated() {}
+	Relocated(int v) : val(v) {}
+};
+
+template<>
+struct SL::is_trivially_relocatable<Relocated> : std::true_type {};
+
+
+const unsigned long MB = 1UL << 20;
+
+
+int main() {
+	printf("Running memory test cases\n");
+
+	// Test large_buffer
+	test_is_large();
+	test_allocate();
+	test_allocate_no_huge_pages();
+	test_reallocate();
+	test_numa_policy();
+
+	// Test vector storage
+	test_vector_large();
+	test_vector_large_growth();
+	test_vector_large_tracked();
+	test_vector_large_copy();
+
+	// Test relocation
+	test_relocatable_trait();
+	test_vector_relocate_small();
+	test_vector_relocate_opt_in();
+
+	printf("All memory test cases passed!\n");
+	return 0;
+}
+
+// Testing large_buffer
+
+void test_is_large() {
+	printf("Testing is_large()\n");
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = 4096;
+	assert(!large_buffer::is_large(0));
+	assert(!large_buffer::is_large(4095));
+	assert(large_buffer::is_large(4096));
+
+	large_buffer::options().threshold = 0;
+	assert(!large_buffer::is_large(0));
+	assert(large_buffer::is_large(1));
+
+	large_buffer::options() = saved;
+	assert(large_buffer::mapped_size(1) == large_buffer::HUGE_PAGE_SIZE);
+	assert(large_buffer::mapped_size(large_buffer::HUGE_PAGE_SIZE) == large_buffer::HUGE_PAGE_SIZE);
+
+	printf("Passed!\n");
+}
+
+void test_allocate() {
+	printf("Testing allocate()\n");
+
+	AllocScope scope;
+	unsigned long bytes = 3 * MB;
+	char* buffer = (char*) large_buffer::allocate(bytes);
+
+	assert(buffer != nullptr);
+	assert((uintptr_t) buffer % large_buffer::HUGE_PAGE_SIZE == 0);
+	for (unsigned long i = 0; i < bytes; i++) {
+		assert(buffer[i] == 0);
+	}
+	memset(buffer, 0xab, bytes);
+	large_buffer::deallocate(buffer, bytes);
+
+	// Never goes through operator new
+	assert(scope.allocations() == 0);
+
+	large_buffer::deallocate(nullptr, bytes);
+
+	printf("Passed!\n");
+}
+
+void test_allocate_no_huge_pages() {
+	printf("Testing allocate() without huge pages\n");
+
+	large_buffer_options saved = large_buffer::options();
+
+	// Reserved pages fall back to transparent ones when none are reserved
+	large_buffer::options().huge_pages = huge_page_mode::reserved;
+	char* buffer = (char*) large_buffer::allocate(5 * MB);
+	memset(buffer, 1, 5 * MB);
+	large_buffer::deallocate(buffer, 5 * MB);
+
+	large_buffer::options().huge_pages = huge_page_mode::none;
+	buffer = (char*) large_buffer::allocate(MB);
+	memset(buffer, 1, MB);
+	large_buffer::deallocate(buffer, MB);
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+void test_reallocate() {
+	printf("Testing reallocate()\n");
+
+	unsigned long count = 3 * MB / sizeof(uint32_t);
+	uint32_t* buffer = (uint32_t*) large_buffer::allocate(count * sizeof(uint32_t));
+	for (unsigned long i = 0; i < count; i++) {
+		buffer[i] = i * 2654435761u;
+	}
+
+	// Same mapping size keeps the buffer in place
+	assert(large_buffer::reallocate(buffer, count * sizeof(uint32_t), count * sizeof(uint32_t) + 1) == buffer);
+
+	uint32_t* grown = (uint32_t*) large_buffer::reallocate(buffer, count * sizeof(uint32_t), 4 * count * sizeof(uint32_t));
+	for (unsigned long i = 0; i < count; i++) {
+		assert(grown[i] == (uint32_t) (i * 2654435761u));
+	}
+	for (unsigned long i = count; i < 4 * count; i++) {
+		assert(grown[i] == 0);
+		grown[i] = i;
+	}
+
+	uint32_t* shrunk = (uint32_t*) large_buffer::reallocate(grown, 4 * count * sizeof(uint32_t), count / 2 * sizeof(uint32_t));
+	for (unsigned long i = 0; i < count / 2; i++) {
+		assert(shrunk[i] == (uint32_t) (i * 2654435761u));
+	}
+	large_buffer::deallocate(shrunk, count / 2 * sizeof(uint32_t));
+
+	printf("Passed!\n");
+}
+
+void test_numa_policy() {
+	printf("Testing numa_policy\n");
+
+	large_buffer_options saved = large_buffer::options();
+
+	const int policies[] = { MPOL_BIND, MPOL_INTERLEAVE };
+	const numa_policy modes[] = { numa_policy::bind, numa_policy::interleave };
+	for (int i = 0; i < 2; i++) {
+		large_buffer::options().numa = modes[i];
+		large_buffer::options().node_mask = 1; // node 0 exists everywhere
+		char* buffer = (char*) large_buffer::allocate(2 * MB);
+		memset(buffer, 1, 2 * MB);
+
+		int mode = -1;
+		unsigned long mask = 0;
+		long rc = syscall(SYS_get_mempolicy, &mode, &mask, sizeof(mask) * 8, buffer, MPOL_F_ADDR);
+		// Kernels without NUMA support reject both calls
+		if (rc == 0) {
+			assert(mode == policies[i]);
+			assert(mask == 1);
+		}
+		large_buffer::deallocate(buffer, 2 * MB);
+	}
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+// Testing vector storage
+
+void test_vector_large() {
+	printf("Testing vector large storage\n");
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = 4096;
+
+	{
+		vector<int> vec(MB, 7);
+		assert((uintptr_t) vec.data() % large_buffer::HUGE_PAGE_SIZE == 0);
+		for (unsigned long i = 0; i < vec.size(); i++) {
+			assert(vec[i] == 7);
+		}
+	}
+
+	{
+		// Below the threshold storage of non-relocatable types still comes
+		// from new[]
+		AllocScope scope;
+		vector<Tracked> vec(16, Tracked(7));
+		assert(scope.allocations() == 1);
+	}
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+void test_vector_large_growth() {
+	printf("Testing vector large growth\n");
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = 4096;
+
+	vector<int> vec;
+	AllocScope scope;
+	for (int i = 0; i < (int) (4 * MB); i++) {
+		vec.push_back(i);
+	}
+
+	// Small buffers grow with realloc and large ones with mremap
+	assert(scope.allocations() == 0);
+	for (int i = 0; i < (int) (4 * MB); i++) {
+		assert(vec[i] == i);
+	}
+
+	// Shrinking back below the threshold returns to new[]
+	while (vec.size() > 100) {
+		vec.pop_back();
+	}
+	assert(vec.capacity() * sizeof(int) < 4096);
+	for (int i = 0; i < 100; i++) {
+		assert(vec[i] == i);
+	}
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+void test_vector_large_tracked() {
+	printf("Testing vector large storage of non-trivial types\n");
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = 4096;
+	long live = Tracked::live();
+
+	{
+		vector<Tracked> vec;
+		for (int i = 0; i < 10000; i++) {
+			vec.push_back(i);
+		}
+		for (int i = 0; i < 10000; i++) {
+			assert(vec[i].val() == i);
+		}
+
+		// Every slot of the capacity is constructed, as with new T[]
+		assert(Tracked::live() == live + (long) vec.capacity());
+
+		vec.resize(50);
+		assert(vec[49].val() == 49);
+	}
+	assert(Tracked::live() == live);
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+void test_vector_large_copy() {
+	printf("Testing vector large copy and move\n");
+
+	large_buffer_options saved = large_buffer::options();
+	large_buffer::options().threshold = 4096;
+
+	vector<int> vec(MB, 3);
+	vector<int> copy(vec);
+	assert(copy.data() != vec.data());
+	assert(copy[MB - 1] == 3);
+
+	vector<int> small(4, 1);
+	small = vec;
+	assert(small.size() == MB && small[MB - 1] == 3);
+
+	vector<int> moved;
+	int* data = vec.data();
+	moved = std::move(vec);
+	assert(moved.data() == data);
+	assert(vec.data() == nullptr);
+
+	// Large storage replaced by small storage
+	moved = vector<int>(4, 1);
+	assert(moved.size() == 4);
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
+
+// Testing relocation
+
+void test_relocatable_trait() {
+	printf("Testing is_trivially_relocatable\n");
+
+	struct Pod { int a; double b; };
+
+	assert(is_trivially_relocatable<int>::value);
+	assert(is_trivially_relocatable<Pod>::value);
+	assert(!is_trivially_relocatable<Tracked>::value);
+	assert(is_trivially_relocatable<Relocated>::value);
+
+	printf("Passed!\n");
+}
+
+void test_vector_relocate_small() {
+	printf("Testing vector relocation of small buffers\n");
+
+	AllocScope scope;
+	{
+		vector<int> vec;
+		for (int i = 0; i < 1000; i++) {
+			vec.push_back(i);
+		}
+		for (int i = 0; i < 1000; i++) {
+			assert(vec[i] == i);
+		}
+
+		vec.resize(10);
+		assert(vec.capacity() == 10);
+		for (int i = 0; i < 10; i++) {
+			assert(vec[i] == i);
+		}
+
+		vector<int> copy(vec);
+		copy = vec;
+		assert(copy[9] == 9);
+	}
+	assert(scope.allocations() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_vector_relocate_opt_in() {
+	printf("Testing vector relocation of opted-in types\n");
+
+	large_buffer_options saved = large_buffer::options();
+	long live = Tracked::live();
+
+	for (unsigned long threshold : { 1UL << 21, 4096UL }) {
+		large_buffer::options().threshold = threshold;
+		{
+			vector<Relocated> vec;
+			Tracked::reset();
+			for (int i = 0; i < 10000; i++) {
+				vec.push_back(i);
+			}
+
+			// Each push copies its argument into place; growth copies nothing
+			assert(Tracked::copies() == 10000);
+			assert(Tracked::moves() == 0);
+			for (int i = 0; i < 10000; i++) {
+				assert(vec[i].val.val() == i);
+			}
+			assert(Tracked::live() == live + (long) vec.capacity());
+
+			while (vec.size() > 3) {
+				vec.pop_back();
+			}
+			assert(vec[2].val.val() == 2);
+			assert(Tracked::live() == live + (long) vec.capacity());
+		}
+		assert(Tracked::live() == live);
+	}
+
+	large_buffer::options() = saved;
+
+	printf("Passed!\n");
+}
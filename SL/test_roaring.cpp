@@ -0,0 +1,338 @@
+// Roaring Test File
+
+#include "roaring.h"
+#include <stdio.h>
+#include <cassert>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace SL;
+
+void test_basic_constr();
+void test_add_contains();
+void test_remove();
+void test_array_to_bitmap();
+void test_next();
+void test_for_each();
+void test_bitvector_roundtrip();
+void test_copy();
+
+void test_and();
+void test_or();
+void test_and_not();
+void test_against_set();
+void test_memory();
+
+roaring_bitmap from_set(const std::set<unsigned long> &values);
+std::set<unsigned long> to_set(const roaring_bitmap &bitmap);
+std::set<unsigned long> random_set(unsigned long count, unsigned long range, unsigned long seed);
+
+
+int main() {
+	printf("Running roaring test cases\n");
+
+	// Test Members
+	test_basic_constr();
+	test_add_contains();
+	test_remove();
+	test_array_to_bitmap();
+	test_next();
+	test_for_each();
+	test_bitvector_roundtrip();
+	test_copy();
+
+	// Test Set Operations
+	test_and();
+	test_or();
+	test_and_not();
+	test_against_set();
+	test_memory();
+
+	printf("All roaring test cases passed!\n");
+	return 0;
+}
+
+// Testing Members
+
+void test_basic_constr() {
+	printf("Testing basic constructor\n");
+
+	roaring_bitmap bitmap;
+	assert(bitmap.empty());
+	assert(bitmap.cardinality() == 0);
+	assert(!bitmap.contains(0));
+	assert(bitmap.next(0) == roaring_bitmap::NPOS);
+
+	printf("Passed!\n");
+}
+
+void test_add_contains() {
+	printf("Testing add()/contains()\n");
+
+	roaring_bitmap bitmap;
+	bitmap.add(5);
+	bitmap.add(70000);
+	bitmap.add(5);
+	bitmap.add(0xffffffffUL);
+	bitmap.add(1);
+
+	assert(bitmap.cardinality() == 4);
+	assert(bitmap.chunk_count() == 3);
+	assert(bitmap.contains(1) && bitmap.contains(5) && bitmap.contains(70000));
+	assert(bitmap.contains(0xffffffffUL));
+	assert(!bitmap.contains(2) && !bitmap.contains(65536 + 5));
+	assert(!bitmap.contains(1UL << 40));
+
+	try {
+		bitmap.add(1UL << 32);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_remove() {
+	printf("Testing remove()\n");
+
+	roaring_bitmap bitmap;
+	bitmap.add(5);
+	bitmap.add(6);
+	bitmap.add(70000);
+
+	bitmap.remove(5);
+	bitmap.remove(5);
+	bitmap.remove(12345);
+	assert(bitmap.cardinality() == 2);
+	assert(!bitmap.contains(5) && bitmap.contains(6));
+
+	// Empty chunks are dropped
+	bitmap.remove(70000);
+	assert(bitmap.chunk_count() == 1);
+	bitmap.remove(6);
+	assert(bitmap.empty());
+
+	printf("Passed!\n");
+}
+
+void test_array_to_bitmap() {
+	printf("Testing container conversion\n");
+
+	roaring_bitmap bitmap;
+	for (unsigned long i = 0; i < roaring_bitmap::ARRAY_MAX; i++) {
+		bitmap.add(i * 2);
+	}
+
+	// One past the array limit switches to 8 KB of bits
+	bitmap.add(1);
+	assert(bitmap.cardinality() == roaring_bitmap::ARRAY_MAX + 1);
+	for (unsigned long i = 0; i < roaring_bitmap::ARRAY_MAX; i++) {
+		assert(bitmap.contains(i * 2));
+	}
+	assert(bitmap.contains(1) && !bitmap.contains(3));
+
+	// And back once it drops to the limit
+	bitmap.remove(1);
+	assert(bitmap.cardinality() == roaring_bitmap::ARRAY_MAX);
+	assert(bitmap.contains(8190) && !bitmap.contains(1));
+
+	printf("Passed!\n");
+}
+
+void test_next() {
+	printf("Testing next()\n");
+
+	roaring_bitmap bitmap;
+	bitmap.add(10);
+	bitmap.add(65535);
+	bitmap.add(200000);
+	for (unsigned long i = 300000; i < 310000; i += 2) {
+		bitmap.add(i);
+	}
+
+	assert(bitmap.next(0) == 10);
+	assert(bitmap.next(10) == 10);
+	assert(bitmap.next(11) == 65535);
+	assert(bitmap.next(65536) == 200000);
+	assert(bitmap.next(200001) == 300000);
+	assert(bitmap.next(300001) == 300002);
+	assert(bitmap.next(309999) == roaring_bitmap::NPOS);
+	assert(bitmap.next(1UL << 33) == roaring_bitmap::NPOS);
+
+	printf("Passed!\n");
+}
+
+void test_for_each() {
+	printf("Testing for_each()\n");
+
+	std::set<unsigned long> values = random_set(10000, 1UL << 20, 1);
+	roaring_bitmap bitmap = from_set(values);
+
+	std::vector<unsigned long> seen;
+	bitmap.for_each([&seen](unsigned long val) { seen.push_back(val); });
+	assert(seen == std::vector<unsigned long>(values.begin(), values.end()));
+
+	printf("Passed!\n");
+}
+
+void test_bitvector_roundtrip() {
+	printf("Testing bitvector conversion\n");
+
+	bitvector bits(200000);
+	for (unsigned long i = 0; i < 200000; i += 7) {
+		bits.set(i);
+	}
+
+	roaring_bitmap bitmap(bits);
+	assert(bitmap.cardinality() == bits.count());
+	assert(bitmap.to_bitvector(200000) == bits);
+
+	printf("Passed!\n");
+}
+
+void test_copy() {
+	printf("Testing copy\n");
+
+	roaring_bitmap a = from_set(random_set(5000, 1UL << 18, 2));
+	roaring_bitmap b(a);
+	assert(a == b);
+
+	b.add(123456789);
+	assert(!(a == b));
+	assert(!a.contains(123456789));
+
+	a = b;
+	assert(a == b);
+
+	printf("Passed!\n");
+}
+
+// Testing Set Operations
+
+void test_and() {
+	printf("Testing operator&=\n");
+
+	roaring_bitmap a, b;
+	for (unsigned long i = 0; i < 100000; i += 2) {
+		a.add(i);
+	}
+	for (unsigned long i = 0; i < 100000; i += 3) {
+		b.add(i);
+	}
+	b.add(1UL << 30);
+
+	roaring_bitmap c = a & b;
+	assert(c.cardinality() == 100000 / 6 + 1);
+	for (unsigned long i = 0; i < 100000; i++) {
+		assert(c.contains(i) == (i % 6 == 0));
+	}
+
+	a &= b;
+	assert(a == c);
+
+	printf("Passed!\n");
+}
+
+void test_or() {
+	printf("Testing operator|=\n");
+
+	roaring_bitmap a, b;
+	a.add(1);
+	a.add(70000);
+	b.add(2);
+	b.add(1UL << 25);
+
+	roaring_bitmap c = a | b;
+	assert(c.cardinality() == 4);
+	assert(c.contains(1) && c.contains(2) && c.contains(70000) && c.contains(1UL << 25));
+
+	printf("Passed!\n");
+}
+
+void test_and_not() {
+	printf("Testing and_not()\n");
+
+	roaring_bitmap live, deleted;
+	for (unsigned long i = 0; i < 10000; i++) {
+		live.add(i);
+	}
+	for (unsigned long i = 0; i < 10000; i += 10) {
+		deleted.add(i);
+	}
+
+	live.and_not(deleted);
+	assert(live.cardinality() == 9000);
+	assert(!live.contains(0) && live.contains(1) && !live.contains(9990));
+
+	printf("Passed!\n");
+}
+
+void test_against_set() {
+	printf("Testing operations against std::set\n");
+
+	// Mixes of sparse and dense chunks on both sides
+	for (unsigned long seed = 0; seed < 6; seed++) {
+		std::set<unsigned long> x = random_set(seed % 2 ? 50000 : 3000, 1UL << 19, seed * 2 + 10);
+		std::set<unsigned long> y = random_set(seed % 3 ? 40000 : 2000, 1UL << 19, seed * 2 + 11);
+		roaring_bitmap a = from_set(x), b = from_set(y);
+
+		std::set<unsigned long> both, either, only;
+		for (unsigned long v : x) {
+			(y.count(v) ? both : only).insert(v);
+			either.insert(v);
+		}
+		either.insert(y.begin(), y.end());
+
+		roaring_bitmap diff(a);
+		diff.and_not(b);
+		assert(to_set(a & b) == both);
+		assert(to_set(a | b) == either);
+		assert(to_set(diff) == only);
+		assert((a & b).cardinality() == both.size());
+	}
+
+	printf("Passed!\n");
+}
+
+void test_memory() {
+	printf("Testing memory_bytes()\n");
+
+	// 1000 documents out of 10M: far below the 1.25 MB of a bitvector
+	roaring_bitmap sparse = from_set(random_set(1000, 10000000, 3));
+	assert(sparse.memory_bytes() < 10000000 / 8 / 50);
+
+	// A dense chunk stays at 8 KB instead of two bytes per member
+	roaring_bitmap dense;
+	for (unsigned long i = 0; i < 60000; i++) {
+		dense.add(i);
+	}
+	assert(dense.memory_bytes() < 60000 * 2 / 10);
+
+	printf("Passed!\n");
+}
+
+// Helper Functions
+
+roaring_bitmap from_set(const std::set<unsigned long> &values) {
+	roaring_bitmap bitmap;
+	for (unsigned long v : values) {
+		bitmap.add(v);
+	}
+	return bitmap;
+}
+
+std::set<unsigned long> to_set(const roaring_bitmap &bitmap) {
+	std::set<unsigned long> values;
+	bitmap.for_each([&values](unsigned long v) { values.insert(v); });
+	return values;
+}
+
+std::set<unsigned long> random_set(unsigned long count, unsigned long range, unsigned long seed) {
+	std::mt19937_64 rng(seed);
+	std::set<unsigned long> values;
+	while (values.size() < count) {
+		values.insert(rng() % range);
+	}
+	return values;
+}
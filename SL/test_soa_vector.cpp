@@ -0,0 +1,368 @@
+// SoA Vector Test File
+
+#include "soa_vector.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <cassert>
+#include <string>
+#include <tuple>
+
+using namespace SL;
+using SL::test::AllocScope;
+using SL::test::Tracked;
+
+typedef soa_vector<unsigned int, float, float, unsigned long> Records;
+
+void test_basic_constr();
+void test_fill_constr();
+
+void test_push_back();
+void test_pop_back();
+void test_resize();
+void test_resize_val();
+void test_reserve();
+void test_shrink_to_fit();
+void test_matches_vector();
+
+void test_index_operator();
+void test_at();
+void test_front_back();
+void test_row();
+void test_reference_assign();
+void test_column();
+void test_column_const();
+void test_allocations();
+
+
+int main() {
+	printf("Running soa_vector test cases\n");
+
+	// Test Constructors
+	test_basic_constr();
+	test_fill_constr();
+
+	// Test Capacity and Modifiers
+	test_push_back();
+	test_pop_back();
+	test_resize();
+	test_resize_val();
+	test_reserve();
+	test_shrink_to_fit();
+	test_matches_vector();
+
+	// Test Accessors
+	test_index_operator();
+	test_at();
+	test_front_back();
+	test_row();
+	test_reference_assign();
+	test_column();
+	test_column_const();
+	test_allocations();
+
+	printf("All soa_vector test cases passed!\n");
+	return 0;
+}
+
+// Testing Constructors
+
+void test_basic_constr() {
+	printf("Testing basic constructor\n");
+
+	Records records;
+	assert(records.size() == 0);
+	assert(records.capacity() == 0);
+	assert(records.empty());
+
+	printf("Passed!\n");
+}
+
+void test_fill_constr() {
+	printf("Testing fill constructor\n");
+
+	soa_vector<int, std::string> vec(4, 7, "x");
+	assert(vec.size() == 4);
+	assert(vec.capacity() == 4);
+	for (unsigned long i = 0; i < 4; i++) {
+		assert(vec.get<0>(i) == 7);
+		assert(vec.get<1>(i) == "x");
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Capacity and Modifiers
+
+void test_push_back() {
+	printf("Testing push_back()\n");
+
+	Records records;
+	for (unsigned int i = 0; i < 100; i++) {
+		records.push_back(i, i * 0.5f, 1.0f, i * 10UL);
+	}
+	records.push_back(Records::value_type(100, 50.0f, 1.0f, 1000));
+
+	assert(records.size() == 101);
+	assert(records.capacity() == 128);
+	for (unsigned int i = 0; i <= 100; i++) {
+		assert(records.get<0>(i) == i);
+		assert(records.get<1>(i) == i * 0.5f);
+		assert(records.get<3>(i) == i * 10UL);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_pop_back() {
+	printf("Testing pop_back()\n");
+
+	Records records;
+	for (unsigned int i = 0; i < 16; i++) {
+		records.push_back(i, 0, 0, 0);
+	}
+	for (int i = 0; i < 12; i++) {
+		records.pop_back();
+	}
+	assert(records.size() == 4);
+	assert(records.capacity() == 8);
+	assert(records.get<0>(3) == 3);
+
+	while (!records.empty()) {
+		records.pop_back();
+	}
+	try {
+		records.pop_back();
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_resize() {
+	printf("Testing resize()\n");
+
+	soa_vector<int, double> vec;
+	vec.resize(10);
+	assert(vec.size() == 10);
+	assert(vec.get<0>(9) == 0 && vec.get<1>(9) == 0.0);
+
+	vec.resize(3);
+	assert(vec.size() == 3);
+	assert(vec.capacity() == 3);
+
+	printf("Passed!\n");
+}
+
+void test_resize_val() {
+	printf("Testing resize(n, vals)\n");
+
+	soa_vector<int, double> vec;
+	vec.push_back(1, 1.5);
+	vec.resize(5, 2, 2.5);
+	assert(vec.size() == 5);
+	assert(vec.get<0>(0) == 1 && vec.get<1>(0) == 1.5);
+	for (unsigned long i = 1; i < 5; i++) {
+		assert(vec.get<0>(i) == 2 && vec.get<1>(i) == 2.5);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_reserve() {
+	printf("Testing reserve()\n");
+
+	Records records;
+	records.reserve(50);
+	assert(records.capacity() == 50);
+	assert(records.size() == 0);
+
+	records.reserve(10);
+	assert(records.capacity() == 50);
+
+	printf("Passed!\n");
+}
+
+void test_shrink_to_fit() {
+	printf("Testing shrink_to_fit()\n");
+
+	Records records;
+	records.reserve(100);
+	for (unsigned int i = 0; i < 10; i++) {
+		records.push_back(i, 0, 0, 0);
+	}
+	records.shrink_to_fit();
+	assert(records.capacity() == 16);
+	assert(records.get<0>(9) == 9);
+
+	printf("Passed!\n");
+}
+
+void test_matches_vector() {
+	printf("Testing capacity matches vector\n");
+
+	soa_vector<int, char> soa;
+	vector<int> vec;
+	for (int i = 0; i < 1000; i++) {
+		soa.push_back(i, 'a');
+		vec.push_back(i);
+		assert(soa.capacity() == vec.capacity());
+	}
+	for (int i = 0; i < 990; i++) {
+		soa.pop_back();
+		vec.pop_back();
+		assert(soa.capacity() == vec.capacity());
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Accessors
+
+void test_index_operator() {
+	printf("Testing operator[]\n");
+
+	Records records;
+	records.push_back(7, 0.25f, 2.0f, 99);
+
+	Records::reference row = records[0];
+	assert(row.get<0>() == 7);
+	assert(row.get<2>() == 2.0f);
+
+	row.get<1>() = 0.75f;
+	assert(records.get<1>(0) == 0.75f);
+
+	printf("Passed!\n");
+}
+
+void test_at() {
+	printf("Testing at()\n");
+
+	Records records;
+	records.push_back(1, 0, 0, 0);
+	assert(records.at(0).get<0>() == 1);
+
+	try {
+		records.at(1);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_front_back() {
+	printf("Testing front()/back()\n");
+
+	Records records;
+	records.push_back(1, 0, 0, 0);
+	records.push_back(2, 0, 0, 0);
+	assert(records.front().get<0>() == 1);
+	assert(records.back().get<0>() == 2);
+
+	printf("Passed!\n");
+}
+
+void test_row() {
+	printf("Testing row()\n");
+
+	Records records;
+	records.push_back(3, 1.5f, 2.5f, 40);
+
+	Records::value_type row = records.row(0);
+	assert(row == Records::value_type(3, 1.5f, 2.5f, 40));
+
+	Records::value_type converted = records[0];
+	assert(converted == row);
+
+	printf("Passed!\n");
+}
+
+void test_reference_assign() {
+	printf("Testing reference operator=\n");
+
+	Records records;
+	records.push_back(1, 1.0f, 1.0f, 1);
+	records.push_back(2, 2.0f, 2.0f, 2);
+
+	records[0] = Records::value_type(5, 5.0f, 5.0f, 5);
+	assert(records.row(0) == Records::value_type(5, 5.0f, 5.0f, 5));
+
+	// Assigning between rows copies values, not the proxy
+	records[1] = records[0];
+	assert(records.row(1) == Records::value_type(5, 5.0f, 5.0f, 5));
+	records.get<0>(0) = 6;
+	assert(records.get<0>(1) == 5);
+
+	printf("Passed!\n");
+}
+
+void test_column() {
+	printf("Testing column()\n");
+
+	Records records;
+	for (unsigned int i = 0; i < 100; i++) {
+		records.push_back(i, (float) i, 0, 0);
+	}
+
+	span<float> scores = records.column<1>();
+	assert(scores.size() == 100);
+	assert(scores.data() == records.data<1>());
+
+	float sum = 0;
+	for (float score : scores) {
+		sum += score;
+	}
+	assert(sum == 4950.0f);
+
+	// Columns are contiguous
+	for (unsigned long i = 0; i < 100; i++) {
+		assert(&scores[i] == records.data<1>() + i);
+	}
+
+	for (float &score : scores) {
+		score *= 2;
+	}
+	assert(records.get<1>(99) == 198.0f);
+
+	span<unsigned int> ids = records.column<0>().subspan(10, 5);
+	assert(ids.size() == 5 && ids[0] == 10);
+
+	printf("Passed!\n");
+}
+
+void test_column_const() {
+	printf("Testing column() const\n");
+
+	Records records;
+	records.push_back(4, 0.5f, 0, 0);
+	const Records &view = records;
+
+	span<const float> scores = view.column<1>();
+	assert(scores.size() == 1 && scores[0] == 0.5f);
+	assert(view.get<0>(0) == 4);
+	assert(view.data<0>() == records.data<0>());
+
+	printf("Passed!\n");
+}
+
+void test_allocations() {
+	printf("Testing allocation counts\n");
+
+	// Tracked columns are not relocatable, so their storage comes from
+	// new[] where the counter sees it
+	AllocScope scope;
+	soa_vector<Tracked, Tracked, Tracked> reserved;
+	reserved.reserve(64);
+
+	// One block per column, for the empty and the reserved storage
+	assert(scope.allocations() == 3 + 3);
+
+	AllocScope fill;
+	for (int i = 0; i < 64; i++) {
+		reserved.push_back(i, i, i);
+	}
+	assert(fill.allocations() == 0);
+
+	printf("Passed!\n");
+}
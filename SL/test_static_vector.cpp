@@ -0,0 +1,350 @@
+// Static Vector Test File
+//
+// Built as C++20 so the constexpr SL::vector cases run as well.
+
+#include "static_vector.h"
+#include "vector.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+using namespace SL;
+using SL::test::AllocScope;
+
+void test_basic_constr();
+void test_fill_constr();
+void test_list_constr();
+
+void test_push_back();
+void test_pop_back();
+void test_resize();
+void test_clear();
+
+void test_at();
+void test_front_back();
+void test_iterators();
+void test_no_heap();
+
+void test_constexpr_table();
+void test_constexpr_vector();
+
+
+int main() {
+	printf("Running static_vector test cases\n");
+
+	// Test Constructors
+	test_basic_constr();
+	test_fill_constr();
+	test_list_constr();
+
+	// Test Capacity and Modifiers
+	test_push_back();
+	test_pop_back();
+	test_resize();
+	test_clear();
+
+	// Test Accessors
+	test_at();
+	test_front_back();
+	test_iterators();
+	test_no_heap();
+
+	// Test Constant Evaluation
+	test_constexpr_table();
+	test_constexpr_vector();
+
+	printf("All static_vector test cases passed!\n");
+	return 0;
+}
+
+// Testing Constructors
+
+void test_basic_constr() {
+	printf("Testing basic constructor\n");
+
+	static_vector<int, 8> vec;
+	assert(vec.size() == 0);
+	assert(vec.capacity() == 8);
+	assert(vec.empty());
+	assert(!vec.full());
+
+	printf("Passed!\n");
+}
+
+void test_fill_constr() {
+	printf("Testing fill constructor\n");
+
+	static_vector<std::string, 8> vec(5, "x");
+	assert(vec.size() == 5);
+	for (unsigned long i = 0; i < 5; i++) {
+		assert(vec[i] == "x");
+	}
+
+	try {
+		static_vector<int, 8>(9, 0);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_list_constr() {
+	printf("Testing initializer list constructor\n");
+
+	static_vector<int, 4> vec = { 3, 1, 4 };
+	assert(vec.size() == 3);
+	assert(vec[0] == 3 && vec[1] == 1 && vec[2] == 4);
+
+	try {
+		static_vector<int, 2>({ 1, 2, 3 });
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+// Testing Capacity and Modifiers
+
+void test_push_back() {
+	printf("Testing push_back()\n");
+
+	static_vector<int, 16> vec;
+	for (int i = 0; i < 16; i++) {
+		vec.push_back(i * i);
+	}
+	assert(vec.size() == 16);
+	assert(vec.full());
+	for (int i = 0; i < 16; i++) {
+		assert(vec[i] == i * i);
+	}
+
+	try {
+		vec.push_back(0);
+		assert(false);
+	} catch (const char* e) {
+	}
+	assert(vec.size() == 16);
+
+	printf("Passed!\n");
+}
+
+void test_pop_back() {
+	printf("Testing pop_back()\n");
+
+	static_vector<int, 4> vec = { 1, 2 };
+	vec.pop_back();
+	assert(vec.size() == 1 && vec.back() == 1);
+	vec.pop_back();
+	assert(vec.empty());
+
+	try {
+		vec.pop_back();
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_resize() {
+	printf("Testing resize()\n");
+
+	static_vector<int, 10> vec;
+	vec.resize(4, 7);
+	assert(vec.size() == 4 && vec[3] == 7);
+	vec.resize(2);
+	assert(vec.size() == 2 && vec[1] == 7);
+	vec.resize(6);
+	assert(vec.size() == 6 && vec[5] == 0);
+
+	try {
+		vec.resize(11);
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		vec.reserve(11);
+		assert(false);
+	} catch (const char* e) {
+	}
+	vec.reserve(10);
+	assert(vec.size() == 6);
+
+	printf("Passed!\n");
+}
+
+void test_clear() {
+	printf("Testing clear()\n");
+
+	static_vector<int, 4> vec = { 1, 2, 3, 4 };
+	vec.clear();
+	assert(vec.empty());
+	vec.push_back(5);
+	assert(vec.size() == 1 && vec[0] == 5);
+
+	printf("Passed!\n");
+}
+
+// Testing Accessors
+
+void test_at() {
+	printf("Testing at()\n");
+
+	static_vector<int, 4> vec = { 1, 2 };
+	vec.at(1) = 9;
+	assert(vec.at(1) == 9);
+
+	try {
+		vec.at(2);
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	const static_vector<int, 4> &view = vec;
+	assert(view[0] == 1);
+	try {
+		view[2];
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_front_back() {
+	printf("Testing front() and back()\n");
+
+	static_vector<int, 4> vec = { 1, 2, 3 };
+	assert(vec.front() == 1 && vec.back() == 3);
+	vec.front() = 8;
+	assert(vec[0] == 8);
+
+	static_vector<int, 4> empty;
+	try {
+		empty.front();
+		assert(false);
+	} catch (const char* e) {
+	}
+	try {
+		empty.back();
+		assert(false);
+	} catch (const char* e) {
+	}
+
+	printf("Passed!\n");
+}
+
+void test_iterators() {
+	printf("Testing iterators\n");
+
+	static_vector<int, 8> vec = { 5, 3, 8, 1 };
+	std::sort(vec.begin(), vec.end());
+	assert(vec[0] == 1 && vec[1] == 3 && vec[2] == 5 && vec[3] == 8);
+	assert(vec.end() - vec.begin() == 4);
+	assert(vec.data() == vec.begin());
+
+	int sum = 0;
+	for (int val : vec) {
+		sum += val;
+	}
+	assert(sum == 17);
+
+	printf("Passed!\n");
+}
+
+void test_no_heap() {
+	printf("Testing static_vector never allocates\n");
+
+	AllocScope scope;
+	static_vector<std::string, 32> vec;
+	for (int i = 0; i < 32; i++) {
+		vec.push_back("");
+	}
+	vec.resize(4);
+	static_vector<std::string, 32> copy(vec);
+	assert(copy.size() == 4);
+	assert(scope.allocations() == 0);
+
+	printf("Passed!\n");
+}
+
+// Testing Constant Evaluation
+
+// Digit value of every byte, 0xff for non-digits
+constexpr static_vector<unsigned char, 256> make_digit_table() {
+	static_vector<unsigned char, 256> table(256, 0xff);
+	for (int c = '0'; c <= '9'; c++) {
+		table[c] = c - '0';
+	}
+	return table;
+}
+
+void test_constexpr_table() {
+	printf("Testing static_vector in constant evaluation\n");
+
+	// Computed by the compiler; no code runs to build it
+	constexpr static_vector<unsigned char, 256> DIGITS = make_digit_table();
+	static_assert(DIGITS.size() == 256, "table has an entry per byte");
+	static_assert(DIGITS['0'] == 0 && DIGITS['7'] == 7, "digits map to values");
+	static_assert(DIGITS['a'] == 0xff, "other bytes are not digits");
+
+	constexpr static_vector<int, 4> LIST = { 1, 2, 3 };
+	static_assert(LIST.size() == 3 && LIST.back() == 3, "list constructed at compile time");
+
+	for (int c = 0; c < 256; c++) {
+		assert(DIGITS[c] == (c >= '0' && c <= '9' ? c - '0' : 0xff));
+	}
+
+	printf("Passed!\n");
+}
+
+#ifdef SL_CONSTEXPR_VECTOR
+// Grows a vector through several reallocations, sorts it and shrinks it
+// back down; only the result outlives the evaluation
+constexpr int sorted_median(int n) {
+	vector<int> vec;
+	for (int i = 0; i < n; i++) {
+		vec.push_back((i * 37) % n);
+	}
+	std::sort(vec.begin(), vec.end());
+	vector<int> copy = vec;
+	int median = copy[n / 2];
+	while (copy.size() > 1) {
+		copy.pop_back();
+	}
+	copy.shrink_to_fit();
+	return median + (int) copy.size() - 1;
+}
+
+constexpr unsigned long distinct_lengths() {
+	vector<std::string> words;
+	const char* text[] = { "a", "bb", "cc", "ddd", "e" };
+	for (const char* word : text) {
+		words.push_back(word);
+	}
+	vector<unsigned long> lengths(4, 0);
+	for (auto itr = words.begin(); itr != words.end(); ++itr) {
+		lengths[itr->size()] = 1;
+	}
+	return lengths[1] + lengths[2] + lengths[3];
+}
+#endif
+
+void test_constexpr_vector() {
+	printf("Testing vector in constant evaluation\n");
+
+#ifdef SL_CONSTEXPR_VECTOR
+	static_assert(sorted_median(101) == 50, "constexpr vector sorts");
+	static_assert(distinct_lengths() == 3, "constexpr vector holds strings");
+	assert(sorted_median(101) == 50);
+	assert(distinct_lengths() == 3);
+#else
+	printf("Skipped: vector is constexpr only under C++20\n");
+#endif
+
+	printf("Passed!\n");
+}
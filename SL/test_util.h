@@ -0,0 +1,223 @@
+// test utility header file
+//
+// Allocation and element-operation counting for SL container tests and
+// benchmarks.
+//
+//   AllocCounter - replaces the global operator new/delete and counts
+//                  allocations, deallocations and bytes. It sees only
+//                  storage that comes from new, i.e. containers of element
+//                  types that are not trivially relocatable, such as
+//                  Tracked. Relocatable types (int, pointers, ...) get
+//                  their storage from malloc/realloc/mremap through
+//                  relocate() and large_buffer, which are not counted.
+//   Tracked      - element type counting its constructions, copies, moves
+//                  and destructions.
+//
+// Because it replaces the global allocation functions, this header must be
+// included by exactly one translation unit of each test/bench executable.
+
+#ifndef SL_TEST_UTIL_H
+#define SL_TEST_UTIL_H
+
+#include <cstdlib>
+#include <new>
+
+namespace SL {
+namespace test {
+
+struct AllocCounts {
+	unsigned long allocations;
+	unsigned long deallocations;
+	unsigned long bytes;
+
+	AllocCounts operator-(const AllocCounts &other) const {
+		return { allocations - other.allocations, deallocations - other.deallocations, bytes - other.bytes };
+	}
+};
+
+class AllocCounter {
+public:
+	static AllocCounts counts() {
+		return counts_;
+	}
+
+	static void allocated(std::size_t bytes) {
+		counts_.allocations++;
+		counts_.bytes += bytes;
+	}
+
+	static void deallocated() {
+		counts_.deallocations++;
+	}
+
+	// malloc and free behind calls the compiler cannot see through.
+	// Inlined into the replaced operator delete, the free() would be
+	// paired with every new in the program and reported by
+	// -Wmismatched-new-delete.
+	__attribute__((noinline)) static void* system_allocate(std::size_t bytes) {
+		return std::malloc(bytes ? bytes : 1);
+	}
+
+	__attribute__((noinline)) static void system_free(void* ptr) {
+		std::free(ptr);
+	}
+
+private:
+	static inline AllocCounts counts_ = { 0, 0, 0 };
+};
+
+// Counts allocations made between construction and counts()
+class AllocScope {
+public:
+	AllocScope() : start_(AllocCounter::counts()) {}
+
+	AllocCounts counts() const {
+		return AllocCounter::counts() - start_;
+	}
+
+	unsigned long allocations() const {
+		return counts().allocations;
+	}
+
+	unsigned long deallocations() const {
+		return counts().deallocations;
+	}
+
+	unsigned long bytes() const {
+		return counts().bytes;
+	}
+
+private:
+	AllocCounts start_;
+};
+
+
+struct OpCounts {
+	unsigned long constructions; // default and value constructions
+	unsigned long copies;        // copy constructions and copy assignments
+	unsigned long moves;         // move constructions and move assignments
+	unsigned long destructions;
+};
+
+class Tracked {
+public:
+	Tracked() : val_(0) {
+		counts_.constructions++;
+		live_++;
+	}
+
+	Tracked(int val) : val_(val) {
+		counts_.constructions++;
+		live_++;
+	}
+
+	Tracked(const Tracked &other) : val_(other.val_) {
+		counts_.copies++;
+		live_++;
+	}
+
+	Tracked(Tracked &&other) : val_(other.val_) {
+		counts_.moves++;
+		live_++;
+	}
+
+	Tracked& operator=(const Tracked &other) {
+		val_ = other.val_;
+		counts_.copies++;
+		return *this;
+	}
+
+	Tracked& operator=(Tracked &&other) {
+		val_ = other.val_;
+		counts_.moves++;
+		return *this;
+	}
+
+	~Tracked() {
+		counts_.destructions++;
+		live_--;
+	}
+
+	int val() const {
+		return val_;
+	}
+
+	bool operator==(const Tracked &other) const {
+		return val_ == other.val_;
+	}
+
+	static void reset() {
+		counts_ = { 0, 0, 0, 0 };
+	}
+
+	static OpCounts counts() {
+		return counts_;
+	}
+
+	static unsigned long constructions() {
+		return counts_.constructions;
+	}
+
+	static unsigned long copies() {
+		return counts_.copies;
+	}
+
+	static unsigned long moves() {
+		return counts_.moves;
+	}
+
+	static unsigned long destructions() {
+		return counts_.destructions;
+	}
+
+	// Objects constructed (any way) and not yet destroyed; not reset
+	static long live() {
+		return live_;
+	}
+
+private:
+	int val_;
+	static inline OpCounts counts_ = { 0, 0, 0, 0 };
+	static inline long live_ = 0;
+};
+
+
+}
+}
+
+
+// Global allocation functions
+
+void* operator new(std::size_t bytes) {
+	SL::test::AllocCounter::allocated(bytes);
+	void* ptr = SL::test::AllocCounter::system_allocate(bytes);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t bytes) {
+	return operator new(bytes);
+}
+
+void operator delete(void* ptr) noexcept {
+	if (ptr) {
+		SL::test::AllocCounter::deallocated();
+		SL::test::AllocCounter::system_free(ptr);
+	}
+}
+
+void operator delete[](void* ptr) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	operator delete(ptr);
+}
+
+#endif
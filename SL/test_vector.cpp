@@ -1,10 +1,15 @@
 // Vector Test File
 
 #include "vector.h"
+#include "test_util.h"
 #include <stdio.h>
 #include <cassert>
+#include <algorithm>
+#include <utility>
 
 using namespace SL;
+using SL::test::AllocScope;
+using SL::test::Tracked;
 
 void test_basic_constr();
 void test_fill_constr();
@@ -27,6 +32,7 @@ void test_iterator_deref();
 
 void test_rbegin();
 void test_rend();
+void test_iterator_random_access();
 
 void test_size();
 void test_capacity();
@@ -34,6 +40,7 @@ void test_empty();
 void test_resize();
 void test_resize_val();
 void test_reserve();
+void test_clear();
 void test_shrink_to_fit();
 
 void test_index_operator();
@@ -46,6 +53,17 @@ void test_data_const();
 void test_push_back();
 void test_pop_back();
 
+void test_counts_default_constr();
+void test_counts_fill_constr();
+void test_counts_copy_constr();
+void test_counts_copy_operator();
+void test_counts_move_operator();
+void test_counts_push_back();
+void test_counts_reserve();
+void test_counts_pop_back();
+void test_counts_iterator();
+void test_counts_no_leaks();
+
 
 enum Func { op, at, front, back };
 
@@ -84,6 +102,7 @@ int main() {
 	test_iterator_deref();
 	test_rbegin();
 	test_rend();
+	test_iterator_random_access();
 
 	// Test Capactiy
 	test_size();
@@ -92,6 +111,7 @@ int main() {
 	test_resize();
 	test_resize_val();
 	test_reserve();
+	test_clear();
 	test_shrink_to_fit();
 
 	// Test Accessors
@@ -106,6 +126,18 @@ int main() {
 	test_push_back();
 	test_pop_back();
 
+	// Test Allocation and Copy Counts
+	test_counts_default_constr();
+	test_counts_fill_constr();
+	test_counts_copy_constr();
+	test_counts_copy_operator();
+	test_counts_move_operator();
+	test_counts_push_back();
+	test_counts_reserve();
+	test_counts_pop_back();
+	test_counts_iterator();
+	test_counts_no_leaks();
+
 	printf("All vector test cases passed!\n");
 	return 0;
 }
@@ -198,8 +230,42 @@ void test_copy_operator() {
 
 void test_move_operator() {
 	printf("Testing move operator=\n");
-	
-	printf("ADD TEST\n");
+
+	{
+		unsigned long vec_capacity = 10;
+		vector<int> vec;
+		vec.reserve(vec_capacity);
+		populate_incr(vec, vec_capacity);
+		int* data = vec.data();
+
+		vector<int> moved;
+		moved = std::move(vec);
+
+		assert(moved.data() == data);
+		assert(moved.size() == vec_capacity);
+		assert(moved.capacity() == vec_capacity);
+		for (int i = 0; i < vec_capacity; i++) {
+			assert(moved[i] == i);
+		}
+
+		assert(vec.data() == nullptr);
+		assert(vec.empty());
+		assert(vec.capacity() == 0);
+
+		// A moved-from vector is still usable
+		vec.push_back(1);
+		assert(vec.size() == 1 && vec[0] == 1);
+	}
+
+	{
+		vector<int> vec(4, 1);
+		vector<int> other(2, 2);
+		vec = other;
+		assert(vec.size() == 2 && vec[0] == 2 && vec[1] == 2);
+
+		vec = vec;
+		assert(vec.size() == 2 && vec[0] == 2);
+	}
 
 	printf("Passed!\n");
 }
@@ -574,6 +640,57 @@ void test_rend() {
 	printf("Passed!\n");
 }
 
+void test_iterator_random_access() {
+	printf("Testing random access iterator\n");
+
+	{
+		vector<int> vec;
+		populate_incr(vec, 10);
+
+		auto itr = vec.begin();
+		assert(vec.end() - itr == 10);
+		assert(*(itr + 3) == 3);
+		assert(itr[7] == 7);
+		itr += 5;
+		assert(*itr-- == 5);
+		assert(*itr == 4);
+		assert(itr < vec.end() && vec.begin() <= itr && !(itr > vec.end()));
+
+		*itr = 40;
+		assert(vec[4] == 40);
+	}
+
+	{
+		vector<int> vec;
+		populate_incr(vec, 10);
+
+		auto itr = vec.rbegin();
+		assert(vec.rend() - itr == 10);
+		assert(*(itr + 2) == 7);
+		assert(itr < vec.rend());
+	}
+
+	{
+		vector<int> vec;
+		for (int i = 0; i < 1000; i++) {
+			vec.push_back(i * 7919 % 1000);
+		}
+
+		std::sort(vec.begin(), vec.end());
+		for (int i = 0; i < 1000; i++) {
+			assert(vec[i] == i);
+		}
+
+		// Sorting through reverse iterators gives descending order
+		std::sort(vec.rbegin(), vec.rend());
+		for (int i = 0; i < 1000; i++) {
+			assert(vec[i] == 999 - i);
+		}
+	}
+
+	printf("Passed!\n");
+}
+
 // Testing Capacity
 
 void test_size() {
@@ -829,6 +946,44 @@ void test_reserve() {
 	printf("Passed!\n");
 }
 
+void test_clear() {
+	printf("Testing clear()\n");
+
+	{
+		vector<int> vec;
+		vec.clear();
+		assert(vec.empty());
+		assert(vec.capacity() == default_cap);
+	}
+
+	{
+		vector<int> vec;
+		populate_incr(vec, 35);
+		assert(vec.capacity() == 64);
+
+		// Storage stays for the next fill
+		vec.clear();
+		assert(vec.empty());
+		assert(vec.capacity() == 64);
+		populate_incr(vec, 35);
+		assert(vec.capacity() == 64);
+		for (int i = 0; i < 35; i++) {
+			assert(vec[i] == i);
+		}
+	}
+
+	{
+		vector<Tracked> vec(10, Tracked(3));
+		vec.clear();
+		assert(vec.size() == 0);
+		assert(vec.capacity() == 10);
+		vec.push_back(Tracked(4));
+		assert(vec.size() == 1 && vec[0].val() == 4);
+	}
+
+	printf("Passed!\n");
+}
+
 void test_shrink_to_fit() {
 	printf("Testing shrink_to_fit()\n");
 
@@ -1093,6 +1248,246 @@ void test_pop_back() {
 	printf("Passed!\n");
 }
 
+// Testing Allocation and Copy Counts
+//
+// These pin down exactly how much work each operation does, so a change
+// that adds an allocation or an element copy fails here first.
+
+void test_counts_default_constr() {
+	printf("Testing counts of vector()\n");
+
+	Tracked::reset();
+	AllocScope scope;
+	{
+		vector<Tracked> vec;
+		assert(scope.allocations() == 1);
+		assert(Tracked::constructions() == 0);
+	}
+	assert(scope.deallocations() == 1);
+	assert(Tracked::destructions() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_counts_fill_constr() {
+	printf("Testing counts of vector(length, val)\n");
+
+	Tracked::reset();
+	AllocScope scope;
+	{
+		vector<Tracked> vec(10, Tracked(7));
+
+		// val itself, then 10 default constructed slots assigned from it
+		assert(scope.allocations() == 1);
+		assert(scope.bytes() >= 10 * sizeof(Tracked));
+		assert(Tracked::constructions() == 11);
+		assert(Tracked::copies() == 10);
+		assert(Tracked::moves() == 0);
+		assert(Tracked::destructions() == 1);
+	}
+	assert(Tracked::destructions() == 11);
+	assert(scope.deallocations() == 1);
+
+	printf("Passed!\n");
+}
+
+void test_counts_copy_constr() {
+	printf("Testing counts of vector(const vector&)\n");
+
+	vector<Tracked> original(10, Tracked(7));
+
+	Tracked::reset();
+	AllocScope scope;
+	vector<Tracked> copy(original);
+
+	assert(scope.allocations() == 1);
+	assert(Tracked::constructions() == 10);
+	assert(Tracked::copies() == 10);
+	assert(Tracked::destructions() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_counts_copy_operator() {
+	printf("Testing counts of copy operator=\n");
+
+	vector<Tracked> source(10, Tracked(7));
+	vector<Tracked> dest(4, Tracked(1));
+
+	Tracked::reset();
+	AllocScope scope;
+	dest = source;
+
+	assert(scope.allocations() == 1);
+	assert(scope.deallocations() == 1);
+	assert(Tracked::constructions() == 10);
+	assert(Tracked::copies() == 10);
+	assert(Tracked::destructions() == 4);
+
+	printf("Passed!\n");
+}
+
+void test_counts_move_operator() {
+	printf("Testing counts of move operator=\n");
+
+	vector<Tracked> source(10, Tracked(7));
+	vector<Tracked> dest(4, Tracked(1));
+
+	Tracked::reset();
+	AllocScope scope;
+	dest = std::move(source);
+
+	// Steals the buffer: nothing is allocated, copied or moved
+	assert(scope.allocations() == 0);
+	assert(scope.deallocations() == 1);
+	assert(Tracked::constructions() == 0);
+	assert(Tracked::copies() == 0);
+	assert(Tracked::moves() == 0);
+	assert(Tracked::destructions() == 4);
+
+	printf("Passed!\n");
+}
+
+void test_counts_push_back() {
+	printf("Testing counts of push_back()\n");
+
+	{
+		vector<Tracked> vec;
+
+		Tracked::reset();
+		AllocScope scope;
+		for (int i = 0; i < 16; i++) {
+			vec.push_back(i);
+		}
+
+		// Capacity 0 -> 1 -> 2 -> 4 -> 8 -> 16. Each growth default
+		// constructs the new capacity (1 + 2 + 4 + 8 + 16 = 31), copies the
+		// old elements (0 + 1 + 2 + 4 + 8 = 15) and destroys the old
+		// capacity (15). Each push constructs its argument, copies it into
+		// place and destroys it.
+		assert(scope.allocations() == 5);
+		assert(scope.deallocations() == 5);
+		assert(Tracked::constructions() == 31 + 16);
+		assert(Tracked::copies() == 15 + 16);
+		assert(Tracked::moves() == 0);
+		assert(Tracked::destructions() == 15 + 16);
+	}
+
+	{
+		vector<Tracked> vec;
+		vec.reserve(1);
+		Tracked val(3);
+
+		Tracked::reset();
+		AllocScope scope;
+		vec.push_back(val);
+
+		// Copied into the by-value argument, then copied into place
+		assert(scope.allocations() == 0);
+		assert(Tracked::copies() == 2);
+		assert(Tracked::destructions() == 1);
+	}
+
+	printf("Passed!\n");
+}
+
+void test_counts_reserve() {
+	printf("Testing counts of reserve()\n");
+
+	vector<Tracked> vec;
+
+	Tracked::reset();
+	AllocScope scope;
+	vec.reserve(16);
+
+	assert(scope.allocations() == 1);
+	assert(Tracked::constructions() == 16);
+	assert(Tracked::copies() == 0);
+
+	for (int i = 0; i < 16; i++) {
+		vec.push_back(i);
+	}
+	assert(scope.allocations() == 1);
+	assert(Tracked::constructions() == 32);
+	assert(Tracked::copies() == 16);
+
+	printf("Passed!\n");
+}
+
+void test_counts_pop_back() {
+	printf("Testing counts of pop_back()\n");
+
+	vector<Tracked> vec;
+	vec.reserve(16);
+	for (int i = 0; i < 16; i++) {
+		vec.push_back(i);
+	}
+
+	Tracked::reset();
+	AllocScope scope;
+	for (int i = 0; i < 12; i++) {
+		vec.pop_back();
+	}
+
+	// Only the shrink from 16 to 8 at size 4 does any element work
+	assert(vec.capacity() == 8);
+	assert(scope.allocations() == 1);
+	assert(scope.deallocations() == 1);
+	assert(Tracked::constructions() == 8);
+	assert(Tracked::copies() == 4);
+	assert(Tracked::destructions() == 16);
+
+	printf("Passed!\n");
+}
+
+void test_counts_iterator() {
+	printf("Testing counts of Iterator*()\n");
+
+	vector<Tracked> vec(10, Tracked(1));
+
+	Tracked::reset();
+	AllocScope scope;
+	int sum = 0;
+	for (auto itr = vec.begin(); itr != vec.end(); itr++) {
+		sum += (*itr).val();
+	}
+
+	// Dereferencing returns a reference to the element
+	assert(sum == 10);
+	assert(scope.allocations() == 0);
+	assert(Tracked::copies() == 0);
+	assert(Tracked::destructions() == 0);
+
+	printf("Passed!\n");
+}
+
+void test_counts_no_leaks() {
+	printf("Testing counts balance\n");
+
+	long live = Tracked::live();
+	AllocScope scope;
+	{
+		vector<Tracked> vec;
+		for (int round = 0; round < 5; round++) {
+			for (int i = 0; i < 100; i++) {
+				vec.push_back(i);
+			}
+			vector<Tracked> copy(vec);
+			copy.resize(37);
+			vec.resize(250, Tracked(round));
+			vec.shrink_to_fit();
+			vec = copy;
+			while (!vec.empty()) {
+				vec.pop_back();
+			}
+		}
+	}
+	assert(Tracked::live() == live);
+	assert(scope.allocations() == scope.deallocations());
+
+	printf("Passed!\n");
+}
+
 // Helper Functions
 
 template<class T>
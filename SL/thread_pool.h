@@ -0,0 +1,154 @@
+// thread_pool header file
+//
+// Fixed set of worker threads for fork-join loops. run(tasks, f) calls
+// f(0) ... f(tasks - 1) on the workers and the calling thread and returns
+// once every call has finished, rethrowing the first exception any call
+// threw. One run() executes at a time; concurrent callers queue up.
+
+#ifndef SL_THREAD_POOL_H
+#define SL_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SL {
+
+class thread_pool {
+public:
+	// Constructors
+
+	// One worker per hardware thread besides the caller
+	thread_pool() : thread_pool(std::max(std::thread::hardware_concurrency(), 1U) - 1) {}
+
+	explicit thread_pool(unsigned long workers) {
+		for (unsigned long i = 0; i < workers; i++) {
+			threads_.emplace_back(&thread_pool::worker, this);
+		}
+	}
+
+	thread_pool(const thread_pool &) = delete;
+	thread_pool& operator=(const thread_pool &) = delete;
+
+
+	// Destructor
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread &t : threads_) {
+			t.join();
+		}
+	}
+
+
+	// Capacity
+
+	// Threads taking part in run(), including the caller
+	unsigned long size() const {
+		return threads_.size() + 1;
+	}
+
+
+	// Modifiers
+	template<class F>
+	void run(unsigned long tasks, F f) {
+		std::lock_guard<std::mutex> serial(run_mutex_);
+		std::function<void(unsigned long)> job = [&f](unsigned long i) { f(i); };
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_ = job;
+			tasks_ = tasks;
+			next_.store(0, std::memory_order_relaxed);
+			error_ = nullptr;
+			generation_++;
+			busy_++;
+		}
+		wake_.notify_all();
+
+		work(job, tasks);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		busy_--;
+		done_.wait(lock, [this] { return busy_ == 0; });
+		job_ = nullptr;
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+	}
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex run_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+
+	// Guarded by mutex_
+	std::function<void(unsigned long)> job_;
+	unsigned long tasks_ = 0;
+	unsigned long generation_ = 0;
+	unsigned long busy_ = 0;   // threads inside the current job, run() waits for 0
+	bool stop_ = false;
+	std::exception_ptr error_;
+
+	std::atomic<unsigned long> next_{0};
+
+
+	void worker() {
+		unsigned long seen = 0;
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true) {
+			wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+			if (stop_) {
+				return;
+			}
+			seen = generation_;
+			if (!job_) {
+				// Woke after the run it was signalled for had finished
+				continue;
+			}
+			// Copied under the lock, so work() shares nothing but next_
+			std::function<void(unsigned long)> job = job_;
+			unsigned long tasks = tasks_;
+			busy_++;
+			lock.unlock();
+
+			work(job, tasks);
+
+			lock.lock();
+			if (--busy_ == 0) {
+				done_.notify_all();
+			}
+		}
+	}
+
+	// Claims task indices until none are left
+	void work(const std::function<void(unsigned long)> &job, unsigned long tasks) {
+		while (true) {
+			unsigned long i = next_.fetch_add(1, std::memory_order_relaxed);
+			if (i >= tasks) {
+				return;
+			}
+			try {
+				job(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+			}
+		}
+	}
+};
+
+
+}
+#endif
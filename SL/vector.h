@@ -1,8 +1,29 @@
 // vector header file
+//
+// Under C++20 vector can also be used in constant evaluation: a constexpr
+// function may build, sort and search a vector like any other, as long as
+// the vector is gone before the evaluation ends. Copy what should outlive
+// it into a static_vector. While constant evaluating, storage always comes
+// from new[]; large buffers and byte relocation are runtime only.
 
 #ifndef SL_VECTOR_H
 #define SL_VECTOR_H
 
+#include "memory.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+#if __cpp_constexpr_dynamic_alloc >= 201907L && __cpp_lib_is_constant_evaluated >= 201811L
+#define SL_CONSTEXPR_VECTOR 1
+#define SL_CONSTEXPR20 constexpr
+#else
+#define SL_CONSTEXPR20
+#endif
+
 namespace SL {
 
 template<class T> 
@@ -11,55 +32,76 @@ public:
 	class Iterator;
 
 	// Constructors
-	vector() {
+	SL_CONSTEXPR20 vector() {
 		capacity_ = 0;
 		size_ = 0;
-		data_ = new T[capacity_];
+		data_ = allocate_data(capacity_, large_);
 	}
 
-	vector(const vector &v) {
+	SL_CONSTEXPR20 vector(const vector &v) {
 		capacity_ = v.capacity_;
 		size_ = v.size_;
-		data_ = new T[capacity_];
+		data_ = allocate_data(capacity_, large_);
 
-		for (int i = 0; i < size_; i++) {
+		for (unsigned long i = 0; i < size_; i++) {
 			data_[i] = v.data_[i];
 		}		
 	}
 
-	vector(unsigned long length, T val) {
+	SL_CONSTEXPR20 vector(unsigned long length, T val) {
 		capacity_ = length;
 		size_ = length;
-		data_ = new T[capacity_];
+		data_ = allocate_data(capacity_, large_);
 
-		for (int i = 0; i < size_; i++) {
+		for (unsigned long i = 0; i < size_; i++) {
 			data_[i] = val;
 		}
 	}
 
 
 	// Equals Operator
-	vector& operator=(const vector& other) { // copy
-		delete[] data_;
-		this->vector(other);
+	SL_CONSTEXPR20 vector& operator=(const vector& other) { // copy
+		if (this == &other) {
+			return *this;
+		}
+
+		bool temp_large;
+		T* temp_data = allocate_data(other.capacity_, temp_large);
+		for (unsigned long i = 0; i < other.size_; i++) {
+			temp_data[i] = other.data_[i];
+		}
+
+		free_data(data_, capacity_, large_);
+		data_ = temp_data;
+		large_ = temp_large;
+		size_ = other.size_;
+		capacity_ = other.capacity_;
+		return *this;
 	}
 
-	vector& operator=(vector&& other) { // move
-		delete[] data_;
+	SL_CONSTEXPR20 vector& operator=(vector&& other) { // move
+		if (this == &other) {
+			return *this;
+		}
+
+		free_data(data_, capacity_, large_);
 
 		data_ = other.data_;
 		size_ = other.size_;
 		capacity_ = other.capacity_;
+		large_ = other.large_;
 
 		other.data_ = nullptr;
 		other.capacity_ = 0;
-		other.size = 0;
+		other.size_ = 0;
+		other.large_ = false;
+		return *this;
 	}
 
 
 	// Destructor
-	~vector() {
-		delete[] data_;
+	SL_CONSTEXPR20 ~vector() {
+		free_data(data_, capacity_, large_);
 		data_ = nullptr;
 		size_ = 0;
 		capacity_ = 0;
@@ -67,19 +109,19 @@ public:
 
 
 	// Iterators
-	Iterator begin() {
+	SL_CONSTEXPR20 Iterator begin() {
 		return Iterator(data_, capacity_, 0);
 	}
 
-	Iterator end() {
+	SL_CONSTEXPR20 Iterator end() {
 		return Iterator(data_, capacity_, size_);
 	}
 
-	Iterator rbegin() {
+	SL_CONSTEXPR20 Iterator rbegin() {
 		return Iterator(data_, capacity_, size_ - 1, true);
 	}
 
-	Iterator rend() {
+	SL_CONSTEXPR20 Iterator rend() {
 		return Iterator(data_, capacity_, -1, true);
 	}
 
@@ -92,24 +134,24 @@ public:
 
 
 	// Capacity
-	unsigned long size() {
+	SL_CONSTEXPR20 unsigned long size() const {
 		return size_;
 	}
 	
-	unsigned long capacity() {
+	SL_CONSTEXPR20 unsigned long capacity() const {
 		return capacity_;
 	}
 	
-	bool empty() {
+	SL_CONSTEXPR20 bool empty() const {
 		return size_ == 0;
 	}
 
-	void resize(unsigned long n) {
+	SL_CONSTEXPR20 void resize(unsigned long n) {
 		T def_val = T{};
 		resize(n, def_val);
 	}
 
-	void resize(unsigned long n, const T& val) {
+	SL_CONSTEXPR20 void resize(unsigned long n, const T& val) {
 		if (n < size_) {
 			size_ = n;
 			update_capacity(n);
@@ -119,7 +161,7 @@ public:
 				update_capacity(n);
 			}
 			
-			for (int i = size_; i < n; i++) {
+			for (unsigned long i = size_; i < n; i++) {
 				data_[i] = val;
 			}
 
@@ -127,13 +169,19 @@ public:
 		}
 	}
 
-	void reserve(unsigned long n) {
+	SL_CONSTEXPR20 void reserve(unsigned long n) {
 		if (n > capacity_) {
 			update_capacity(n);
 		}
 	}
 
-	void shrink_to_fit() {
+	// Empties the vector but keeps its storage for reuse, where resize(0)
+	// would release it
+	SL_CONSTEXPR20 void clear() {
+		size_ = 0;
+	}
+
+	SL_CONSTEXPR20 void shrink_to_fit() {
 		if (capacity_ > 0 && size_ <= capacity_ - capacity_ / OPTIMIZATION_FACTOR) {			
 			unsigned long lower_bound = lowest_higher_factor(size_);
 			if (lower_bound < capacity_) {
@@ -144,11 +192,11 @@ public:
 
 
 	// Accessors
-	T& operator[](unsigned long index) {
+	SL_CONSTEXPR20 T& operator[](unsigned long index) {
 		return vector<T>::at(index);
 	}
 
-	T& at(unsigned long index) {
+	SL_CONSTEXPR20 T& at(unsigned long index) {
 		if (index >= size_) {
 			// TODO: Should swap out with exception class
 			throw "Out of range exception!";
@@ -156,25 +204,25 @@ public:
 		return data_[index];		
 	}
 
-	T& front() {
+	SL_CONSTEXPR20 T& front() {
 		return vector<T>::at(0);
 	}
 
-	T& back() {
+	SL_CONSTEXPR20 T& back() {
 		return vector<T>::at(size_ - 1);
 	}
 
-	T* data() noexcept {
+	SL_CONSTEXPR20 T* data() noexcept {
 		return data_;
 	}
 
-	const T* data() const noexcept {
+	SL_CONSTEXPR20 const T* data() const noexcept {
 		return data_;
 	}
 
 
 	// Modifiers
-	void push_back(T val) {
+	SL_CONSTEXPR20 void push_back(T val) {
 		if (size_ == capacity_) {
 			// need to update capacity
 			vector<T>::increase_capacity();
@@ -183,7 +231,7 @@ public:
 		size_++;
 	}
 
-	void pop_back() {
+	SL_CONSTEXPR20 void pop_back() {
 		if (empty()) {
 			throw "Cannot pop_back on empty vector!";
 		}
@@ -192,28 +240,74 @@ public:
 	}
 
 
+	// Random access, so SL::vector can be handed to std::sort and friends
 	class Iterator {
 	public:
-		Iterator() : data_(nullptr), capacity_(0), index_(0), reverse_(false) {}
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef long difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+
+		SL_CONSTEXPR20 Iterator() : data_(nullptr), capacity_(0), index_(0), reverse_(false) {}
 
 		// Pre increment op
 		//increment before doing op
 
-		Iterator& operator++() {
-			index_ += reverse_ ? -1 : 1;
+		SL_CONSTEXPR20 Iterator& operator++() {
+			index_ += step();
 			return *this;
 		}
 
 		// Post increment
 		// increment after doing op
 
-		Iterator operator++(int) {
+		SL_CONSTEXPR20 Iterator operator++(int) {
+			Iterator temp(data_, capacity_, index_, reverse_);
+			index_ += step();
+			return temp;
+		}
+
+		SL_CONSTEXPR20 Iterator& operator--() {
+			index_ -= step();
+			return *this;
+		}
+
+		SL_CONSTEXPR20 Iterator operator--(int) {
 			Iterator temp(data_, capacity_, index_, reverse_);
-			index_ += reverse_ ? -1 : 1;
+			index_ -= step();
 			return temp;
 		}
 
-		bool operator==(const Iterator &other) {
+		SL_CONSTEXPR20 Iterator& operator+=(long n) {
+			index_ += n * step();
+			return *this;
+		}
+
+		SL_CONSTEXPR20 Iterator& operator-=(long n) {
+			index_ -= n * step();
+			return *this;
+		}
+
+		SL_CONSTEXPR20 Iterator operator+(long n) const {
+			Iterator temp(*this);
+			return temp += n;
+		}
+
+		friend SL_CONSTEXPR20 Iterator operator+(long n, const Iterator &itr) {
+			return itr + n;
+		}
+
+		SL_CONSTEXPR20 Iterator operator-(long n) const {
+			Iterator temp(*this);
+			return temp -= n;
+		}
+
+		SL_CONSTEXPR20 long operator-(const Iterator &other) const {
+			return (long) (index_ - other.index_) * step();
+		}
+
+		SL_CONSTEXPR20 bool operator==(const Iterator &other) const {
 			if (reverse_ != other.reverse_) {
 				throw "Cannot compare normal iterator with reverse iterator";
 			}
@@ -223,29 +317,57 @@ public:
 					&& index_ == other.index_;
 		}
 
-		bool operator!=(const Iterator &other) {
+		SL_CONSTEXPR20 bool operator!=(const Iterator &other) const {
 			return !(*this == other);
 		}
 
-		T operator*() {
+		SL_CONSTEXPR20 bool operator<(const Iterator &other) const {
+			return *this - other < 0;
+		}
+
+		SL_CONSTEXPR20 bool operator>(const Iterator &other) const {
+			return other < *this;
+		}
+
+		SL_CONSTEXPR20 bool operator<=(const Iterator &other) const {
+			return !(other < *this);
+		}
+
+		SL_CONSTEXPR20 bool operator>=(const Iterator &other) const {
+			return !(*this < other);
+		}
+
+		SL_CONSTEXPR20 T& operator*() const {
 			if (data_ == nullptr || index_ >= capacity_) {
 				throw "Dereferencing vector iterator out of bounds";
 			}
 			return data_[index_];
 		}
 
+		SL_CONSTEXPR20 T* operator->() const {
+			return &**this;
+		}
+
+		SL_CONSTEXPR20 T& operator[](long n) const {
+			return *(*this + n);
+		}
+
 	private:
 		unsigned long capacity_;
 		unsigned long index_;
 		bool reverse_;
 		T* data_;
 
-		Iterator(T* data, unsigned long capacity, unsigned long index) : 
+		SL_CONSTEXPR20 Iterator(T* data, unsigned long capacity, unsigned long index) : 
 				capacity_(capacity), index_(index), reverse_(false), data_(data) {}
 
-		Iterator(T* data, unsigned long capacity, unsigned long index, bool reverse) : 
+		SL_CONSTEXPR20 Iterator(T* data, unsigned long capacity, unsigned long index, bool reverse) : 
 				capacity_(capacity), index_(index), reverse_(reverse), data_(data) {}
 
+		SL_CONSTEXPR20 long step() const {
+			return reverse_ ? -1 : 1;
+		}
+
 		friend class vector;
 	};
 
@@ -258,19 +380,20 @@ private:
 	unsigned long capacity_;
 	unsigned long size_;
 	T *data_;
+	bool large_; // data_ comes from large_buffer rather than new[]
 
 
-	void increase_capacity() {
+	SL_CONSTEXPR20 void increase_capacity() {
 		update_capacity(lowest_higher_factor(capacity_));
 	}
 
-	void prune_capacity() {
+	SL_CONSTEXPR20 void prune_capacity() {
 		if (capacity_ > LOWEST_SIZE && size_ <= capacity_/ (UPDATE_FACTOR*UPDATE_FACTOR)) {
 			update_capacity(capacity_ / UPDATE_FACTOR);
 		}
 	}
 
-	unsigned long lowest_higher_factor(unsigned long val) {
+	SL_CONSTEXPR20 unsigned long lowest_higher_factor(unsigned long val) {
 		unsigned long lower_bound = LOWEST_SIZE;
 		while (lower_bound <= val) {
 			lower_bound *= UPDATE_FACTOR;
@@ -278,16 +401,129 @@ private:
 		return lower_bound;
 	}
 
-	void update_capacity(unsigned long new_capacity) {
-		capacity_ = new_capacity;
+	SL_CONSTEXPR20 void update_capacity(unsigned long new_capacity) {
+		if constexpr (is_trivially_relocatable<T>::value) {
+			if (!constant_evaluated()) {
+				relocate(new_capacity);
+				return;
+			}
+		}
 
-		T* temp_data = new T[capacity_];
+		bool temp_large;
+		T* temp_data = allocate_data(new_capacity, temp_large);
 
-		for (int i = 0; i < size_; i++) {
+		for (unsigned long i = 0; i < size_; i++) {
 			temp_data[i] = data_[i];
 		}
-		delete[] data_;
+		free_data(data_, capacity_, large_);
 		data_ = temp_data;
+		capacity_ = new_capacity;
+		large_ = temp_large;
+	}
+
+	// Moves the elements as bytes: realloc between small buffers, mremap
+	// between large ones, so a growing buffer extends in place whenever the
+	// memory after it is free and otherwise never holds two copies of the
+	// data for longer than the move itself
+	void relocate(unsigned long new_capacity) {
+		unsigned long old_bytes = capacity_ * sizeof(T);
+		unsigned long new_bytes = new_capacity * sizeof(T);
+		bool new_large = large_buffer::is_large(new_bytes);
+
+		destroy_slots(data_, new_capacity, capacity_);
+		if (!large_ && !new_large) {
+			T* temp_data = (T*) std::realloc((void*) data_, new_bytes ? new_bytes : 1);
+			if (temp_data == nullptr) {
+				throw "Vector allocation failed!";
+			}
+			data_ = temp_data;
+		} else if (large_ && new_large) {
+			data_ = (T*) large_buffer::reallocate(data_, old_bytes, new_bytes);
+		} else {
+			T* temp_data = (T*) allocate_bytes(new_bytes, new_large);
+			std::memcpy((void*) temp_data, (void*) data_, std::min(old_bytes, new_bytes));
+			free_bytes(data_, old_bytes, large_);
+			data_ = temp_data;
+		}
+		construct_slots(data_, capacity_, new_capacity);
+
+		capacity_ = new_capacity;
+		large_ = new_large;
+	}
+
+	// Storage of every capacity is fully constructed, as with new T[]. It
+	// comes from new[] unless it is large or holds relocatable elements,
+	// which need storage that can be moved as bytes.
+	static SL_CONSTEXPR20 T* allocate_data(unsigned long capacity, bool &large) {
+		if (constant_evaluated()) {
+			large = false;
+			return new T[capacity];
+		}
+
+		large = large_buffer::is_large(capacity * sizeof(T));
+		if (!large && !is_trivially_relocatable<T>::value) {
+			return new T[capacity];
+		}
+
+		T* data = (T*) allocate_bytes(capacity * sizeof(T), large);
+		construct_slots(data, 0, capacity);
+		return data;
+	}
+
+	static SL_CONSTEXPR20 void free_data(T* data, unsigned long capacity, bool large) {
+		if (constant_evaluated() || (!large && !is_trivially_relocatable<T>::value)) {
+			delete[] data;
+			return;
+		}
+
+		if (data != nullptr) {
+			destroy_slots(data, 0, capacity);
+		}
+		free_bytes(data, capacity * sizeof(T), large);
+	}
+
+	static constexpr bool constant_evaluated() {
+#ifdef SL_CONSTEXPR_VECTOR
+		return std::is_constant_evaluated();
+#else
+		return false;
+#endif
+	}
+
+	static void* allocate_bytes(unsigned long bytes, bool large) {
+		if (large) {
+			return large_buffer::allocate(bytes);
+		}
+
+		void* data = std::malloc(bytes ? bytes : 1);
+		if (data == nullptr) {
+			throw "Vector allocation failed!";
+		}
+		return data;
+	}
+
+	static void free_bytes(void* data, unsigned long bytes, bool large) {
+		if (large) {
+			large_buffer::deallocate(data, bytes);
+		} else {
+			std::free(data);
+		}
+	}
+
+	static void construct_slots(T* data, unsigned long from, unsigned long to) {
+		if (!std::is_trivially_default_constructible<T>::value) {
+			for (unsigned long i = from; i < to; i++) {
+				new (data + i) T();
+			}
+		}
+	}
+
+	static void destroy_slots(T* data, unsigned long from, unsigned long to) {
+		if (!std::is_trivially_destructible<T>::value) {
+			for (unsigned long i = from; i < to; i++) {
+				data[i].~T();
+			}
+		}
 	}
 
 };